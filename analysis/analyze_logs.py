@@ -3,18 +3,26 @@
 
 The RTP log is expected to contain columns: timestamp, bitrate_bps, fps.
 The SCTP log should contain columns: traffic_name, timestamp, size_bytes, latency_ms.
+When a log has a traffic_name column, each traffic profile row is also
+reported on its own.
 """
 
 import csv
 import math
 import statistics
 import sys
-from typing import List, Tuple
+from collections import defaultdict
+from typing import Dict, List, Tuple
 
 
-def _load_numeric(reader: csv.DictReader, field: str) -> List[float]:
+def _load_rows(path: str) -> List[dict]:
+    with open(path, newline="") as f:
+        return list(csv.DictReader(f))
+
+
+def _load_numeric(rows: List[dict], field: str) -> List[float]:
     values = []
-    for row in reader:
+    for row in rows:
         try:
             values.append(float(row.get(field, 0)))
         except ValueError:
@@ -22,13 +30,17 @@ def _load_numeric(reader: csv.DictReader, field: str) -> List[float]:
     return values
 
 
-def analyze_rtp(path: str) -> Tuple[Tuple[float, float], Tuple[float, float]]:
-    with open(path, newline="") as f:
-        reader = csv.DictReader(f)
-        bitrates = _load_numeric(reader, "bitrate_bps")
-        f.seek(0)
-        reader = csv.DictReader(f)
-        fps = _load_numeric(reader, "fps")
+def _by_name(rows: List[dict]) -> Dict[str, List[dict]]:
+    groups = defaultdict(list)
+    for row in rows:
+        if row.get("traffic_name"):
+            groups[row["traffic_name"]].append(row)
+    return groups
+
+
+def analyze_rtp(rows: List[dict]) -> Tuple[Tuple[float, float], Tuple[float, float]]:
+    bitrates = _load_numeric(rows, "bitrate_bps")
+    fps = _load_numeric(rows, "fps")
     return _avg_tail(bitrates), _avg_tail(fps)
 
 
@@ -41,13 +53,9 @@ def _avg_tail(values: List[float]) -> Tuple[float, float]:
     return avg, tail
 
 
-def analyze_sctp(path: str):
-    with open(path, newline="") as f:
-        reader = csv.DictReader(f)
-        latency = _load_numeric(reader, "latency_ms")
-        f.seek(0)
-        reader = csv.DictReader(f)
-        bandwidth = _load_numeric(reader, "size_bytes")
+def analyze_sctp(rows: List[dict]):
+    latency = _load_numeric(rows, "latency_ms")
+    bandwidth = _load_numeric(rows, "size_bytes")
     sla = sum(1 for l in latency if l <= 100) / len(latency) if latency else 0
     lat_avg, lat_std = _avg_std(latency)
     bw_avg, bw_std = _avg_std(bandwidth)
@@ -64,17 +72,27 @@ def main(argv):
     if len(argv) != 3:
         print("Usage: analyze_logs.py <rtp_log.csv> <sctp_log.csv>")
         return 1
-    rtp_stats = analyze_rtp(argv[1])
-    sctp_stats = analyze_sctp(argv[2])
+    rtp_rows = _load_rows(argv[1])
+    sctp_rows = _load_rows(argv[2])
+    rtp_stats = analyze_rtp(rtp_rows)
+    sctp_stats = analyze_sctp(sctp_rows)
     print("RTP bitrate avg={:.2f}bps tail95={:.2f}bps".format(*rtp_stats[0]))
     print("RTP fps     avg={:.2f}fps tail95={:.2f}fps".format(*rtp_stats[1]))
     sla, lat, bw = sctp_stats
     print("SCTP SLA satisfaction={:.2%}".format(sla))
     print("SCTP latency avg={:.2f}ms std={:.2f}ms".format(lat[0], lat[1]))
     print("SCTP bandwidth avg={:.2f}B std={:.2f}B".format(bw[0], bw[1]))
+
+    for name, rows in sorted(_by_name(rtp_rows).items()):
+        (br, _), (fps, _) = analyze_rtp(rows)
+        print("[{}] RTP bitrate avg={:.2f}bps fps avg={:.2f}fps".format(
+            name, br, fps))
+    for name, rows in sorted(_by_name(sctp_rows).items()):
+        sla, lat, _ = analyze_sctp(rows)
+        print("[{}] SCTP SLA satisfaction={:.2%} latency avg={:.2f}ms "
+              "std={:.2f}ms".format(name, sla, lat[0], lat[1]))
     return 0
 
 
 if __name__ == "__main__":
     sys.exit(main(sys.argv))
-
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Summarize the receiver's frame_timing.csv.
+
+frame_timing.csv is written by FrameTimingLogger (examples/peerconnection/
+client/frame_timing_info.h) with one row per decoded frame. For each track
+this prints end-to-end (capture to decoded frame, from the RTCP-synced NTP
+capture time) and decode latency percentiles over every frame whose
+e2e_ms is known, plus frame size and QP averages.
+
+With --pacing, the sender's frame_pacing*.csv files (written by
+FileVideoSource, examples/peerconnection/client/file_video_source.h) are
+summarized too: insert lateness percentiles and skipped frames. Lateness is
+the capture-side part of e2e_ms; whatever remains is network, jitter buffer
+and decode.
+"""
+
+import argparse
+import csv
+import sys
+from collections import defaultdict
+
+PERCENTILES = (50, 90, 95, 99, 99.9)
+
+
+def _percentile(sorted_values, pct):
+    if not sorted_values:
+        return float("nan")
+    index = min(int(len(sorted_values) * pct / 100.0), len(sorted_values) - 1)
+    return sorted_values[index]
+
+
+def _mean(values):
+    return sum(values) / len(values) if values else float("nan")
+
+
+def _summarize_pacing(path):
+    lateness = []
+    skipped = 0
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            lateness.append(int(row["lateness_us"]) / 1000.0)
+            skipped += int(row["skipped"])
+    lateness.sort()
+    print(f"{path}: {len(lateness)} frames inserted, {skipped} skipped")
+    cells = ", ".join(f"p{p}={_percentile(lateness, p):.3f}"
+                      for p in PERCENTILES)
+    print(f"  lateness_ms: {cells}, "
+          f"max={lateness[-1] if lateness else float('nan'):.3f}")
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("csv", help="frame_timing.csv")
+    parser.add_argument("--pacing", action="append", default=[],
+                        metavar="CSV",
+                        help="sender frame_pacing.csv; may be repeated")
+    args = parser.parse_args(argv)
+
+    tracks = defaultdict(lambda: defaultdict(list))
+    with open(args.csv, newline="") as f:
+        for row in csv.DictReader(f):
+            track = tracks[row["track"]]
+            track["frames"].append(1)
+            e2e = int(row["e2e_ms"])
+            if e2e >= 0:
+                track["e2e"].append(e2e)
+            decode = int(row["decode_finish"]) - int(row["decode_start"])
+            track["decode"].append(decode)
+            track["size"].append(int(row["frame_size"]))
+            if int(row["qp"]) >= 0:
+                track["qp"].append(int(row["qp"]))
+
+    for name in sorted(tracks, key=int):
+        track = tracks[name]
+        print(f"track {name}: {len(track['frames'])} frames, "
+              f"{len(track['e2e'])} with e2e")
+        for metric in ("e2e", "decode"):
+            values = sorted(track[metric])
+            cells = ", ".join(f"p{p}={_percentile(values, p)}"
+                              for p in PERCENTILES)
+            print(f"  {metric}_ms: {cells}, max={values[-1] if values else 'nan'}")
+        print(f"  frame_size avg={_mean(track['size']):.0f} B, "
+              f"qp avg={_mean(track['qp']):.1f}")
+    for path in args.pacing:
+        _summarize_pacing(path)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -5,9 +5,15 @@ CSV=""
 SERVER="localhost"
 PORT=8888
 CLIENT="./peerconnection_client"
+ROOM="bench$$"
+DURATION=60
+LOCAL_RECEIVER=1
+SESSIONS=1
 
 usage() {
-  echo "Usage: $0 --csv <file> [--server <host>] [--port <port>]" >&2
+  echo "Usage: $0 --csv <file> [--server <host>] [--port <port>]" \
+       "[--room <id>] [--duration <s>] [--sessions <n>]" \
+       "[--no-local-receiver]" >&2
   exit 1
 }
 
@@ -19,6 +25,14 @@ while [[ $# -gt 0 ]]; do
       SERVER="$2"; shift 2;;
     --port)
       PORT="$2"; shift 2;;
+    --room)
+      ROOM="$2"; shift 2;;
+    --duration)
+      DURATION="$2"; shift 2;;
+    --sessions)
+      SESSIONS="$2"; shift 2;;
+    --no-local-receiver)
+      LOCAL_RECEIVER=0; shift;;
     *)
       usage;;
   esac
@@ -28,5 +42,33 @@ if [[ -z "$CSV" ]]; then
   usage
 fi
 
-$CLIENT --traffic_csv="$CSV" --server="$SERVER" --port="$PORT"
-python3 "$(dirname "$0")/analyze_logs.py" rtp_log.csv sctp_log.csv
+# Both peers log under webrtc_logs/<date>_<room>/{sender,receiver}, or
+# webrtc_logs/<date>_<room>/session_<i>/{sender,receiver} with --sessions.
+# The sender runs every row of the profile; the receiver records SCTP
+# latency.
+DATE=$(date +%Y-%m-%d_%H-%M-%S)
+LOG_DIR="webrtc_logs/${DATE}_${ROOM}"
+COMMON=(--server="$SERVER" --port="$PORT" --room_id="$ROOM"
+        --log_date="$DATE" --headless=true --num_sessions="$SESSIONS")
+
+if [[ $LOCAL_RECEIVER -eq 1 ]]; then
+  timeout "$DURATION" $CLIENT "${COMMON[@]}" --is_sender=false &
+  RECEIVER_PID=$!
+fi
+timeout "$DURATION" $CLIENT "${COMMON[@]}" --is_sender=true \
+    --traffic_csv="$CSV" || true
+if [[ -n "$RECEIVER_PID" ]]; then
+  wait "$RECEIVER_PID" || true
+fi
+
+if [[ $SESSIONS -eq 1 ]]; then
+  python3 "$(dirname "$0")/analyze_logs.py" "$LOG_DIR/sender/rtp_log.csv" \
+      "$LOG_DIR/receiver/sctp_log.csv"
+else
+  for ((i = 0; i < SESSIONS; i++)); do
+    echo "== session $i =="
+    python3 "$(dirname "$0")/analyze_logs.py" \
+        "$LOG_DIR/session_$i/sender/rtp_log.csv" \
+        "$LOG_DIR/session_$i/receiver/sctp_log.csv" || true
+  done
+fi
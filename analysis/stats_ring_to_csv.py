@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Convert the receiver's stats_ring.bin into CSV.
+
+The ring is written by StatsRingFile (examples/peerconnection/client/
+stats_ring_file.h): a header followed by fixed-size InboundRtpRecord slots.
+Records are emitted oldest first; fields the stats report did not carry are
+-1.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+MAGIC = b"WRTCSTR1"
+HEADER = struct.Struct("<8sIIQQ")
+
+# (name, struct code) in InboundRtpRecord order.
+FIELDS = [
+    ("timestamp_us", "q"),
+    ("ssrc", "q"),
+    ("frames_received", "q"),
+    ("frames_decoded", "q"),
+    ("frames_dropped", "q"),
+    ("key_frames_decoded", "q"),
+    ("frame_width", "q"),
+    ("frame_height", "q"),
+    ("frames_per_second", "d"),
+    ("jitter_buffer_delay_s", "d"),
+    ("jitter_buffer_emitted_count", "q"),
+    ("total_decode_time_s", "d"),
+    ("min_playout_delay_s", "d"),
+    ("jitter_s", "d"),
+    ("bytes_received", "q"),
+    ("header_bytes_received", "q"),
+    ("packets_received", "q"),
+    ("packets_lost", "q"),
+    ("packets_discarded", "q"),
+    ("fec_packets_received", "q"),
+    ("fec_packets_discarded", "q"),
+    ("fec_bytes_received", "q"),
+    ("retransmitted_packets_received", "q"),
+    ("retransmitted_bytes_received", "q"),
+    ("nack_count", "q"),
+    ("pli_count", "q"),
+    ("freeze_count", "q"),
+    ("total_freezes_duration_s", "d"),
+    ("remote_bytes_sent", "q"),
+    ("remote_packets_sent", "q"),
+    ("remote_round_trip_time_s", "d"),
+]
+RECORD = struct.Struct("<" + "".join(code for _, code in FIELDS))
+
+
+def read_records(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, record_size, capacity, count = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != 1:
+        raise ValueError("{} is not a version 1 stats ring".format(path))
+    if record_size != RECORD.size:
+        raise ValueError("record size {} does not match this script ({})".format(
+            record_size, RECORD.size))
+    first = max(0, count - capacity)
+    for index in range(first, count):
+        offset = HEADER.size + (index % capacity) * record_size
+        yield RECORD.unpack_from(data, offset)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("ring", help="Path to stats_ring.bin")
+    parser.add_argument("-o", "--output", help="Output CSV (default: stdout)")
+    args = parser.parse_args(argv[1:])
+
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    try:
+        writer = csv.writer(out)
+        writer.writerow([name for name, _ in FIELDS])
+        for record in read_records(args.ring):
+            writer.writerow(record)
+    finally:
+        if out is not sys.stdout:
+            out.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
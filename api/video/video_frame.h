@@ -57,6 +57,11 @@ class RTC_EXPORT VideoFrame {
     bool is_keyframe = false;
     VideoFrameType frame_type =
         VideoFrameType::kEmptyFrame;
+
+    // Full decoder-side timing of this frame, including the sender
+    // timestamps when it carried the video-timing extension.
+    TimingFrameInfo timing_info;
+    int qp = -1;  // -1 if the decoder did not report one.
   };
 
   // Add getter/setter for the timing info
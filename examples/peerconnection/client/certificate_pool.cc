@@ -0,0 +1,62 @@
+#include "examples/peerconnection/client/certificate_pool.h"
+
+#include <optional>
+#include <utility>
+
+#include "rtc_base/logging.h"
+#include "rtc_base/rtc_certificate_generator.h"
+
+namespace {
+rtc::scoped_refptr<rtc::RTCCertificate> Generate() {
+  return rtc::RTCCertificateGenerator::GenerateCertificate(
+      rtc::KeyParams(rtc::KT_DEFAULT), std::nullopt);
+}
+}  // namespace
+
+CertificatePool::CertificatePool(size_t target_size)
+    : target_size_(target_size), worker_([this] { RefillLoop(); }) {}
+
+CertificatePool::~CertificatePool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  refill_.notify_all();
+  worker_.join();
+}
+
+rtc::scoped_refptr<rtc::RTCCertificate> CertificatePool::Take() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ready_.empty()) {
+      rtc::scoped_refptr<rtc::RTCCertificate> certificate =
+          std::move(ready_.front());
+      ready_.pop_front();
+      refill_.notify_one();
+      return certificate;
+    }
+  }
+  RTC_LOG(LS_INFO) << "Certificate pool empty, generating inline";
+  refill_.notify_one();
+  return Generate();
+}
+
+void CertificatePool::RefillLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_) {
+    if (ready_.size() >= target_size_) {
+      refill_.wait(lock);
+      continue;
+    }
+    lock.unlock();
+    rtc::scoped_refptr<rtc::RTCCertificate> certificate = Generate();
+    lock.lock();
+    if (!certificate) {
+      RTC_LOG(LS_ERROR) << "Certificate generation failed";
+      // Leave it to Take()'s inline fallback rather than spinning.
+      refill_.wait(lock);
+      continue;
+    }
+    ready_.push_back(std::move(certificate));
+  }
+}
@@ -0,0 +1,36 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_CERTIFICATE_POOL_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_CERTIFICATE_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "api/scoped_refptr.h"
+#include "rtc_base/rtc_certificate.h"
+
+// Keeps |target_size| KT_DEFAULT certificates generated ahead of time on a
+// background thread, so CreatePeerConnection() does not pay for key
+// generation. Safe to share between Conductors.
+class CertificatePool {
+ public:
+  explicit CertificatePool(size_t target_size = 4);
+  ~CertificatePool();
+
+  // Returns a pregenerated certificate and schedules a replacement. Falls
+  // back to generating one inline if the pool is empty; returns null only
+  // if generation fails.
+  rtc::scoped_refptr<rtc::RTCCertificate> Take();
+
+ private:
+  void RefillLoop();
+
+  const size_t target_size_;
+  std::mutex mutex_;
+  std::condition_variable refill_;
+  std::deque<rtc::scoped_refptr<rtc::RTCCertificate>> ready_;
+  bool running_ = true;
+  std::thread worker_;
+};
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_CERTIFICATE_POOL_H_
@@ -0,0 +1,42 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_COLLIDER_CONNECTION_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_COLLIDER_CONNECTION_H_
+
+#include <functional>
+#include <string>
+#include <utility>
+
+// A client's link to the AppRTC collider, the relay that carries
+// {"cmd":"register"} and {"cmd":"send"} messages one way and {"msg":...}
+// envelopes the other. WebSocketClient reaches a remote collider over
+// ws(s)://; LocalRoomServer provides an in-process one.
+//
+// Callbacks run on the thread that created the connection.
+class ColliderConnection {
+ public:
+  // Receives the unwrapped "msg" of each envelope.
+  using MessageCallback = std::function<void(const std::string&)>;
+  using ConnectionCallback = std::function<void(bool)>;
+
+  virtual ~ColliderConnection() = default;
+
+  // Starts connecting and returns without waiting; the connection callback
+  // reports the outcome.
+  virtual bool Connect(const std::string& url) = 0;
+  virtual void Close() = 0;
+  virtual bool SendMessage(const std::string& message) = 0;
+  virtual bool IsConnected() const = 0;
+
+  void SetMessageCallback(MessageCallback callback) {
+    message_callback_ = std::move(callback);
+  }
+
+  void SetConnectionCallback(ConnectionCallback callback) {
+    connection_callback_ = std::move(callback);
+  }
+
+ protected:
+  MessageCallback message_callback_;
+  ConnectionCallback connection_callback_;
+};
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_COLLIDER_CONNECTION_H_
@@ -9,11 +9,15 @@
  */
 
 #include "examples/peerconnection/client/conductor.h"
+#include "examples/peerconnection/client/file_video_source.h"
+#include "examples/peerconnection/client/local_room_server.h"
+#include "examples/peerconnection/client/mapped_y4m_frame_generator.h"
 #include "examples/peerconnection/client/websocket_client.h"
 
 #include <stddef.h>
 #include <filesystem>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <utility>
@@ -26,6 +30,7 @@
 
 
 #include "absl/memory/memory.h"
+#include "absl/strings/match.h"
 #include "absl/types/span.h"
 #include "api/audio_codecs/builtin_audio_decoder_factory.h"
 #include "api/audio_codecs/builtin_audio_encoder_factory.h"
@@ -45,6 +50,7 @@
 #include "api/task_queue/default_task_queue_factory.h"
 #include "api/task_queue/task_queue_factory.h"
 #include "api/test/create_frame_generator.h"
+#include "api/units/time_delta.h"
 #include "api/video/video_frame.h"
 #include "api/video/video_source_interface.h"
 #include "api/video_codecs/video_decoder_factory_template.h"
@@ -69,7 +75,9 @@
 #include "pc/video_track_source.h"
 #include "rtc_base/checks.h"
 #include "rtc_base/logging.h"
+#include "rtc_base/string_encode.h"
 #include "rtc_base/strings/json.h"
+#include "rtc_base/time_utils.h"
 #include "system_wrappers/include/clock.h"
 #include "test/frame_generator_capturer.h"
 #include "test/platform_video_capturer.h"
@@ -156,20 +164,120 @@ class CapturerTrackSource : public webrtc::VideoTrackSource {
   std::unique_ptr<TestVideoCapturer> capturer_;
 };
 
-}  // namespace
+// Negotiates the timing-related header extensions the frame logs rely on.
+void EnableTimingExtensions(
+    rtc::scoped_refptr<webrtc::RtpTransceiverInterface> transceiver) {
+  auto extensions = transceiver->GetHeaderExtensionsToNegotiate();
+  for (auto& ext : extensions) {
+    if (ext.uri == webrtc::RtpExtension::kAbsoluteCaptureTimeUri ||
+        ext.uri == webrtc::RtpExtension::kVideoTimingUri ||
+        ext.uri == webrtc::RtpExtension::kTimestampOffsetUri ||
+        ext.uri == webrtc::RtpExtension::kPlayoutDelayUri) {
+      ext.direction = webrtc::RtpTransceiverDirection::kSendRecv;
+    }
+  }
+  auto error = transceiver->SetHeaderExtensionsToNegotiate(extensions);
+  if (!error.ok()) {
+    RTC_LOG(LS_ERROR) << "Failed to set header extensions: "
+                      << error.message();
+  }
+}
 
-// y4m reader
-class Y4mVideoSource : public webrtc::VideoTrackSource {
- public:
-  explicit Y4mVideoSource(std::unique_ptr<webrtc::test::FrameGeneratorCapturer> capturer)
-      : VideoTrackSource(/*remote=*/false), capturer_(std::move(capturer)) {}  // Changed Y4mVideoTrackSource to VideoTrackSource
- protected:
-  rtc::VideoSourceInterface<webrtc::VideoFrame>* source() override {
-    return capturer_.get();
+// One send encoding per layer of |profile|.
+std::vector<webrtc::RtpEncodingParameters> SendEncodings(
+    const RunProfile& profile) {
+  std::vector<webrtc::RtpEncodingParameters> encodings;
+  for (const RunProfile::Layer& layer : profile.layers) {
+    webrtc::RtpEncodingParameters encoding;
+    encoding.rid = layer.rid;
+    encoding.active = layer.active;
+    encoding.max_bitrate_bps = layer.max_bitrate_bps;
+    encoding.max_framerate = layer.max_framerate;
+    encoding.scale_resolution_down_by = layer.scale_resolution_down_by;
+    encoding.scalability_mode = layer.scalability_mode;
+    encodings.push_back(std::move(encoding));
   }
- private:
-  std::unique_ptr<webrtc::test::FrameGeneratorCapturer> capturer_;
-};
+  return encodings;
+}
+
+// Moves the codecs named in |profile| to the front of |transceiver|'s
+// preferences, in the profile's order. Codecs it does not name follow in
+// their default order, so negotiation can still fall back to them.
+void ApplyCodecPreferences(
+    rtc::scoped_refptr<webrtc::RtpTransceiverInterface> transceiver,
+    std::vector<webrtc::RtpCodecCapability> available,
+    const RunProfile& profile) {
+  if (profile.codecs.empty())
+    return;
+  std::vector<webrtc::RtpCodecCapability> preferred;
+  for (const std::string& name : profile.codecs) {
+    auto wanted = profile.codec_parameters.find(name);
+    for (auto it = available.begin(); it != available.end();) {
+      bool match = absl::EqualsIgnoreCase(it->name, name);
+      if (match && wanted != profile.codec_parameters.end()) {
+        for (const auto& [key, value] : wanted->second) {
+          auto param = it->parameters.find(key);
+          if (param == it->parameters.end() || param->second != value) {
+            match = false;
+            break;
+          }
+        }
+      }
+      if (match) {
+        preferred.push_back(std::move(*it));
+        it = available.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  if (preferred.empty()) {
+    RTC_LOG(LS_WARNING) << "None of the profile's codecs is available";
+    return;
+  }
+  preferred.insert(preferred.end(), available.begin(), available.end());
+  webrtc::RTCError error = transceiver->SetCodecPreferences(preferred);
+  if (!error.ok()) {
+    RTC_LOG(LS_ERROR) << "Failed to set codec preferences: "
+                      << error.message();
+    return;
+  }
+  RTC_LOG(LS_INFO) << "Preferred video codec: " << preferred.front().name;
+}
+
+// Encodings themselves are fixed when the transceiver is added; only the
+// degradation preference is left to set here.
+void ApplyDegradationPreference(
+    rtc::scoped_refptr<webrtc::RtpSenderInterface> sender,
+    const RunProfile& profile) {
+  if (!profile.degradation_preference)
+    return;
+  webrtc::RtpParameters parameters = sender->GetParameters();
+  parameters.degradation_preference = profile.degradation_preference;
+  webrtc::RTCError error = sender->SetParameters(parameters);
+  if (!error.ok()) {
+    RTC_LOG(LS_ERROR) << "Failed to set degradation preference: "
+                      << error.message();
+  }
+}
+
+// Prefers the zero-copy mapped generator and falls back to the stock
+// fread-based one where the file cannot be mapped.
+std::unique_ptr<webrtc::test::FrameGeneratorInterface> CreateY4mGenerator(
+    const std::string& path,
+    bool preload) {
+  std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator =
+      MappedY4mFrameGenerator::Create(
+          path, preload ? MappedY4mFrameGenerator::Mode::kPreload
+                        : MappedY4mFrameGenerator::Mode::kMapped);
+  if (generator)
+    return generator;
+  RTC_LOG(LS_WARNING) << "Reading " << path << " with Y4mFrameGenerator";
+  return std::make_unique<webrtc::test::Y4mFrameGenerator>(
+      path, webrtc::test::Y4mFrameGenerator::RepeatMode::kLoop);
+}
+
+}  // namespace
 
 
 
@@ -229,10 +337,14 @@ private:
 class MyDataObserver : public webrtc::DataChannelObserver {
  public:
   using OnPayload = std::function<void(absl::Span<const uint8_t>)>;
+  using OnBufferedAmount = std::function<void(uint64_t)>;
 
   MyDataObserver(rtc::scoped_refptr<webrtc::DataChannelInterface> channel,
-                 OnPayload on_payload)
-      : channel_(std::move(channel)), on_payload_(std::move(on_payload)) {
+                 OnPayload on_payload,
+                 OnBufferedAmount on_buffered_amount = nullptr)
+      : channel_(std::move(channel)),
+        on_payload_(std::move(on_payload)),
+        on_buffered_amount_(std::move(on_buffered_amount)) {
     channel_->RegisterObserver(this);
   }
   ~MyDataObserver() override { channel_->UnregisterObserver(); }
@@ -241,29 +353,25 @@ class MyDataObserver : public webrtc::DataChannelObserver {
     if (channel_->state() == webrtc::DataChannelInterface::kOpen) {
       RTC_LOG(LS_INFO) << "[SCTP] " << channel_->label() << " opened";
     }
-    const std::string kPattern = "hello data";
-    channel_->Send(webrtc::DataBuffer(kPattern));
   }
 
+  // The channel itself identifies the flow, so the whole message is payload.
   void OnMessage(const webrtc::DataBuffer& buffer) override {
     if (!on_payload_) return;
     if (buffer.data.size() == 0) return;
+    on_payload_(absl::Span<const uint8_t>(buffer.data.cdata<uint8_t>(),
+                                          buffer.data.size()));
+  }
 
-    // If you keep the 1-byte TrafficKind header, strip it when present.
-    const uint8_t* raw = buffer.data.cdata<uint8_t>();
-    size_t sz = buffer.data.size();
-    // Heuristic: if upper bit-pattern looks like a valid enum in your range, strip,
-    // otherwise pass through whole buffer. For simplicity we strip 1 byte unconditionally.
-    if (sz >= 1) {
-      on_payload_(absl::Span<const uint8_t>(raw + 1, sz - 1));
-    } else {
-      on_payload_(absl::Span<const uint8_t>());  // empty
-    }
+  void OnBufferedAmountChange(uint64_t sent_data_size) override {
+    if (on_buffered_amount_)
+      on_buffered_amount_(channel_->buffered_amount());
   }
 
  private:
   rtc::scoped_refptr<webrtc::DataChannelInterface> channel_;
   OnPayload on_payload_;
+  OnBufferedAmount on_buffered_amount_;
 };
 
 bool Conductor::curl_initialized_ = false;
@@ -275,6 +383,15 @@ Conductor::Conductor(PeerConnectionClient* client, MainWindow* main_wnd, bool he
 
 Conductor::~Conductor() {
   RTC_DCHECK(!peer_connection_);
+  if (http_thread_) {
+    // Let the last messages (the bye, an open candidate batch) go out.
+    {
+      std::lock_guard<std::mutex> lock(outbox_mutex_);
+      batch_open_ = false;
+    }
+    http_thread_->BlockingCall([this] { DrainSignals(); });
+    http_thread_->Stop();
+  }
   CleanupCurl();
 }
 
@@ -282,6 +399,24 @@ void Conductor::Start () {
   if (!traffic_csv_path_.empty()) {
     traffic_profiles_ = LoadProfiles(traffic_csv_path_);
   }
+  // Also needed without a profile: the remote's scheduled flows are logged
+  // here.
+  traffic_scheduler_ =
+      std::make_unique<TrafficScheduler>(traffic_profiles_, log_dir_);
+  // Build the factory and start generating certificates before the first
+  // call asks for them.
+  if (!certificate_pool_)
+    certificate_pool_ = std::make_shared<CertificatePool>();
+  if (!PrewarmFactory())
+    RTC_LOG(LS_ERROR) << "Failed to prewarm PeerConnectionFactory";
+  ui_thread_ = rtc::Thread::Current();
+  run_metrics_ = std::make_unique<RunMetrics>(
+      log_dir_, run_metrics_options_, [this] {
+        main_wnd_->QueueUIThreadCallback(PEER_CONNECTION_CLOSED, nullptr);
+      });
+  http_thread_ = rtc::Thread::Create();
+  http_thread_->SetName("http_thread", nullptr);
+  http_thread_->Start();
   client_->RegisterObserver(this);
   main_wnd_->RegisterObserver(this);
 }
@@ -335,17 +470,11 @@ void Conductor::CleanupCurl() {
 }
 
 
-bool Conductor::InitializePeerConnection() {
-  RTC_DCHECK(!peer_connection_factory_);
-  RTC_DCHECK(!peer_connection_);
-
-  if (!signaling_thread_.get()) {
-    signaling_thread_ = rtc::Thread::CreateWithSocketServer();
-    signaling_thread_->Start();
-  }
-
+rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface>
+Conductor::CreateFactory(rtc::Thread* signaling_thread,
+                         webrtc::TaskQueueFactory** task_queue_factory) {
   webrtc::PeerConnectionFactoryDependencies deps;
-  deps.signaling_thread = signaling_thread_.get();
+  deps.signaling_thread = signaling_thread;
   deps.task_queue_factory = webrtc::CreateDefaultTaskQueueFactory();
   deps.audio_encoder_factory = webrtc::CreateBuiltinAudioEncoderFactory();
   deps.audio_decoder_factory = webrtc::CreateBuiltinAudioDecoderFactory();
@@ -370,16 +499,18 @@ bool Conductor::InitializePeerConnection() {
  // Create video encoder factory 
   auto video_encoder_factory = webrtc::CreateBuiltinVideoEncoderFactory();
   
-  // Log supported codecs by the factory
-  RTC_LOG(LS_INFO) << "Available video encoders:";
-  std::vector<webrtc::SdpVideoFormat> supported_formats = 
-      video_encoder_factory->GetSupportedFormats();
-  for (const auto& format : supported_formats) {
-    RTC_LOG(LS_INFO) << "  " << format.name;
-    for (const auto& param : format.parameters) {
-      RTC_LOG(LS_INFO) << "    " << param.first << ": " << param.second;
+  // Log supported codecs by the factory. Enumerating them probes every
+  // codec implementation, so it is done once per process.
+  static std::once_flag log_formats_once;
+  std::call_once(log_formats_once, [&] {
+    RTC_LOG(LS_INFO) << "Available video encoders:";
+    for (const auto& format : video_encoder_factory->GetSupportedFormats()) {
+      RTC_LOG(LS_INFO) << "  " << format.name;
+      for (const auto& param : format.parameters) {
+        RTC_LOG(LS_INFO) << "    " << param.first << ": " << param.second;
+      }
     }
-  }
+  });
 
   // Don't create ADM - this will work make device even without audio devices
   deps.audio_mixer = nullptr;
@@ -391,11 +522,38 @@ bool Conductor::InitializePeerConnection() {
   deps.video_decoder_factory = webrtc::CreateBuiltinVideoDecoderFactory();
 
   webrtc::EnableMedia(deps);
-  task_queue_factory_ = deps.task_queue_factory.get();
-  peer_connection_factory_ =
-      webrtc::CreateModularPeerConnectionFactory(std::move(deps));
+  *task_queue_factory = deps.task_queue_factory.get();
+  return webrtc::CreateModularPeerConnectionFactory(std::move(deps));
+}
+
+bool Conductor::PrewarmFactory() {
+  if (peer_connection_factory_)
+    return true;
+  if (shared_factory_) {
+    peer_connection_factory_ = shared_factory_;
+  } else {
+    if (!signaling_thread_.get()) {
+      signaling_thread_ = rtc::Thread::CreateWithSocketServer();
+      signaling_thread_->Start();
+    }
+    peer_connection_factory_ =
+        CreateFactory(signaling_thread_.get(), &task_queue_factory_);
+    if (!peer_connection_factory_)
+      return false;
+  }
+  // Every video transceiver asks for these; the factory's answer does not
+  // change, and each query walks the whole encoder factory.
+  video_sender_codecs_ =
+      peer_connection_factory_
+          ->GetRtpSenderCapabilities(cricket::MEDIA_TYPE_VIDEO)
+          .codecs;
+  return true;
+}
 
-  if (!peer_connection_factory_) {
+bool Conductor::InitializePeerConnection() {
+  RTC_DCHECK(!peer_connection_);
+
+  if (!PrewarmFactory()) {
     main_wnd_->MessageBox("Error", "Failed to initialize PeerConnectionFactory",
                           true);
     DeletePeerConnection();
@@ -407,7 +565,15 @@ bool Conductor::InitializePeerConnection() {
     DeletePeerConnection();
   }
 
+  if (run_metrics_)
+    run_metrics_->Start();
   AddTracks();
+  if (is_sender_ && peer_connection_) {
+    // Fed from the stats collector's reports rather than a GetStats() of
+    // its own.
+    outbound_layer_stats_ = std::make_unique<OutboundLayerStats>(log_dir_);
+    GetReceiverVideoStats();
+  }
 
   // Added
   AddSCTPs();
@@ -471,29 +637,31 @@ bool Conductor::CreatePeerConnection() {
 
 
   // Setup proper ICE connection timeouts
-  config.ice_connection_receiving_timeout = 5000;  // 5 seconds
-  config.ice_backup_candidate_pair_ping_interval = 5000; // 5 seconds
-  config.ice_check_min_interval = std::optional<int>(500); // 500ms minimum between checks
+  config.ice_connection_receiving_timeout =
+      run_profile_.ice_connection_receiving_timeout_ms;
+  config.ice_backup_candidate_pair_ping_interval =
+      run_profile_.ice_backup_candidate_pair_ping_interval_ms;
+  config.ice_check_min_interval = run_profile_.ice_check_min_interval_ms;
   config.continual_gathering_policy = 
       webrtc::PeerConnectionInterface::GATHER_CONTINUALLY;
 
   // Logging
   config.logging_folder = log_dir_; 
 
-  // Generate and add certificates
-  rtc::scoped_refptr<rtc::RTCCertificate> certificate = 
-      rtc::RTCCertificateGenerator::GenerateCertificate(
-          rtc::KeyParams(rtc::KT_DEFAULT), std::nullopt);
+  // Pregenerated by the pool; it generates inline only when drained.
+  rtc::scoped_refptr<rtc::RTCCertificate> certificate =
+      certificate_pool_
+          ? certificate_pool_->Take()
+          : rtc::RTCCertificateGenerator::GenerateCertificate(
+                rtc::KeyParams(rtc::KT_DEFAULT), std::nullopt);
   if (certificate) {
     config.certificates.push_back(certificate);
   }
 
 
   // Set port range in configuration
-  const int kMinPort = 50000;  // Minimum port
-  const int kMaxPort = 50005;  // Maximum port
-  config.port_allocator_config.min_port = kMinPort;
-  config.port_allocator_config.max_port = kMaxPort;
+  config.port_allocator_config.min_port = run_profile_.min_port;
+  config.port_allocator_config.max_port = run_profile_.max_port;
 
 
   webrtc::PeerConnectionDependencies pc_dependencies(this);
@@ -508,19 +676,45 @@ bool Conductor::CreatePeerConnection() {
 
 
 void Conductor::DeletePeerConnection() {
-  stats_collector_->Stop();
+  if (stats_collector_) {
+    stats_collector_->SetReportObserver(nullptr);
+    stats_collector_->Stop();
+  }
+
+  if (traffic_scheduler_)
+    traffic_scheduler_->Stop();
+
+  frame_timing_logger_ = nullptr;
+  headless_sink_ = nullptr;
+  outbound_layer_stats_ = nullptr;
+  if (layer_safety_) {
+    layer_safety_->SetNotAlive();
+    layer_safety_ = nullptr;
+  }
 
   if (bulk_sender_)
     bulk_sender_->Stop();
   if (bulk_receiver_)
     bulk_receiver_->Detach();
+  if (kv_sender_)
+    kv_sender_->Stop();
+  if (kv_receiver_)
+    kv_receiver_->Detach();
+  if (mesh_sender_)
+    mesh_sender_->Stop();
+  if (mesh_receiver_)
+    mesh_receiver_->Detach();
+  // After every producer has stopped, so the summary has all samples.
+  if (run_metrics_)
+    run_metrics_->Stop();
 
   main_wnd_->StopLocalRenderer();
   main_wnd_->StopRemoteRenderer();
   peer_connection_ = nullptr;
-  peer_connection_factory_ = nullptr;
+  // The factory stays warm for the next call; it goes with the Conductor.
   peer_id_ = -1;
   loopback_ = false;
+  bitrate_applied_ = false;
 }
 
 void Conductor::EnsureStreamingUI() {
@@ -555,7 +749,26 @@ void Conductor::OnAddTrack(
     // If this is a video track, start stats collection
     if (receiver->track() &&
         receiver->track()->kind() == webrtc::MediaStreamTrackInterface::kVideoKind) {
+        if (!frame_timing_logger_) {
+            frame_timing_logger_ = std::make_unique<FrameTimingLogger>(log_dir_);
+            frame_timing_logger_->SetRunMetrics(run_metrics_.get());
+        }
+        rtc::scoped_refptr<webrtc::VideoTrackInterface> video_track(
+            static_cast<webrtc::VideoTrackInterface*>(receiver->track().get()));
+        frame_timing_logger_->AddTrack(video_track);
+        if (headless_ && frame_verification_) {
+            if (!headless_sink_) {
+                headless_sink_ = std::make_unique<HeadlessFrameSink>(
+                    log_dir_, *frame_verification_);
+            }
+            headless_sink_->AddTrack(video_track);
+        }
         GetReceiverVideoStats();
+        if (!layer_schedule_.empty()) {
+          ui_thread_->PostTask([self = rtc::scoped_refptr<Conductor>(this)] {
+            self->ScheduleLayerSwitches();
+          });
+        }
     }
 }
 
@@ -585,6 +798,9 @@ void Conductor::OnRemoveTrack(
 
 void Conductor::OnDataChannel(
     rtc::scoped_refptr<webrtc::DataChannelInterface> channel) {
+  if (traffic_scheduler_ && traffic_scheduler_->OnRemoteDataChannel(channel))
+    return;
+
   std::string label = channel->label();
   std::string lower = label;
   std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
@@ -598,23 +814,16 @@ void Conductor::OnDataChannel(
 
   // Install flow if missing
   if (!flows_.count(kind)) {
-    auto on_payload = [this, kind](absl::Span<const uint8_t> bytes) {
-      auto fit = flows_.find(kind);
-      if (fit != flows_.end() && fit->second.handler) fit->second.handler(bytes);
-    };
     Flow f;
     f.channel  = channel;
-    f.observer = std::make_unique<MyDataObserver>(channel, on_payload);
+    f.observer = CreateFlowObserver(kind, channel);
     f.label    = label;
     flows_.emplace(kind, std::move(f));
   } else {
     // If we already had a placeholder, replace channel/observer.
     auto& f = flows_.at(kind);
     f.channel  = channel;
-    f.observer = std::make_unique<MyDataObserver>(channel, [this,kind](absl::Span<const uint8_t> b){
-      auto fit = flows_.find(kind);
-      if (fit != flows_.end() && fit->second.handler) fit->second.handler(b);
-    });
+    f.observer = CreateFlowObserver(kind, channel);
     f.label = label;
   }
 
@@ -631,42 +840,39 @@ void Conductor::OnIceCandidate(const webrtc::IceCandidateInterface* candidate) {
     return;
   }
 
-  // Create candidate message
-  Json::Value jmessage;
-  jmessage["type"] = "candidate";
-  jmessage["label"] = candidate->sdp_mline_index();
-  jmessage["id"] = candidate->sdp_mid();
+  Json::Value jcandidate;
+  jcandidate["label"] = candidate->sdp_mline_index();
+  jcandidate["id"] = candidate->sdp_mid();
   std::string sdp;
   if (!candidate->ToString(&sdp)) {
     RTC_LOG(LS_ERROR) << "Failed to serialize candidate";
     return;
   }
-  jmessage["candidate"] = sdp;
+  jcandidate["candidate"] = sdp;
+  // Trickled as soon as it is gathered, whether or not the remote
+  // description has arrived; the room server holds it for the peer.
+  SendCandidate(std::move(jcandidate));
+}
 
-  Json::StreamWriterBuilder factory;
-  std::string message = Json::writeString(factory, jmessage);
-  
-  if (is_initiator_) {
-    // For initiator, send directly via HTTP
-    SendMessage(message);
-  } else {
-    // For non-initiator, use websocket
-    if (!ws_client_ || !ws_client_->IsConnected()) {
-      RTC_LOG(LS_INFO) << "WebSocket not connected, queuing ICE candidate";
-      pending_messages_.push_back(new std::string(message));  // Allocate new string
-    } else {
-      // Create WebSocket wrapper message
-      Json::Value wrapped_message;
-      wrapped_message["cmd"] = "send";
-      wrapped_message["msg"] = message;
-      std::string ws_message = Json::writeString(factory, wrapped_message);
-      ws_client_->SendMessage(ws_message);
-    }
+void Conductor::OnIceGatheringChange(
+    webrtc::PeerConnectionInterface::IceGatheringState new_state) {
+  if (new_state != webrtc::PeerConnectionInterface::kIceGatheringComplete)
+    return;
+  // Nothing more is coming, so the open batch need not wait out its window.
+  {
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    batch_open_ = false;
   }
-  
+  ScheduleSignalDrain(/*force=*/true);
 }
 
 
+void Conductor::OnIceConnectionChange(
+    webrtc::PeerConnectionInterface::IceConnectionState new_state) {
+  if (new_state == webrtc::PeerConnectionInterface::kIceConnectionConnected)
+    LogSetupEvent("ice_connected");
+}
+
 //
 // PeerConnectionClientObserver implementation.
 //
@@ -775,77 +981,84 @@ void Conductor::OnMessageFromPeer(int peer_id, const std::string& message) {
     EnsureStreamingUI();
 
     RTC_LOG (LS_INFO) << "Set remote description";
+    LogSetupEvent("remote_description");
     peer_connected_ = true;
-
-
-    // Now we can send any pending ICE candidates
-    while (!pending_messages_.empty()) {
-        ws_client_->SendMessage(*pending_messages_.front());
-        pending_messages_.pop_front();
-    }
-    /*    
-    while (!pending_messages_.empty()) {
-        auto& message = pending_messages_.front();  // Get the front message
-        if (message) {
-            SendMessage(*message);  // Use SendMessage to send the message
-        }
-        pending_messages_.pop_front();  // Remove the sent message from the queue
-    }
-    */
-
+    ApplyBitrateSettings();
     return;
   }
 
   if (type == "candidate") {
-    // Handle ICE candidate
-    std::string candidate_str;
-    if (!rtc::GetStringFromJsonObject(jmessage, "candidate", &candidate_str)) {
-      RTC_LOG(LS_WARNING) << "ICE candidate is missing 'candidate'";
-      return;
-    }
-    std::string sdp_mid;
-    if (!rtc::GetStringFromJsonObject(jmessage, "id", &sdp_mid)) {
-      RTC_LOG(LS_WARNING) << "ICE candidate is missing 'id'";
-      return;
-    }
-    int sdp_mline_index = 0;
-    if (!rtc::GetIntFromJsonObject(jmessage, "label", &sdp_mline_index)) {
-      RTC_LOG(LS_WARNING) << "ICE candidate is missing 'label'";
-      return;
-    }
+    AddRemoteCandidate(jmessage);
+    return;
+  }
 
-    webrtc::SdpParseError error;
-    std::unique_ptr<webrtc::IceCandidateInterface> candidate(
-     webrtc::CreateIceCandidate(sdp_mid, sdp_mline_index, candidate_str, &error));
-    if (!candidate) {
-      RTC_LOG(LS_WARNING) << "Failed to parse ICE candidate: " << error.description;
+  if (type == "candidates") {
+    // A batch from SendCandidate(); each entry is a "candidate" body.
+    const Json::Value& candidates = jmessage["candidates"];
+    if (!candidates.isArray()) {
+      RTC_LOG(LS_WARNING) << "Candidate batch is missing 'candidates'";
       return;
     }
+    for (const Json::Value& jcandidate : candidates)
+      AddRemoteCandidate(jcandidate);
+    return;
+  }
 
-    if (!peer_connection_->AddIceCandidate(candidate.get())) {
-      RTC_LOG(LS_WARNING) << "Failed to add ICE candidate";
-      return;
-    }
-    RTC_LOG(LS_INFO) << "Added ICE candidate";
+  RTC_LOG(LS_WARNING) << "Received unknown message type: " << type;
+}
 
+bool Conductor::AddRemoteCandidate(const Json::Value& jcandidate) {
+  std::string candidate_str;
+  if (!rtc::GetStringFromJsonObject(jcandidate, "candidate", &candidate_str)) {
+    RTC_LOG(LS_WARNING) << "ICE candidate is missing 'candidate'";
+    return false;
+  }
+  std::string sdp_mid;
+  if (!rtc::GetStringFromJsonObject(jcandidate, "id", &sdp_mid)) {
+    RTC_LOG(LS_WARNING) << "ICE candidate is missing 'id'";
+    return false;
+  }
+  int sdp_mline_index = 0;
+  if (!rtc::GetIntFromJsonObject(jcandidate, "label", &sdp_mline_index)) {
+    RTC_LOG(LS_WARNING) << "ICE candidate is missing 'label'";
+    return false;
+  }
 
-    // Set high quality bitrate for 4K
-    webrtc::BitrateSettings bitrate_settings;
-    // For 4K video, use higher bitrates
-    bitrate_settings.min_bitrate_bps =    200000;    // 200 kbps min
-    bitrate_settings.start_bitrate_bps =  300000;  // 300 kbps start
-    bitrate_settings.max_bitrate_bps =  50000000;    // 50 Mbps max
-    peer_connection_->SetBitrate(bitrate_settings);
+  webrtc::SdpParseError error;
+  std::unique_ptr<webrtc::IceCandidateInterface> candidate(
+      webrtc::CreateIceCandidate(sdp_mid, sdp_mline_index, candidate_str,
+                                 &error));
+  if (!candidate) {
+    RTC_LOG(LS_WARNING) << "Failed to parse ICE candidate: "
+                        << error.description;
+    return false;
+  }
 
-    return;
+  if (!peer_connection_->AddIceCandidate(candidate.get())) {
+    RTC_LOG(LS_WARNING) << "Failed to add ICE candidate";
+    return false;
   }
+  RTC_LOG(LS_INFO) << "Added ICE candidate";
+  return true;
+}
 
-  RTC_LOG(LS_WARNING) << "Received unknown message type: " << type;
+void Conductor::ApplyBitrateSettings() {
+  if (bitrate_applied_)
+    return;
+  webrtc::BitrateSettings bitrate_settings;
+  bitrate_settings.min_bitrate_bps = run_profile_.min_bitrate_bps;
+  bitrate_settings.start_bitrate_bps = run_profile_.start_bitrate_bps;
+  bitrate_settings.max_bitrate_bps = run_profile_.max_bitrate_bps;
+  const webrtc::RTCError error = peer_connection_->SetBitrate(bitrate_settings);
+  if (!error.ok()) {
+    RTC_LOG(LS_WARNING) << "SetBitrate failed: " << error.message();
+    return;
+  }
+  bitrate_applied_ = true;
 }
 
 void Conductor::OnMessageSent(int err) {
-  // Process the next pending message if any.
-  main_wnd_->QueueUIThreadCallback(SEND_MESSAGE_TO_PEER, NULL);
+  // Signaling goes out through |outbox_|; nothing is queued on |client_|.
 }
 
 void Conductor::OnServerConnectionFailure() {
@@ -893,12 +1106,26 @@ size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
   return size * nmemb;
 }
 
+namespace {
+// --server may carry a scheme, e.g. http://127.0.0.1:<port> for a
+// LocalRoomServer in another process; a bare host means AppRTC over HTTPS.
+std::string RoomServerUrl(const std::string& server) {
+  if (server.find("://") != std::string::npos)
+    return server;
+  return "https://" + server;
+}
+
+// A candidate batch stays open this long after its first candidate.
+constexpr int64_t kCandidateBatchWindowMs = 20;
+}  // namespace
+
 // websocket version for apprtc
 void Conductor::StartLogin(const std::string& server, int port) {
-  if (ws_client_) {
-    RTC_LOG(LS_WARNING) << "WebSocket client already exists";
+  if (ws_client_ || join_pending_) {
+    RTC_LOG(LS_WARNING) << "Already in or joining a room";
     return;
   }
+  server_ = server;
 
   // Generate or set room ID
   if (room_id_.empty()) {
@@ -906,51 +1133,56 @@ void Conductor::StartLogin(const std::string& server, int port) {
     RTC_LOG(LS_INFO) << "Generated room number is "<<room_id_;
   } 
 
-  // Perform HTTP POST to /join/{room_id}
-  std::string join_url = "https://" + server + "/join/" + room_id_;
+  login_start_ms_ = rtc::TimeMillis();
+  if (!log_dir_.empty() && !setup_log_.is_open()) {
+    setup_log_.open(log_dir_ + "/setup_timing.csv");
+    setup_log_ << "event,elapsed_ms\n";
+  }
+  LogSetupEvent("join");
 
+  if (local_room_) {
+    // No I/O involved, so there is nothing to wait for.
+    OnJoinResponse(local_room_->Join(room_id_));
+    return;
+  }
+
+  // Global init stays on this thread; it is not thread-safe.
   if (!InitializeCurl()) {
     RTC_LOG(LS_ERROR) << "Failed to initialize CURL";
     return;
   }
 
-  CURLcode res;
-  std::string read_buffer;
-
-  if(curl_) {
-    curl_easy_setopt(curl_, CURLOPT_URL, join_url.c_str());
-    curl_easy_setopt(curl_, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &read_buffer);
-
-    struct curl_slist *headers = nullptr;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    headers = curl_slist_append(headers, "User-Agent: peerconnection-client/1.0");
-    curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers);
-
-    Json::Value join_payload;
-    join_payload["room_id"] = room_id_;
-    Json::StreamWriterBuilder writer;
-    std::string payload = Json::writeString(writer, join_payload);
-    curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, payload.c_str());
-    curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, payload.length());
-
-    curl_easy_setopt(curl_, CURLOPT_TIMEOUT, 10L);
-    curl_easy_setopt(curl_, CURLOPT_VERBOSE, 1L);
-
-    RTC_LOG(LS_INFO) << "Server Response: " << read_buffer;
+  // Perform HTTP POST to /join/{room_id}
+  const std::string join_url =
+      RoomServerUrl(server) + "/join/" + room_id_;
+  Json::Value join_payload;
+  join_payload["room_id"] = room_id_;
+  Json::StreamWriterBuilder writer;
+  std::string payload = Json::writeString(writer, join_payload);
+
+  // DNS, TLS and the round trip take long enough to freeze the window, so
+  // the POST runs on |http_thread_| and the response comes back here. The
+  // connection it opens stays up for the /message POSTs that follow.
+  join_pending_ = true;
+  rtc::Thread* ui_thread = rtc::Thread::Current();
+  http_thread_->PostTask([self = rtc::scoped_refptr<Conductor>(this),
+                          ui_thread, join_url,
+                          payload = std::move(payload)]() mutable {
+    std::string response;
+    self->PostToRoom(join_url, payload, &response);
+    // |self| travels on, so the last reference is never dropped on the
+    // thread the Conductor owns.
+    ui_thread->PostTask(
+        [self = std::move(self), response = std::move(response)] {
+          self->join_pending_ = false;
+          self->OnJoinResponse(response);
+        });
+  });
+}
 
-    res = curl_easy_perform(curl_);
-    if(res != CURLE_OK) {
-      RTC_LOG(LS_ERROR) << "curl_easy_perform() failed: " << curl_easy_strerror(res);
-      curl_easy_cleanup(curl_);
-      return;
-    }
-    curl_slist_free_all(headers);
-    //curl_easy_cleanup(curl_);
-  }
+void Conductor::OnJoinResponse(const std::string& read_buffer) {
+  RTC_LOG(LS_INFO) << "Server Response: " << read_buffer;
 
-  /////
   // Parse server response
   Json::Value response;
   Json::CharReaderBuilder reader;
@@ -966,6 +1198,7 @@ void Conductor::StartLogin(const std::string& server, int port) {
     RTC_LOG(LS_ERROR) << "Join failed: " << response["result"].asString();
     return;
   }
+  LogSetupEvent("joined");
 
   // Extract connection parameters
   Json::Value params = response["params"];
@@ -974,7 +1207,8 @@ void Conductor::StartLogin(const std::string& server, int port) {
   client_id_ = params["client_id"].asString();
   room_id_ = params["room_id"].asString();
 
-  post_url_ = "https://" + server + "/message/" + room_id_ + "/" + client_id_;
+  post_url_ =
+      RoomServerUrl(server_) + "/message/" + room_id_ + "/" + client_id_;
   
   // Store initial messages if any
   if (params.isMember("messages") && params["messages"].isArray()) {
@@ -982,7 +1216,11 @@ void Conductor::StartLogin(const std::string& server, int port) {
   }
 
   // Connect to WebSocket server
-  ws_client_ = std::make_unique<WebSocketClient>();
+  if (local_room_) {
+    ws_client_ = local_room_->CreateConnection();
+  } else {
+    ws_client_ = std::make_unique<WebSocketClient>(socket_server_);
+  }
   ws_client_->SetMessageCallback(
       std::bind(&Conductor::OnWebSocketMessage, this, std::placeholders::_1));
   ws_client_->SetConnectionCallback(
@@ -992,6 +1230,15 @@ void Conductor::StartLogin(const std::string& server, int port) {
   ws_client_->Connect(wss_url);
 }
 
+void Conductor::LogSetupEvent(const char* event) {
+  const int64_t elapsed_ms = rtc::TimeMillis() - login_start_ms_;
+  RTC_LOG(LS_INFO) << "Call setup: " << event << " after " << elapsed_ms
+                   << " ms";
+  std::lock_guard<std::mutex> lock(setup_log_mutex_);
+  if (setup_log_.is_open())
+    setup_log_ << event << "," << elapsed_ms << std::endl;
+}
+
 void Conductor::OnWebSocketMessage(const std::string& message) {
   Json::CharReaderBuilder reader;
   Json::Value json_message;
@@ -1030,6 +1277,7 @@ void Conductor::OnWebSocketConnection(bool connected) {
     Json::StreamWriterBuilder writer;
     std::string message = Json::writeString(writer, reg_message);
     ws_client_->SendMessage(message);
+    LogSetupEvent("registered");
 
     // Process any initial messages
     if (!initial_messages_.empty()) {
@@ -1115,14 +1363,24 @@ void Conductor::AddTracks() {
     return;
   }
 
+  // RTP rows of the traffic profile replace the default video source.
+  if (AddProfileVideoTracks()) {
+    if (!headless_)
+      main_wnd_->SwitchToStreamingUI();
+    return;
+  }
+
   bool use_camera = true;
 
   // Before adding any tracks, create transceiver with RTP extensions configured
   webrtc::RtpTransceiverInit init;
   init.direction = webrtc::RtpTransceiverDirection::kSendRecv;
   init.stream_ids.push_back(kStreamId);
+  // Simulcast layers can only be set up here, not by SetParameters().
+  init.send_encodings = SendEncodings(run_profile_);
 
-  // Add transceiver first to configure extensions
+  // Add transceiver first to configure extensions and codecs; the track
+  // added below takes it over.
   auto transceiver_result = peer_connection_->AddTransceiver(
       cricket::MEDIA_TYPE_VIDEO,
       init);
@@ -1130,53 +1388,28 @@ void Conductor::AddTracks() {
   if (transceiver_result.ok()) {
     auto transceiver = transceiver_result.value();
     
-    // Get and modify extensions
-    auto extensions = transceiver->GetHeaderExtensionsToNegotiate();
-
-    for (auto& ext : extensions) {
-      // Enable timing-related extensions
-      if (ext.uri == webrtc::RtpExtension::kAbsoluteCaptureTimeUri ||
-          ext.uri == webrtc::RtpExtension::kVideoTimingUri ||
-          ext.uri == webrtc::RtpExtension::kTimestampOffsetUri ||
-          ext.uri == webrtc::RtpExtension::kPlayoutDelayUri) {
-        ext.direction = webrtc::RtpTransceiverDirection::kSendRecv;
-      }
-    }
-
-    // Set modified extensions
-    auto error = transceiver->SetHeaderExtensionsToNegotiate(extensions);
-    if (!error.ok()) {
-      RTC_LOG(LS_ERROR) << "Failed to set header extensions: " 
-                      << error.message();
-    }
+    EnableTimingExtensions(transceiver);
+    ApplyCodecPreferences(transceiver, video_sender_codecs_, run_profile_);
+  } else {
+    RTC_LOG(LS_ERROR) << "Failed to add video transceiver: "
+                      << transceiver_result.error().message();
   }
 
   // Try Y4M first if path is provided
   if (!y4m_path_.empty()) {
     RTC_LOG(LS_INFO) << "Attempting to use Y4M file from path: " << y4m_path_;
     
-    std::unique_ptr<webrtc::test::Y4mFrameGenerator> frame_generator(
-        new webrtc::test::Y4mFrameGenerator(
-            y4m_path_,
-            webrtc::test::Y4mFrameGenerator::RepeatMode::kLoop
-        ));
+    std::unique_ptr<webrtc::test::FrameGeneratorInterface> frame_generator =
+        CreateY4mGenerator(y4m_path_, y4m_preload_);
 
     if (frame_generator) {
-      auto resolution = frame_generator->GetResolution();
       const int kTargetFps = frame_generator->fps().value_or(30);
-      
-      auto video_capturer = std::make_unique<webrtc::test::FrameGeneratorCapturer>(
-          webrtc::Clock::GetRealTimeClock(),
-          std::move(frame_generator),
-          kTargetFps,
-          *task_queue_factory_
-      );
-
-      if (video_capturer) {
-        video_capturer->Start();
-        rtc::scoped_refptr<Y4mVideoSource> video_source = 
-            rtc::make_ref_counted<Y4mVideoSource>(std::move(video_capturer));
-            
+
+      rtc::scoped_refptr<FileVideoSource> video_source =
+          FileVideoSource::Create(std::move(frame_generator), kTargetFps,
+                                  log_dir_ + "/frame_pacing.csv");
+
+      if (video_source) {
         rtc::scoped_refptr<webrtc::VideoTrackInterface> video_track =
             peer_connection_factory_->CreateVideoTrack(kVideoLabel, video_source.get());
 
@@ -1187,78 +1420,15 @@ void Conductor::AddTracks() {
         auto result_or_error = peer_connection_->AddTrack(video_track, {kStreamId});
         if (result_or_error.ok()) {
           use_camera = false;  // Successfully using Y4M
+          ApplyDegradationPreference(result_or_error.value(), run_profile_);
           RTC_LOG(LS_INFO) << "Successfully initialized Y4M video source";
         } else {
           RTC_LOG(LS_WARNING) << "Failed to add Y4M track to peer connection. Falling back to camera.";
         }
       } else {
-        RTC_LOG(LS_WARNING) << "Failed to create Y4M video capturer. Falling back to camera.";
-      }
-
-      // Configure RTP encoding parameters for high quality
-      auto senders = peer_connection_->GetSenders();
-      rtc::scoped_refptr<webrtc::RtpSenderInterface> sender;
-      for (const auto& s : senders) {
-        if (s->track() && s->track()->kind() == webrtc::MediaStreamTrackInterface::kVideoKind) {
-          sender = s;
-          break;
-        }
+        RTC_LOG(LS_WARNING) << "Failed to create Y4M video source. Falling back to camera.";
       }
 
-      if (sender) {
-        webrtc::RtpParameters parameters = sender->GetParameters();
-        
-        // Log initial codecs
-        RTC_LOG(LS_INFO) << "Available codecs before setting parameters:";
-        for (const auto& codec : parameters.codecs) {
-          RTC_LOG(LS_INFO) << "Codec: " << codec.name 
-                          << " Payload: " << codec.payload_type;
-        }
-
-        // Configure H264 parameters
-        for (webrtc::RtpCodecParameters& codec : parameters.codecs) {
-          if (codec.name == "H264") {
-
-            codec.parameters["profile-level-id"] = "42e01f";
-            codec.parameters["packetization-mode"] = "1";
-            codec.parameters["level-asymmetry-allowed"] = "1";
-            // For 4K support
-            codec.parameters["max-mbps"] = "972000";
-            codec.parameters["max-fs"] = std::to_string((resolution.width * resolution.height) / 256);
-
-            RTC_LOG(LS_INFO) << "Configured H264 parameters:";
-            for (const auto& param : codec.parameters) {
-              RTC_LOG(LS_INFO) << "  " << param.first << ": " << param.second;
-            }
-          }
-        }
-        // Set high bitrate for encoding
-        parameters.encodings.clear();
-        webrtc::RtpEncodingParameters encoding;
-        encoding.active = true;
-        encoding.max_bitrate_bps = std::optional<int>(25000000);  // 25 Mbps for 1080p/60fps
-        encoding.max_framerate = std::optional<int>(60);          // Up to 60fps
-        encoding.scale_resolution_down_by = std::optional<double>(1.0);  // No downscaling
-        parameters.encodings.push_back(encoding);
-
-        // Set the parameters
-        webrtc::RTCError error = sender->SetParameters(parameters);
-        if (!error.ok()) {
-          RTC_LOG(LS_ERROR) << "Failed to set parameters: " << error.message();
-        } else {
-          RTC_LOG(LS_INFO) << "Successfully set encoding parameters";
-        }
-
-        // Verify encoder configuration
-        auto final_params = sender->GetParameters();
-        RTC_LOG(LS_INFO) << "Final encoder configuration:";
-        for (const auto& codec : final_params.codecs) {
-          RTC_LOG(LS_INFO) << "Using codec: " << codec.name;
-          for (const auto& param : codec.parameters) {
-            RTC_LOG(LS_INFO) << "  " << param.first << " = " << param.second;
-          }
-        }
-      }
     } else {
       RTC_LOG(LS_WARNING) << "Failed to create Y4M frame generator. Falling back to camera.";
     }
@@ -1283,6 +1453,8 @@ void Conductor::AddTracks() {
       if (!result_or_error.ok()) {
         RTC_LOG(LS_ERROR) << "Failed to add video track to PeerConnection: "
                          << result_or_error.error().message();
+      } else {
+        ApplyDegradationPreference(result_or_error.value(), run_profile_);
       }
     } else {
       RTC_LOG(LS_ERROR) << "OpenVideoCaptureDevice failed";
@@ -1298,6 +1470,75 @@ void Conductor::AddTracks() {
   }
 }
 
+bool Conductor::AddProfileVideoTracks() {
+  bool added = false;
+  for (const TrafficProfile& profile : traffic_profiles_) {
+    if (!TrafficScheduler::IsRtp(profile) || profile.video_file_name.empty())
+      continue;
+
+    auto frame_generator =
+        CreateY4mGenerator(profile.video_file_name, y4m_preload_);
+    const int fps = profile.frame_rate > 0
+                        ? profile.frame_rate
+                        : frame_generator->fps().value_or(30);
+    auto source = FileVideoSource::Create(
+        std::move(frame_generator), fps,
+        log_dir_ + "/frame_pacing_" + profile.traffic_name + ".csv");
+    rtc::scoped_refptr<webrtc::VideoTrackInterface> track =
+        peer_connection_factory_->CreateVideoTrack(source,
+                                                   profile.traffic_name);
+
+    webrtc::RtpTransceiverInit init;
+    init.direction = webrtc::RtpTransceiverDirection::kSendOnly;
+    init.stream_ids.push_back(kStreamId);
+    webrtc::RtpEncodingParameters encoding;
+    if (profile.max_bitrate > 0)
+      encoding.max_bitrate_bps = profile.max_bitrate * 1000;
+    if (profile.frame_rate > 0)
+      encoding.max_framerate = profile.frame_rate;
+    init.send_encodings.push_back(encoding);
+
+    auto result = peer_connection_->AddTransceiver(track, init);
+    if (!result.ok()) {
+      RTC_LOG(LS_ERROR) << "Failed to add video track for "
+                        << profile.traffic_name << ": "
+                        << result.error().message();
+      continue;
+    }
+    EnableTimingExtensions(result.value());
+    ApplyCodecPreferences(result.value(), video_sender_codecs_, run_profile_);
+    ApplyDegradationPreference(result.value()->sender(), run_profile_);
+    traffic_scheduler_->AddRtpSender(profile.traffic_name,
+                                     result.value()->sender());
+    if (!added && !headless_)
+      main_wnd_->StartLocalRenderer(track.get());
+    added = true;
+    RTC_LOG(LS_INFO) << "Added video track " << profile.traffic_name << " ("
+                     << profile.video_file_name << ", "
+                     << profile.max_bitrate << " kbps, " << fps << " fps)";
+  }
+  return added;
+}
+
+void Conductor::StartProfileFlows() {
+  if (!traffic_scheduler_)
+    return;
+  traffic_scheduler_->AddDataChannels(peer_connection_.get());
+  for (const TrafficProfile& profile : traffic_profiles_) {
+    std::string pattern = profile.pattern;
+    std::transform(pattern.begin(), pattern.end(), pattern.begin(), ::tolower);
+    if (TrafficScheduler::IsRtp(profile) ||
+        TrafficScheduler::IsScheduledSctp(profile))
+      continue;
+    if (sctp::Sender* sender = GetOrCreateSender(pattern))
+      sender->Start(*this);
+    else
+      RTC_LOG(LS_WARNING) << "Unsupported traffic profile row: "
+                          << profile.traffic_name;
+  }
+  traffic_scheduler_->Start(peer_connection_);
+}
+
 void Conductor::AddSCTPs() {
   webrtc::DataChannelInit lowprio;
   lowprio.negotiated = true;
@@ -1313,32 +1554,179 @@ void Conductor::AddSCTPs() {
   ctrl.ordered = true;
   ctrl.priority = webrtc::PriorityValue(webrtc::Priority::kHigh);
 
+  // Small-message flows: request/response kv competes at high priority,
+  // mesh is unordered so one lost message does not stall the others.
+  webrtc::DataChannelInit kv;
+  kv.negotiated = true;
+  kv.id = 4;
+  kv.ordered = true;
+  kv.priority = webrtc::PriorityValue(webrtc::Priority::kHigh);
+
+  webrtc::DataChannelInit mesh;
+  mesh.negotiated = true;
+  mesh.id = 6;
+  mesh.ordered = false;
+  mesh.priority = webrtc::PriorityValue(webrtc::Priority::kMedium);
+
   // Open bulk data flow and control flow.
   AddSctpFlow(TrafficKind::kBulkTest, "bulk", lowprio);
   AddSctpFlow(TrafficKind::kControl, "ctrl", ctrl);
+  AddSctpFlow(TrafficKind::kKv, "kv", kv);
+  AddSctpFlow(TrafficKind::kMesh, "mesh", mesh);
 
-  // Register handler for control messages to trigger remote bulk sending.
+  // Register handler for control messages to trigger remote sending.
   RegisterPayloadHandler(TrafficKind::kControl,
                          [this](absl::Span<const uint8_t> bytes) {
-                           std::string cmd(bytes.begin(), bytes.end());
-                           if (cmd == "start") {
-                             if (!bulk_sender_)
-                               bulk_sender_ =
-                                   std::make_unique<sctp::bulk::Sender>();
-                             bulk_sender_->Start(*this);
-                           } else if (cmd == "stop") {
-                             if (bulk_sender_)
-                               bulk_sender_->Stop();
-                           }
+                           OnControlCommand(
+                               std::string(bytes.begin(), bytes.end()));
                          });
 
-  //AddSctpFlow(TrafficKind::kKv,       "kv",   highprio);
-  //AddSctpFlow(TrafficKind::kMesh,     "mesh", lowprio);
-
   if (!bulk_receiver_) {
     bulk_receiver_ = std::make_unique<sctp::bulk::Receiver>(log_dir_);
     bulk_receiver_->Attach(*this);
   }
+  if (!kv_receiver_) {
+    kv_receiver_ = std::make_unique<sctp::kv::Receiver>(
+        log_dir_, kv_config_.buffered_cap);
+    kv_receiver_->Attach(*this);
+  }
+  if (!mesh_receiver_) {
+    mesh_receiver_ = std::make_unique<sctp::mesh::Receiver>(log_dir_);
+    mesh_receiver_->Attach(*this);
+  }
+
+  StartProfileFlows();
+}
+
+void Conductor::OnControlCommand(const std::string& cmd) {
+  const size_t space = cmd.find(' ');
+  const std::string verb = cmd.substr(0, space);
+  if (verb == "layer") {
+    if (space != std::string::npos)
+      SelectLayer(cmd.substr(space + 1));
+    return;
+  }
+  const std::string flow =
+      space == std::string::npos ? "bulk" : cmd.substr(space + 1);
+
+  if (verb == "start") {
+    if (sctp::Sender* sender = GetOrCreateSender(flow))
+      sender->Start(*this);
+    else
+      RTC_LOG(LS_WARNING) << "Unknown SCTP flow: " << flow;
+  } else if (verb == "stop") {
+    sctp::Sender* sender = flow == "bulk"   ? bulk_sender_.get()
+                           : flow == "kv"   ? kv_sender_.get()
+                           : flow == "mesh" ? mesh_sender_.get()
+                                            : nullptr;
+    if (sender)
+      sender->Stop();
+  }
+}
+
+sctp::Sender* Conductor::GetOrCreateSender(const std::string& flow) {
+  if (flow == "bulk") {
+    if (!bulk_sender_)
+      bulk_sender_ = std::make_unique<sctp::bulk::Sender>();
+    return bulk_sender_.get();
+  }
+  if (flow == "kv") {
+    if (!kv_sender_)
+      kv_sender_ = std::make_unique<sctp::kv::Sender>(kv_config_);
+    return kv_sender_.get();
+  }
+  if (flow == "mesh") {
+    if (!mesh_sender_)
+      mesh_sender_ = std::make_unique<sctp::mesh::Sender>(mesh_config_);
+    return mesh_sender_.get();
+  }
+  return nullptr;
+}
+
+void Conductor::SendControlCommand(const std::string& cmd) {
+  SendPayload(TrafficKind::kControl,
+              absl::Span<const uint8_t>(
+                  reinterpret_cast<const uint8_t*>(cmd.data()), cmd.size()));
+}
+
+void Conductor::SelectLayer(const std::string& layer) {
+  if (!peer_connection_)
+    return;
+  for (const auto& sender : peer_connection_->GetSenders()) {
+    if (sender->media_type() != cricket::MEDIA_TYPE_VIDEO)
+      continue;
+    webrtc::RtpParameters parameters = sender->GetParameters();
+    std::vector<webrtc::RtpEncodingParameters>& encodings =
+        parameters.encodings;
+    if (layer == "all") {
+      // Back to the run profile's layers, as set up in AddTracks().
+      const std::vector<RunProfile::Layer>& layers = run_profile_.layers;
+      if (encodings.size() != layers.size())
+        continue;
+      for (size_t i = 0; i < encodings.size(); ++i) {
+        encodings[i].active = layers[i].active;
+        if (layers[i].scalability_mode)
+          encodings[i].scalability_mode = layers[i].scalability_mode;
+      }
+    } else if (encodings.size() > 1) {
+      // Simulcast: keep only the encoding with that rid.
+      bool found = false;
+      for (webrtc::RtpEncodingParameters& encoding : encodings) {
+        encoding.active = encoding.rid == layer;
+        found |= encoding.active;
+      }
+      if (!found) {
+        RTC_LOG(LS_WARNING) << "No simulcast layer with rid " << layer;
+        continue;
+      }
+    } else if (!encodings.empty()) {
+      // SVC: send the layers of a lower scalability mode.
+      encodings[0].scalability_mode = layer;
+    }
+    webrtc::RTCError error = sender->SetParameters(parameters);
+    if (!error.ok()) {
+      RTC_LOG(LS_WARNING) << "Failed to select layer " << layer << ": "
+                          << error.message();
+      continue;
+    }
+    RTC_LOG(LS_INFO) << "Sending layer " << layer << " on " << sender->id();
+  }
+}
+
+void Conductor::SelectRemoteLayer(const std::string& layer) {
+  SendControlCommand("layer " + layer);
+  std::lock_guard<std::mutex> lock(layer_log_mutex_);
+  if (!layer_log_.is_open()) {
+    layer_log_.open(log_dir_ + "/layer_switches.csv");
+    layer_log_ << "timestamp,layer\n";
+  }
+  layer_log_ << rtc::TimeMillis() << "," << layer << std::endl;
+}
+
+void Conductor::ScheduleLayerSwitches() {
+  RTC_DCHECK(ui_thread_->IsCurrent());
+  // One schedule per call, however many video tracks arrive.
+  if (layer_safety_ || !peer_connection_)
+    return;
+  layer_safety_ = webrtc::PendingTaskSafetyFlag::Create();
+  for (const std::string& entry : layer_schedule_) {
+    const size_t colon = entry.find(':');
+    int seconds = -1;
+    if (colon != std::string::npos &&
+        !rtc::FromString(entry.substr(0, colon), &seconds)) {
+      seconds = -1;
+    }
+    if (seconds < 0 || colon + 1 == entry.size()) {
+      RTC_LOG(LS_WARNING) << "Ignoring layer schedule entry " << entry;
+      continue;
+    }
+    ui_thread_->PostDelayedTask(
+        webrtc::SafeTask(layer_safety_,
+                         [this, layer = entry.substr(colon + 1)] {
+                           SelectRemoteLayer(layer);
+                         }),
+        webrtc::TimeDelta::Seconds(seconds));
+  }
 }
 
 void Conductor::DisconnectFromCurrentPeer() {
@@ -1355,25 +1743,15 @@ void Conductor::DisconnectFromCurrentPeer() {
 void Conductor::StartBulkSctp() {
   if (bulk_receiver_)
     bulk_receiver_->LogStart();
-  const std::string cmd = "start";
-  SendPayload(TrafficKind::kControl,
-              absl::Span<const uint8_t>(
-                  reinterpret_cast<const uint8_t*>(cmd.data()), cmd.size()));
+  for (const std::string& flow : sctp_flows_)
+    SendControlCommand("start " + flow);
 }
 
 void Conductor::StopBulkSctp() {
   if (bulk_receiver_)
     bulk_receiver_->LogStop();
-  const std::string cmd = "stop";
-  SendPayload(TrafficKind::kControl,
-              absl::Span<const uint8_t>(
-                  reinterpret_cast<const uint8_t*>(cmd.data()), cmd.size()));
-}
-
-void Conductor::ServiceWebSocket() {
-  if (ws_client_) {
-    ws_client_->Service();
-  }
+  for (const std::string& flow : sctp_flows_)
+    SendControlCommand("stop " + flow);
 }
 
 void Conductor::SetEmulationMode(bool is_emulation, bool is_sender) {
@@ -1402,33 +1780,6 @@ void Conductor::UIThreadCallback(int msg_id, void* data) {
       }
       break;
 
-    case SEND_MESSAGE_TO_PEER: {
-      RTC_LOG(LS_INFO) << "SEND_MESSAGE_TO_PEER";
-      std::string* msg = reinterpret_cast<std::string*>(data);
-      if (msg) {
-        // For convenience, we always run the message through the queue.
-        // This way we can be sure that messages are sent to the server
-        // in the same order they were signaled without much hassle.
-        pending_messages_.push_back(std::move(msg));
-      }
-
-      if (!pending_messages_.empty() && !client_->IsSendingMessage()) {
-        msg = pending_messages_.front();
-        pending_messages_.pop_front();
-
-        if (!client_->SendToPeer(peer_id_, *msg) && peer_id_ != -1) {
-          RTC_LOG(LS_ERROR) << "SendToPeer failed";
-          DisconnectFromServer();
-        }
-        delete msg;
-      }
-
-      if (!peer_connection_.get())
-        peer_id_ = -1;
-
-      break;
-    }
-
     case NEW_TRACK_ADDED: {
       auto* track = reinterpret_cast<webrtc::MediaStreamTrackInterface*>(data);
       if (track->kind() == webrtc::MediaStreamTrackInterface::kVideoKind) {
@@ -1451,7 +1802,6 @@ void Conductor::UIThreadCallback(int msg_id, void* data) {
       RTC_DCHECK_NOTREACHED();
       break;
   }
-  ServiceWebSocket();
 }
 
 void Conductor::OnSuccess(webrtc::SessionDescriptionInterface* desc) {
@@ -1488,93 +1838,132 @@ void Conductor::OnFailure(webrtc::RTCError error) {
   RTC_LOG(LS_ERROR) << ToString(error.type()) << ": " << error.message();
 }
 
-/*
 void Conductor::SendMessage(const std::string& json_object) {
-  std::string* msg = new std::string(json_object);
-  main_wnd_->QueueUIThreadCallback(SEND_MESSAGE_TO_PEER, msg);
+  {
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    outbox_.push_back({json_object, Json::Value()});
+    // Candidates after this message must not overtake it.
+    batch_open_ = false;
+  }
+  ScheduleSignalDrain(/*force=*/false);
 }
-*/
-// Modify SendMessage in conductor.cc:
-void Conductor::SendMessage(const std::string& json_object) {
-  int a = 1;
-  if (a) {
-    // Use HTTP POST if initiator
-    if (!InitializeCurl()) {
-      RTC_LOG(LS_ERROR) << "Failed to initialize CURL for sending message";
-      return;
-    }
 
-    response_buffer_.clear();
-    struct curl_slist *headers = nullptr;
-    bool request_success = false;
+void Conductor::SendCandidate(Json::Value candidate) {
+  {
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    if (!batch_open_) {
+      outbox_.push_back({std::string(), Json::Value(Json::arrayValue)});
+      batch_open_ = true;
+      batch_started_ms_ = rtc::TimeMillis();
+    }
+    outbox_.back().candidates.append(std::move(candidate));
+  }
+  ScheduleSignalDrain(/*force=*/false);
+}
 
-    do {
-        headers = curl_slist_append(nullptr, "Content-Type: application/json");
-        if (!headers) {
-            RTC_LOG(LS_ERROR) << "Failed to create headers";
-            break;
-        }
-        
-        // Set all CURL options
-        curl_easy_setopt(curl_, CURLOPT_URL, post_url_.c_str());
-        curl_easy_setopt(curl_, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, json_object.c_str());
-        curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, json_object.length());
-        curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &response_buffer_);
-        
-        // Important SSL settings
-        curl_easy_setopt(curl_, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_setopt(curl_, CURLOPT_SSL_VERIFYHOST, 0L);
-        
-        // Connection settings
-        curl_easy_setopt(curl_, CURLOPT_TIMEOUT, 10L);
-        curl_easy_setopt(curl_, CURLOPT_CONNECTTIMEOUT, 10L);
-        curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L); // For multi-threaded apps
-
-        RTC_LOG(LS_INFO) << "POST " << post_url_ << " " << json_object;
-
-        CURLcode res = curl_easy_perform(curl_);
-        if (res != CURLE_OK) {
-            RTC_LOG(LS_ERROR) << "curl_easy_perform() failed: " << curl_easy_strerror(res);
-            break;
-        }
+void Conductor::ScheduleSignalDrain(bool force) {
+  {
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    if (drain_scheduled_ && !force)
+      return;
+    drain_scheduled_ = true;
+  }
+  // |http_thread_| is stopped before the Conductor goes away.
+  http_thread_->PostTask([this] { DrainSignals(); });
+}
 
-        long response_code;
-        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &response_code);
-        if (response_code >= 200 && response_code < 300) {
-            request_success = true;
-        } else {
-            RTC_LOG(LS_ERROR) << "HTTP error: " << response_code;
+void Conductor::DrainSignals() {
+  while (true) {
+    OutgoingSignal next;
+    {
+      std::lock_guard<std::mutex> lock(outbox_mutex_);
+      if (outbox_.empty()) {
+        drain_scheduled_ = false;
+        return;
+      }
+      if (outbox_.size() == 1 && batch_open_) {
+        const int64_t wait_ms =
+            batch_started_ms_ + kCandidateBatchWindowMs - rtc::TimeMillis();
+        if (wait_ms > 0) {
+          // |drain_scheduled_| stays set; this drain comes back for it.
+          http_thread_->PostDelayedTask([this] { DrainSignals(); },
+                                        webrtc::TimeDelta::Millis(wait_ms));
+          return;
         }
-
-    } while (false);
-
-    if (headers) {
-        curl_slist_free_all(headers);
-    }
-
-    if (!request_success) {
-        RTC_LOG(LS_ERROR) << "Failed to send message";
+        batch_open_ = false;
+      }
+      next = std::move(outbox_.front());
+      outbox_.pop_front();
     }
-
-  } else {
-    // Use WebSocket if not initiator
-    if (!ws_client_ || !ws_client_->IsConnected()) {
-      RTC_LOG(LS_ERROR) << "WebSocket not connected";
-      return;
+    if (next.candidates.isNull()) {
+      DeliverSignal(next.message);
+    } else {
+      Json::Value batch;
+      batch["type"] = "candidates";
+      batch["candidates"] = std::move(next.candidates);
+      DeliverSignal(rtc::JsonValueToString(batch));
     }
+  }
+}
 
-    // Wrap the message in AppRTC format
-    Json::Value wrapped_message;
-    wrapped_message["cmd"] = "send";
-    wrapped_message["msg"] = json_object;
+void Conductor::DeliverSignal(const std::string& message) {
+  if (local_room_) {
+    const std::string result =
+        local_room_->PostMessage(room_id_, client_id_, message);
+    if (result.find("\"SUCCESS\"") == std::string::npos)
+      RTC_LOG(LS_ERROR) << "Failed to send message: " << result;
+    return;
+  }
+  // AppRTC accepts /message from either side; the room server forwards it
+  // over the collider once the peer has registered.
+  RTC_LOG(LS_INFO) << "POST " << post_url_ << " " << message;
+  std::string response;
+  if (!PostToRoom(post_url_, message, &response))
+    RTC_LOG(LS_ERROR) << "Failed to send message";
+}
 
-    std::string message = rtc::JsonValueToString(wrapped_message);
-    RTC_LOG(LS_INFO) << "Sending WebSocket message: " << message;
-    ws_client_->SendMessage(message);
+bool Conductor::PostToRoom(const std::string& url,
+                           const std::string& payload,
+                           std::string* response) {
+  RTC_DCHECK(http_thread_->IsCurrent());
+  if (!curl_) {
+    RTC_LOG(LS_ERROR) << "CURL is not initialized";
+    return false;
+  }
+  // Reset drops the options, not the connection cache, so consecutive
+  // POSTs to the room server reuse one TCP/TLS connection.
+  curl_easy_reset(curl_);
+  struct curl_slist* headers = nullptr;
+  headers = curl_slist_append(headers, "Content-Type: application/json");
+  headers = curl_slist_append(headers, "User-Agent: peerconnection-client/1.0");
+  curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl_, CURLOPT_POST, 1L);
+  curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, payload.c_str());
+  curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, payload.length());
+  curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, WriteCallback);
+  curl_easy_setopt(curl_, CURLOPT_WRITEDATA, response);
+  curl_easy_setopt(curl_, CURLOPT_SSL_VERIFYPEER, 0L);
+  curl_easy_setopt(curl_, CURLOPT_SSL_VERIFYHOST, 0L);
+  curl_easy_setopt(curl_, CURLOPT_TIMEOUT, 10L);
+  curl_easy_setopt(curl_, CURLOPT_CONNECTTIMEOUT, 10L);
+  curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl_, CURLOPT_TCP_KEEPALIVE, 1L);
+
+  bool success = false;
+  const CURLcode res = curl_easy_perform(curl_);
+  if (res != CURLE_OK) {
+    RTC_LOG(LS_ERROR) << "curl_easy_perform() failed: "
+                      << curl_easy_strerror(res);
+  } else {
+    long response_code = 0;
+    curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &response_code);
+    success = response_code >= 200 && response_code < 300;
+    if (!success)
+      RTC_LOG(LS_ERROR) << "HTTP error: " << response_code;
   }
+  curl_slist_free_all(headers);
+  return success;
 }
 
 // Replace old stats methods with new ones
@@ -1588,9 +1977,18 @@ void Conductor::GetReceiverVideoStats() {
     if (!stats_collector_) {
         stats_collector_ = std::make_unique<RTCStatsCollector>();
     }
+    if (outbound_layer_stats_) {
+        stats_collector_->SetReportObserver(
+            [layers = outbound_layer_stats_.get()](
+                const webrtc::RTCStatsReport& report) {
+                layers->OnReport(report);
+            });
+    }
 
     // Start collection if not already running
     if (!stats_collector_->IsRunning()) {
+        stats_collector_->SetIntervalMs(stats_interval_ms_);
+        stats_collector_->SetCollectionMode(stats_mode_);
         if (stats_collector_->Start(log_dir_, peer_connection_)) {
             RTC_LOG(LS_INFO) << "Started stats collection to " << log_dir_;
         } else {
@@ -1608,17 +2006,12 @@ bool Conductor::AddSctpFlow(TrafficKind kind, const std::string& label, const we
   auto ch = peer_connection_->CreateDataChannel(label, &cfg);
   if (!ch) { RTC_LOG(LS_ERROR) << "CreateDataChannel failed for " << label; return false; }
 
-  auto on_payload = [this, kind](absl::Span<const uint8_t> bytes) {
-    auto fit = flows_.find(kind);
-    if (fit != flows_.end() && fit->second.handler) fit->second.handler(bytes);
-  };
-
   if (it == flows_.end()) {
-    Flow f; f.channel = ch; f.observer = std::make_unique<MyDataObserver>(ch, on_payload); f.label = label;
+    Flow f; f.channel = ch; f.observer = CreateFlowObserver(kind, ch); f.label = label;
     flows_.emplace(kind, std::move(f));
   } else {
     it->second.channel  = ch;  
-    it->second.observer = std::make_unique<MyDataObserver>(ch, on_payload);
+    it->second.observer = CreateFlowObserver(kind, ch);
     it->second.label    = label;
   }
 
@@ -1628,24 +2021,35 @@ bool Conductor::AddSctpFlow(TrafficKind kind, const std::string& label, const we
 }
 
 
-void Conductor::SendPayload(TrafficKind kind, absl::Span<const uint8_t> data) {
+std::unique_ptr<MyDataObserver> Conductor::CreateFlowObserver(
+    TrafficKind kind,
+    rtc::scoped_refptr<webrtc::DataChannelInterface> channel) {
+  auto on_payload = [this, kind](absl::Span<const uint8_t> bytes) {
+    auto fit = flows_.find(kind);
+    if (fit != flows_.end() && fit->second.handler) fit->second.handler(bytes);
+  };
+  auto on_buffered_amount = [this, kind](uint64_t buffered_amount) {
+    auto fit = flows_.find(kind);
+    if (fit != flows_.end() && fit->second.buffered_handler)
+      fit->second.buffered_handler(buffered_amount);
+  };
+  return std::make_unique<MyDataObserver>(std::move(channel), on_payload,
+                                          on_buffered_amount);
+}
+
+bool Conductor::SendPayload(TrafficKind kind, absl::Span<const uint8_t> data) {
+  return SendPayload(kind, rtc::CopyOnWriteBuffer(data.data(), data.size()));
+}
+
+bool Conductor::SendPayload(TrafficKind kind, rtc::CopyOnWriteBuffer payload) {
   auto it = flows_.find(kind);
   if (it == flows_.end() || !it->second.channel ||
       it->second.channel->state() != webrtc::DataChannelInterface::kOpen) {
     RTC_LOG(LS_WARNING) << "Flow " << static_cast<int>(kind) << " not ready";
-    return;
+    return false;
   }
-  // If you keep the 1-byte header, prepend it:
-  std::vector<uint8_t> buf;
-  buf.reserve(data.size() + 1);
-  buf.push_back(static_cast<uint8_t>(kind));
-  buf.insert(buf.end(), data.begin(), data.end());
-
-
-    const std::string kPattern = "hello data";
-  it->second.channel->Send(webrtc::DataBuffer(kPattern));
-
-  it->second.channel->Send(webrtc::DataBuffer(rtc::CopyOnWriteBuffer(buf), true));
+  return it->second.channel->Send(
+      webrtc::DataBuffer(std::move(payload), /*binary=*/true));
 }
 
 void Conductor::RegisterPayloadHandler(TrafficKind kind, PayloadHandler handler) {
@@ -1660,6 +2064,18 @@ void Conductor::RegisterPayloadHandler(TrafficKind kind, PayloadHandler handler)
   it->second.handler = std::move(handler);
 }
 
+void Conductor::RegisterBufferedAmountHandler(TrafficKind kind,
+                                              BufferedAmountHandler handler) {
+  auto it = flows_.find(kind);
+  if (it == flows_.end()) {
+    Flow f;
+    f.buffered_handler = std::move(handler);
+    flows_.emplace(kind, std::move(f));
+    return;
+  }
+  it->second.buffered_handler = std::move(handler);
+}
+
 bool Conductor::IsFlowOpen(TrafficKind kind) const {
   auto it = flows_.find(kind);
   if (it == flows_.end() || !it->second.channel) return false;
@@ -1670,4 +2086,20 @@ uint64_t Conductor::BufferedAmount(TrafficKind kind) const {
   auto it = flows_.find(kind);
   if (it == flows_.end() || !it->second.channel) return 0;
   return it->second.channel->buffered_amount();
-}
\ No newline at end of file
+}
+
+size_t Conductor::MaxMessageSize() const {
+  // RFC 8841: the size to assume when the remote gives no limit.
+  constexpr size_t kDefaultMaxMessageSize = 64 * 1024;
+  if (!peer_connection_)
+    return kDefaultMaxMessageSize;
+  rtc::scoped_refptr<webrtc::SctpTransportInterface> transport =
+      peer_connection_->GetSctpTransport();
+  if (!transport)
+    return kDefaultMaxMessageSize;
+  const std::optional<double> max_message_size =
+      transport->Information().MaxMessageSize();
+  if (!max_message_size || *max_message_size <= 0)
+    return kDefaultMaxMessageSize;
+  return static_cast<size_t>(*max_message_size);
+}
@@ -19,6 +19,7 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
@@ -29,18 +30,34 @@
 #include "api/media_stream_interface.h"
 #include "api/peer_connection_interface.h"
 #include "api/rtc_error.h"
+#include "api/rtp_parameters.h"
 #include "api/rtp_receiver_interface.h"
 #include "api/scoped_refptr.h"
+#include "api/task_queue/pending_task_safety_flag.h"
 #include "api/task_queue/task_queue_factory.h"
+#include "examples/peerconnection/client/certificate_pool.h"
+#include "examples/peerconnection/client/collider_connection.h"
+#include "examples/peerconnection/client/frame_timing_info.h"
+#include "examples/peerconnection/client/headless_frame_sink.h"
 #include "examples/peerconnection/client/main_wnd.h"
+#include "examples/peerconnection/client/outbound_layer_stats.h"
 #include "examples/peerconnection/client/peer_connection_client.h"
 #include "examples/peerconnection/client/rtc_stats_collector.h"
+#include "examples/peerconnection/client/run_metrics.h"
+#include "examples/peerconnection/client/run_profile.h"
 #include "examples/peerconnection/client/traffic_profile.h"
+#include "examples/peerconnection/client/traffic_scheduler.h"
 #include "examples/peerconnection/client/websocket_client.h"
 #include "json/value.h"
+#include "rtc_base/copy_on_write_buffer.h"
+#include "rtc_base/physical_socket_server.h"
 #include "rtc_base/thread.h"
 #include "sctp_traffic/bulk/bulk_receiver.h"
 #include "sctp_traffic/bulk/bulk_sender.h"
+#include "sctp_traffic/kv/kv_receiver.h"
+#include "sctp_traffic/kv/kv_sender.h"
+#include "sctp_traffic/mesh/mesh_receiver.h"
+#include "sctp_traffic/mesh/mesh_sender.h"
 
 namespace webrtc {
 class VideoCaptureModule;
@@ -50,6 +67,7 @@ namespace cricket {
 class VideoRenderer;
 }  // namespace cricket
 
+class LocalRoomServer;
 class MyDataObserver;
 
 class Conductor : public webrtc::PeerConnectionObserver,
@@ -60,7 +78,6 @@ class Conductor : public webrtc::PeerConnectionObserver,
   enum CallbackID {
     MEDIA_CHANNELS_INITIALIZED = 1,
     PEER_CONNECTION_CLOSED,
-    SEND_MESSAGE_TO_PEER,
     NEW_TRACK_ADDED,
     TRACK_REMOVED,
   };
@@ -82,38 +99,142 @@ class Conductor : public webrtc::PeerConnectionObserver,
   bool connection_active() const;
 
   void Close() override;
-  
-  void ServiceWebSocket();
 
   void SetRoomId(const std::string& room_id) { room_id_ = room_id; }
+  // Joins rooms on |server| in-process instead of over HTTPS at the login
+  // server. |server| must outlive the conductor.
+  void SetLocalRoomServer(LocalRoomServer* server) { local_room_ = server; }
+  // The UI thread's socket server; the AppRTC WebSocket registers its
+  // descriptors there so signaling is handled as soon as it arrives.
+  void SetSocketServer(rtc::PhysicalSocketServer* socket_server) {
+    socket_server_ = socket_server;
+  }
 
   void SetEmulationMode(bool is_emulation, bool is_sender);
 
   void SetNetInterface(std::string interface_name);
 
   void SetY4mPath(const std::string& path) { y4m_path_ = path; }
+  // Fault Y4M sources fully into RAM before streaming instead of paging
+  // them in on demand.
+  void SetY4mPreload(bool preload) { y4m_preload_ = preload; }
 
   // juheon added
   void SetHeadless(bool headless) { headless_ = headless; }
+  // In headless mode, checksums and/or compares every remote video frame
+  // against a reference Y4M; see HeadlessFrameSink.
+  void SetFrameVerification(const HeadlessFrameSink::Options& options) {
+    frame_verification_ = options;
+  }
 
   void SetLogDirectory(const std::string& log_dir) { log_dir_ = log_dir; }
 
   void SetTrafficProfile(const std::string& path) { traffic_csv_path_ = path; }
 
+  // Flows ("bulk", "kv", "mesh") the remote is asked to generate when SCTP
+  // traffic is started from the UI.
+  void SetSctpFlows(std::vector<std::string> flows) {
+    sctp_flows_ = std::move(flows);
+  }
+  // Settings for the kv and mesh generators, used when they are created.
+  void SetSctpGeneratorConfigs(const sctp::kv::Config& kv,
+                               const sctp::mesh::Config& mesh) {
+    kv_config_ = kv;
+    mesh_config_ = mesh;
+  }
+
+  // Receiver side: "<seconds>:<layer>" entries, each asking the sender to
+  // switch to <layer> that many seconds after the remote video arrives.
+  void SetLayerSchedule(std::vector<std::string> schedule) {
+    layer_schedule_ = std::move(schedule);
+  }
+  // Receiver side: asks the sender to send only |layer| (a simulcast rid
+  // or a scalability mode), or "all" for the run profile's layers again.
+  // Switches are logged to layer_switches.csv.
+  void SelectRemoteLayer(const std::string& layer);
+
+  void SetStatsIntervalMs(int interval_ms) { stats_interval_ms_ = interval_ms; }
+  void SetStatsSelectorMode(bool enabled) {
+    stats_mode_ = enabled
+                      ? RTCStatsCollector::CollectionMode::kReceiverSelector
+                      : RTCStatsCollector::CollectionMode::kFullReport;
+  }
+
+  // Takes effect at Start(). On convergence the call is closed as if the
+  // peer had left.
+  void SetRunMetricsOptions(const RunMetrics::Options& options) {
+    run_metrics_options_ = options;
+  }
+  // Null before Start().
+  RunMetrics* run_metrics() const { return run_metrics_.get(); }
+
   enum class TrafficKind {kKv, kMesh, kBulkTest, kControl};
   using PayloadHandler = std::function<void(absl::Span<const uint8_t>)>;
+  // Invoked on the signaling thread with the channel's current
+  // buffered_amount() whenever queued data drains to the transport.
+  using BufferedAmountHandler = std::function<void(uint64_t)>;
 
   bool AddSctpFlow(TrafficKind kind, const std::string& label, const webrtc::DataChannelInit& cfg);
-  void SendPayload(TrafficKind kind, absl::Span<const uint8_t> data);
+  // Flows are identified by their channel, so payloads go out untagged.
+  // The span overload copies once; the buffer overload hands |payload| to
+  // the channel without copying, so callers can keep a prebuilt buffer and
+  // resend it.
+  bool SendPayload(TrafficKind kind, absl::Span<const uint8_t> data);
+  bool SendPayload(TrafficKind kind, rtc::CopyOnWriteBuffer payload);
   void RegisterPayloadHandler(TrafficKind kind, PayloadHandler handler);
+  void RegisterBufferedAmountHandler(TrafficKind kind,
+                                     BufferedAmountHandler handler);
 
   bool IsFlowOpen(TrafficKind kind) const;
   uint64_t BufferedAmount(TrafficKind kind) const;
-
-  rtc::Thread* signaling_thread() const { return signaling_thread_.get(); }
+  // Largest message the remote accepts on any flow, as negotiated in SDP
+  // (a=max-message-size); 64 KiB until the SCTP transport is up.
+  size_t MaxMessageSize() const;
+
+  rtc::Thread* signaling_thread() const {
+    return shared_signaling_thread_ ? shared_signaling_thread_
+                                    : signaling_thread_.get();
+  }
+
+  // Builds the factory every Conductor uses: builtin codecs, no audio
+  // device. |task_queue_factory| receives the factory's task queue factory,
+  // which lives as long as the returned factory.
+  static rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface>
+  CreateFactory(rtc::Thread* signaling_thread,
+                webrtc::TaskQueueFactory** task_queue_factory);
+
+  // Makes InitializePeerConnection() reuse |factory| (created by
+  // CreateFactory() on |signaling_thread|) instead of building its own, so
+  // several Conductors share one set of signaling/worker/network threads.
+  void SetSharedFactory(
+      rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> factory,
+      rtc::Thread* signaling_thread,
+      webrtc::TaskQueueFactory* task_queue_factory) {
+    shared_factory_ = std::move(factory);
+    shared_signaling_thread_ = signaling_thread;
+    task_queue_factory_ = task_queue_factory;
+  }
+
+  // Certificates for CreatePeerConnection(); Start() creates a private pool
+  // if none was set.
+  void SetCertificatePool(std::shared_ptr<CertificatePool> pool) {
+    certificate_pool_ = std::move(pool);
+  }
+
+  // Codecs, layers, bitrate envelope, ports and ICE timers of the calls.
+  void SetRunProfile(const RunProfile& profile) { run_profile_ = profile; }
+
+  // Local UDP port range for ICE candidates; overrides the run profile's.
+  void SetPortRange(int min_port, int max_port) {
+    run_profile_.min_port = min_port;
+    run_profile_.max_port = max_port;
+  }
 
  protected:
   ~Conductor();
+  // Creates (or adopts the shared) factory if there is none yet. The
+  // factory then lives until the Conductor is destroyed.
+  bool PrewarmFactory();
   bool InitializePeerConnection();
   bool ReinitializePeerConnectionForLoopback();
   bool CreatePeerConnection();
@@ -121,6 +242,20 @@ class Conductor : public webrtc::PeerConnectionObserver,
   void EnsureStreamingUI();
   void AddTracks();
   void AddSCTPs();
+  // Adds one video track per RTP row of the traffic profile; returns false
+  // if there are none.
+  bool AddProfileVideoTracks();
+  // Starts the SCTP rows of the traffic profile on this (sending) peer.
+  void StartProfileFlows();
+  // Handles "start [flow]" / "stop [flow]" and "layer <layer>" from the
+  // remote's ctrl channel; a bare start/stop addresses the bulk flow.
+  void OnControlCommand(const std::string& cmd);
+  // Sender side of SelectRemoteLayer().
+  void SelectLayer(const std::string& layer);
+  // On the UI thread, once per call.
+  void ScheduleLayerSwitches();
+  sctp::Sender* GetOrCreateSender(const std::string& flow);
+  void SendControlCommand(const std::string& cmd);
 
   //
   // PeerConnectionObserver implementation.
@@ -138,9 +273,9 @@ class Conductor : public webrtc::PeerConnectionObserver,
       rtc::scoped_refptr<webrtc::DataChannelInterface> channel) override;
   void OnRenegotiationNeeded() override {}
   void OnIceConnectionChange(
-      webrtc::PeerConnectionInterface::IceConnectionState new_state) override {}
+      webrtc::PeerConnectionInterface::IceConnectionState new_state) override;
   void OnIceGatheringChange(
-      webrtc::PeerConnectionInterface::IceGatheringState new_state) override {}
+      webrtc::PeerConnectionInterface::IceGatheringState new_state) override;
   void OnIceCandidate(const webrtc::IceCandidateInterface* candidate) override;
   void OnIceConnectionReceivingChange(bool receiving) override {}
 
@@ -186,8 +321,12 @@ class Conductor : public webrtc::PeerConnectionObserver,
   std::string GetLogFolder() const override {return log_dir_;}
 
  protected:
-  // Send a message to the remote peer.
+  // Send a message to the remote peer. Queued and posted to the room in
+  // order on |http_thread_|.
   void SendMessage(const std::string& json_object);
+  // Queues one {label,id,candidate}. Candidates gathered within
+  // kCandidateBatchWindowMs of the first leave as one "candidates" message.
+  void SendCandidate(Json::Value candidate);
 
   int peer_id_;
   bool loopback_;
@@ -196,15 +335,29 @@ class Conductor : public webrtc::PeerConnectionObserver,
   rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection_;
   rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface>
       peer_connection_factory_;
+  // Video codecs |peer_connection_factory_| can send, looked up once in
+  // PrewarmFactory().
+  std::vector<webrtc::RtpCodecCapability> video_sender_codecs_;
+  // Set when running under SessionManager.
+  rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> shared_factory_;
+  rtc::Thread* shared_signaling_thread_ = nullptr;
+  std::shared_ptr<CertificatePool> certificate_pool_;
+  RunProfile run_profile_;
+  rtc::Thread* ui_thread_ = nullptr;
 
   // One flow = one channel + its observer + its handler.
   struct Flow {
     rtc::scoped_refptr<webrtc::DataChannelInterface> channel;
    std::unique_ptr<MyDataObserver> observer;
     PayloadHandler handler;  // nullable until user registers it
+    BufferedAmountHandler buffered_handler;  // nullable
     std::string label;       // for debugging / remote mapping
   };
 
+  std::unique_ptr<MyDataObserver> CreateFlowObserver(
+      TrafficKind kind,
+      rtc::scoped_refptr<webrtc::DataChannelInterface> channel);
+
    // Map flows by kind
    std::unordered_map<TrafficKind, Flow> flows_;
 
@@ -219,6 +372,13 @@ class Conductor : public webrtc::PeerConnectionObserver,
    // Bulk SCTP traffic helpers.
    std::unique_ptr<sctp::bulk::Sender> bulk_sender_;
    std::unique_ptr<sctp::bulk::Receiver> bulk_receiver_;
+   std::unique_ptr<sctp::kv::Sender> kv_sender_;
+   std::unique_ptr<sctp::kv::Receiver> kv_receiver_;
+   std::unique_ptr<sctp::mesh::Sender> mesh_sender_;
+   std::unique_ptr<sctp::mesh::Receiver> mesh_receiver_;
+   std::vector<std::string> sctp_flows_ = {"bulk"};
+   sctp::kv::Config kv_config_;
+   sctp::mesh::Config mesh_config_;
 
    /*
    rtc::scoped_refptr<webrtc::DataChannelInterface> data_channel_;
@@ -230,13 +390,18 @@ class Conductor : public webrtc::PeerConnectionObserver,
 
    PeerConnectionClient* client_;
    MainWindow* main_wnd_;
-   std::deque<std::string*> pending_messages_;
 
   private:
-   std::unique_ptr<WebSocketClient> ws_client_;
+   std::unique_ptr<ColliderConnection> ws_client_;
 
+   // Continues StartLogin() on the UI thread with the /join response body.
+   void OnJoinResponse(const std::string& response);
    void OnWebSocketMessage(const std::string& message);
    void OnWebSocketConnection(bool connected);
+   // Adds one {label,id,candidate} from the peer.
+   bool AddRemoteCandidate(const Json::Value& jcandidate);
+   // Appends |event| to setup_timing.csv with the time since StartLogin().
+   void LogSetupEvent(const char* event);
 
    Json::Value messages_;
 
@@ -249,6 +414,41 @@ class Conductor : public webrtc::PeerConnectionObserver,
    Json::Value initial_messages_;
 
    std::string post_url_;  // For HTTP POST when initiator
+   LocalRoomServer* local_room_ = nullptr;
+   rtc::PhysicalSocketServer* socket_server_ = nullptr;
+   // Runs /join and every /message POST off the UI and signaling threads,
+   // in order, on the one keep-alive |curl_| handle.
+   std::unique_ptr<rtc::Thread> http_thread_;
+   bool join_pending_ = false;
+
+   // A queued signaling message; |candidates| is set for a candidate batch.
+   struct OutgoingSignal {
+     std::string message;
+     Json::Value candidates;
+   };
+   // Posts a drain of |outbox_| unless one is pending; |force| posts anyway,
+   // so a batch still inside its window leaves now.
+   void ScheduleSignalDrain(bool force);
+   // On |http_thread_|.
+   void DrainSignals();
+   void DeliverSignal(const std::string& message);
+   bool PostToRoom(const std::string& url,
+                   const std::string& payload,
+                   std::string* response);
+   // Applies the call's bitrate limits once the remote description is set.
+   void ApplyBitrateSettings();
+
+   std::mutex outbox_mutex_;
+   std::deque<OutgoingSignal> outbox_;
+   // Whether outbox_.back() is a batch that still takes candidates.
+   bool batch_open_ = false;
+   int64_t batch_started_ms_ = 0;
+   bool drain_scheduled_ = false;
+   bool bitrate_applied_ = false;
+
+   int64_t login_start_ms_ = 0;
+   std::mutex setup_log_mutex_;
+   std::ofstream setup_log_;
 
    static bool curl_initialized_;
    CURL* curl_ = nullptr;
@@ -258,16 +458,30 @@ class Conductor : public webrtc::PeerConnectionObserver,
                                void* userp);
    bool InitializeCurl();
    void CleanupCurl();
-   std::string response_buffer_;
 
    std::string net_interface_;
    bool is_emulation_ = false;
    bool is_sender_ = true;
    std::string y4m_path_;
+   bool y4m_preload_ = false;
   std::string log_dir_;
 
   std::string traffic_csv_path_;
   std::vector<TrafficProfile> traffic_profiles_;
+  std::unique_ptr<TrafficScheduler> traffic_scheduler_;
+  // Per-frame receive timing of every remote video track.
+  std::unique_ptr<FrameTimingLogger> frame_timing_logger_;
+  std::optional<HeadlessFrameSink::Options> frame_verification_;
+  std::unique_ptr<HeadlessFrameSink> headless_sink_;
+  RunMetrics::Options run_metrics_options_;
+  std::unique_ptr<RunMetrics> run_metrics_;
+  // Per-layer send rates, on the sending peer.
+  std::unique_ptr<OutboundLayerStats> outbound_layer_stats_;
+  std::vector<std::string> layer_schedule_;
+  // Created on the UI thread per call; cleared when the call ends.
+  rtc::scoped_refptr<webrtc::PendingTaskSafetyFlag> layer_safety_;
+  std::mutex layer_log_mutex_;
+  std::ofstream layer_log_;
 
    // juheon added
    bool headless_ = false;
@@ -276,6 +490,9 @@ class Conductor : public webrtc::PeerConnectionObserver,
    void GetReceiverVideoStats();
 
    std::unique_ptr<RTCStatsCollector> stats_collector_;
+   int stats_interval_ms_ = 200;
+   RTCStatsCollector::CollectionMode stats_mode_ =
+       RTCStatsCollector::CollectionMode::kFullReport;
 
    using StatsCallback =
        std::function<void(StatsType type, const std::string& message)>;
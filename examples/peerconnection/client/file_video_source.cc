@@ -1,146 +1,158 @@
-// file_video_source.h
-#ifndef FILE_VIDEO_SOURCE_H_
-#define FILE_VIDEO_SOURCE_H_
-
-#include "api/video/video_frame.h"
-#include "api/video/video_source_interface.h"
-#include "pc/video_track_source.h"
-#include "rtc_tools/video_file_reader.h"
-#include "rtc_base/thread.h"
-#include "media/base/video_broadcaster.h"
-#include "rtc_base/system/rtc_export.h"
-
-class FileVideoSource : public webrtc::VideoTrackSource {
- public:
-  static rtc::scoped_refptr<FileVideoSource> Create(
-      const std::string& file_path, 
-      int target_fps,
-      int width = 0,    // Only needed for .yuv files
-      int height = 0);  // Only needed for .yuv files
-
- protected:
-  explicit FileVideoSource(rtc::scoped_refptr<webrtc::test::Video> video_file,
-                          int target_fps);
-
- private:
-  class FrameGenerator : public rtc::VideoSourceInterface<webrtc::VideoFrame> {
-   public:
-    FrameGenerator(rtc::scoped_refptr<webrtc::test::Video> video_file,
-                  int target_fps);
-    ~FrameGenerator() override;
-
-    void AddOrUpdateSink(rtc::VideoSinkInterface<webrtc::VideoFrame>* sink,
-                        const rtc::VideoSinkWants& wants) override;
-    void RemoveSink(rtc::VideoSinkInterface<webrtc::VideoFrame>* sink) override;
-
-   private:
-    void StartTimer();
-    void OnFrame();
-
-    rtc::scoped_refptr<webrtc::test::Video> video_file_;
-    cricket::VideoBroadcaster broadcaster_;  // Changed from rtc to cricket
-    std::unique_ptr<rtc::Thread> thread_;
-    webrtc::test::Video::Iterator frame_iterator_;
-    int target_fps_;
-    bool running_;
-  };
-
-  std::unique_ptr<FrameGenerator> frame_generator_;
-  rtc::VideoSourceInterface<webrtc::VideoFrame>* source() override {
-    return frame_generator_.get();
-  }
-};
+#include "examples/peerconnection/client/file_video_source.h"
 
-#endif  // FILE_VIDEO_SOURCE_H_
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <utility>
 
-// file_video_source.cc
-#include "file_video_source.h"
+#include "api/make_ref_counted.h"
 #include "rtc_base/logging.h"
 #include "rtc_base/time_utils.h"
 
-FileVideoSource::FrameGenerator::FrameGenerator(
-    rtc::scoped_refptr<webrtc::test::Video> video_file,
-    int target_fps)
-    : video_file_(video_file),
-      frame_iterator_(video_file->begin()),
-      target_fps_(target_fps),
-      running_(false) {
-  thread_ = rtc::Thread::CreateWithSocketServer();  // Changed to CreateWithSocketServer
-  thread_->Start();
-}
+#if defined(WEBRTC_LINUX)
+#include <errno.h>
+#include <time.h>
+#endif
 
-FileVideoSource::FrameGenerator::~FrameGenerator() {
-  running_ = false;
-  thread_->Stop();
+rtc::scoped_refptr<FileVideoSource> FileVideoSource::Create(
+    std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator,
+    int target_fps,
+    const std::string& pacing_log_path) {
+  if (!generator || target_fps <= 0)
+    return nullptr;
+  return rtc::make_ref_counted<FileVideoSource>(std::move(generator),
+                                                target_fps, pacing_log_path);
 }
 
-void FileVideoSource::FrameGenerator::AddOrUpdateSink(
-    rtc::VideoSinkInterface<webrtc::VideoFrame>* sink,
-    const rtc::VideoSinkWants& wants) {
-  broadcaster_.AddOrUpdateSink(sink, wants);
-  if (!running_)
-    StartTimer();
+FileVideoSource::FileVideoSource(
+    std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator,
+    int target_fps,
+    const std::string& pacing_log_path)
+    : VideoTrackSource(/*remote=*/false),
+      frame_generator_(std::make_unique<FrameGenerator>(
+          std::move(generator),
+          target_fps,
+          pacing_log_path)) {
+  frame_generator_->Start();
 }
 
-void FileVideoSource::FrameGenerator::RemoveSink(
-    rtc::VideoSinkInterface<webrtc::VideoFrame>* sink) {
-  broadcaster_.RemoveSink(sink);
-  if (!broadcaster_.has_sinks())  // Changed from GetSinks().empty()
-    running_ = false;
+FileVideoSource::~FileVideoSource() = default;
+
+FileVideoSource::FrameGenerator::FrameGenerator(
+    std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator,
+    int target_fps,
+    const std::string& pacing_log_path)
+    : generator_(std::move(generator)),
+      period_ns_(rtc::kNumNanosecsPerSec / target_fps),
+      decimation_(std::max(
+          1,
+          static_cast<int>(
+              static_cast<double>(generator_->fps().value_or(target_fps)) /
+                  target_fps +
+              0.5))) {
+  if (pacing_log_path.empty())
+    return;
+  pacing_log_.open(pacing_log_path);
+  if (!pacing_log_.is_open()) {
+    RTC_LOG(LS_ERROR) << "Failed to open " << pacing_log_path;
+    return;
+  }
+  pacing_log_ << "frame,ideal_us,inserted_us,lateness_us,skipped\n";
 }
 
-void FileVideoSource::FrameGenerator::StartTimer() {
-  running_ = true;
-  thread_->PostTask(rtc::ToQueuedTask([this]() {  // Changed to use ToQueuedTask
-    while (running_) {
-      OnFrame();
-      rtc::Thread::Current()->SleepMs(1000 / target_fps_);
-    }
-  }));
+FileVideoSource::FrameGenerator::~FrameGenerator() {
+  Stop();
 }
 
-void FileVideoSource::FrameGenerator::OnFrame() {
-  if (frame_iterator_ == video_file_->end()) {
-    frame_iterator_ = video_file_->begin(); // Loop back to start
-  }
+void FileVideoSource::FrameGenerator::Start() {
+  if (running_.exchange(true))
+    return;
+  thread_ = std::thread([this] { PacingLoop(); });
+}
 
-  webrtc::VideoFrame video_frame =
-      webrtc::VideoFrame::Builder()
-          .set_video_frame_buffer(*frame_iterator_)
-          .set_timestamp_us(rtc::TimeMicros())
-          .set_rotation(webrtc::kVideoRotation_0)
-          .build();
+void FileVideoSource::FrameGenerator::Stop() {
+  if (!running_.exchange(false))
+    return;
+  if (thread_.joinable())
+    thread_.join();
+  RTC_LOG(LS_INFO) << "FileVideoSource: " << frames_ << " frames inserted, "
+                   << skipped_ << " skipped, max lateness "
+                   << max_lateness_us_ << " us";
+  pacing_log_.flush();
+}
 
-  broadcaster_.OnFrame(video_frame);
-  ++frame_iterator_;
+int FileVideoSource::FrameGenerator::GetFrameWidth() const {
+  webrtc::MutexLock lock(&generator_lock_);
+  return static_cast<int>(generator_->GetResolution().width);
 }
 
-FileVideoSource::FileVideoSource(
-    rtc::scoped_refptr<webrtc::test::Video> video_file,
-    int target_fps)
-    : VideoTrackSource(/*remote=*/false) {
-  frame_generator_ = std::make_unique<FrameGenerator>(video_file, target_fps);
+int FileVideoSource::FrameGenerator::GetFrameHeight() const {
+  webrtc::MutexLock lock(&generator_lock_);
+  return static_cast<int>(generator_->GetResolution().height);
 }
 
-rtc::scoped_refptr<FileVideoSource> FileVideoSource::Create(
-    const std::string& file_path,
-    int target_fps,
-    int width,
-    int height) {
-  rtc::scoped_refptr<webrtc::test::Video> video_file;
-  
-  if (width != 0 && height != 0) {
-    // If dimensions are provided, try to open as YUV file
-    video_file = webrtc::test::OpenYuvFile(file_path, width, height);
-  } else {
-    // Try to open as either YUV or Y4M file
-    video_file = webrtc::test::OpenYuvOrY4mFile(file_path, width, height);
+void FileVideoSource::FrameGenerator::SleepUntil(int64_t deadline_ns) {
+#if defined(WEBRTC_LINUX)
+  // rtc::TimeNanos() reads CLOCK_MONOTONIC here, so the deadline can be
+  // handed to the kernel as is.
+  timespec ts;
+  ts.tv_sec = deadline_ns / rtc::kNumNanosecsPerSec;
+  ts.tv_nsec = deadline_ns % rtc::kNumNanosecsPerSec;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) ==
+         EINTR) {
   }
+#else
+  const int64_t remaining_ns = deadline_ns - rtc::TimeNanos();
+  if (remaining_ns > 0)
+    std::this_thread::sleep_for(std::chrono::nanoseconds(remaining_ns));
+#endif
+}
 
-  if (!video_file) {
-    RTC_LOG(LS_ERROR) << "Failed to open video file: " << file_path;
-    return nullptr;
+void FileVideoSource::FrameGenerator::PacingLoop() {
+  const int64_t start_ns = rtc::TimeNanos();
+  uint64_t slot = 0;
+  while (running_.load(std::memory_order_relaxed)) {
+    int64_t deadline_ns = start_ns + static_cast<int64_t>(slot) * period_ns_;
+    SleepUntil(deadline_ns);
+
+    // Waking a full period late means the next slots are already due; drop
+    // them instead of bursting frames at the encoder to catch up.
+    const int64_t late_ns = rtc::TimeNanos() - deadline_ns;
+    const int64_t missed = late_ns > 0 ? late_ns / period_ns_ : 0;
+    slot += missed;
+    deadline_ns += missed * period_ns_;
+
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer;
+    std::optional<webrtc::VideoFrame::UpdateRect> update_rect;
+    {
+      webrtc::MutexLock lock(&generator_lock_);
+      // Keep content time in step with wall time across skipped slots.
+      const int64_t skip = (missed + 1) * decimation_ - 1;
+      for (int64_t i = 0; i < skip; ++i)
+        generator_->SkipNextFrame();
+      webrtc::test::FrameGeneratorInterface::VideoFrameData frame_data =
+          generator_->NextFrame();
+      buffer = std::move(frame_data.buffer);
+      update_rect = frame_data.update_rect;
+    }
+    const int64_t inserted_us = rtc::TimeMicros();
+    TestVideoCapturer::OnFrame(webrtc::VideoFrame::Builder()
+                                   .set_video_frame_buffer(buffer)
+                                   .set_timestamp_us(inserted_us)
+                                   .set_update_rect(update_rect)
+                                   .build());
+
+    // Logged after delivery so file I/O never sits between a deadline and
+    // the insert it measures.
+    const int64_t ideal_us = deadline_ns / rtc::kNumNanosecsPerMicrosec;
+    const int64_t lateness_us = inserted_us - ideal_us;
+    ++frames_;
+    skipped_ += missed;
+    max_lateness_us_ = std::max(max_lateness_us_, lateness_us);
+    if (pacing_log_.is_open()) {
+      pacing_log_ << slot << "," << ideal_us << "," << inserted_us << ","
+                  << lateness_us << "," << missed << "\n";
+    }
+    ++slot;
   }
-
-  return rtc::make_ref_counted<FileVideoSource>(video_file, target_fps);
-}
\ No newline at end of file
+}
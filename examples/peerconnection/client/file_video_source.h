@@ -1,53 +1,98 @@
-#ifndef FILE_VIDEO_SOURCE_H_
-#define FILE_VIDEO_SOURCE_H_
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_FILE_VIDEO_SOURCE_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_FILE_VIDEO_SOURCE_H_
 
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "api/scoped_refptr.h"
+#include "api/test/frame_generator_interface.h"
 #include "api/video/video_frame.h"
 #include "api/video/video_source_interface.h"
 #include "pc/video_track_source.h"
-#include "rtc_tools/video_file_reader.h"
-#include "rtc_base/thread.h"
-#include "media/base/video_broadcaster.h"
-#include "rtc_base/system/rtc_export.h"
+#include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/thread_annotations.h"
+#include "test/test_video_capturer.h"
 
+// Video track source that feeds frames from a FrameGeneratorInterface at a
+// fixed rate. Frame n is due at start + n * period on the monotonic clock
+// (rtc::TimeNanos), and the pacing thread sleeps until that absolute deadline
+// rather than for a relative interval, so oversleeping on one frame does not
+// push back every later one.
+//
+// When the thread wakes a whole period or more past a deadline, the missed
+// slots are skipped (the generator advances past their frames) and the
+// current one is sent at once. Each inserted frame is logged to the pacing
+// CSV with its ideal and actual insert time and the number of slots skipped
+// before it:
+//
+//   frame,ideal_us,inserted_us,lateness_us,skipped
+//
+// inserted_us is the frame's timestamp_us, i.e. the capture time the sender
+// stamps on the frame, so lateness_us is the capture-side share of the
+// end-to-end delay in frame_timing.csv.
 class FileVideoSource : public webrtc::VideoTrackSource {
  public:
+  // |target_fps| is the insert rate; when the generator reports a higher
+  // native rate, frames in between are skipped in content time. An empty
+  // |pacing_log_path| disables the CSV. Starts pacing immediately.
   static rtc::scoped_refptr<FileVideoSource> Create(
-      const std::string& file_path, 
+      std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator,
       int target_fps,
-      int width = 0,    // Only needed for .yuv files
-      int height = 0);  // Only needed for .yuv files
+      const std::string& pacing_log_path);
 
  protected:
-  explicit FileVideoSource(rtc::scoped_refptr<webrtc::test::Video> video_file,
-                          int target_fps);
+  FileVideoSource(
+      std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator,
+      int target_fps,
+      const std::string& pacing_log_path);
+  ~FileVideoSource() override;
 
  private:
-  class FrameGenerator : public rtc::VideoSourceInterface<webrtc::VideoFrame> {
+  class FrameGenerator : public webrtc::test::TestVideoCapturer {
    public:
-    FrameGenerator(rtc::scoped_refptr<webrtc::test::Video> video_file,
-                  int target_fps);
+    FrameGenerator(
+        std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator,
+        int target_fps,
+        const std::string& pacing_log_path);
     ~FrameGenerator() override;
 
-    void AddOrUpdateSink(rtc::VideoSinkInterface<webrtc::VideoFrame>* sink,
-                        const rtc::VideoSinkWants& wants) override;
-    void RemoveSink(rtc::VideoSinkInterface<webrtc::VideoFrame>* sink) override;
+    void Start() override;
+    void Stop() override;
+    int GetFrameWidth() const override;
+    int GetFrameHeight() const override;
 
    private:
-    void StartTimer();
-    void OnFrame();
-
-    rtc::scoped_refptr<webrtc::test::Video> video_file_;
-    cricket::VideoBroadcaster broadcaster_;  // Changed from rtc to cricket
-    std::unique_ptr<rtc::Thread> thread_;
-    webrtc::test::Video::Iterator frame_iterator_;
-    int target_fps_;
-    bool running_;
+    void PacingLoop();
+    // Sleeps until |deadline_ns| on the rtc::TimeNanos() clock.
+    static void SleepUntil(int64_t deadline_ns);
+
+    mutable webrtc::Mutex generator_lock_;
+    const std::unique_ptr<webrtc::test::FrameGeneratorInterface> generator_
+        RTC_GUARDED_BY(generator_lock_);
+    const int64_t period_ns_;
+    // Content frames advanced per inserted frame, from the generator's
+    // native rate over |target_fps|.
+    const int decimation_;
+
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    // Written only by the pacing thread.
+    std::ofstream pacing_log_;
+    uint64_t frames_ = 0;
+    uint64_t skipped_ = 0;
+    int64_t max_lateness_us_ = 0;
   };
 
-  std::unique_ptr<FrameGenerator> frame_generator_;
   rtc::VideoSourceInterface<webrtc::VideoFrame>* source() override {
     return frame_generator_.get();
   }
+
+  std::unique_ptr<FrameGenerator> frame_generator_;
 };
 
-#endif  // FILE_VIDEO_SOURCE_H_
\ No newline at end of file
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_FILE_VIDEO_SOURCE_H_
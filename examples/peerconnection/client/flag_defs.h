@@ -12,6 +12,7 @@
 #define EXAMPLES_PEERCONNECTION_CLIENT_FLAG_DEFS_H_
 
 #include <string>
+#include <vector>
 
 #include "absl/flags/flag.h"
 
@@ -59,4 +60,128 @@ ABSL_FLAG(std::string,
           "",
           "CSV file describing traffic profiles");
 
+ABSL_FLAG(int,
+          stats_interval_ms,
+          200,
+          "Receiver getStats() polling period in milliseconds. Samples are "
+          "kept in stats_ring.bin; see analysis/stats_ring_to_csv.py.");
+
+ABSL_FLAG(bool,
+          stats_selector,
+          false,
+          "Poll getStats() per video receiver instead of for the whole "
+          "PeerConnection, and log which stats_ring.bin fields changed "
+          "between polls to stats_delta.log.");
+
+ABSL_FLAG(bool,
+          y4m_preload,
+          false,
+          "Load Y4M video sources fully into (locked) memory at startup "
+          "instead of paging them in from disk while streaming.");
+
+ABSL_FLAG(bool,
+          frame_checksum,
+          false,
+          "With --headless, checksum a grid of luma samples of every decoded "
+          "frame into headless_frames.csv.");
+
+ABSL_FLAG(std::string,
+          quality_ref,
+          "",
+          "With --headless, Y4M the decoded frames are compared against; "
+          "per-frame PSNR and SSIM go to headless_frames.csv.");
+
+ABSL_FLAG(int,
+          quality_workers,
+          2,
+          "Threads computing PSNR/SSIM for --quality_ref.");
+
+ABSL_FLAG(int,
+          num_sessions,
+          1,
+          "Number of concurrent sessions sharing one PeerConnectionFactory "
+          "(Linux, requires --headless when above 1). Session i joins room "
+          "<room_id>-i and logs to <log dir>/session_i.");
+
+ABSL_FLAG(std::vector<std::string>,
+          sctp_flows,
+          std::vector<std::string>({"bulk"}),
+          "Comma-separated SCTP generators the remote peer starts when SCTP "
+          "traffic is started: bulk, kv, mesh.");
+
+ABSL_FLAG(std::string,
+          kv_request_size,
+          "fixed:128",
+          "Size distribution of kv requests: fixed:<bytes>, "
+          "uniform:<min>-<max>, exp:<mean>[:<max>] or "
+          "lognormal:<median>:<sigma>[:<max>].");
+
+ABSL_FLAG(std::string,
+          kv_response_size,
+          "lognormal:1024:1.0:16384",
+          "Size distribution of the responses kv requests ask for; same "
+          "format as --kv_request_size.");
+
+ABSL_FLAG(std::string,
+          mesh_message_size,
+          "exp:200:4096",
+          "Size distribution of mesh messages; same format as "
+          "--kv_request_size.");
+
+ABSL_FLAG(bool,
+          local_room,
+          false,
+          "Host an AppRTC-compatible room server in this process and join "
+          "rooms there instead of at --server.");
+
+ABSL_FLAG(int,
+          local_room_port,
+          0,
+          "With --local_room, also serve it on 127.0.0.1:<port> so a peer in "
+          "another process can join with --server=http://127.0.0.1:<port>.");
+
+ABSL_FLAG(std::string,
+          run_profile,
+          "",
+          "JSON run profile: codec preference, simulcast/SVC layers, "
+          "degradation preference, bitrate envelope, field trials, ports and "
+          "ICE timers. See run_profile.h for the format.");
+
+ABSL_FLAG(std::string,
+          video_layers,
+          "",
+          "Sender: \"simulcast\" for three simulcast encodings (rids q, h, "
+          "f), or a scalability mode such as L1T3 or L3T3_KEY for VP9/AV1 "
+          "SVC. Replaces the layers of --run_profile.");
+
+ABSL_FLAG(std::vector<std::string>,
+          layer_schedule,
+          std::vector<std::string>(),
+          "Receiver: comma-separated <seconds>:<layer> entries; <seconds> "
+          "after the remote video arrives, the sender is told over the ctrl "
+          "channel to send only <layer> (a rid, a scalability mode, or all).");
+
+ABSL_FLAG(int,
+          metrics_period_ms,
+          1000,
+          "Period of the metrics_snapshots.jsonl lines; metrics_summary.json "
+          "is written when the call ends.");
+
+ABSL_FLAG(double,
+          converge_tolerance,
+          0.0,
+          "End the call once p50 and p95 of the e2e delay (SCTP delay "
+          "without video) change by at most this fraction over "
+          "--converge_windows snapshots, e.g. 0.02. 0 disables.");
+
+ABSL_FLAG(int,
+          converge_windows,
+          5,
+          "Consecutive stable snapshots needed by --converge_tolerance.");
+
+ABSL_FLAG(int,
+          converge_min_s,
+          30,
+          "Shortest run --converge_tolerance may end.");
+
 #endif  // EXAMPLES_PEERCONNECTION_CLIENT_FLAG_DEFS_H_
@@ -0,0 +1,170 @@
+#include "examples/peerconnection/client/frame_timing_info.h"
+
+#include <chrono>
+#include <utility>
+
+#include "rtc_base/logging.h"
+#include "rtc_base/time_utils.h"
+#include "system_wrappers/include/clock.h"
+
+namespace {
+constexpr auto kDrainInterval = std::chrono::milliseconds(100);
+}  // namespace
+
+class FrameTimingLogger::TrackSink
+    : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
+ public:
+  TrackSink(FrameTimingLogger* logger,
+            int index,
+            rtc::scoped_refptr<webrtc::VideoTrackInterface> track)
+      : logger_(logger), index_(index), track_(std::move(track)) {
+    track_->AddOrUpdateSink(this, rtc::VideoSinkWants());
+  }
+  ~TrackSink() override { track_->RemoveSink(this); }
+
+  void OnFrame(const webrtc::VideoFrame& frame) override {
+    const webrtc::VideoFrame::FrameTiming& timing = frame.frame_timing();
+    FrameTimingRecord record;
+    record.log_time_ms = rtc::TimeMillis();
+    record.track = index_;
+    record.timing = timing.timing_info;
+    // ntp_time_ms() is the capture time in the local NTP clock, 0 until an
+    // RTCP sender report has been received.
+    if (frame.ntp_time_ms() > 0) {
+      record.e2e_ms =
+          webrtc::Clock::GetRealTimeClock()->CurrentNtpInMilliseconds() -
+          frame.ntp_time_ms();
+    }
+    record.packets = frame.packet_infos().size();
+    record.frame_size = timing.encoded_size;
+    record.qp = timing.qp;
+    record.width = frame.width();
+    record.height = frame.height();
+    record.is_keyframe = timing.is_keyframe;
+    logger_->Push(record);
+
+    if (RunMetrics* metrics = logger_->metrics_) {
+      const int64_t now_us = rtc::TimeMicros();
+      if (last_frame_us_ >= 0)
+        metrics->Add(RunMetrics::kFrameIntervalUs, now_us - last_frame_us_);
+      last_frame_us_ = now_us;
+      if (record.e2e_ms >= 0)
+        metrics->Add(RunMetrics::kE2eDelayUs, record.e2e_ms * 1000);
+    }
+  }
+
+ private:
+  FrameTimingLogger* const logger_;
+  const int index_;
+  const rtc::scoped_refptr<webrtc::VideoTrackInterface> track_;
+  // Decoder thread only.
+  int64_t last_frame_us_ = -1;
+};
+
+FrameTimingLogger::FrameTimingLogger(const std::string& log_dir,
+                                     size_t capacity)
+    : ring_(capacity), log_file_(log_dir + "/frame_timing.csv") {
+  if (!log_file_.is_open()) {
+    RTC_LOG(LS_ERROR) << "Failed to open " << log_dir << "/frame_timing.csv";
+  }
+  log_file_ << "timestamp,track,rtp_timestamp,capture_time,encode_start,"
+               "encode_finish,packetization_finish,pacer_exit,"
+               "network_timestamp,network2_timestamp,receive_start,"
+               "receive_finish,decode_start,decode_finish,render_time,"
+               "is_outlier,is_timer_triggered,e2e_ms,packets,frame_size,qp,"
+               "width,height,is_keyframe\n";
+  drain_thread_ = std::thread([this] { DrainLoop(); });
+}
+
+FrameTimingLogger::~FrameTimingLogger() {
+  Stop();
+}
+
+void FrameTimingLogger::AddTrack(
+    rtc::scoped_refptr<webrtc::VideoTrackInterface> track) {
+  const int index = static_cast<int>(sinks_.size());
+  sinks_.push_back(std::make_unique<TrackSink>(this, index, std::move(track)));
+}
+
+void FrameTimingLogger::Stop() {
+  // RemoveSink() returns once no OnFrame() is in flight for that sink.
+  sinks_.clear();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_)
+      return;
+    running_ = false;
+  }
+  wake_.notify_all();
+  if (drain_thread_.joinable())
+    drain_thread_.join();
+  if (dropped_ > 0) {
+    RTC_LOG(LS_WARNING) << "frame_timing.csv: " << dropped_
+                        << " frames dropped, drain fell behind";
+  }
+  if (rows_written_ > 0 && rows_without_e2e_ == rows_written_) {
+    RTC_LOG(LS_WARNING) << "frame_timing.csv: no RTCP sender report arrived, "
+                           "so e2e_ms is -1 throughout";
+  } else if (rows_without_e2e_ > 0) {
+    RTC_LOG(LS_INFO) << "frame_timing.csv: e2e_ms is -1 for the "
+                     << rows_without_e2e_ << " of " << rows_written_
+                     << " frames decoded before the first sender report";
+  }
+  log_file_.close();
+}
+
+void FrameTimingLogger::Push(const FrameTimingRecord& record) {
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (head_ - tail_ == ring_.size()) {
+      ++dropped_;
+      return;
+    }
+    ring_[head_ % ring_.size()] = record;
+    ++head_;
+    wake = head_ - tail_ == ring_.size() / 2;
+  }
+  if (wake)
+    wake_.notify_one();
+}
+
+void FrameTimingLogger::DrainLoop() {
+  std::vector<FrameTimingRecord> rows;
+  rows.reserve(ring_.size());
+  bool running = true;
+  while (running) {
+    rows.clear();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait_for(lock, kDrainInterval, [this] {
+        return !running_ || head_ - tail_ >= ring_.size() / 2;
+      });
+      running = running_;
+      for (; tail_ != head_; ++tail_)
+        rows.push_back(ring_[tail_ % ring_.size()]);
+    }
+    WriteRows(rows);
+  }
+  log_file_.flush();
+}
+
+void FrameTimingLogger::WriteRows(const std::vector<FrameTimingRecord>& rows) {
+  for (const FrameTimingRecord& row : rows) {
+    ++rows_written_;
+    if (row.e2e_ms < 0)
+      ++rows_without_e2e_;
+    const webrtc::TimingFrameInfo& t = row.timing;
+    log_file_ << row.log_time_ms << "," << row.track << "," << t.rtp_timestamp
+              << "," << t.capture_time_ms << "," << t.encode_start_ms << ","
+              << t.encode_finish_ms << "," << t.packetization_finish_ms << ","
+              << t.pacer_exit_ms << "," << t.network_timestamp_ms << ","
+              << t.network2_timestamp_ms << "," << t.receive_start_ms << ","
+              << t.receive_finish_ms << "," << t.decode_start_ms << ","
+              << t.decode_finish_ms << "," << t.render_time_ms << ","
+              << t.IsOutlier() << "," << t.IsTimerTriggered() << ","
+              << row.e2e_ms << "," << row.packets << "," << row.frame_size
+              << "," << row.qp << "," << row.width << "," << row.height << ","
+              << row.is_keyframe << "\n";
+  }
+}
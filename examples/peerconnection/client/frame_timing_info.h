@@ -1,65 +1,91 @@
-// frame_timing_logger.h
-#ifndef FRAME_TIMING_LOGGER_H_
-#define FRAME_TIMING_LOGGER_H_
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_FRAME_TIMING_INFO_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_FRAME_TIMING_INFO_H_
 
+#include <condition_variable>
+#include <cstdint>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include "api/media_stream_interface.h"
+#include "api/scoped_refptr.h"
 #include "api/video/video_frame.h"
 #include "api/video/video_sink_interface.h"
-#include "rtc_base/logging.h"
+#include "examples/peerconnection/client/run_metrics.h"
+
+// One decoded frame as seen by FrameTimingLogger. Times are local
+// milliseconds. The sender-side times in |timing| are -1 unless the frame
+// carried the video-timing extension, which senders attach only to
+// timer-triggered frames and size outliers.
+//
+// e2e_ms is known for every frame instead: it is the receiver's NTP clock
+// when the decoded frame arrives minus the frame's capture time, which
+// WebRTC maps into that clock from the sender's RTCP sender reports. It is
+// -1 until the first sender report; Stop() logs how many frames that was.
+struct FrameTimingRecord {
+  int64_t log_time_ms = 0;
+  int track = 0;
+  webrtc::TimingFrameInfo timing;
+  int64_t e2e_ms = -1;
+  size_t packets = 0;
+  size_t frame_size = 0;
+  int qp = -1;
+  int width = 0;
+  int height = 0;
+  bool is_keyframe = false;
+};
 
-class FrameTimingLogger : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
+// Records every decoded frame of the attached remote video tracks into
+// frame_timing.csv. OnFrame runs on the decoder thread and only copies the
+// frame's timing into a preallocated ring; a drain thread formats and writes
+// the rows. When the drain falls a full ring behind, new frames are counted
+// as dropped instead of blocking the decoder.
+class FrameTimingLogger {
  public:
-  explicit FrameTimingLogger(const std::string& log_dir) 
-      : log_file_(log_dir + "/frame_timing.csv") {
-    // Write CSV header
-    log_file_ << "timestamp,rtp_timestamp,capture_time,encode_start,encode_finish,"
-              << "packetization_finish,pacer_exit,network_timestamp,"
-              << "network2_timestamp,receive_start,receive_finish,"
-              << "decode_start,decode_finish,render_time,is_outlier,is_timer_triggered"
-              << std::endl;
-  }
+  static constexpr size_t kDefaultCapacity = 8192;
+
+  explicit FrameTimingLogger(const std::string& log_dir,
+                             size_t capacity = kDefaultCapacity);
+  ~FrameTimingLogger();
+
+  // Also feeds e2e delay and frame intervals into |metrics|, which must
+  // outlive the logger. Call before AddTrack().
+  void SetRunMetrics(RunMetrics* metrics) { metrics_ = metrics; }
 
-  void OnFrame(const webrtc::VideoFrame& frame) override {
-    const webrtc::TimingFrameInfo& timing = frame.timing();
-    
-    if (!timing.IsInvalid()) {
-      log_file_ << rtc::TimeMillis() << ","
-                << timing.rtp_timestamp << ","
-                << timing.capture_time_ms << ","
-                << timing.encode_start_ms << ","
-                << timing.encode_finish_ms << ","
-                << timing.packetization_finish_ms << ","
-                << timing.pacer_exit_ms << ","
-                << timing.network_timestamp_ms << ","
-                << timing.network2_timestamp_ms << ","
-                << timing.receive_start_ms << ","
-                << timing.receive_finish_ms << ","
-                << timing.decode_start_ms << ","
-                << timing.decode_finish_ms << ","
-                << timing.render_time_ms << ","
-                << timing.IsOutlier() << ","
-                << timing.IsTimerTriggered()
-                << std::endl;
-      
-      RTC_LOG(LS_INFO) << "Frame timing: "
-                       << "Capture-to-render delay: " << timing.EndToEndDelay() << "ms"
-                       << " Encoding time: " 
-                       << (timing.encode_finish_ms - timing.encode_start_ms) << "ms";
-    }
-    
-    // Forward frame to next sink if exists
-    if (next_sink_)
-      next_sink_->OnFrame(frame);
-  }
+  // Column "track" in the CSV is the order in which tracks were added.
+  void AddTrack(rtc::scoped_refptr<webrtc::VideoTrackInterface> track);
 
-  void SetNextSink(rtc::VideoSinkInterface<webrtc::VideoFrame>* sink) {
-    next_sink_ = sink;
-  }
+  // Detaches from all tracks, writes what is left in the ring and closes
+  // the file.
+  void Stop();
 
  private:
+  class TrackSink;
+
+  void Push(const FrameTimingRecord& record);
+  void DrainLoop();
+  void WriteRows(const std::vector<FrameTimingRecord>& rows);
+
+  std::vector<std::unique_ptr<TrackSink>> sinks_;
+  RunMetrics* metrics_ = nullptr;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::vector<FrameTimingRecord> ring_;
+  uint64_t head_ = 0;  // Next slot to write.
+  uint64_t tail_ = 0;  // Next slot to drain.
+  uint64_t dropped_ = 0;
+  bool running_ = true;
+
+  // Drain thread only.
+  uint64_t rows_written_ = 0;
+  uint64_t rows_without_e2e_ = 0;
+
   std::ofstream log_file_;
-  rtc::VideoSinkInterface<webrtc::VideoFrame>* next_sink_ = nullptr;
+  std::thread drain_thread_;
 };
 
-#endif  // FRAME_TIMING_LOGGER_H_
\ No newline at end of file
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_FRAME_TIMING_INFO_H_
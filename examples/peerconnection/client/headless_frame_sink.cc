@@ -0,0 +1,243 @@
+#include "examples/peerconnection/client/headless_frame_sink.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <utility>
+
+#include "api/video/i420_buffer.h"
+#include "common_video/libyuv/include/webrtc_libyuv.h"
+#include "examples/peerconnection/client/mapped_y4m_frame_generator.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/time_utils.h"
+
+namespace {
+constexpr int kChecksumColumns = 64;
+constexpr int kChecksumRows = 36;
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ull;
+constexpr uint64_t kFnvPrime = 1099511628211ull;
+// Reference frames the first compared frame is matched against.
+constexpr size_t kAlignWindow = 60;
+constexpr int kRtpClockRate = 90000;
+}  // namespace
+
+class HeadlessFrameSink::TrackSink
+    : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
+ public:
+  TrackSink(HeadlessFrameSink* owner,
+            int index,
+            rtc::scoped_refptr<webrtc::VideoTrackInterface> track)
+      : owner_(owner), index_(index), track_(std::move(track)) {
+    track_->AddOrUpdateSink(this, rtc::VideoSinkWants());
+  }
+  ~TrackSink() override { track_->RemoveSink(this); }
+
+  void OnFrame(const webrtc::VideoFrame& frame) override {
+    owner_->OnFrame(index_, frame);
+  }
+
+ private:
+  HeadlessFrameSink* const owner_;
+  const int index_;
+  const rtc::scoped_refptr<webrtc::VideoTrackInterface> track_;
+};
+
+HeadlessFrameSink::HeadlessFrameSink(const std::string& log_dir,
+                                     const Options& options)
+    : checksum_(options.checksum),
+      max_pending_buffers_(2 * std::max(1, options.workers)),
+      log_file_(log_dir + "/headless_frames.csv") {
+  if (!log_file_.is_open()) {
+    RTC_LOG(LS_ERROR) << "Failed to open " << log_dir
+                      << "/headless_frames.csv";
+  }
+  log_file_ << "timestamp,track,rtp_timestamp,width,height,checksum,"
+               "ref_frame,psnr,ssim\n";
+
+  if (!options.reference_y4m.empty()) {
+    reference_ = MappedY4mFrameGenerator::Create(
+        options.reference_y4m, MappedY4mFrameGenerator::Mode::kMapped);
+    if (reference_) {
+      reference_fps_ = reference_->frame_rate().value_or(reference_fps_);
+    } else {
+      RTC_LOG(LS_WARNING) << "Cannot map " << options.reference_y4m
+                          << "; PSNR/SSIM disabled";
+    }
+  }
+  const int workers = std::max(1, options.workers);
+  for (int i = 0; i < workers; ++i)
+    workers_.emplace_back([this] { WorkerLoop(); });
+}
+
+HeadlessFrameSink::~HeadlessFrameSink() {
+  Stop();
+}
+
+void HeadlessFrameSink::AddTrack(
+    rtc::scoped_refptr<webrtc::VideoTrackInterface> track) {
+  const int index = static_cast<int>(sinks_.size());
+  sinks_.push_back(std::make_unique<TrackSink>(this, index, std::move(track)));
+}
+
+void HeadlessFrameSink::Stop() {
+  // RemoveSink() returns once no OnFrame() is in flight for that sink.
+  sinks_.clear();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_)
+      return;
+    running_ = false;
+  }
+  wake_.notify_all();
+  for (std::thread& worker : workers_)
+    worker.join();
+  workers_.clear();
+  if (skipped_comparisons_ > 0) {
+    RTC_LOG(LS_WARNING) << "headless_frames.csv: " << skipped_comparisons_
+                        << " frames not compared, workers fell behind";
+  }
+  log_file_.close();
+}
+
+std::optional<uint64_t> HeadlessFrameSink::Checksum(
+    const webrtc::VideoFrameBuffer& buffer) {
+  const uint8_t* data_y = nullptr;
+  int stride_y = 0;
+  if (const webrtc::I420BufferInterface* i420 = buffer.GetI420()) {
+    data_y = i420->DataY();
+    stride_y = i420->StrideY();
+  } else if (const webrtc::NV12BufferInterface* nv12 = buffer.GetNV12()) {
+    data_y = nv12->DataY();
+    stride_y = nv12->StrideY();
+  } else {
+    // Native or high bit depth buffers would need a conversion.
+    return std::nullopt;
+  }
+  const int width = buffer.width();
+  const int height = buffer.height();
+  uint64_t hash = kFnvOffsetBasis;
+  for (int row = 0; row < kChecksumRows; ++row) {
+    const uint8_t* line =
+        data_y + static_cast<size_t>(row * height / kChecksumRows) * stride_y;
+    for (int column = 0; column < kChecksumColumns; ++column) {
+      hash ^= line[column * width / kChecksumColumns];
+      hash *= kFnvPrime;
+    }
+  }
+  return hash;
+}
+
+void HeadlessFrameSink::OnFrame(int track, const webrtc::VideoFrame& frame) {
+  Job job;
+  job.receive_ms = rtc::TimeMillis();
+  job.track = track;
+  job.rtp_timestamp = frame.rtp_timestamp();
+  job.width = frame.width();
+  job.height = frame.height();
+  if (checksum_)
+    job.checksum = Checksum(*frame.video_frame_buffer());
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (reference_) {
+      if (pending_buffers_ < max_pending_buffers_) {
+        job.buffer = frame.video_frame_buffer();
+        ++pending_buffers_;
+      } else {
+        ++skipped_comparisons_;
+      }
+    }
+    queue_.push_back(std::move(job));
+  }
+  wake_.notify_one();
+}
+
+void HeadlessFrameSink::WorkerLoop() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [this] { return !running_ || !queue_.empty(); });
+      if (queue_.empty())
+        return;
+      job = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    const bool held_buffer = job.buffer != nullptr;
+    Process(job);
+    if (held_buffer) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --pending_buffers_;
+    }
+  }
+}
+
+void HeadlessFrameSink::Process(Job& job) {
+  int64_t ref_frame = -1;
+  double psnr = -1;
+  double ssim = -1;
+  if (job.buffer) {
+    // Off the decoder thread, so a non-I420 buffer may be converted here.
+    rtc::scoped_refptr<webrtc::I420BufferInterface> frame =
+        job.buffer->ToI420();
+    job.buffer = nullptr;
+    rtc::scoped_refptr<webrtc::I420BufferInterface> ref =
+        reference_->FrameAt(0);
+    if (frame && (frame->width() != ref->width() ||
+                  frame->height() != ref->height())) {
+      rtc::scoped_refptr<webrtc::I420Buffer> scaled =
+          webrtc::I420Buffer::Create(ref->width(), ref->height());
+      scaled->ScaleFrom(*frame);
+      frame = scaled;
+    }
+    if (frame) {
+      Alignment* alignment;
+      {
+        std::lock_guard<std::mutex> lock(align_mutex_);
+        alignment = &alignments_[job.track];
+      }
+      std::call_once(alignment->once, [&] {
+        Align(job.track, *frame, job.rtp_timestamp, alignment);
+      });
+      const int64_t count = static_cast<int64_t>(reference_->frame_count());
+      const int32_t rtp_delta =
+          static_cast<int32_t>(job.rtp_timestamp - alignment->rtp_timestamp);
+      const int64_t offset = std::llround(static_cast<double>(rtp_delta) *
+                                          reference_fps_ / kRtpClockRate);
+      ref_frame =
+          ((static_cast<int64_t>(alignment->index) + offset) % count + count) %
+          count;
+      ref = reference_->FrameAt(static_cast<size_t>(ref_frame));
+      psnr = webrtc::I420PSNR(*ref, *frame);
+      ssim = webrtc::I420SSIM(*ref, *frame);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(file_mutex_);
+  log_file_ << job.receive_ms << "," << job.track << "," << job.rtp_timestamp
+            << "," << job.width << "," << job.height << ",";
+  if (job.checksum) {
+    log_file_ << std::hex << std::setw(16) << std::setfill('0')
+              << *job.checksum << std::dec << std::setfill(' ');
+  }
+  log_file_ << "," << ref_frame << "," << psnr << "," << ssim << "\n";
+}
+
+void HeadlessFrameSink::Align(int track,
+                              const webrtc::I420BufferInterface& frame,
+                              uint32_t rtp_timestamp,
+                              Alignment* alignment) {
+  const size_t window = std::min(kAlignWindow, reference_->frame_count());
+  double best_psnr = -1;
+  for (size_t i = 0; i < window; ++i) {
+    const double psnr = webrtc::I420PSNR(*reference_->FrameAt(i), frame);
+    if (psnr > best_psnr) {
+      best_psnr = psnr;
+      alignment->index = i;
+    }
+  }
+  alignment->rtp_timestamp = rtp_timestamp;
+  RTC_LOG(LS_INFO) << "Reference aligned for track " << track << ": RTP "
+                   << rtp_timestamp << " is frame " << alignment->index
+                   << " (PSNR " << best_psnr << " dB)";
+}
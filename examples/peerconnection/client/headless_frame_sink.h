@@ -0,0 +1,120 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_HEADLESS_FRAME_SINK_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_HEADLESS_FRAME_SINK_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "api/media_stream_interface.h"
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame.h"
+#include "api/video/video_frame_buffer.h"
+#include "api/video/video_sink_interface.h"
+
+class MappedY4mFrameGenerator;
+
+// Receiver-side frame verification for --headless runs. Attached to the
+// remote video tracks, it never converts or copies a decoded frame:
+//
+// - With |checksum|, OnFrame hashes a sparse grid of luma samples (FNV-1a)
+//   straight from the decoder's I420 or NV12 planes, enough to tell frames
+//   apart or spot a frozen stream.
+// - With |reference_y4m|, the decoded buffer is queued by reference to a
+//   worker pool that computes PSNR and SSIM against the matching source
+//   frame. Each track's first frame is aligned against the start of the
+//   reference; its later ones are placed by RTP timestamp at the
+//   reference's frame rate.
+//   Queued frames hold decoder buffers, so at most 2 * |workers| wait at a
+//   time and further frames skip the comparison.
+//
+// One row per frame goes to headless_frames.csv:
+//
+//   timestamp,track,rtp_timestamp,width,height,checksum,ref_frame,psnr,ssim
+//
+// checksum is empty and ref_frame, psnr, ssim are -1 when not computed.
+class HeadlessFrameSink {
+ public:
+  struct Options {
+    bool checksum = false;
+    std::string reference_y4m;
+    int workers = 2;
+  };
+
+  HeadlessFrameSink(const std::string& log_dir, const Options& options);
+  ~HeadlessFrameSink();
+
+  // Column "track" in the CSV is the order in which tracks were added.
+  void AddTrack(rtc::scoped_refptr<webrtc::VideoTrackInterface> track);
+
+  // Detaches from all tracks, finishes queued comparisons and closes the
+  // file.
+  void Stop();
+
+ private:
+  class TrackSink;
+
+  // RTP-to-reference mapping of one track, written once under |once|.
+  struct Alignment {
+    std::once_flag once;
+    size_t index = 0;
+    uint32_t rtp_timestamp = 0;
+  };
+
+  struct Job {
+    int64_t receive_ms = 0;
+    int track = 0;
+    uint32_t rtp_timestamp = 0;
+    int width = 0;
+    int height = 0;
+    std::optional<uint64_t> checksum;
+    // Set only when the frame is to be compared with the reference.
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer;
+  };
+
+  static std::optional<uint64_t> Checksum(
+      const webrtc::VideoFrameBuffer& buffer);
+
+  void OnFrame(int track, const webrtc::VideoFrame& frame);
+  void WorkerLoop();
+  void Process(Job& job);
+  // Picks the reference frame a track's first compared frame matches best,
+  // which anchors the RTP-to-reference mapping for the track's later frames.
+  void Align(int track,
+             const webrtc::I420BufferInterface& frame,
+             uint32_t rtp_timestamp,
+             Alignment* alignment);
+
+  const bool checksum_;
+  const size_t max_pending_buffers_;
+  std::unique_ptr<MappedY4mFrameGenerator> reference_;
+  double reference_fps_ = 30;
+
+  std::vector<std::unique_ptr<TrackSink>> sinks_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<Job> queue_;
+  size_t pending_buffers_ = 0;
+  uint64_t skipped_comparisons_ = 0;
+  bool running_ = true;
+  std::vector<std::thread> workers_;
+
+  // Tracks have their own RTP timestamp base, so each is aligned on its
+  // own. Map nodes never move, so an entry stays valid once
+  // |align_mutex_| is released.
+  std::mutex align_mutex_;
+  std::map<int, Alignment> alignments_;
+
+  std::mutex file_mutex_;
+  std::ofstream log_file_;
+};
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_HEADLESS_FRAME_SINK_H_
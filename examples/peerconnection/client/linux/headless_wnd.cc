@@ -3,9 +3,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <memory>
-#include "api/video/i420_buffer.h"
 #include "rtc_base/logging.h"
-#include "third_party/libyuv/include/libyuv/convert_from.h"
 #include "rtc_base/thread.h"
 
 /*
@@ -145,29 +143,9 @@ HeadlessWnd::VideoRenderer::~VideoRenderer() {
   rendered_track_->RemoveSink(this);
 }
 
-void HeadlessWnd::VideoRenderer::SetSize(int width, int height) {
-  if (width_ == width && height_ == height) {
-    return;
-  }
-  width_ = width;
-  height_ = height;
-  image_.SetSize(width * height * 4);  // ARGB
-}
-
 void HeadlessWnd::VideoRenderer::OnFrame(const webrtc::VideoFrame& video_frame) {
-  rtc::scoped_refptr<webrtc::I420BufferInterface> buffer(
-      video_frame.video_frame_buffer()->ToI420());
-  if (video_frame.rotation() != webrtc::kVideoRotation_0) {
-    buffer = webrtc::I420Buffer::Rotate(*buffer, video_frame.rotation());
-  }
-  SetSize(buffer->width(), buffer->height());
-
+  // Nothing is displayed, so the frame is neither converted nor copied.
+  width_ = video_frame.width();
+  height_ = video_frame.height();
   RTC_LOG(LS_VERBOSE) << "Received video frame: " << width_ << "x" << height_;
-
-  // Store frame data but don't display it since we're headless
-  libyuv::I420ToARGB(buffer->DataY(), buffer->StrideY(), 
-                     buffer->DataU(), buffer->StrideU(),
-                     buffer->DataV(), buffer->StrideV(),
-                     image_.data(), width_ * 4, 
-                     buffer->width(), buffer->height());
 }
\ No newline at end of file
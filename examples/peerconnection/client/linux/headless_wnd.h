@@ -43,13 +43,10 @@ class HeadlessWnd : public MainWindow {
     // VideoSinkInterface implementation
     void OnFrame(const webrtc::VideoFrame& frame) override;
 
-    rtc::ArrayView<const uint8_t> image() const { return image_; }
     int width() const { return width_; }
     int height() const { return height_; }
 
    protected:
-    void SetSize(int width, int height);
-    rtc::Buffer image_;
     int width_;
     int height_;
     HeadlessWnd* main_wnd_;
@@ -12,6 +12,10 @@
 #include <gtk/gtk.h>
 #include <stdio.h>
 #include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "absl/flags/parse.h"
 #include "absl/flags/usage.h"
@@ -19,7 +23,10 @@
 #include "examples/peerconnection/client/conductor.h"
 #include "examples/peerconnection/client/flag_defs.h"
 #include "examples/peerconnection/client/linux/main_wnd.h"
+#include "examples/peerconnection/client/local_room_server.h"
 #include "examples/peerconnection/client/peer_connection_client.h"
+#include "examples/peerconnection/client/run_profile.h"
+#include "examples/peerconnection/client/session_manager.h"
 #include "rtc_base/physical_socket_server.h"
 #include "rtc_base/ssl_adapter.h"
 #include "rtc_base/thread.h"
@@ -46,24 +53,18 @@ ABSL_FLAG(bool, headless, false,
 class CustomSocketServer : public rtc::PhysicalSocketServer {
  public:
   explicit CustomSocketServer(GtkMainWnd* wnd)
-      : wnd_(wnd), conductor_(NULL), client_(NULL) {}
+      : wnd_(wnd), sessions_(NULL) {}
   virtual ~CustomSocketServer() {}
 
   void SetMessageQueue(rtc::Thread* queue) override { message_queue_ = queue; }
 
-  void set_client(PeerConnectionClient* client) { client_ = client; }
-  void set_conductor(Conductor* conductor) { conductor_ = conductor; }
+  void set_sessions(SessionManager* sessions) { sessions_ = sessions; }
 
   bool Wait(webrtc::TimeDelta max_wait_duration, bool process_io) override {
     while (gtk_events_pending())
       gtk_main_iteration();
 
-    if (conductor_) {
-      conductor_->ServiceWebSocket();
-    }
-
-    if (!wnd_->IsWindow() && !conductor_->connection_active() &&
-        client_ != NULL && !client_->is_connected()) {
+    if (!wnd_->IsWindow() && sessions_ && !sessions_->Active()) {
       message_queue_->Quit();
     }
     return rtc::PhysicalSocketServer::Wait(webrtc::TimeDelta::Zero(),
@@ -73,8 +74,7 @@ class CustomSocketServer : public rtc::PhysicalSocketServer {
  protected:
   rtc::Thread* message_queue_;
   GtkMainWnd* wnd_;
-  Conductor* conductor_;
-  PeerConnectionClient* client_;
+  SessionManager* sessions_;
 };
 
 
@@ -87,6 +87,9 @@ Basic Options:
   --server=<hostname>         Signaling server hostname (default: localhost)
   --port=<port>              Server port (default: 8888)
   --room_id=<id>             Room ID for the session
+  --local_room               Use an in-process room server instead of --server
+  --local_room_port=<port>   Also serve it on 127.0.0.1:<port>; the other peer
+                             then passes --server=http://127.0.0.1:<port>
 
 Experiment Mode Options:
   --experiment_mode=<mode>    Operation mode (default: real)
@@ -142,7 +145,27 @@ Example Commands:
   // Parse command line flags
   std::vector<char*> remaining_args = absl::ParseCommandLine(argc, argv);
 
-  const std::string forced_field_trials = absl::GetFlag(FLAGS_force_fieldtrials);
+  RunProfile run_profile;
+  const std::string run_profile_path = absl::GetFlag(FLAGS_run_profile);
+  if (!run_profile_path.empty()) {
+    std::string error;
+    std::optional<RunProfile> loaded = LoadRunProfile(run_profile_path, &error);
+    if (!loaded) {
+      printf("Error: bad --run_profile: %s\n", error.c_str());
+      return -1;
+    }
+    run_profile = *std::move(loaded);
+  }
+  const std::string video_layers = absl::GetFlag(FLAGS_video_layers);
+  if (!video_layers.empty() && !SetLayerMode(video_layers, &run_profile)) {
+    printf("Error: unknown --video_layers %s\n", video_layers.c_str());
+    return -1;
+  }
+
+  // Field trials are read for the lifetime of the process, so the string
+  // has to outlive everything below.
+  const std::string forced_field_trials =
+      absl::GetFlag(FLAGS_force_fieldtrials) + run_profile.field_trials;
   webrtc::field_trial::InitFieldTrialsFromString(forced_field_trials.c_str());
 
   // Validate port number
@@ -162,25 +185,64 @@ Example Commands:
     return -1;
   }
 
-  const std::string server = absl::GetFlag(FLAGS_server);
-  GtkMainWnd wnd(server.c_str(), absl::GetFlag(FLAGS_port),
-                 absl::GetFlag(FLAGS_autoconnect),
-                 absl::GetFlag(FLAGS_autocall),
-                 absl::GetFlag(FLAGS_headless));
+  const bool headless = absl::GetFlag(FLAGS_headless);
+  const int num_sessions = absl::GetFlag(FLAGS_num_sessions);
+  if (num_sessions < 1 || (num_sessions > 1 && !headless)) {
+    printf("Error: --num_sessions must be 1, or more with --headless.\n");
+    return -1;
+  }
 
-  wnd.Create();
+  sctp::kv::Config kv_config;
+  sctp::mesh::Config mesh_config;
+  if (!sctp::ParseSizeDistribution(absl::GetFlag(FLAGS_kv_request_size),
+                                   &kv_config.request_size)) {
+    printf("Error: bad --kv_request_size\n");
+    return -1;
+  }
+  if (!sctp::ParseSizeDistribution(absl::GetFlag(FLAGS_kv_response_size),
+                                   &kv_config.response_size)) {
+    printf("Error: bad --kv_response_size\n");
+    return -1;
+  }
+  if (!sctp::ParseSizeDistribution(absl::GetFlag(FLAGS_mesh_message_size),
+                                   &mesh_config.message_size)) {
+    printf("Error: bad --mesh_message_size\n");
+    return -1;
+  }
+
+  // Session 0 drives the GTK window; the others are headless and never
+  // show one.
+  const std::string server = absl::GetFlag(FLAGS_server);
+  std::vector<std::unique_ptr<GtkMainWnd>> windows;
+  for (int i = 0; i < num_sessions; ++i) {
+    windows.push_back(std::make_unique<GtkMainWnd>(
+        server.c_str(), absl::GetFlag(FLAGS_port),
+        absl::GetFlag(FLAGS_autoconnect), absl::GetFlag(FLAGS_autocall),
+        headless));
+    windows.back()->Create();
+  }
+  GtkMainWnd& wnd = *windows.front();
 
   CustomSocketServer socket_server(&wnd);
   rtc::AutoSocketServerThread thread(&socket_server);
 
   rtc::InitializeSSL();
-  PeerConnectionClient client;
-  auto conductor = rtc::make_ref_counted<Conductor>(&client, &wnd, absl::GetFlag(FLAGS_headless));
-  std::string traffic_csv = absl::GetFlag(FLAGS_traffic_csv);
-  if (!traffic_csv.empty()) {
-    conductor->SetTrafficProfile(traffic_csv);
+  // Declared before |sessions| so it outlives every conductor.
+  std::unique_ptr<LocalRoomServer> local_room;
+  if (absl::GetFlag(FLAGS_local_room)) {
+    local_room = std::make_unique<LocalRoomServer>();
+    const int local_room_port = absl::GetFlag(FLAGS_local_room_port);
+    if (local_room_port > 0 &&
+        !local_room->ListenOnLoopback(local_room_port)) {
+      printf("Error: cannot serve the local room on port %d.\n",
+             local_room_port);
+      return -1;
+    }
+  }
+  SessionManager sessions;
+  if (!sessions.Initialize(num_sessions)) {
+    return -1;
   }
-  conductor->SetRoomId(absl::GetFlag(FLAGS_room_id));
 
   // Get log date - if empty, use current date
   std::string date = absl::GetFlag(FLAGS_log_date);
@@ -195,29 +257,77 @@ Example Commands:
   std::string room_id = absl::GetFlag(FLAGS_room_id);
   bool is_sender = absl::GetFlag(FLAGS_is_sender);
   std::string role = is_sender ? "sender" : "receiver";
-  std::string log_dir = "webrtc_logs/" + date + "_" + room_id + "/" + role;
-  
-  // Create directory
-  std::filesystem::create_directories(log_dir);
-  
-  // Pass log_dir to conductor
-  conductor->SetLogDirectory(log_dir);
+  std::string traffic_csv = absl::GetFlag(FLAGS_traffic_csv);
 
-  // Configure experiment mode
-  conductor->SetEmulationMode(is_emulation, is_sender);
-  conductor->SetY4mPath(absl::GetFlag(FLAGS_y4m_path));
+  // With several sessions, session i joins room "<room_id>-i", logs under
+  // session_i/ and gets its own block of ICE ports, so the remote process
+  // started with the same flags pairs up session by session.
+  const int session_port_base = run_profile.min_port;
+  constexpr int kSessionPortSpan = 10;
+  for (int i = 0; i < num_sessions; ++i) {
+    Conductor* conductor = sessions.AddSession(windows[i].get(), headless);
+    conductor->SetRunProfile(run_profile);
+    if (!traffic_csv.empty()) {
+      conductor->SetTrafficProfile(traffic_csv);
+    }
+    conductor->SetSctpFlows(absl::GetFlag(FLAGS_sctp_flows));
+    conductor->SetSctpGeneratorConfigs(kv_config, mesh_config);
+    conductor->SetLayerSchedule(absl::GetFlag(FLAGS_layer_schedule));
+    conductor->SetStatsIntervalMs(absl::GetFlag(FLAGS_stats_interval_ms));
+    conductor->SetStatsSelectorMode(absl::GetFlag(FLAGS_stats_selector));
+    RunMetrics::Options metrics_options;
+    metrics_options.snapshot_period_ms = absl::GetFlag(FLAGS_metrics_period_ms);
+    metrics_options.convergence_tolerance =
+        absl::GetFlag(FLAGS_converge_tolerance);
+    metrics_options.convergence_windows = absl::GetFlag(FLAGS_converge_windows);
+    metrics_options.min_duration_s = absl::GetFlag(FLAGS_converge_min_s);
+    conductor->SetRunMetricsOptions(metrics_options);
+    conductor->SetLocalRoomServer(local_room.get());
+    conductor->SetSocketServer(&socket_server);
+
+    std::string log_dir = "webrtc_logs/" + date + "_" + room_id + "/";
+    if (num_sessions > 1) {
+      conductor->SetRoomId(room_id + "-" + std::to_string(i));
+      log_dir += "session_" + std::to_string(i) + "/";
+      const int min_port = session_port_base + i * kSessionPortSpan;
+      conductor->SetPortRange(min_port, min_port + kSessionPortSpan - 1);
+    } else {
+      conductor->SetRoomId(room_id);
+    }
+    log_dir += role;
+
+    // Create directory
+    std::filesystem::create_directories(log_dir);
+
+    // Pass log_dir to conductor
+    conductor->SetLogDirectory(log_dir);
+
+    // Configure experiment mode
+    conductor->SetEmulationMode(is_emulation, is_sender);
+    conductor->SetY4mPath(absl::GetFlag(FLAGS_y4m_path));
+    conductor->SetY4mPreload(absl::GetFlag(FLAGS_y4m_preload));
+    if (absl::GetFlag(FLAGS_frame_checksum) ||
+        !absl::GetFlag(FLAGS_quality_ref).empty()) {
+      HeadlessFrameSink::Options verification;
+      verification.checksum = absl::GetFlag(FLAGS_frame_checksum);
+      verification.reference_y4m = absl::GetFlag(FLAGS_quality_ref);
+      verification.workers = absl::GetFlag(FLAGS_quality_workers);
+      conductor->SetFrameVerification(verification);
+    }
 
-  if (is_emulation) {
-    conductor->SetNetInterface(absl::GetFlag(FLAGS_network_interface));
+    if (is_emulation) {
+      conductor->SetNetInterface(absl::GetFlag(FLAGS_network_interface));
+    }
   }
 
-  socket_server.set_client(&client);
-  socket_server.set_conductor(conductor.get());
+  socket_server.set_sessions(&sessions);
 
-  conductor->Start();
+  sessions.StartAll();
 
   thread.Run();
-  wnd.Destroy();
+  for (auto& window : windows) {
+    window->Destroy();
+  }
 
   rtc::CleanupSSL();
   return 0;
@@ -12,6 +12,8 @@
 #include <gtk/gtk.h>
 #include <stdio.h>
 
+#include <algorithm>
+
 #include "absl/flags/parse.h"
 #include "api/scoped_refptr.h"
 #include "examples/peerconnection/client/conductor.h"
@@ -36,11 +38,6 @@ class CustomSocketServer : public rtc::PhysicalSocketServer {
   void set_conductor(Conductor* conductor) { conductor_ = conductor; }
 
   bool Wait(webrtc::TimeDelta max_wait_duration, bool process_io) override {
-    // Service WebSocket client
-    if (conductor_) {
-      conductor_->ServiceWebSocket();
-    }
-
     // Check for disconnection
     if (!conductor_->connection_active() &&
         client_ != NULL && !client_->is_connected()) {
@@ -48,8 +45,11 @@ class CustomSocketServer : public rtc::PhysicalSocketServer {
       message_queue_->Quit();
     }
 
-    // Process socket events with a small timeout
-    return rtc::PhysicalSocketServer::Wait(webrtc::TimeDelta::Millis(100), process_io);
+    // WebSocket I/O wakes the wait through its registered descriptors; the
+    // cap only bounds how late the disconnect check above runs.
+    return rtc::PhysicalSocketServer::Wait(
+        std::min(max_wait_duration, webrtc::TimeDelta::Millis(100)),
+        process_io);
   }
 
  protected:
@@ -106,6 +106,7 @@ int main(int argc, char* argv[]) {
   auto conductor = rtc::make_ref_counted<Conductor>(&client, &wnd);
   socket_server.set_client(&client);
   socket_server.set_conductor(conductor.get());
+  conductor->SetSocketServer(&socket_server);
 
   RTC_LOG(LS_INFO) << "Starting message loop...";
   
@@ -737,8 +737,6 @@ void print_current_time() {
 }
 
 void GtkMainWnd::VideoRenderer::OnFrame(const webrtc::VideoFrame& video_frame) {
-  gdk_threads_enter();
-
   int64_t current_time = rtc::TimeMillis();
 
   // Initialize start time with first frame
@@ -782,7 +780,10 @@ void GtkMainWnd::VideoRenderer::OnFrame(const webrtc::VideoFrame& video_frame) {
   // Log frame metrics
   LogFrameMetrics(video_frame);
 
+  // Headless runs never draw, so they take neither the GDK lock nor the
+  // ARGB conversion below.
   if (!headless_) {
+    gdk_threads_enter();
     rtc::scoped_refptr<webrtc::I420BufferInterface> buffer(
         video_frame.video_frame_buffer()->ToI420());
     if (video_frame.rotation() != webrtc::kVideoRotation_0) {
@@ -0,0 +1,512 @@
+#include "examples/peerconnection/client/local_room_server.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "absl/strings/str_split.h"
+#include "api/task_queue/pending_task_safety_flag.h"
+#include "json/reader.h"
+#include "json/value.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/strings/json.h"
+#include "rtc_base/thread.h"
+
+namespace {
+// Signaling messages are SDP and candidates; anything larger is a bug.
+constexpr size_t kMaxMessageSize = 1024 * 1024;
+
+bool ParseJson(const std::string& text, Json::Value* value) {
+  Json::CharReaderBuilder builder;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  return reader->parse(text.data(), text.data() + text.size(), value,
+                       nullptr);
+}
+
+std::string Result(const char* result) {
+  Json::Value response;
+  response["result"] = result;
+  return rtc::JsonValueToString(response);
+}
+}  // namespace
+
+class LocalRoomServer::InProcessConnection : public ColliderConnection,
+                                             public Endpoint {
+ public:
+  explicit InProcessConnection(LocalRoomServer* server) : server_(server) {}
+  ~InProcessConnection() override { Close(); }
+
+  bool Connect(const std::string& url) override {
+    thread_ = rtc::Thread::Current();
+    connected_ = true;
+    // Reported asynchronously, as a network connection would be.
+    thread_->PostTask(webrtc::SafeTask(safety_.flag(), [this] {
+      if (connection_callback_)
+        connection_callback_(true);
+    }));
+    return true;
+  }
+
+  void Close() override {
+    if (!connected_.exchange(false))
+      return;
+    server_->Disconnect(this);
+  }
+
+  bool SendMessage(const std::string& message) override {
+    if (!connected_) {
+      RTC_LOG(LS_ERROR) << "Cannot send message - not connected";
+      return false;
+    }
+    server_->OnColliderMessage(this, message);
+    return true;
+  }
+
+  bool IsConnected() const override { return connected_; }
+
+  void Deliver(const std::string& message, const std::string& error) override {
+    thread_->PostTask(webrtc::SafeTask(safety_.flag(), [this, message, error] {
+      if (!error.empty()) {
+        RTC_LOG(LS_WARNING) << "Collider error: " << error;
+        return;
+      }
+      if (!message.empty() && message_callback_)
+        message_callback_(message);
+    }));
+  }
+
+ private:
+  LocalRoomServer* const server_;
+  rtc::Thread* thread_ = nullptr;
+  std::atomic<bool> connected_{false};
+  webrtc::ScopedTaskSafety safety_;
+};
+
+// One ws:// client of the loopback listener. Lives on the service thread.
+struct LocalRoomServer::LoopbackSession : public Endpoint {
+  LoopbackSession(LocalRoomServer* server, lws* wsi)
+      : server(server), wsi(wsi) {}
+
+  void Deliver(const std::string& message, const std::string& error) override {
+    Json::Value envelope;
+    envelope["msg"] = message;
+    envelope["error"] = error;
+    outbox.push_back(rtc::JsonValueToString(envelope));
+    // Wakes the service thread, which asks for a writable callback.
+    lws_cancel_service(server->context_);
+  }
+
+  LocalRoomServer* const server;
+  lws* const wsi;
+  // Guarded by |server->mutex_|.
+  std::deque<std::string> outbox;
+  std::string inbox;
+};
+
+struct LocalRoomServer::HttpRequest {
+  std::string path;
+  std::string body;
+  int status = HTTP_STATUS_OK;
+  std::string response;
+};
+
+LocalRoomServer::LocalRoomServer() = default;
+
+LocalRoomServer::~LocalRoomServer() {
+  if (running_.exchange(false)) {
+    lws_cancel_service(context_);
+    service_thread_.join();
+  }
+  if (context_)
+    lws_context_destroy(context_);
+}
+
+bool LocalRoomServer::ListenOnLoopback(int port) {
+  if (context_ || port <= 0)
+    return false;
+
+  static const lws_protocols kProtocols[] = {
+      {"http", &LocalRoomServer::HttpCallback, sizeof(HttpRequest*), 0},
+      {"apprtc", &LocalRoomServer::ColliderCallback,
+       sizeof(LoopbackSession*), 4096},
+      {nullptr, nullptr, 0, 0}};
+
+  lws_context_creation_info info;
+  memset(&info, 0, sizeof info);
+  info.port = port;
+  info.iface = "127.0.0.1";
+  info.protocols = kProtocols;
+  info.gid = -1;
+  info.uid = -1;
+  info.user = this;
+  context_ = lws_create_context(&info);
+  if (!context_) {
+    RTC_LOG(LS_ERROR) << "LocalRoomServer: cannot listen on 127.0.0.1:"
+                      << port;
+    return false;
+  }
+  {
+    webrtc::MutexLock lock(&mutex_);
+    wss_url_ = "ws://127.0.0.1:" + std::to_string(port) + "/ws";
+  }
+  running_ = true;
+  service_thread_ = std::thread([this] {
+    while (running_)
+      lws_service(context_, 100);
+  });
+  RTC_LOG(LS_INFO) << "LocalRoomServer: serving http://127.0.0.1:" << port;
+  return true;
+}
+
+std::string LocalRoomServer::Join(const std::string& room_id) {
+  webrtc::MutexLock lock(&mutex_);
+  Room& room = rooms_[room_id];
+  if (room.clients.size() >= 2)
+    return Result("FULL");
+
+  const std::string client_id = std::to_string(next_client_id_++);
+  room.clients.push_back(client_id);
+
+  // Whatever the other client posted while alone in the room.
+  Json::Value messages(Json::arrayValue);
+  for (auto it = room.pending.begin(); it != room.pending.end();) {
+    if (it->first != client_id) {
+      messages.append(it->second);
+      it = room.pending.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  Json::Value params;
+  params["is_initiator"] = room.clients.size() == 1 ? "true" : "false";
+  params["room_id"] = room_id;
+  params["client_id"] = client_id;
+  params["wss_url"] = wss_url_;
+  params["messages"] = messages;
+  Json::Value response;
+  response["result"] = "SUCCESS";
+  response["params"] = params;
+  RTC_LOG(LS_INFO) << "LocalRoomServer: client " << client_id
+                   << " joined room " << room_id;
+  return rtc::JsonValueToString(response);
+}
+
+std::string LocalRoomServer::PostMessage(const std::string& room_id,
+                                         const std::string& client_id,
+                                         const std::string& message) {
+  webrtc::MutexLock lock(&mutex_);
+  auto it = rooms_.find(room_id);
+  if (it == rooms_.end())
+    return Result("UNKNOWN_ROOM");
+  const std::vector<std::string>& clients = it->second.clients;
+  if (std::find(clients.begin(), clients.end(), client_id) == clients.end())
+    return Result("UNKNOWN_CLIENT");
+  ForwardLocked(it->second, client_id, message);
+  return Result("SUCCESS");
+}
+
+std::string LocalRoomServer::Leave(const std::string& room_id,
+                                   const std::string& client_id) {
+  webrtc::MutexLock lock(&mutex_);
+  return LeaveLocked(room_id, client_id);
+}
+
+std::unique_ptr<ColliderConnection> LocalRoomServer::CreateConnection() {
+  return std::make_unique<InProcessConnection>(this);
+}
+
+std::string LocalRoomServer::LeaveLocked(const std::string& room_id,
+                                         const std::string& client_id) {
+  auto it = rooms_.find(room_id);
+  if (it == rooms_.end())
+    return Result("UNKNOWN_ROOM");
+  Room& room = it->second;
+  auto endpoint = room.endpoints.find(client_id);
+  if (endpoint != room.endpoints.end()) {
+    endpoint->second->registered = false;
+    room.endpoints.erase(endpoint);
+  }
+  room.clients.erase(
+      std::remove(room.clients.begin(), room.clients.end(), client_id),
+      room.clients.end());
+  room.pending.erase(
+      std::remove_if(room.pending.begin(), room.pending.end(),
+                     [&](const std::pair<std::string, std::string>& pending) {
+                       return pending.first == client_id;
+                     }),
+      room.pending.end());
+  if (room.clients.empty())
+    rooms_.erase(it);
+  RTC_LOG(LS_INFO) << "LocalRoomServer: client " << client_id
+                   << " left room " << room_id;
+  return Result("SUCCESS");
+}
+
+void LocalRoomServer::ForwardLocked(Room& room,
+                                    const std::string& from,
+                                    const std::string& message) {
+  for (const auto& [client_id, endpoint] : room.endpoints) {
+    if (client_id != from) {
+      endpoint->Deliver(message, "");
+      return;
+    }
+  }
+  room.pending.emplace_back(from, message);
+}
+
+void LocalRoomServer::OnColliderMessage(Endpoint* endpoint,
+                                        const std::string& message) {
+  Json::Value command;
+  const bool parsed = ParseJson(message, &command) && command.isObject();
+  const std::string cmd = parsed ? command["cmd"].asString() : "";
+
+  webrtc::MutexLock lock(&mutex_);
+  if (cmd == "register") {
+    const std::string room_id = command["roomid"].asString();
+    const std::string client_id = command["clientid"].asString();
+    auto it = rooms_.find(room_id);
+    if (endpoint->registered) {
+      endpoint->Deliver("", "Duplicated register request");
+      return;
+    }
+    if (it == rooms_.end() ||
+        std::find(it->second.clients.begin(), it->second.clients.end(),
+                  client_id) == it->second.clients.end() ||
+        it->second.endpoints.count(client_id)) {
+      endpoint->Deliver("", "Invalid client id");
+      return;
+    }
+    Room& room = it->second;
+    endpoint->room_id = room_id;
+    endpoint->client_id = client_id;
+    endpoint->registered = true;
+    room.endpoints[client_id] = endpoint;
+    for (auto pending = room.pending.begin(); pending != room.pending.end();) {
+      if (pending->first != client_id) {
+        endpoint->Deliver(pending->second, "");
+        pending = room.pending.erase(pending);
+      } else {
+        ++pending;
+      }
+    }
+    return;
+  }
+
+  if (cmd == "send") {
+    if (!endpoint->registered) {
+      endpoint->Deliver("", "Client not registered");
+      return;
+    }
+    ForwardLocked(rooms_[endpoint->room_id], endpoint->client_id,
+                  command["msg"].asString());
+    return;
+  }
+
+  endpoint->Deliver("", "Invalid message");
+}
+
+void LocalRoomServer::Disconnect(Endpoint* endpoint) {
+  webrtc::MutexLock lock(&mutex_);
+  if (endpoint->registered)
+    LeaveLocked(endpoint->room_id, endpoint->client_id);
+}
+
+int LocalRoomServer::HandleHttp(const std::string& path,
+                                const std::string& body,
+                                std::string* response) {
+  const std::vector<std::string> parts =
+      absl::StrSplit(path, '/', absl::SkipEmpty());
+  if (parts.size() == 2 && parts[0] == "join") {
+    *response = Join(parts[1]);
+    return HTTP_STATUS_OK;
+  }
+  if (parts.size() == 3 && parts[0] == "message") {
+    *response = PostMessage(parts[1], parts[2], body);
+    return HTTP_STATUS_OK;
+  }
+  if (parts.size() == 3 && parts[0] == "leave") {
+    *response = Leave(parts[1], parts[2]);
+    return HTTP_STATUS_OK;
+  }
+  *response = Result("NOT_FOUND");
+  return HTTP_STATUS_NOT_FOUND;
+}
+
+int LocalRoomServer::HttpCallback(lws* wsi,
+                                  lws_callback_reasons reason,
+                                  void* user,
+                                  void* in,
+                                  size_t len) {
+  auto* server =
+      static_cast<LocalRoomServer*>(lws_context_user(lws_get_context(wsi)));
+  return server->OnHttpEvent(wsi, reason, user, in, len);
+}
+
+int LocalRoomServer::ColliderCallback(lws* wsi,
+                                      lws_callback_reasons reason,
+                                      void* user,
+                                      void* in,
+                                      size_t len) {
+  auto* server =
+      static_cast<LocalRoomServer*>(lws_context_user(lws_get_context(wsi)));
+  return server->OnColliderEvent(wsi, reason, user, in, len);
+}
+
+bool LocalRoomServer::WriteHttpResponse(lws* wsi, HttpRequest* request) {
+  unsigned char buffer[LWS_PRE + 512];
+  unsigned char* start = &buffer[LWS_PRE];
+  unsigned char* p = start;
+  unsigned char* end = &buffer[sizeof(buffer) - 1];
+  if (lws_add_http_common_headers(wsi, request->status, "application/json",
+                                  request->response.size(), &p, end) ||
+      lws_finalize_write_http_header(wsi, start, &p, end)) {
+    return false;
+  }
+  // The body goes out from LWS_CALLBACK_HTTP_WRITEABLE.
+  lws_callback_on_writable(wsi);
+  return true;
+}
+
+int LocalRoomServer::OnHttpEvent(lws* wsi,
+                                 lws_callback_reasons reason,
+                                 void* user,
+                                 void* in,
+                                 size_t len) {
+  HttpRequest** slot = static_cast<HttpRequest**>(user);
+  switch (reason) {
+    case LWS_CALLBACK_HTTP: {
+      // Keep-alive connections reuse the slot for the next request.
+      delete *slot;
+      *slot = new HttpRequest();
+      HttpRequest* request = *slot;
+      request->path = static_cast<const char*>(in);
+      char content_length[16] = {0};
+      lws_hdr_copy(wsi, content_length, sizeof(content_length),
+                   WSI_TOKEN_HTTP_CONTENT_LENGTH);
+      if (lws_hdr_total_length(wsi, WSI_TOKEN_POST_URI) &&
+          atoi(content_length) > 0) {
+        return 0;  // Wait for LWS_CALLBACK_HTTP_BODY_COMPLETION.
+      }
+      request->status = HandleHttp(request->path, "", &request->response);
+      return WriteHttpResponse(wsi, request) ? 0 : -1;
+    }
+    case LWS_CALLBACK_HTTP_BODY:
+      if (!*slot || (*slot)->body.size() + len > kMaxMessageSize)
+        return -1;
+      (*slot)->body.append(static_cast<const char*>(in), len);
+      return 0;
+    case LWS_CALLBACK_HTTP_BODY_COMPLETION: {
+      HttpRequest* request = *slot;
+      if (!request)
+        return -1;
+      request->status =
+          HandleHttp(request->path, request->body, &request->response);
+      return WriteHttpResponse(wsi, request) ? 0 : -1;
+    }
+    case LWS_CALLBACK_HTTP_WRITEABLE: {
+      HttpRequest* request = *slot;
+      if (!request)
+        break;
+      const std::string& body = request->response;
+      std::vector<unsigned char> buffer(LWS_PRE + body.size());
+      memcpy(&buffer[LWS_PRE], body.data(), body.size());
+      if (lws_write(wsi, &buffer[LWS_PRE], body.size(),
+                    LWS_WRITE_HTTP_FINAL) < static_cast<int>(body.size())) {
+        return -1;
+      }
+      return lws_http_transaction_completed(wsi) ? -1 : 0;
+    }
+    case LWS_CALLBACK_CLOSED_HTTP:
+    case LWS_CALLBACK_HTTP_DROP_PROTOCOL:
+      delete *slot;
+      *slot = nullptr;
+      break;
+    default:
+      break;
+  }
+  return lws_callback_http_dummy(wsi, reason, user, in, len);
+}
+
+int LocalRoomServer::OnColliderEvent(lws* wsi,
+                                     lws_callback_reasons reason,
+                                     void* user,
+                                     void* in,
+                                     size_t len) {
+  LoopbackSession** slot = static_cast<LoopbackSession**>(user);
+  switch (reason) {
+    case LWS_CALLBACK_ESTABLISHED: {
+      *slot = new LoopbackSession(this, wsi);
+      webrtc::MutexLock lock(&mutex_);
+      sessions_.insert(*slot);
+      break;
+    }
+    case LWS_CALLBACK_RECEIVE: {
+      LoopbackSession* session = *slot;
+      if (!session)
+        break;
+      if (session->inbox.size() + len > kMaxMessageSize)
+        return -1;
+      session->inbox.append(static_cast<const char*>(in), len);
+      if (!lws_is_final_fragment(wsi) || lws_remaining_packet_payload(wsi))
+        break;
+      // WebSocketClient cuts long messages into separate text frames, so a
+      // complete frame may still end mid-JSON.
+      Json::Value unused;
+      if (!ParseJson(session->inbox, &unused))
+        break;
+      std::string message;
+      message.swap(session->inbox);
+      OnColliderMessage(session, message);
+      break;
+    }
+    case LWS_CALLBACK_SERVER_WRITEABLE: {
+      LoopbackSession* session = *slot;
+      if (!session)
+        break;
+      std::string envelope;
+      bool more = false;
+      {
+        webrtc::MutexLock lock(&mutex_);
+        if (session->outbox.empty())
+          break;
+        envelope = std::move(session->outbox.front());
+        session->outbox.pop_front();
+        more = !session->outbox.empty();
+      }
+      std::vector<unsigned char> buffer(LWS_PRE + envelope.size());
+      memcpy(&buffer[LWS_PRE], envelope.data(), envelope.size());
+      if (lws_write(wsi, &buffer[LWS_PRE], envelope.size(), LWS_WRITE_TEXT) <
+          static_cast<int>(envelope.size())) {
+        return -1;
+      }
+      if (more)
+        lws_callback_on_writable(wsi);
+      break;
+    }
+    case LWS_CALLBACK_EVENT_WAIT_CANCELLED: {
+      webrtc::MutexLock lock(&mutex_);
+      for (LoopbackSession* session : sessions_) {
+        if (!session->outbox.empty())
+          lws_callback_on_writable(session->wsi);
+      }
+      break;
+    }
+    case LWS_CALLBACK_CLOSED: {
+      LoopbackSession* session = *slot;
+      if (!session)
+        break;
+      Disconnect(session);
+      {
+        webrtc::MutexLock lock(&mutex_);
+        sessions_.erase(session);
+      }
+      delete session;
+      *slot = nullptr;
+      break;
+    }
+    default:
+      break;
+  }
+  return 0;
+}
@@ -0,0 +1,139 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_LOCAL_ROOM_SERVER_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_LOCAL_ROOM_SERVER_H_
+
+#include <libwebsockets.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "examples/peerconnection/client/collider_connection.h"
+#include "rtc_base/synchronization/mutex.h"
+#include "rtc_base/thread_annotations.h"
+
+// Stand-in for an AppRTC deployment: the room server and the collider in
+// one object, so a call can be set up without DNS, TLS or a remote server.
+// It keeps the AppRTC JSON protocol:
+//
+//   POST /join/<room>             -> {"result":"SUCCESS","params":{
+//                                      "is_initiator","room_id","client_id",
+//                                      "wss_url","messages"}}
+//   POST /message/<room>/<client> -> {"result":"SUCCESS"}
+//   POST /leave/<room>/<client>   -> {"result":"SUCCESS"}
+//   collider {"cmd":"register","roomid","clientid"}, {"cmd":"send","msg"}
+//   collider -> client {"msg":...,"error":""}
+//
+// Conductors in the same process reach it directly through Join(),
+// PostMessage() and CreateConnection(). ListenOnLoopback() additionally
+// serves it as plain HTTP and ws:// on 127.0.0.1, so a peer in another
+// process joins with --server=http://127.0.0.1:<port>.
+//
+// A room holds two clients; the first to join is the initiator. Messages
+// sent while the other client has not joined or registered are held and
+// handed over in its join response or on register, as AppRTC does. A
+// client leaves when its collider connection closes. Client ids are
+// sequential, so runs are reproducible.
+//
+// Thread-safe. In-process connections deliver on the thread that called
+// Connect(); the loopback listener runs on its own thread.
+class LocalRoomServer {
+ public:
+  LocalRoomServer();
+  ~LocalRoomServer();
+
+  LocalRoomServer(const LocalRoomServer&) = delete;
+  LocalRoomServer& operator=(const LocalRoomServer&) = delete;
+
+  // Returns false if |port| cannot be bound on 127.0.0.1.
+  bool ListenOnLoopback(int port);
+
+  // Each returns the JSON body of the matching AppRTC endpoint.
+  std::string Join(const std::string& room_id);
+  std::string PostMessage(const std::string& room_id,
+                          const std::string& client_id,
+                          const std::string& message);
+  std::string Leave(const std::string& room_id, const std::string& client_id);
+
+  // A collider connection that never leaves the process. Connect() ignores
+  // its URL.
+  std::unique_ptr<ColliderConnection> CreateConnection();
+
+ private:
+  // A client's collider side, registered or not.
+  class Endpoint {
+   public:
+    virtual ~Endpoint() = default;
+    // Hands over one collider envelope. Called with |mutex_| held; must not
+    // call back into the server.
+    virtual void Deliver(const std::string& message,
+                         const std::string& error) = 0;
+
+    std::string room_id;
+    std::string client_id;
+    bool registered = false;
+  };
+  class InProcessConnection;
+  struct LoopbackSession;
+  struct HttpRequest;
+
+  struct Room {
+    // Join order; clients[0] is the initiator.
+    std::vector<std::string> clients;
+    std::map<std::string, Endpoint*> endpoints;
+    // (sender, message) not yet delivered to the other client.
+    std::deque<std::pair<std::string, std::string>> pending;
+  };
+
+  std::string LeaveLocked(const std::string& room_id,
+                          const std::string& client_id)
+      RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void ForwardLocked(Room& room,
+                     const std::string& from,
+                     const std::string& message)
+      RTC_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Handles one register/send command from |endpoint|.
+  void OnColliderMessage(Endpoint* endpoint, const std::string& message);
+  // Unregisters |endpoint| and removes its client from the room.
+  void Disconnect(Endpoint* endpoint);
+
+  // Routes a loopback HTTP request; returns the status code.
+  int HandleHttp(const std::string& path,
+                 const std::string& body,
+                 std::string* response);
+
+  static int HttpCallback(lws* wsi,
+                          lws_callback_reasons reason,
+                          void* user,
+                          void* in,
+                          size_t len);
+  static int ColliderCallback(lws* wsi,
+                              lws_callback_reasons reason,
+                              void* user,
+                              void* in,
+                              size_t len);
+  int OnHttpEvent(lws* wsi, lws_callback_reasons reason, void* user,
+                  void* in, size_t len);
+  int OnColliderEvent(lws* wsi, lws_callback_reasons reason, void* user,
+                      void* in, size_t len);
+  static bool WriteHttpResponse(lws* wsi, HttpRequest* request);
+
+  webrtc::Mutex mutex_;
+  std::map<std::string, Room> rooms_ RTC_GUARDED_BY(mutex_);
+  uint64_t next_client_id_ RTC_GUARDED_BY(mutex_) = 10000001;
+  // Handed out in join responses; empty until ListenOnLoopback().
+  std::string wss_url_ RTC_GUARDED_BY(mutex_);
+  std::set<LoopbackSession*> sessions_ RTC_GUARDED_BY(mutex_);
+
+  lws_context* context_ = nullptr;
+  std::atomic<bool> running_{false};
+  std::thread service_thread_;
+};
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_LOCAL_ROOM_SERVER_H_
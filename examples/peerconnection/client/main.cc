@@ -96,6 +96,24 @@ int PASCAL wWinMain(HINSTANCE instance,
     return -1;
   }
 
+  sctp::kv::Config kv_config;
+  sctp::mesh::Config mesh_config;
+  if (!sctp::ParseSizeDistribution(absl::GetFlag(FLAGS_kv_request_size),
+                                   &kv_config.request_size)) {
+    printf("Error: bad --kv_request_size\n");
+    return -1;
+  }
+  if (!sctp::ParseSizeDistribution(absl::GetFlag(FLAGS_kv_response_size),
+                                   &kv_config.response_size)) {
+    printf("Error: bad --kv_response_size\n");
+    return -1;
+  }
+  if (!sctp::ParseSizeDistribution(absl::GetFlag(FLAGS_mesh_message_size),
+                                   &mesh_config.message_size)) {
+    printf("Error: bad --mesh_message_size\n");
+    return -1;
+  }
+
   const std::string server = absl::GetFlag(FLAGS_server);
   MainWnd wnd(server.c_str(), absl::GetFlag(FLAGS_port),
               absl::GetFlag(FLAGS_autoconnect), absl::GetFlag(FLAGS_autocall));
@@ -111,6 +129,10 @@ int PASCAL wWinMain(HINSTANCE instance,
   if (!traffic_csv.empty()) {
     conductor->SetTrafficProfile(traffic_csv);
   }
+  conductor->SetSctpFlows(absl::GetFlag(FLAGS_sctp_flows));
+  conductor->SetSctpGeneratorConfigs(kv_config, mesh_config);
+  conductor->SetStatsIntervalMs(absl::GetFlag(FLAGS_stats_interval_ms));
+  conductor->SetStatsSelectorMode(absl::GetFlag(FLAGS_stats_selector));
 
   // Main loop.
   MSG msg;
@@ -0,0 +1,301 @@
+#include "examples/peerconnection/client/mapped_y4m_frame_generator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include "api/make_ref_counted.h"
+#include "api/video/i420_buffer.h"
+#include "common_video/include/video_frame_buffer.h"
+#include "rtc_base/logging.h"
+
+#if defined(WEBRTC_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct MappedY4mFrameGenerator::Mapping {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  bool locked = false;
+
+  ~Mapping() {
+#if defined(WEBRTC_POSIX)
+    if (locked)
+      munlock(data, size);
+    if (data)
+      munmap(const_cast<uint8_t*>(data), size);
+#endif
+  }
+};
+
+namespace {
+
+constexpr char kFileMagic[] = "YUV4MPEG2 ";
+constexpr char kFrameMagic[] = "FRAME";
+
+size_t I420Size(int width, int height) {
+  const size_t chroma =
+      static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+  return static_cast<size_t>(width) * height + 2 * chroma;
+}
+
+// Parses the stream header line, e.g.
+// "YUV4MPEG2 W3840 H2160 F60:1 Ip A1:1 C420jpeg". Only 4:2:0 sampling is
+// accepted; a missing C tag means 4:2:0 by the spec.
+bool ParseHeader(const std::string& header,
+                 int* width,
+                 int* height,
+                 std::optional<double>* fps) {
+  *width = 0;
+  *height = 0;
+  size_t pos = 0;
+  while (pos < header.size()) {
+    size_t end = header.find(' ', pos);
+    if (end == std::string::npos)
+      end = header.size();
+    const std::string tag = header.substr(pos, end - pos);
+    pos = end + 1;
+    if (tag.empty())
+      continue;
+    switch (tag[0]) {
+      case 'W':
+        *width = std::atoi(tag.c_str() + 1);
+        break;
+      case 'H':
+        *height = std::atoi(tag.c_str() + 1);
+        break;
+      case 'F': {
+        int num = 0;
+        int den = 0;
+        if (sscanf(tag.c_str() + 1, "%d:%d", &num, &den) == 2 && den > 0)
+          *fps = static_cast<double>(num) / den;
+        break;
+      }
+      case 'C':
+        if (tag.compare(1, 3, "420") != 0) {
+          RTC_LOG(LS_ERROR) << "Unsupported Y4M colorspace " << tag;
+          return false;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return *width > 0 && *height > 0;
+}
+
+}  // namespace
+
+#if defined(WEBRTC_POSIX)
+
+std::unique_ptr<MappedY4mFrameGenerator> MappedY4mFrameGenerator::Create(
+    const std::string& path,
+    Mode mode) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    RTC_LOG(LS_ERROR) << "Cannot open " << path;
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+  int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+  if (mode == Mode::kPreload)
+    flags |= MAP_POPULATE;
+#endif
+  void* addr = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    RTC_LOG(LS_ERROR) << "mmap of " << path << " failed";
+    return nullptr;
+  }
+
+  auto mapping = std::make_shared<Mapping>();
+  mapping->data = static_cast<const uint8_t*>(addr);
+  mapping->size = size;
+  if (mode == Mode::kPreload) {
+    madvise(addr, size, MADV_WILLNEED);
+    mapping->locked = mlock(addr, size) == 0;
+    if (!mapping->locked) {
+      RTC_LOG(LS_WARNING) << "mlock of " << path
+                          << " failed; pages may be reclaimed";
+    }
+  } else {
+    madvise(addr, size, MADV_SEQUENTIAL);
+  }
+
+  const uint8_t* data = mapping->data;
+  const uint8_t* header_end =
+      static_cast<const uint8_t*>(memchr(data, '\n', size));
+  if (size < sizeof(kFileMagic) - 1 ||
+      memcmp(data, kFileMagic, sizeof(kFileMagic) - 1) != 0 || !header_end) {
+    RTC_LOG(LS_ERROR) << path << " is not a Y4M file";
+    return nullptr;
+  }
+  int width = 0;
+  int height = 0;
+  std::optional<double> fps;
+  const char* tags =
+      reinterpret_cast<const char*>(data) + sizeof(kFileMagic) - 1;
+  if (!ParseHeader(
+          std::string(tags, reinterpret_cast<const char*>(header_end)), &width,
+          &height, &fps)) {
+    RTC_LOG(LS_ERROR) << "Bad Y4M header in " << path;
+    return nullptr;
+  }
+
+  // Frame headers may carry parameters, so each one is scanned once here
+  // rather than assuming a fixed "FRAME\n" stride.
+  const size_t frame_size = I420Size(width, height);
+  std::vector<size_t> offsets;
+  size_t pos = header_end - data + 1;
+  while (pos + sizeof(kFrameMagic) - 1 <= size &&
+         memcmp(data + pos, kFrameMagic, sizeof(kFrameMagic) - 1) == 0) {
+    const uint8_t* line_end =
+        static_cast<const uint8_t*>(memchr(data + pos, '\n', size - pos));
+    if (!line_end)
+      break;
+    const size_t frame = line_end - data + 1;
+    if (frame + frame_size > size)
+      break;
+    offsets.push_back(frame);
+    pos = frame + frame_size;
+  }
+  if (offsets.empty()) {
+    RTC_LOG(LS_ERROR) << "No complete frames in " << path;
+    return nullptr;
+  }
+
+  RTC_LOG(LS_INFO) << "Mapped " << path << ": " << width << "x" << height
+                   << ", " << offsets.size() << " frames"
+                   << (mode == Mode::kPreload ? ", preloaded" : "");
+  return std::unique_ptr<MappedY4mFrameGenerator>(new MappedY4mFrameGenerator(
+      std::move(mapping), mode, width, height, fps, std::move(offsets)));
+}
+
+void MappedY4mFrameGenerator::Readahead(size_t index) {
+  if (mode_ != Mode::kMapped)
+    return;
+  static const size_t kPageSize = sysconf(_SC_PAGESIZE);
+  const size_t frame_size = I420Size(width_, height_);
+  for (int i = 0; i < kReadaheadFrames; ++i) {
+    const size_t offset =
+        frame_offsets_[(index + i) % frame_offsets_.size()];
+    const size_t start = offset / kPageSize * kPageSize;
+    madvise(const_cast<uint8_t*>(mapping_->data) + start,
+            offset + frame_size - start, MADV_WILLNEED);
+  }
+}
+
+void MappedY4mFrameGenerator::Release(size_t index) {
+  if (mode_ != Mode::kMapped)
+    return;
+  static const size_t kPageSize = sysconf(_SC_PAGESIZE);
+  const size_t frame_size = I420Size(width_, height_);
+  for (int i = 0; i < kReadaheadFrames; ++i) {
+    const size_t offset =
+        frame_offsets_[(index + i) % frame_offsets_.size()];
+    // Only pages wholly inside the frame; its neighbours may be in use.
+    // Frames still held by the encoder fault back in from the file.
+    const size_t start = (offset + kPageSize - 1) / kPageSize * kPageSize;
+    const size_t end = (offset + frame_size) / kPageSize * kPageSize;
+    if (end > start) {
+      madvise(const_cast<uint8_t*>(mapping_->data) + start, end - start,
+              MADV_DONTNEED);
+    }
+  }
+}
+
+#else  // !defined(WEBRTC_POSIX)
+
+std::unique_ptr<MappedY4mFrameGenerator> MappedY4mFrameGenerator::Create(
+    const std::string& path,
+    Mode mode) {
+  return nullptr;
+}
+
+void MappedY4mFrameGenerator::Readahead(size_t index) {}
+
+void MappedY4mFrameGenerator::Release(size_t index) {}
+
+#endif  // defined(WEBRTC_POSIX)
+
+MappedY4mFrameGenerator::MappedY4mFrameGenerator(
+    std::shared_ptr<Mapping> mapping,
+    Mode mode,
+    int width,
+    int height,
+    std::optional<double> fps,
+    std::vector<size_t> frame_offsets)
+    : mapping_(std::move(mapping)),
+      mode_(mode),
+      width_(width),
+      height_(height),
+      frame_rate_(fps),
+      frame_offsets_(std::move(frame_offsets)),
+      output_width_(width),
+      output_height_(height) {
+  Readahead(0);
+  Readahead(kReadaheadFrames);
+}
+
+MappedY4mFrameGenerator::~MappedY4mFrameGenerator() = default;
+
+rtc::scoped_refptr<webrtc::I420BufferInterface>
+MappedY4mFrameGenerator::FrameAt(size_t index) const {
+  const uint8_t* y = mapping_->data + frame_offsets_[index];
+  const int chroma_width = (width_ + 1) / 2;
+  const int chroma_height = (height_ + 1) / 2;
+  const uint8_t* u = y + width_ * height_;
+  const uint8_t* v = u + chroma_width * chroma_height;
+  // The lambda holds the mapping until the last user releases the frame.
+  return webrtc::WrapI420Buffer(width_, height_, y, width_, u, chroma_width, v,
+                                chroma_width, [mapping = mapping_] {});
+}
+
+MappedY4mFrameGenerator::VideoFrameData MappedY4mFrameGenerator::NextFrame() {
+  rtc::scoped_refptr<webrtc::I420BufferInterface> buffer = FrameAt(next_);
+  next_ = (next_ + 1) % frame_offsets_.size();
+  // Once per window, not on every frame: the window after the one starting
+  // now is advised, so the disk has a whole window of lead time, and the
+  // one just read is released unless the clip is too short to spare it.
+  if (next_ % kReadaheadFrames == 0) {
+    const size_t count = frame_offsets_.size();
+    Readahead(next_ + kReadaheadFrames);
+    if (count >= 3 * kReadaheadFrames)
+      Release((next_ + count - kReadaheadFrames) % count);
+  }
+
+  webrtc::VideoFrame::UpdateRect update_rect{0, 0, output_width_,
+                                             output_height_};
+  if (output_width_ == width_ && output_height_ == height_)
+    return VideoFrameData(buffer, update_rect);
+
+  rtc::scoped_refptr<webrtc::I420Buffer> scaled =
+      webrtc::I420Buffer::Create(output_width_, output_height_);
+  scaled->ScaleFrom(*buffer);
+  return VideoFrameData(scaled, update_rect);
+}
+
+void MappedY4mFrameGenerator::SkipNextFrame() {
+  next_ = (next_ + 1) % frame_offsets_.size();
+}
+
+void MappedY4mFrameGenerator::ChangeResolution(size_t width, size_t height) {
+  output_width_ = static_cast<int>(width);
+  output_height_ = static_cast<int>(height);
+}
+
+MappedY4mFrameGenerator::Resolution MappedY4mFrameGenerator::GetResolution()
+    const {
+  return {static_cast<size_t>(output_width_),
+          static_cast<size_t>(output_height_)};
+}
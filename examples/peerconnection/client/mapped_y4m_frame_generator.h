@@ -0,0 +1,90 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_MAPPED_Y4M_FRAME_GENERATOR_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_MAPPED_Y4M_FRAME_GENERATOR_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "api/scoped_refptr.h"
+#include "api/test/frame_generator_interface.h"
+#include "api/video/video_frame_buffer.h"
+
+// Looping Y4M (4:2:0 only) frame generator backed by an mmap of the file.
+// Each frame is an I420 buffer wrapping the Y/U/V planes in place, so
+// NextFrame() neither allocates nor copies; the mapping stays alive until
+// the last frame referencing it is released.
+//
+// Drop-in for webrtc::test::Y4mFrameGenerator with RepeatMode::kLoop.
+// POSIX only: Create() returns null elsewhere, or when the file cannot be
+// mapped or parsed, and callers fall back to Y4mFrameGenerator.
+class MappedY4mFrameGenerator
+    : public webrtc::test::FrameGeneratorInterface {
+ public:
+  enum class Mode {
+    // Pages fault in on first use. Frames are advised to the kernel in
+    // windows of kReadaheadFrames, one window ahead of the capturer, and
+    // each window is unmapped again once the capturer is past it.
+    kMapped,
+    // Faults the whole file in at Create() and locks it in RAM where
+    // RLIMIT_MEMLOCK allows, so no frame ever waits on the disk.
+    kPreload,
+  };
+
+  static constexpr int kReadaheadFrames = 4;
+
+  static std::unique_ptr<MappedY4mFrameGenerator> Create(
+      const std::string& path,
+      Mode mode);
+  ~MappedY4mFrameGenerator() override;
+
+  VideoFrameData NextFrame() override;
+  void SkipNextFrame() override;
+  void ChangeResolution(size_t width, size_t height) override;
+  Resolution GetResolution() const override;
+  // Rounded; NTSC rates such as 30000:1001 come out as 30, not 29.
+  std::optional<int> fps() const override {
+    if (!frame_rate_)
+      return std::nullopt;
+    return static_cast<int>(std::lround(*frame_rate_));
+  }
+  // The header's exact F<num>:<den> rate.
+  std::optional<double> frame_rate() const { return frame_rate_; }
+
+  // Random access for reference comparisons; does not move the NextFrame()
+  // position. Frames are at native resolution and wrap the mapping.
+  size_t frame_count() const { return frame_offsets_.size(); }
+  rtc::scoped_refptr<webrtc::I420BufferInterface> FrameAt(size_t index) const;
+
+ private:
+  struct Mapping;
+
+  MappedY4mFrameGenerator(std::shared_ptr<Mapping> mapping,
+                          Mode mode,
+                          int width,
+                          int height,
+                          std::optional<double> fps,
+                          std::vector<size_t> frame_offsets);
+
+  // Both act on the kReadaheadFrames frames from |index| on, in kMapped
+  // mode only.
+  void Readahead(size_t index);
+  void Release(size_t index);
+
+  const std::shared_ptr<Mapping> mapping_;
+  const Mode mode_;
+  const int width_;
+  const int height_;
+  const std::optional<double> frame_rate_;
+  const std::vector<size_t> frame_offsets_;
+  size_t next_ = 0;
+
+  // Set by ChangeResolution(); frames are then scaled into new buffers.
+  int output_width_;
+  int output_height_;
+};
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_MAPPED_Y4M_FRAME_GENERATOR_H_
@@ -0,0 +1,51 @@
+#include "examples/peerconnection/client/outbound_layer_stats.h"
+
+#include "api/stats/rtcstats_objects.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/time_utils.h"
+
+OutboundLayerStats::OutboundLayerStats(const std::string& log_dir)
+    : file_(log_dir + "/outbound_layers.csv") {
+  if (!file_.is_open()) {
+    RTC_LOG(LS_ERROR) << "Failed to open " << log_dir
+                      << "/outbound_layers.csv";
+  }
+  file_ << "timestamp,ssrc,rid,scalability_mode,active,bitrate_bps,fps,width,"
+           "height,quality_limitation\n";
+}
+
+void OutboundLayerStats::OnReport(const webrtc::RTCStatsReport& report) {
+  const int64_t now_ms = rtc::TimeMillis();
+  for (const webrtc::RTCOutboundRtpStreamStats* stats :
+       report.GetStatsOfType<webrtc::RTCOutboundRtpStreamStats>()) {
+    if (stats->kind.value_or("") != "video" || !stats->ssrc)
+      continue;
+    Sample sample;
+    sample.time_us = stats->timestamp().us();
+    sample.bytes_sent = stats->bytes_sent.value_or(0);
+    sample.frames_encoded = stats->frames_encoded.value_or(0);
+
+    auto it = previous_.find(*stats->ssrc);
+    if (it == previous_.end()) {
+      previous_.emplace(*stats->ssrc, sample);
+      continue;
+    }
+    const Sample last = it->second;
+    it->second = sample;
+    const int64_t elapsed_us = sample.time_us - last.time_us;
+    if (elapsed_us <= 0)
+      continue;
+    const double bitrate_bps =
+        (sample.bytes_sent - last.bytes_sent) * 8.0 * 1e6 / elapsed_us;
+    const double fps =
+        (sample.frames_encoded - last.frames_encoded) * 1e6 / elapsed_us;
+
+    file_ << now_ms << "," << *stats->ssrc << "," << stats->rid.value_or("")
+          << "," << stats->scalability_mode.value_or("") << ","
+          << (stats->active.value_or(true) ? 1 : 0) << ","
+          << static_cast<int64_t>(bitrate_bps) << "," << fps << ","
+          << stats->frame_width.value_or(0) << ","
+          << stats->frame_height.value_or(0) << ","
+          << stats->quality_limitation_reason.value_or("") << "\n";
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_OUTBOUND_LAYER_STATS_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_OUTBOUND_LAYER_STATS_H_
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "api/stats/rtc_stats_report.h"
+
+// Appends the rate of each outgoing video layer to outbound_layers.csv:
+//
+//   timestamp,ssrc,rid,scalability_mode,active,bitrate_bps,fps,width,
+//   height,quality_limitation
+//
+// Every simulcast encoding has its own outbound-rtp, so it gets its own
+// row; an SVC stream is one row whose scalability_mode shows the layers
+// being sent. Rates are computed from bytesSent and framesEncoded between
+// reports. Timestamps are rtc::TimeMillis(), like frame_timing.csv.
+//
+// It issues no GetStats() of its own: the owner hands it the reports
+// RTCStatsCollector already fetches (see SetReportObserver()), one call at
+// a time.
+class OutboundLayerStats {
+ public:
+  explicit OutboundLayerStats(const std::string& log_dir);
+
+  // Reports without video outbound-rtp are ignored.
+  void OnReport(const webrtc::RTCStatsReport& report);
+
+ private:
+  struct Sample {
+    int64_t time_us = 0;
+    uint64_t bytes_sent = 0;
+    uint32_t frames_encoded = 0;
+  };
+
+  std::ofstream file_;
+  // By SSRC, the previous report's counters.
+  std::map<uint32_t, Sample> previous_;
+};
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_OUTBOUND_LAYER_STATS_H_
@@ -228,8 +228,10 @@ void PeerConnectionClient::OnConnect(rtc::Socket* socket) {
 
 void PeerConnectionClient::OnHangingGetConnect(rtc::Socket* socket) {
   char buffer[1024];
-  snprintf(buffer, sizeof(buffer), "GET /wait?peer_id=%i HTTP/1.0\r\n\r\n",
-           my_id_);
+  // batch=1 has the server answer with every queued notification at once
+  // rather than one per connection.
+  snprintf(buffer, sizeof(buffer),
+           "GET /wait?peer_id=%i&batch=1 HTTP/1.0\r\n\r\n", my_id_);
   int len = static_cast<int>(strlen(buffer));
   int sent = socket->Send(buffer, len);
   RTC_DCHECK(sent == len);
@@ -376,26 +378,13 @@ void PeerConnectionClient::OnHangingGetRead(rtc::Socket* socket) {
     if (ok) {
       // Store the position where the body begins.
       size_t pos = eoh + 4;
-
-      if (my_id_ == static_cast<int>(peer_id)) {
-        // A notification about a new member or a member that just
-        // disconnected.
-        int id = 0;
-        std::string name;
-        bool connected = false;
-        if (ParseEntry(notification_data_.substr(pos), &name, &id,
-                       &connected)) {
-          if (connected) {
-            peers_[id] = name;
-            callback_->OnPeerConnected(id, name);
-          } else {
-            peers_.erase(id);
-            callback_->OnPeerDisconnected(id);
-          }
-        }
+      std::string content_type;
+      if (GetHeaderValue(notification_data_, eoh, "\r\nContent-Type: ",
+                         &content_type) &&
+          content_type == "multipart/x-peer-batch") {
+        OnNotificationBatch(notification_data_.substr(pos, content_length));
       } else {
-        OnMessageFromPeer(static_cast<int>(peer_id),
-                          notification_data_.substr(pos));
+        OnNotification(peer_id, notification_data_.substr(pos));
       }
     }
 
@@ -408,6 +397,52 @@ void PeerConnectionClient::OnHangingGetRead(rtc::Socket* socket) {
   }
 }
 
+void PeerConnectionClient::OnNotification(size_t peer_id,
+                                          const std::string& body) {
+  if (my_id_ == static_cast<int>(peer_id)) {
+    // A notification about a new member or a member that just
+    // disconnected.
+    int id = 0;
+    std::string name;
+    bool connected = false;
+    if (!body.empty() && ParseEntry(body, &name, &id, &connected)) {
+      if (connected) {
+        peers_[id] = name;
+        callback_->OnPeerConnected(id, name);
+      } else {
+        peers_.erase(id);
+        callback_->OnPeerDisconnected(id);
+      }
+    }
+  } else {
+    OnMessageFromPeer(static_cast<int>(peer_id), body);
+  }
+}
+
+void PeerConnectionClient::OnNotificationBatch(const std::string& body) {
+  size_t pos = 0;
+  while (pos < body.size()) {
+    size_t eoh = body.find("\r\n\r\n", pos);
+    if (eoh == std::string::npos) {
+      RTC_LOG(LS_ERROR) << "Malformed notification batch";
+      return;
+    }
+    // GetHeaderValue() looks for each name after a "\r\n".
+    const std::string headers = "\r\n" + body.substr(pos, eoh + 4 - pos);
+    size_t length = 0;
+    if (!GetHeaderValue(headers, headers.size(), "\r\nContent-Length: ",
+                        &length) ||
+        eoh + 4 + length > body.size()) {
+      RTC_LOG(LS_ERROR) << "Malformed notification batch";
+      return;
+    }
+    size_t peer_id = -1;
+    GetHeaderValue(headers, headers.size(), "\r\nPragma: ", &peer_id);
+    OnNotification(peer_id, body.substr(eoh + 4, length));
+    pos = eoh + 4 + length;
+  }
+}
+
 bool PeerConnectionClient::ParseEntry(const std::string& entry,
                                       std::string* name,
                                       int* id,
@@ -95,6 +95,15 @@ class PeerConnectionClient : public sigslot::has_slots<> {
 
   void OnHangingGetRead(rtc::Socket* socket);
 
+  // One notification of the hanging get: a peer list entry when `peer_id`
+  // is ours, otherwise a message from that peer.
+  void OnNotification(size_t peer_id, const std::string& body);
+
+  // Splits a "multipart/x-peer-batch" body into its parts; each part is
+  // headers (with a Pragma peer id and Content-Length), a blank line and
+  // the body.
+  void OnNotificationBatch(const std::string& body);
+
   // Parses a single line entry in the form "<name>,<id>,<connected>"
   bool ParseEntry(const std::string& entry,
                   std::string* name,
@@ -1,26 +1,35 @@
 #include "examples/peerconnection/client/rtc_stats_collector.h"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+#include "api/stats/rtcstats_objects.h"
 #include "rtc_base/logging.h"
 #include "rtc_base/time_utils.h"
 
 RTCStatsCollectorCallback::RTCStatsCollectorCallback(
     std::ofstream& per_frame_stats_file,
     std::ofstream& average_stats_file,
+    StatsRingFile& ring,
     std::mutex& stats_mutex,
-    PersistentStats& persistent_stats)  // Add persistent stats
+    PersistentStats& persistent_stats,  // Add persistent stats
+    const StatsReportObserver& report_observer,
+    StatsDeltaTracker* delta_tracker,
+    std::ofstream* delta_file)
     : per_frame_stats_file_(per_frame_stats_file),
         average_stats_file_(average_stats_file),
+        ring_(ring),
         stats_mutex_(stats_mutex),
-        persistent_stats_(persistent_stats) {
-    RTC_LOG(LS_INFO) << "RTCStatsCollectorCallback created.";
-}
+        persistent_stats_(persistent_stats),
+        report_observer_(report_observer),
+        delta_tracker_(delta_tracker),
+        delta_file_(delta_file) {}
 
-RTCStatsCollectorCallback::~RTCStatsCollectorCallback() {
-    RTC_LOG(LS_INFO) << "RTCStatsCollectorCallback destroyed.";
-}
+RTCStatsCollectorCallback::~RTCStatsCollectorCallback() = default;
 
 void RTCStatsCollectorCallback::OnStatsDelivered(
     const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) {
-    RTC_LOG(LS_INFO) << "OnStatsDelivered called. Posting task to signaling thread.";
     OnStatsDeliveredOnSignalingThread(report);
 }
 
@@ -80,46 +89,73 @@ bool ParseTimingFrameInfo(const std::string& timing_info_str, webrtc::TimingFram
     return true;
 }
 
-void RTCStatsCollectorCallback::ProcessInboundRTPStats(const webrtc::RTCStats& stats) {
-    std::vector<webrtc::Attribute> attributes = stats.Attributes();
-    auto find_attribute = [&attributes](const std::string& name) -> const webrtc::Attribute* {
-        for (const auto& attribute : attributes) {
-            if (attribute.name() == name) {
-                RTC_LOG(LS_INFO) << "Found attribute " << name << " = " << attribute.ToString();
-                return &attribute;
-            }
-        }
-        RTC_LOG(LS_WARNING) << "Attribute not found: " << name;
-        return nullptr;
-    };
-
-    // Helper function to get numeric values safely without exceptions
-    auto get_numeric = [&find_attribute](const std::string& name, double default_value = 0) -> double {
-        const auto* attr = find_attribute(name);
-        if (!attr || attr->ToString() == "null") {
-            return default_value;  // Return default if null
-        }
-        const std::string& value_str = attr->ToString();
-        char* end;
-        double value = std::strtod(value_str.c_str(), &end);
-        if (end == value_str.c_str()) {
-            RTC_LOG(LS_WARNING) << "Failed to convert value for " << name << ": " << value_str;
-            return default_value;  // Return default on conversion failure
-        }
-        RTC_LOG(LS_INFO) << "Got numeric value for " << name << ": " << value;
-        return value;
-    };
+namespace {
 
-    const auto* timing_info_attr = find_attribute("googTimingFrameInfo");
-    
-    std::lock_guard<std::mutex> lock(stats_mutex_); 
-    if (timing_info_attr) {
-         // Extract the timing info as a string
-        std::string timing_info_str = timing_info_attr->ToString();
+template <typename T>
+int64_t OrUnset(const std::optional<T>& value) {
+    return value ? static_cast<int64_t>(*value) : -1;
+}
+
+double OrUnset(const std::optional<double>& value) {
+    return value ? *value : -1.0;
+}
 
+}  // namespace
+
+void RTCStatsCollectorCallback::ProcessInboundRTPStats(
+    const webrtc::RTCInboundRtpStreamStats& stats,
+    const webrtc::RTCRemoteOutboundRtpStreamStats* remote,
+    int64_t timestamp_us) {
+    InboundRtpRecord record;
+    record.timestamp_us = timestamp_us;
+    record.ssrc = OrUnset(stats.ssrc);
+    record.frames_received = OrUnset(stats.frames_received);
+    record.frames_decoded = OrUnset(stats.frames_decoded);
+    record.frames_dropped = OrUnset(stats.frames_dropped);
+    record.key_frames_decoded = OrUnset(stats.key_frames_decoded);
+    record.frame_width = OrUnset(stats.frame_width);
+    record.frame_height = OrUnset(stats.frame_height);
+    record.frames_per_second = OrUnset(stats.frames_per_second);
+    record.jitter_buffer_delay_s = OrUnset(stats.jitter_buffer_delay);
+    record.jitter_buffer_emitted_count =
+        OrUnset(stats.jitter_buffer_emitted_count);
+    record.total_decode_time_s = OrUnset(stats.total_decode_time);
+    record.min_playout_delay_s = OrUnset(stats.min_playout_delay);
+    record.jitter_s = OrUnset(stats.jitter);
+    record.bytes_received = OrUnset(stats.bytes_received);
+    record.header_bytes_received = OrUnset(stats.header_bytes_received);
+    record.packets_received = OrUnset(stats.packets_received);
+    record.packets_lost = OrUnset(stats.packets_lost);
+    record.packets_discarded = OrUnset(stats.packets_discarded);
+    record.fec_packets_received = OrUnset(stats.fec_packets_received);
+    record.fec_packets_discarded = OrUnset(stats.fec_packets_discarded);
+    record.fec_bytes_received = OrUnset(stats.fec_bytes_received);
+    record.retransmitted_packets_received =
+        OrUnset(stats.retransmitted_packets_received);
+    record.retransmitted_bytes_received =
+        OrUnset(stats.retransmitted_bytes_received);
+    record.nack_count = OrUnset(stats.nack_count);
+    record.pli_count = OrUnset(stats.pli_count);
+    record.freeze_count = OrUnset(stats.freeze_count);
+    record.total_freezes_duration_s = OrUnset(stats.total_freezes_duration);
+    record.remote_bytes_sent = remote ? OrUnset(remote->bytes_sent) : -1;
+    record.remote_packets_sent = remote ? OrUnset(remote->packets_sent) : -1;
+    record.remote_round_trip_time_s =
+        remote ? OrUnset(remote->round_trip_time) : -1.0;
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    ring_.Append(record);
+    std::string delta;
+    if (delta_tracker_ && delta_file_ && delta_file_->is_open() &&
+        delta_tracker_->Update(record, &delta)) {
+        *delta_file_ << delta << "\n";
+    }
+
+    if (stats.goog_timing_frame_info && per_frame_stats_file_.is_open()) {
         // Parse the timing info string into TimingFrameInfo
         webrtc::TimingFrameInfo timing_info;
-        if (ParseTimingFrameInfo(timing_info_str, &timing_info) && timing_info.encode_start_ms > 10000) {
+        if (ParseTimingFrameInfo(*stats.goog_timing_frame_info, &timing_info) &&
+            timing_info.encode_start_ms > 10000) {
             // Calculate timing stages
             int64_t encoding_ms = (timing_info.encode_finish_ms >= 0 && timing_info.encode_start_ms >= 0)
                                     ? timing_info.encode_finish_ms - timing_info.encode_start_ms
@@ -153,50 +189,45 @@ void RTCStatsCollectorCallback::ProcessInboundRTPStats(const webrtc::RTCStats& s
                                                 ? timing_info.receive_finish_ms - timing_info.receive_start_ms
                                                 : -1;
 
-            // Log the frame timings to the file
-            {
-                if (per_frame_stats_file_.is_open()) {
-                    per_frame_stats_file_ << rtc::TimeMillis() << "," << timing_info.rtp_timestamp << ","
-                                        << encoding_ms << ","
-                                        << network_ms << ","
-                                        << decoding_ms << ","
-                                        << rendering_ms << ","
-                                        << e2e_ms << ","
-                                        << inter_frame_ms << ","
-                                        << intra_construction_ms << "\n";
-                    per_frame_stats_file_.flush();
-                }
-            }
+            per_frame_stats_file_ << rtc::TimeMillis() << "," << timing_info.rtp_timestamp << ","
+                                  << encoding_ms << ","
+                                  << network_ms << ","
+                                  << decoding_ms << ","
+                                  << rendering_ms << ","
+                                  << e2e_ms << ","
+                                  << inter_frame_ms << ","
+                                  << intra_construction_ms << "\n";
             // Update the last processed timestamp
             persistent_stats_.last_timestamp_ = timing_info.rtp_timestamp;
         }
     }
 
-
     persistent_stats_.frame_timing_count_ += 1;
 
-    // Extract all stats with null handling
-    int64_t frames_decoded = static_cast<int64_t>(get_numeric("framesDecoded"));
-    int64_t frames_dropped = static_cast<int64_t>(get_numeric("framesDropped"));
-    int64_t frames_received = static_cast<int64_t>(get_numeric("framesReceived"));
-    double framerate = get_numeric("framesPerSecond");
-    double min_playout_delay_ms = get_numeric("googMinPlayoutDelayMs");
-    double jitter_buffer_delay = get_numeric("jitterBufferDelay") * 1000.0;
-    int64_t width = static_cast<int64_t>(get_numeric("frameWidth"));
-    int64_t height = static_cast<int64_t>(get_numeric("frameHeight"));
-    double total_decode_time = get_numeric("totalDecodeTime") * 1000.0;
-    int64_t bytes_received = static_cast<int64_t>(get_numeric("bytesReceived"));
-
-    int64_t packets_received        = static_cast<int64_t>(get_numeric("packetsReceived"));
-    int64_t packets_lost            = static_cast<int64_t>(get_numeric("packetsLost"));
-    int64_t packets_discarded       = static_cast<int64_t>(get_numeric("packetsDiscarded"));
-    int64_t fec_packets_received    = static_cast<int64_t>(get_numeric("fecPacketsReceived"));
-    int64_t fec_packets_discarded   = static_cast<int64_t>(get_numeric("fecPacketsDiscarded"));
-    int64_t packets_repaired        = static_cast<int64_t>(get_numeric("packetsRepaired"));
-    int64_t fec_bytes_recv = static_cast<int64_t>(get_numeric("fecBytesReceived"));
-
-    int64_t retx_pkts_recv  = static_cast<int64_t>(get_numeric("retransmittedPacketsReceived"));
-    int64_t retx_bytes_recv = static_cast<int64_t>(get_numeric("retransmittedBytesReceived"));
+    if (remote) {
+        ProcessRemoteOutboundRTPStats(*remote);
+    }
+
+    int64_t frames_decoded = std::max<int64_t>(record.frames_decoded, 0);
+    int64_t frames_dropped = std::max<int64_t>(record.frames_dropped, 0);
+    int64_t frames_received = std::max<int64_t>(record.frames_received, 0);
+    double framerate = stats.frames_per_second.value_or(0.0);
+    double min_playout_delay_ms = stats.min_playout_delay.value_or(0.0) * 1000.0;
+    double jitter_buffer_delay = stats.jitter_buffer_delay.value_or(0.0) * 1000.0;
+    int64_t width = std::max<int64_t>(record.frame_width, 0);
+    int64_t height = std::max<int64_t>(record.frame_height, 0);
+    double total_decode_time = stats.total_decode_time.value_or(0.0) * 1000.0;
+    int64_t bytes_received = std::max<int64_t>(record.bytes_received, 0);
+
+    int64_t packets_received      = std::max<int64_t>(record.packets_received, 0);
+    int64_t packets_lost          = stats.packets_lost.value_or(0);
+    int64_t packets_discarded     = std::max<int64_t>(record.packets_discarded, 0);
+    int64_t fec_packets_received  = std::max<int64_t>(record.fec_packets_received, 0);
+    int64_t fec_packets_discarded = std::max<int64_t>(record.fec_packets_discarded, 0);
+    int64_t fec_bytes_recv        = std::max<int64_t>(record.fec_bytes_received, 0);
+
+    int64_t retx_pkts_recv  = std::max<int64_t>(record.retransmitted_packets_received, 0);
+    int64_t retx_bytes_recv = std::max<int64_t>(record.retransmitted_bytes_received, 0);
 
     int64_t current_time_ms = rtc::TimeMillis();
 
@@ -276,7 +307,6 @@ void RTCStatsCollectorCallback::ProcessInboundRTPStats(const webrtc::RTCStats& s
         int64_t period_packets_discarded     = 0;
         int64_t period_fec_packets_received  = 0;
         int64_t period_fec_packets_discarded = 0;
-        int64_t period_packets_repaired      = 0;
 
         if (persistent_stats_.last_packets_received_ != -1) {
             period_packets_received      = packets_received      - persistent_stats_.last_packets_received_;
@@ -284,8 +314,10 @@ void RTCStatsCollectorCallback::ProcessInboundRTPStats(const webrtc::RTCStats& s
             period_packets_discarded     = packets_discarded     - persistent_stats_.last_packets_discarded_;
             period_fec_packets_received  = fec_packets_received  - persistent_stats_.last_fec_packets_received_;
             period_fec_packets_discarded = fec_packets_discarded - persistent_stats_.last_fec_packets_discarded_;
-            period_packets_repaired      = packets_repaired      - persistent_stats_.last_packets_repaired_;
         }
+        // inbound-rtp has no packetsRepaired; the column is kept for
+        // existing analysis scripts.
+        const int64_t period_packets_repaired = 0;
 
         double loss_ratio = 0.0;
         if (period_packets_received + period_packets_lost > 0) {
@@ -299,7 +331,6 @@ void RTCStatsCollectorCallback::ProcessInboundRTPStats(const webrtc::RTCStats& s
         persistent_stats_.last_packets_discarded_     = packets_discarded;
         persistent_stats_.last_fec_packets_received_  = fec_packets_received;
         persistent_stats_.last_fec_packets_discarded_ = fec_packets_discarded;
-        persistent_stats_.last_packets_repaired_      = packets_repaired;
 
         // ── receiver FEC bytes Δ ──
         int64_t period_fec_bytes_recv = 0;
@@ -308,11 +339,11 @@ void RTCStatsCollectorCallback::ProcessInboundRTPStats(const webrtc::RTCStats& s
                                     persistent_stats_.last_fec_bytes_recv_;
         persistent_stats_.last_fec_bytes_recv_ = fec_bytes_recv;
 
-        // ── sender FEC bytes Δ ──
-        int64_t period_fec_bytes_sent = 0;
-        if (persistent_stats_.period_remote_start_fec_bytes_sent_ != 0)
-            period_fec_bytes_sent = persistent_stats_.last_remote_fec_bytes_sent_ -
-                                    persistent_stats_.period_remote_start_fec_bytes_sent_;
+        // remote-outbound-rtp carries no FEC or retransmission counters;
+        // these columns are kept for existing analysis scripts.
+        const int64_t period_fec_bytes_sent = 0;
+        const int64_t period_retx_pkts_sent = 0;
+        const int64_t period_retx_bytes_sent = 0;
 
         // receiver-side FEC share of total traffic this second
         double fec_byte_ratio = 0.0;
@@ -333,16 +364,6 @@ void RTCStatsCollectorCallback::ProcessInboundRTPStats(const webrtc::RTCStats& s
         persistent_stats_.last_retx_pkts_recv_  = retx_pkts_recv;
         persistent_stats_.last_retx_bytes_recv_ = retx_bytes_recv;
 
-        // ───── retransmission deltas (sender) ─────
-        int64_t period_retx_pkts_sent  = 0;
-        int64_t period_retx_bytes_sent = 0;
-        if (persistent_stats_.period_remote_start_retx_pkts_sent_ != 0) {
-            period_retx_pkts_sent  = persistent_stats_.last_remote_retx_pkts_sent_
-                                - persistent_stats_.period_remote_start_retx_pkts_sent_;
-            period_retx_bytes_sent = persistent_stats_.last_remote_retx_bytes_sent_
-                                - persistent_stats_.period_remote_start_retx_bytes_sent_;
-        }
-
         // simple receiver-side retransmission ratio
         double retransmission_ratio = 0.0;
         if (period_packets_received + period_packets_lost > 0) {
@@ -350,15 +371,11 @@ void RTCStatsCollectorCallback::ProcessInboundRTPStats(const webrtc::RTCStats& s
                                 static_cast<double>(period_packets_received + period_packets_lost);
         }
 
-        // Handle decoder implementation
-        const auto* decoder_impl_attr = find_attribute("decoderImplementation");
-        std::string decoder_implementation =
-            decoder_impl_attr ? decoder_impl_attr->ToString() : "unknown";
-        if (decoder_implementation == "null") {
-            decoder_implementation = "unknown";
-        }
+        const std::string& decoder_implementation =
+            stats.decoder_implementation ? *stats.decoder_implementation
+                                         : std::string("unknown");
 
-        // Write stats to file with mutex protection
+        // One row per second; the stream is flushed when the file closes.
         if (average_stats_file_.is_open() && avg_frames_decoded > 0) {
             average_stats_file_ << current_time_ms << ","
                 << avg_frames_decoded << ","
@@ -373,8 +390,8 @@ void RTCStatsCollectorCallback::ProcessInboundRTPStats(const webrtc::RTCStats& s
                 << bytes_received << ","
                 << period_average_bitrate << ","
                 << overall_average_bitrate << ","
-                << period_sender_bitrate << ","          
-                << overall_sender_bitrate << ","         
+                << period_sender_bitrate << ","
+                << overall_sender_bitrate << ","
                 << decoder_implementation << ","
                 << period_packets_received << ","
                 << period_packets_lost << ","
@@ -391,7 +408,6 @@ void RTCStatsCollectorCallback::ProcessInboundRTPStats(const webrtc::RTCStats& s
                 << period_retx_pkts_sent << ","
                 << period_retx_bytes_sent << ","
                 << retransmission_ratio << "\n";
-                average_stats_file_.flush();
         }
 
         // Reset accumulators
@@ -406,108 +422,55 @@ void RTCStatsCollectorCallback::ProcessInboundRTPStats(const webrtc::RTCStats& s
         persistent_stats_.last_average_time_ms_ = current_time_ms;
         persistent_stats_.period_remote_start_bytes_ = persistent_stats_.last_remote_bytes_sent_;
 
-        persistent_stats_.period_remote_start_retx_bytes_sent_ =
-
-        persistent_stats_.period_remote_start_fec_bytes_sent_ =
-            persistent_stats_.last_remote_fec_bytes_sent_;
-
         // Reset period accumulators
         persistent_stats_.period_start_time_ms_ = current_time_ms;
         persistent_stats_.period_start_bytes_ = bytes_received;
-
-        persistent_stats_.period_remote_start_retx_pkts_sent_  = persistent_stats_.last_remote_retx_pkts_sent_;
-        persistent_stats_.period_remote_start_retx_bytes_sent_ = persistent_stats_.last_remote_retx_bytes_sent_;
-
     }
 }
 
+// Called with stats_mutex_ held.
 void RTCStatsCollectorCallback::ProcessRemoteOutboundRTPStats(
-    const webrtc::RTCStats& stats) {
-
-  std::vector<webrtc::Attribute> attributes = stats.Attributes();
-  auto find_attribute = [&attributes](const std::string& name) -> const webrtc::Attribute* {
-      for (const auto& a : attributes)
-          if (a.name() == name) return &a;
-      return nullptr;
-  };
-  auto get_numeric = [&find_attribute](const std::string& name,
-                                       double def = 0) -> double {
-      const auto* attr = find_attribute(name);
-      if (!attr || attr->ToString() == "null") return def;
-      char* end; const std::string& s = attr->ToString();
-      double v = std::strtod(s.c_str(), &end);
-      return (end == s.c_str()) ? def : v;
-  };
-
-  std::lock_guard<std::mutex> lock(stats_mutex_);
-
-  int64_t bytes_sent = static_cast<int64_t>(get_numeric("bytesSent"));
-  int64_t now_ms     = rtc::TimeMillis();
-
-  if (persistent_stats_.first_remote_stats_time_ms_ == -1) {
-      persistent_stats_.first_remote_stats_time_ms_ = now_ms;
-      persistent_stats_.period_remote_start_bytes_  = bytes_sent;
-  }
-  persistent_stats_.last_remote_bytes_sent_ = bytes_sent;
-
-  int64_t fec_bytes_sent = static_cast<int64_t>(
-                           get_numeric("fecBytesSent"));
-
-  if (persistent_stats_.first_remote_stats_time_ms_ == -1) {
-      /* …existing init… */
-      persistent_stats_.period_remote_start_fec_bytes_sent_ = fec_bytes_sent;
-  }
-  persistent_stats_.last_remote_fec_bytes_sent_ = fec_bytes_sent;
-
-  int64_t retx_bytes_sent = static_cast<int64_t>(
-                            get_numeric("retransmittedBytesSent"));
+    const webrtc::RTCRemoteOutboundRtpStreamStats& stats) {
+    int64_t bytes_sent = static_cast<int64_t>(stats.bytes_sent.value_or(0));
+    int64_t now_ms     = rtc::TimeMillis();
 
     if (persistent_stats_.first_remote_stats_time_ms_ == -1) {
-        persistent_stats_.period_remote_start_retx_bytes_sent_ = retx_bytes_sent;
+        persistent_stats_.first_remote_stats_time_ms_ = now_ms;
+        persistent_stats_.period_remote_start_bytes_  = bytes_sent;
     }
-    persistent_stats_.last_remote_retx_bytes_sent_ = retx_bytes_sent;
+    persistent_stats_.last_remote_bytes_sent_ = bytes_sent;
 }
 
 
 void RTCStatsCollectorCallback::OnStatsDeliveredOnSignalingThread(
     rtc::scoped_refptr<const webrtc::RTCStatsReport> report) {
-    RTC_LOG(LS_INFO) << "OnStatsDeliveredOnSignalingThread called.";
-
     if (!report) {
         RTC_LOG(LS_ERROR) << "Null stats report received";
         return;
     }
 
-    for (const auto& stats : *report) {
-        std::vector<webrtc::Attribute> attributes = stats.Attributes();
-        auto find_attribute = [&attributes](const std::string& name) -> const webrtc::Attribute* {
-            for (const auto& attribute : attributes) {
-                if (attribute.name() == name) {
-                    return &attribute;
-                }
-            }
-            return nullptr;
-        };
-
-        const auto* kind = find_attribute("kind");
-        if (!kind) {
-            RTC_LOG(LS_INFO) << "Skipping stats " << stats.id() << " because 'kind' attribute not found.";
-            continue;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        if (report_observer_) {
+            report_observer_(*report);
         }
+    }
 
-        if (kind->ToString() != "video") {
-            RTC_LOG(LS_INFO) << "Skipping stats " << stats.id() << " because kind is not video.";
+    const auto remotes =
+        report->GetStatsOfType<webrtc::RTCRemoteOutboundRtpStreamStats>();
+    for (const auto* inbound :
+         report->GetStatsOfType<webrtc::RTCInboundRtpStreamStats>()) {
+        if (inbound->kind.value_or("") != "video") {
             continue;
         }
-
-        if (std::string(stats.type()) == "inbound-rtp") {
-            RTC_LOG(LS_INFO) << "Processing inbound-rtp stats: " << stats.id();
-            ProcessInboundRTPStats(stats);
-        }
-        if (std::string(stats.type()) == "remote-outbound-rtp") {
-            RTC_LOG(LS_INFO) << "Processing remote-outbound-rtp stats: " << stats.id();
-            ProcessRemoteOutboundRTPStats(stats);
+        const webrtc::RTCRemoteOutboundRtpStreamStats* remote = nullptr;
+        for (const auto* candidate : remotes) {
+            if (candidate->ssrc == inbound->ssrc) {
+                remote = candidate;
+                break;
+            }
         }
+        ProcessInboundRTPStats(*inbound, remote, report->timestamp().us());
     }
 }
 
@@ -557,6 +520,11 @@ bool RTCStatsCollector::Start(
     return true;
 }
 
+void RTCStatsCollector::SetReportObserver(StatsReportObserver observer) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    report_observer_ = std::move(observer);
+}
+
 void RTCStatsCollector::Stop() {
     {
         std::lock_guard<std::mutex> lock(stats_mutex_);
@@ -586,6 +554,19 @@ bool RTCStatsCollector::OpenStatsFile(const std::string& foldername) {
     per_frame_stats_file_.flush();
     */
 
+    // High-rate samples go to the ring; stats_ring_to_csv.py converts it.
+    if (!ring_.Open(foldername + "/stats_ring.bin", kStatsRingCapacity)) {
+        RTC_LOG(LS_WARNING) << "Stats ring unavailable, writing CSV only";
+    }
+
+    if (mode_ == CollectionMode::kReceiverSelector) {
+        delta_tracker_.Reset();
+        delta_file_.open(foldername + "/stats_delta.log");
+        if (!delta_file_.is_open()) {
+            RTC_LOG(LS_WARNING) << "Failed to open stats_delta.log";
+        }
+    }
+
     // Open average stats file
     average_stats_file_.open(average_filename);
     if (!average_stats_file_.is_open()) {
@@ -623,6 +604,12 @@ void RTCStatsCollector::CloseStatsFile() {
         average_stats_file_.flush();
         average_stats_file_.close();
     }
+
+    if (delta_file_.is_open()) {
+        delta_file_.close();
+    }
+
+    ring_.Close();
 }
 
 void RTCStatsCollector::ThreadLoop() {
@@ -632,7 +619,7 @@ void RTCStatsCollector::ThreadLoop() {
         CollectStats();
         lock.lock();  // Explicit lock before waiting
 
-        stop_cv_.wait_for(lock, std::chrono::milliseconds(kStatsIntervalMs),
+        stop_cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_),
                           [this]() { return !should_collect_; });
     }
 }
@@ -643,12 +630,46 @@ void RTCStatsCollector::CollectStats() {
         return;
     }
 
+    if (mode_ == CollectionMode::kFullReport) {
+        auto stats_callback = rtc::make_ref_counted<RTCStatsCollectorCallback>(
+            per_frame_stats_file_,
+            average_stats_file_,
+            ring_,
+            stats_mutex_,
+            persistent_stats_,
+            report_observer_);
+        peer_connection_->GetStats(stats_callback.get());
+        return;
+    }
+
     auto stats_callback = rtc::make_ref_counted<RTCStatsCollectorCallback>(
         per_frame_stats_file_,
         average_stats_file_,
+        ring_,
         stats_mutex_,
-        persistent_stats_); 
+        persistent_stats_,
+        report_observer_,
+        &delta_tracker_,
+        &delta_file_);
+    for (const auto& receiver : peer_connection_->GetReceivers()) {
+        if (receiver->media_type() != cricket::MEDIA_TYPE_VIDEO) {
+            continue;
+        }
+        peer_connection_->GetStats(receiver, stats_callback);
+    }
 
-    peer_connection_->GetStats(stats_callback.get());
+    bool observed;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        observed = static_cast<bool>(report_observer_);
+    }
+    if (!observed) {
+        return;
+    }
+    for (const auto& sender : peer_connection_->GetSenders()) {
+        if (sender->media_type() == cricket::MEDIA_TYPE_VIDEO) {
+            peer_connection_->GetStats(sender, stats_callback);
+        }
+    }
 }
 
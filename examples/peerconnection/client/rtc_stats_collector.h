@@ -2,12 +2,16 @@
 #define RTC_STATS_COLLECTOR_H_
 
 #include <fstream>
+#include <functional>
 #include <mutex>
 #include <string>
 #include <vector>
 #include "api/peer_connection_interface.h"
 #include "api/stats/rtc_stats.h"
 #include "api/stats/rtc_stats_collector_callback.h"
+#include "api/stats/rtcstats_objects.h"
+#include "examples/peerconnection/client/stats_delta.h"
+#include "examples/peerconnection/client/stats_ring_file.h"
 #include "rtc_base/thread.h"
 #include <thread>
 #include <condition_variable>
@@ -40,22 +44,13 @@ struct PersistentStats {
     int64_t last_packets_discarded_      = -1;
     int64_t last_fec_packets_received_   = -1;
     int64_t last_fec_packets_discarded_  = -1;
-    int64_t last_packets_repaired_       = -1;
 
     // ── FEC bytes ──
     int64_t last_fec_bytes_recv_          = -1;
-    int64_t last_remote_fec_bytes_sent_   = -1;
-    int64_t period_remote_start_fec_bytes_sent_ = 0;
 
     // ReTX
     int64_t last_retx_pkts_recv_        = -1;
     int64_t last_retx_bytes_recv_       = -1;
-
-    int64_t last_remote_retx_pkts_sent_ = -1;
-    int64_t last_remote_retx_bytes_sent_= -1;
-
-    int64_t period_remote_start_retx_pkts_sent_  = 0;
-    int64_t period_remote_start_retx_bytes_sent_ = 0;
     
     // For current period average bitrate
     int64_t period_start_bytes_ = 0;
@@ -66,13 +61,20 @@ struct PersistentStats {
     int64_t period_remote_start_bytes_   = 0;   // 직전 구간 시작 값
 };
 
+// Also handed every report the collector fetches, with stats_mutex held.
+using StatsReportObserver = std::function<void(const webrtc::RTCStatsReport&)>;
+
 class RTCStatsCollectorCallback : public webrtc::RTCStatsCollectorCallback {
 public:
     RTCStatsCollectorCallback(
         std::ofstream& per_frame_stats_file,
         std::ofstream& average_stats_file,
+        StatsRingFile& ring,
         std::mutex& stats_mutex,
-        PersistentStats& persistent_stats);  // Add persistent stats
+        PersistentStats& persistent_stats,  // Add persistent stats
+        const StatsReportObserver& report_observer,
+        StatsDeltaTracker* delta_tracker = nullptr,
+        std::ofstream* delta_file = nullptr);
     ~RTCStatsCollectorCallback();
 
 
@@ -81,23 +83,42 @@ protected:
         const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) override;
 
 private:
-    void ProcessRemoteOutboundRTPStats(const webrtc::RTCStats& stats);
-    
+    void ProcessRemoteOutboundRTPStats(
+        const webrtc::RTCRemoteOutboundRtpStreamStats& stats);
+
     void OnStatsDeliveredOnSignalingThread(
         rtc::scoped_refptr<const webrtc::RTCStatsReport> report);
-    
-    void ProcessInboundRTPStats(const webrtc::RTCStats& stats);
+
+    // |remote| is the remote-outbound-rtp for the same SSRC, if any.
+    void ProcessInboundRTPStats(
+        const webrtc::RTCInboundRtpStreamStats& stats,
+        const webrtc::RTCRemoteOutboundRtpStreamStats* remote,
+        int64_t timestamp_us);
 
     std::ofstream& per_frame_stats_file_;
     std::ofstream& average_stats_file_;
+    StatsRingFile& ring_;
     std::mutex& stats_mutex_;
     PersistentStats& persistent_stats_;  // Reference to persistent stats
+    const StatsReportObserver& report_observer_;
+    StatsDeltaTracker* delta_tracker_;   // Selector mode only
+    std::ofstream* delta_file_;
 
     //const int kFrameTimingLogCount = 5; // 60 frames per second
 };
 
 class RTCStatsCollector {
 public:
+    enum class CollectionMode {
+        // One PeerConnection-wide GetStats() per poll.
+        kFullReport,
+        // One GetStats(receiver) per video receiver. The report only holds
+        // that receiver's inbound-rtp and the objects it references. The
+        // logged fields that changed since the previous poll are appended
+        // to stats_delta.log as "<timestamp_us> <ssrc> name=value ...".
+        kReceiverSelector,
+    };
+
     RTCStatsCollector();
     ~RTCStatsCollector();
 
@@ -107,6 +128,15 @@ public:
 
     bool IsRunning () { return is_running_;}
 
+    // Polling period; takes effect on the next Start().
+    void SetIntervalMs(int interval_ms) { interval_ms_ = interval_ms; }
+    // Takes effect on the next Start().
+    void SetCollectionMode(CollectionMode mode) { mode_ = mode; }
+    // Reports already delivered are not replayed. In kReceiverSelector mode
+    // every video sender is polled as well while an observer is set.
+    // Pass nullptr to detach; no call is running once this returns.
+    void SetReportObserver(StatsReportObserver observer);
+
 private:
     void CollectStats();
     void ThreadLoop();
@@ -116,6 +146,10 @@ private:
 
     std::ofstream per_frame_stats_file_;
     std::ofstream average_stats_file_;
+    StatsRingFile ring_;
+    std::ofstream delta_file_;
+    StatsDeltaTracker delta_tracker_;
+    StatsReportObserver report_observer_;  // Guarded by stats_mutex_.
 
     std::thread stats_thread_;          // Use std::thread instead of rtc::Thread
     std::mutex stats_mutex_;            // Mutex for thread safety
@@ -124,7 +158,11 @@ private:
     rtc::scoped_refptr<webrtc::PeerConnectionInterface> peer_connection_;
 
     bool is_running_ = false;
-    const int kStatsIntervalMs = 200; // Collection interval in milliseconds
+    static constexpr int kDefaultStatsIntervalMs = 200;
+    // ~22 minutes of history at 20 ms, ~16 MB on disk.
+    static constexpr size_t kStatsRingCapacity = 64 * 1024;
+    int interval_ms_ = kDefaultStatsIntervalMs;
+    CollectionMode mode_ = CollectionMode::kFullReport;
 
     PersistentStats persistent_stats_;
 };
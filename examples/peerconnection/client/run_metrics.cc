@@ -0,0 +1,191 @@
+#include "examples/peerconnection/client/run_metrics.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <utility>
+
+#include "json/value.h"
+#include "json/writer.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/time_utils.h"
+
+namespace {
+
+struct MetricInfo {
+  const char* name;
+  // Divides the recorded value into the reported unit.
+  double scale;
+};
+
+constexpr MetricInfo kMetricInfo[RunMetrics::kNumMetrics] = {
+    {"e2e_delay_ms", 1e3},
+    {"frame_interval_ms", 1e3},
+    {"sctp_delay_ms", 1e3},
+    {"sctp_goodput_mbps", 1e6},
+};
+
+Json::Value Describe(const sctp::LatencyHistogram::Snapshot& snapshot,
+                     double scale) {
+  Json::Value out;
+  out["count"] = Json::UInt64(snapshot.total);
+  if (snapshot.total == 0)
+    return out;
+  out["p50"] = snapshot.Quantile(0.50) / scale;
+  out["p90"] = snapshot.Quantile(0.90) / scale;
+  out["p95"] = snapshot.Quantile(0.95) / scale;
+  out["p99"] = snapshot.Quantile(0.99) / scale;
+  out["max"] = snapshot.max / scale;
+  return out;
+}
+
+bool WithinTolerance(int64_t previous, int64_t current, double tolerance) {
+  if (previous <= 0)
+    return previous == current;
+  return std::abs(current - previous) <=
+         tolerance * static_cast<double>(previous);
+}
+
+std::string ToJson(const Json::Value& value, const char* indentation) {
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = indentation;
+  return Json::writeString(builder, value);
+}
+
+}  // namespace
+
+RunMetrics::RunMetrics(const std::string& log_dir,
+                       const Options& options,
+                       std::function<void()> on_converged)
+    : log_dir_(log_dir),
+      options_(options),
+      on_converged_(std::move(on_converged)) {}
+
+RunMetrics::~RunMetrics() {
+  Stop();
+}
+
+void RunMetrics::Merge(Metric metric,
+                       const sctp::LatencyHistogram::Snapshot& samples) {
+  if (samples.total == 0)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_[metric].Merge(samples);
+}
+
+void RunMetrics::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_)
+    return;
+  running_ = true;
+  if (start_ms_ < 0)
+    start_ms_ = rtc::TimeMillis();
+  if (!snapshots_.is_open()) {
+    snapshots_.open(log_dir_ + "/metrics_snapshots.jsonl", std::ios::app);
+    if (!snapshots_.is_open()) {
+      RTC_LOG(LS_ERROR) << "Failed to open " << log_dir_
+                        << "/metrics_snapshots.jsonl";
+    }
+  }
+  reporter_ = std::thread([this] { ReportLoop(); });
+}
+
+void RunMetrics::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_)
+      return;
+    running_ = false;
+  }
+  wake_.notify_all();
+  reporter_.join();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  FoldLocked();
+  const int64_t now_ms = rtc::TimeMillis();
+  WriteSnapshotLocked(now_ms);
+  WriteSummaryLocked(now_ms);
+  snapshots_.flush();
+}
+
+void RunMetrics::ReportLoop() {
+  const auto period = std::chrono::milliseconds(options_.snapshot_period_ms);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!wake_.wait_for(lock, period, [this] { return !running_; })) {
+    FoldLocked();
+    const int64_t now_ms = rtc::TimeMillis();
+    WriteSnapshotLocked(now_ms);
+    if (converged_ || options_.convergence_tolerance <= 0)
+      continue;
+    CheckConvergenceLocked(now_ms);
+    if (converged_) {
+      RTC_LOG(LS_INFO) << "Run metrics converged after "
+                       << (now_ms - start_ms_) / 1000 << " s";
+      WriteSummaryLocked(now_ms);
+      lock.unlock();
+      if (on_converged_)
+        on_converged_();
+      lock.lock();
+    }
+  }
+}
+
+void RunMetrics::FoldLocked() {
+  for (int i = 0; i < kNumMetrics; ++i) {
+    sctp::LatencyHistogram::Snapshot window;
+    live_[i].Collect(&window);
+    window.Merge(pending_[i]);
+    pending_[i] = sctp::LatencyHistogram::Snapshot();
+    totals_[i].Merge(window);
+  }
+}
+
+void RunMetrics::CheckConvergenceLocked(int64_t now_ms) {
+  const sctp::LatencyHistogram::Snapshot& tracked =
+      totals_[kE2eDelayUs].total > 0 ? totals_[kE2eDelayUs]
+                                     : totals_[kSctpDelayUs];
+  if (tracked.total == 0) {
+    stable_windows_ = 0;
+    return;
+  }
+  const int64_t p50 = tracked.Quantile(0.50);
+  const int64_t p95 = tracked.Quantile(0.95);
+  const double tolerance = options_.convergence_tolerance;
+  if (last_p50_ >= 0 && WithinTolerance(last_p50_, p50, tolerance) &&
+      WithinTolerance(last_p95_, p95, tolerance)) {
+    ++stable_windows_;
+  } else {
+    stable_windows_ = 0;
+  }
+  last_p50_ = p50;
+  last_p95_ = p95;
+  converged_ = stable_windows_ >= options_.convergence_windows &&
+               now_ms - start_ms_ >= options_.min_duration_s * 1000;
+}
+
+void RunMetrics::WriteSnapshotLocked(int64_t now_ms) {
+  if (!snapshots_.is_open())
+    return;
+  Json::Value line;
+  line["timestamp"] = Json::Int64(now_ms);
+  line["elapsed_s"] = (now_ms - start_ms_) / 1000.0;
+  for (int i = 0; i < kNumMetrics; ++i)
+    line[kMetricInfo[i].name] = Describe(totals_[i], kMetricInfo[i].scale);
+  snapshots_ << ToJson(line, "") << "\n";
+}
+
+void RunMetrics::WriteSummaryLocked(int64_t now_ms) {
+  Json::Value summary;
+  summary["duration_s"] = (now_ms - start_ms_) / 1000.0;
+  summary["converged"] = converged_;
+  for (int i = 0; i < kNumMetrics; ++i) {
+    summary["metrics"][kMetricInfo[i].name] =
+        Describe(totals_[i], kMetricInfo[i].scale);
+  }
+  std::ofstream file(log_dir_ + "/metrics_summary.json", std::ios::trunc);
+  if (!file.is_open()) {
+    RTC_LOG(LS_ERROR) << "Failed to write " << log_dir_
+                      << "/metrics_summary.json";
+    return;
+  }
+  file << ToJson(summary, "  ") << "\n";
+}
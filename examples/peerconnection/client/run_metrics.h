@@ -0,0 +1,100 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_RUN_METRICS_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_RUN_METRICS_H_
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "sctp_traffic/latency_histogram.h"
+
+// Streaming summary of a run, so sweeps get their numbers without
+// post-processing the per-frame and per-interval CSVs. Every metric is a
+// sctp::LatencyHistogram (log-linear, ~6% error), fed wait-free by the
+// thread that observes it:
+//
+//   e2e_delay_ms       decoded frames with the video-timing extension
+//   frame_interval_ms  time between decoded frames of a track
+//   sctp_delay_ms      bulk SCTP message delay
+//   sctp_goodput_mbps  bulk SCTP rate, one sample per receiver log interval
+//
+// A reporter thread folds the histograms into running totals every
+// |snapshot_period_ms|, appends a snapshot line to metrics_snapshots.jsonl
+// and, on Stop(), writes metrics_summary.json. Memory stays constant
+// however long the run is.
+//
+// With a convergence tolerance, the run is declared converged once p50 and
+// p95 of the e2e delay (the SCTP delay without video) have each moved by
+// at most that fraction for |convergence_windows| snapshots in a row, and
+// |min_duration_s| has passed. |on_converged| then runs once, on the
+// reporter thread.
+class RunMetrics {
+ public:
+  enum Metric {
+    kE2eDelayUs,
+    kFrameIntervalUs,
+    kSctpDelayUs,
+    kSctpGoodputBps,
+    kNumMetrics,
+  };
+
+  struct Options {
+    int snapshot_period_ms = 1000;
+    // 0 never declares convergence.
+    double convergence_tolerance = 0.0;
+    int convergence_windows = 5;
+    int min_duration_s = 30;
+  };
+
+  RunMetrics(const std::string& log_dir,
+             const Options& options,
+             std::function<void()> on_converged);
+  ~RunMetrics();
+
+  RunMetrics(const RunMetrics&) = delete;
+  RunMetrics& operator=(const RunMetrics&) = delete;
+
+  // Any thread.
+  void Add(Metric metric, int64_t value) { live_[metric].Add(value); }
+  // For producers that already drain their own histogram.
+  void Merge(Metric metric, const sctp::LatencyHistogram::Snapshot& samples);
+
+  // Starts the reporter. Totals carry over from an earlier Start().
+  void Start();
+  // Stops the reporter and rewrites metrics_summary.json.
+  void Stop();
+
+ private:
+  void ReportLoop();
+  // Called with |mutex_| held.
+  void FoldLocked();
+  void CheckConvergenceLocked(int64_t now_ms);
+  void WriteSnapshotLocked(int64_t now_ms);
+  void WriteSummaryLocked(int64_t now_ms);
+
+  const std::string log_dir_;
+  const Options options_;
+  const std::function<void()> on_converged_;
+
+  std::array<sctp::LatencyHistogram, kNumMetrics> live_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool running_ = false;
+  std::thread reporter_;
+  // Merge()d samples not yet folded into |totals_|.
+  std::array<sctp::LatencyHistogram::Snapshot, kNumMetrics> pending_;
+  std::array<sctp::LatencyHistogram::Snapshot, kNumMetrics> totals_;
+  std::ofstream snapshots_;
+  int64_t start_ms_ = -1;
+  int64_t last_p50_ = -1;
+  int64_t last_p95_ = -1;
+  int stable_windows_ = 0;
+  bool converged_ = false;
+};
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_RUN_METRICS_H_
@@ -0,0 +1,339 @@
+#include "examples/peerconnection/client/run_profile.h"
+
+#include <fstream>
+#include <set>
+#include <utility>
+
+#include "json/reader.h"
+#include "json/value.h"
+#include "modules/video_coding/svc/scalability_mode_util.h"
+
+namespace {
+
+// Fails on keys of |object| outside |known|.
+bool CheckKeys(const Json::Value& object,
+               const std::set<std::string>& known,
+               const std::string& where,
+               std::string* error) {
+  if (!object.isObject()) {
+    *error = where + " must be an object";
+    return false;
+  }
+  for (const std::string& key : object.getMemberNames()) {
+    if (!known.count(key)) {
+      *error = "unknown key " + where + "." + key;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ReadInt(const Json::Value& object,
+             const char* key,
+             int* out,
+             std::string* error) {
+  if (!object.isMember(key))
+    return true;
+  if (!object[key].isInt()) {
+    *error = std::string(key) + " must be an integer";
+    return false;
+  }
+  *out = object[key].asInt();
+  return true;
+}
+
+// Like ReadInt(); jsoncpp's asString/asBool/asDouble assert or throw on the
+// wrong type, so every value is checked before it is read.
+bool ReadString(const Json::Value& object,
+                const char* key,
+                std::string* out,
+                std::string* error) {
+  if (!object.isMember(key))
+    return true;
+  if (!object[key].isString()) {
+    *error = std::string(key) + " must be a string";
+    return false;
+  }
+  *out = object[key].asString();
+  return true;
+}
+
+bool ReadBool(const Json::Value& object,
+              const char* key,
+              bool* out,
+              std::string* error) {
+  if (!object.isMember(key))
+    return true;
+  if (!object[key].isBool()) {
+    *error = std::string(key) + " must be true or false";
+    return false;
+  }
+  *out = object[key].asBool();
+  return true;
+}
+
+bool ReadDouble(const Json::Value& object,
+                const char* key,
+                double* out,
+                std::string* error) {
+  if (!object.isMember(key))
+    return true;
+  if (!object[key].isNumeric()) {
+    *error = std::string(key) + " must be a number";
+    return false;
+  }
+  *out = object[key].asDouble();
+  return true;
+}
+
+bool ReadLayer(const Json::Value& jlayer,
+               RunProfile::Layer* layer,
+               std::string* error) {
+  if (!CheckKeys(jlayer,
+                 {"rid", "active", "max_bitrate_bps", "max_framerate",
+                  "scale_resolution_down_by", "scalability_mode"},
+                 "layers[]", error)) {
+    return false;
+  }
+  *layer = RunProfile::Layer();
+  if (!ReadString(jlayer, "rid", &layer->rid, error) ||
+      !ReadBool(jlayer, "active", &layer->active, error)) {
+    return false;
+  }
+  if (jlayer.isMember("max_bitrate_bps")) {
+    int bps = 0;
+    if (!ReadInt(jlayer, "max_bitrate_bps", &bps, error))
+      return false;
+    layer->max_bitrate_bps = bps;
+  }
+  if (jlayer.isMember("max_framerate")) {
+    double framerate = 0;
+    if (!ReadDouble(jlayer, "max_framerate", &framerate, error))
+      return false;
+    layer->max_framerate = framerate;
+  }
+  if (jlayer.isMember("scale_resolution_down_by")) {
+    double scale = 0;
+    if (!ReadDouble(jlayer, "scale_resolution_down_by", &scale, error))
+      return false;
+    layer->scale_resolution_down_by = scale;
+    if (scale < 1.0) {
+      *error = "scale_resolution_down_by must be at least 1";
+      return false;
+    }
+  }
+  if (jlayer.isMember("scalability_mode")) {
+    std::string mode;
+    if (!ReadString(jlayer, "scalability_mode", &mode, error))
+      return false;
+    layer->scalability_mode = mode;
+    if (!webrtc::ScalabilityModeFromString(*layer->scalability_mode)) {
+      *error = "unknown scalability_mode " + *layer->scalability_mode;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ReadDegradationPreference(const std::string& name,
+                               webrtc::DegradationPreference* out) {
+  static const std::map<std::string, webrtc::DegradationPreference> kNames = {
+      {"disabled", webrtc::DegradationPreference::DISABLED},
+      {"maintain-framerate", webrtc::DegradationPreference::MAINTAIN_FRAMERATE},
+      {"maintain-resolution",
+       webrtc::DegradationPreference::MAINTAIN_RESOLUTION},
+      {"balanced", webrtc::DegradationPreference::BALANCED},
+  };
+  auto it = kNames.find(name);
+  if (it == kNames.end())
+    return false;
+  *out = it->second;
+  return true;
+}
+
+bool ParseRunProfile(const Json::Value& root,
+                     RunProfile* profile,
+                     std::string* error) {
+  if (!CheckKeys(root,
+                 {"codecs", "codec_parameters", "degradation_preference",
+                  "layers", "bitrate", "field_trials", "ports", "ice"},
+                 "profile", error)) {
+    return false;
+  }
+
+  if (root.isMember("codecs")) {
+    const Json::Value& codecs = root["codecs"];
+    if (!codecs.isArray()) {
+      *error = "codecs must be an array";
+      return false;
+    }
+    for (const Json::Value& codec : codecs) {
+      if (!codec.isString()) {
+        *error = "codecs must hold codec names";
+        return false;
+      }
+      profile->codecs.push_back(codec.asString());
+    }
+  }
+
+  const Json::Value& codec_parameters = root["codec_parameters"];
+  if (!codec_parameters.isNull()) {
+    if (!codec_parameters.isObject()) {
+      *error = "codec_parameters must be an object";
+      return false;
+    }
+    for (const std::string& codec : codec_parameters.getMemberNames()) {
+      const Json::Value& params = codec_parameters[codec];
+      if (!params.isObject()) {
+        *error = "codec_parameters." + codec + " must be an object";
+        return false;
+      }
+      for (const std::string& key : params.getMemberNames()) {
+        // fmtp values; numbers such as packetization-mode are fine too.
+        if (!params[key].isString() && !params[key].isNumeric()) {
+          *error = "codec_parameters." + codec + "." + key +
+                   " must be a string or number";
+          return false;
+        }
+        profile->codec_parameters[codec][key] = params[key].asString();
+      }
+    }
+  }
+
+  if (root.isMember("degradation_preference")) {
+    std::string name;
+    if (!ReadString(root, "degradation_preference", &name, error))
+      return false;
+    webrtc::DegradationPreference preference;
+    if (!ReadDegradationPreference(name, &preference)) {
+      *error = "unknown degradation_preference " + name;
+      return false;
+    }
+    profile->degradation_preference = preference;
+  }
+
+  if (root.isMember("layers")) {
+    const Json::Value& layers = root["layers"];
+    if (!layers.isArray() || layers.empty()) {
+      *error = "layers must be a non-empty array";
+      return false;
+    }
+    profile->layers.clear();
+    std::set<std::string> rids;
+    for (const Json::Value& jlayer : layers) {
+      RunProfile::Layer layer;
+      if (!ReadLayer(jlayer, &layer, error))
+        return false;
+      if (layers.size() > 1 &&
+          (layer.rid.empty() || !rids.insert(layer.rid).second)) {
+        *error = "simulcast layers need distinct rids";
+        return false;
+      }
+      profile->layers.push_back(std::move(layer));
+    }
+  }
+
+  if (root.isMember("bitrate")) {
+    const Json::Value& bitrate = root["bitrate"];
+    if (!CheckKeys(bitrate, {"min_bps", "start_bps", "max_bps"}, "bitrate",
+                   error) ||
+        !ReadInt(bitrate, "min_bps", &profile->min_bitrate_bps, error) ||
+        !ReadInt(bitrate, "start_bps", &profile->start_bitrate_bps, error) ||
+        !ReadInt(bitrate, "max_bps", &profile->max_bitrate_bps, error)) {
+      return false;
+    }
+    if (profile->min_bitrate_bps > profile->start_bitrate_bps ||
+        profile->start_bitrate_bps > profile->max_bitrate_bps) {
+      *error = "bitrate must satisfy min_bps <= start_bps <= max_bps";
+      return false;
+    }
+  }
+
+  if (!ReadString(root, "field_trials", &profile->field_trials, error))
+    return false;
+
+  if (root.isMember("ports")) {
+    const Json::Value& ports = root["ports"];
+    if (!CheckKeys(ports, {"min", "max"}, "ports", error) ||
+        !ReadInt(ports, "min", &profile->min_port, error) ||
+        !ReadInt(ports, "max", &profile->max_port, error)) {
+      return false;
+    }
+    if (profile->min_port < 1 || profile->min_port > profile->max_port ||
+        profile->max_port > 65535) {
+      *error = "ports must satisfy 1 <= min <= max <= 65535";
+      return false;
+    }
+  }
+
+  if (root.isMember("ice")) {
+    const Json::Value& ice = root["ice"];
+    if (!CheckKeys(ice,
+                   {"receiving_timeout_ms", "backup_ping_interval_ms",
+                    "check_min_interval_ms"},
+                   "ice", error) ||
+        !ReadInt(ice, "receiving_timeout_ms",
+                 &profile->ice_connection_receiving_timeout_ms, error) ||
+        !ReadInt(ice, "backup_ping_interval_ms",
+                 &profile->ice_backup_candidate_pair_ping_interval_ms,
+                 error) ||
+        !ReadInt(ice, "check_min_interval_ms",
+                 &profile->ice_check_min_interval_ms, error)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+std::optional<RunProfile> LoadRunProfile(const std::string& path,
+                                         std::string* error) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    *error = "cannot open " + path;
+    return std::nullopt;
+  }
+  Json::CharReaderBuilder reader;
+  Json::Value root;
+  std::string parse_errors;
+  if (!Json::parseFromStream(reader, file, &root, &parse_errors)) {
+    *error = path + ": " + parse_errors;
+    return std::nullopt;
+  }
+  RunProfile profile;
+  if (!ParseRunProfile(root, &profile, error)) {
+    *error = path + ": " + *error;
+    return std::nullopt;
+  }
+  return profile;
+}
+
+bool SetLayerMode(const std::string& mode, RunProfile* profile) {
+  // The top layer keeps the profile's rate and frame rate caps.
+  RunProfile::Layer top = profile->layers.front();
+  if (mode == "simulcast") {
+    RunProfile::Layer quarter;
+    quarter.rid = "q";
+    quarter.scale_resolution_down_by = 4.0;
+    quarter.max_bitrate_bps = 500000;
+    quarter.max_framerate = top.max_framerate;
+    RunProfile::Layer half = quarter;
+    half.rid = "h";
+    half.scale_resolution_down_by = 2.0;
+    half.max_bitrate_bps = 2000000;
+    top.rid = "f";
+    top.scale_resolution_down_by = 1.0;
+    top.scalability_mode = std::nullopt;
+    profile->layers = {quarter, half, top};
+    return true;
+  }
+  if (!webrtc::ScalabilityModeFromString(mode))
+    return false;
+  top.rid.clear();
+  top.scalability_mode = mode;
+  profile->layers = {top};
+  if (profile->codecs.empty())
+    profile->codecs = {"VP9", "AV1"};
+  return true;
+}
@@ -0,0 +1,82 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_RUN_PROFILE_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_RUN_PROFILE_H_
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "api/rtp_parameters.h"
+
+// Media and transport settings of one run, so a parameter sweep changes a
+// file instead of the build. A default-constructed profile reproduces the
+// settings the client used before profiles existed. Loaded from JSON:
+//
+//   {
+//     "codecs": ["H264", "VP8"],
+//     "codec_parameters": {"H264": {"profile-level-id": "42e01f"}},
+//     "degradation_preference": "maintain-framerate",
+//     "layers": [
+//       {"rid": "q", "scale_resolution_down_by": 4, "max_bitrate_bps": 500000},
+//       {"rid": "f", "max_bitrate_bps": 8000000, "scalability_mode": "L1T3"}
+//     ],
+//     "bitrate": {"min_bps": 200000, "start_bps": 300000,
+//                 "max_bps": 50000000},
+//     "field_trials": "WebRTC-Pacer-BlockAudio/Enabled/",
+//     "ports": {"min": 50000, "max": 50005},
+//     "ice": {"receiving_timeout_ms": 5000, "backup_ping_interval_ms": 5000,
+//             "check_min_interval_ms": 500}
+//   }
+//
+// Every key is optional; unknown keys are an error so a misspelt one does
+// not silently leave a default in place.
+struct RunProfile {
+  struct Layer {
+    std::string rid;
+    bool active = true;
+    std::optional<int> max_bitrate_bps;
+    std::optional<double> max_framerate;
+    std::optional<double> scale_resolution_down_by;
+    std::optional<std::string> scalability_mode;
+  };
+
+  // Video codec names in preference order; codecs not listed keep their
+  // place after these.
+  std::vector<std::string> codecs;
+  // Per codec name, fmtp values a capability must have to be preferred,
+  // e.g. picking one H264 profile out of several.
+  std::map<std::string, std::map<std::string, std::string>> codec_parameters;
+  std::optional<webrtc::DegradationPreference> degradation_preference;
+  // One encoding per layer; more than one is simulcast and needs rids.
+  std::vector<Layer> layers = {
+      {"", true, 25000000, 60.0, 1.0, std::nullopt}};
+
+  // PeerConnectionInterface::SetBitrate() envelope.
+  int min_bitrate_bps = 200000;
+  int start_bitrate_bps = 300000;
+  int max_bitrate_bps = 50000000;
+
+  // Appended to --force_fieldtrials, e.g. pacing or FEC experiments.
+  std::string field_trials;
+
+  int min_port = 50000;
+  int max_port = 50005;
+
+  int ice_connection_receiving_timeout_ms = 5000;
+  int ice_backup_candidate_pair_ping_interval_ms = 5000;
+  int ice_check_min_interval_ms = 500;
+};
+
+// Reads the profile at |path|. Returns nullopt and sets |error| if the file
+// cannot be read or does not describe a valid profile.
+std::optional<RunProfile> LoadRunProfile(const std::string& path,
+                                         std::string* error);
+
+// Replaces the layers of |profile| for --video_layers. "simulcast" is three
+// encodings with rids q, h and f at a quarter, half and full resolution.
+// Anything else is a scalability mode such as L1T3 or L3T3_KEY for a single
+// encoding; VP9, then AV1, become the preferred codecs unless the profile
+// names its own. Returns false for an unknown mode.
+bool SetLayerMode(const std::string& mode, RunProfile* profile);
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_RUN_PROFILE_H_
@@ -5,6 +5,7 @@
 #include <thread>
 
 #include "examples/peerconnection/client/conductor.h"
+#include "sctp_traffic/chunk_header.h"
 
 namespace {
 int64_t NowMillis() {
@@ -23,7 +24,8 @@ Receiver::Receiver(const std::string& log_dir, int log_period_ms)
   std::string path = log_dir + "/sctp_traffic.csv";
   log_file_.open(path);
   if (log_file_.is_open()) {
-    log_file_ << "Time,Throughput,Start,Stop\n";
+    log_file_ << "Time,Throughput,Start,Stop,Messages,DelayP50Ms,DelayP95Ms,"
+                 "DelayP99Ms,DelayMaxMs,Reordered,Missing\n";
     log_file_.flush();
   }
 }
@@ -37,12 +39,13 @@ void Receiver::Attach(Conductor& c) {
   // 1) Register payload handler
   conductor_->RegisterPayloadHandler(Kind::kBulkTest,
                                      [this](absl::Span<const uint8_t> bytes) {
-                                       rx_accum_ += bytes.size();
-                                       rx_total_ += bytes.size();
+                                       stats_.OnMessage(bytes,
+                                                        WallClockMicros());
                                      });
 
   // 2) Periodic log timer
   last_ms_ = NowMillis();
+  console_start_ms_ = last_ms_;
   running_.store(true);
   worker_ = std::thread([this]() {
     while (running_.load()) {
@@ -57,20 +60,48 @@ void Receiver::Tick() {
   const double dt = (now - last_ms_) / 1000.0;
   last_ms_ = now;
 
-  const uint64_t bytes = rx_accum_;
-  rx_accum_ = 0;
-  const double mbps = dt > 0 ? (bytes * 8.0) / (dt * 1e6) : 0.0;
+  FlowStats::Interval interval;
+  stats_.Collect(&interval);
+  const double mbps = dt > 0 ? (interval.bytes * 8.0) / (dt * 1e6) : 0.0;
+
+  // Idle intervals are left out, so goodput quantiles describe the
+  // transfer rather than the gaps between transfers.
+  if (RunMetrics* metrics = conductor_->run_metrics();
+      metrics && interval.messages > 0) {
+    metrics->Merge(RunMetrics::kSctpDelayUs, interval.delay_us);
+    metrics->Add(RunMetrics::kSctpGoodputBps,
+                 static_cast<int64_t>(mbps * 1e6));
+  }
 
   if (logging_.load() && log_file_.is_open()) {
-    log_file_ << now << "," << mbps << ",0,0\n";
-    log_file_.flush();
+    const auto& delay = interval.delay_us;
+    log_file_ << now << "," << mbps << ",0,0," << interval.messages << ","
+              << MicrosToMillis(delay.Quantile(0.50)) << ","
+              << MicrosToMillis(delay.Quantile(0.95)) << ","
+              << MicrosToMillis(delay.Quantile(0.99)) << ","
+              << MicrosToMillis(delay.total ? delay.max : -1) << ","
+              << interval.reordered << "," << interval.missing << "\n";
   }
 
-  std::cout << "[BULK][RX] " << mbps << " Mbps (" << bytes << " B / " << dt
-            << " s), total=" << rx_total_ << " B" << std::endl;
+  console_bytes_ += interval.bytes;
+  const int64_t console_ms = now - console_start_ms_;
+  if (console_ms >= 1000) {
+    std::cout << "[BULK][RX] " << (console_bytes_ * 8.0) / (console_ms * 1e3)
+              << " Mbps (" << console_bytes_ << " B / " << console_ms / 1000.0
+              << " s), total=" << stats_.total_bytes() << " B" << std::endl;
+    console_bytes_ = 0;
+    console_start_ms_ = now;
+  }
 }
 
 void Receiver::Detach() {
+  if (conductor_) {
+    // OnMessage runs on the signaling thread; once the handler is gone
+    // there, none is in flight.
+    conductor_->signaling_thread()->BlockingCall([this] {
+      conductor_->RegisterPayloadHandler(Kind::kBulkTest, nullptr);
+    });
+  }
   running_.store(false);
   if (worker_.joinable())
     worker_.join();
@@ -82,22 +113,23 @@ void Receiver::Detach() {
 
 void Receiver::LogStart() {
   int64_t now = NowMillis();
+  // Drop whatever arrived before the start marker.
+  FlowStats::Interval discarded;
+  stats_.Collect(&discarded);
   if (log_file_.is_open()) {
-    log_file_ << now << ",0,1,0\n";
+    log_file_ << now << ",0,1,0,0,-1,-1,-1,-1,0,0\n";
     log_file_.flush();
   }
-  rx_accum_ = 0;
-  last_ms_ = now;
   logging_.store(true);
 }
 
 void Receiver::LogStop() {
   int64_t now = NowMillis();
+  logging_.store(false);
   if (log_file_.is_open()) {
-    log_file_ << now << ",0,0,1\n";
+    log_file_ << now << ",0,0,1,0,-1,-1,-1,-1,0,0\n";
     log_file_.flush();
   }
-  logging_.store(false);
 }
 
 }  // namespace sctp::bulk
@@ -6,6 +6,7 @@
 #include <string>
 #include <thread>
 
+#include "sctp_traffic/flow_stats.h"
 #include "sctp_traffic/traffic.h"
 
 class Conductor;
@@ -14,7 +15,8 @@ namespace sctp::bulk {
 
 class Receiver final : public sctp::Receiver {
  public:
-  Receiver(const std::string& log_dir, int log_period_ms = 1000);
+  // Rows are appended to sctp_traffic.csv every |log_period_ms|.
+  Receiver(const std::string& log_dir, int log_period_ms = 100);
   ~Receiver() override;
 
   void Attach(Conductor& c) override;
@@ -32,10 +34,13 @@ class Receiver final : public sctp::Receiver {
   std::thread worker_;
   std::atomic<bool> running_{false};
 
-  uint64_t rx_accum_ = 0;
-  uint64_t rx_total_ = 0;
+  FlowStats stats_;
   int64_t last_ms_ = 0;
 
+  // Console summary is printed about once per second regardless of period.
+  uint64_t console_bytes_ = 0;
+  int64_t console_start_ms_ = 0;
+
   std::ofstream log_file_;
   std::atomic<bool> logging_{false};
 };
@@ -1,10 +1,14 @@
 #include "sctp_traffic/bulk/bulk_sender.h"
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <thread>
 
+#include "api/task_queue/task_queue_base.h"
+#include "api/units/time_delta.h"
 #include "examples/peerconnection/client/conductor.h"
+#include "sctp_traffic/chunk_header.h"
 
 namespace {
 int64_t NowMillis() {
@@ -12,6 +16,15 @@ int64_t NowMillis() {
              std::chrono::steady_clock::now().time_since_epoch())
       .count();
 }
+
+// How often a not-yet-open bulk channel is re-checked in kEventDriven mode.
+constexpr webrtc::TimeDelta kOpenRetryInterval = webrtc::TimeDelta::Millis(10);
+
+rtc::CopyOnWriteBuffer ZeroedPayload(size_t size) {
+  rtc::CopyOnWriteBuffer payload(size);
+  std::fill(payload.MutableData(), payload.MutableData() + size, 0x00);
+  return payload;
+}
 }  // namespace
 
 using Kind = Conductor::TrafficKind;
@@ -24,15 +37,42 @@ Sender::~Sender() {
 }
 
 void Sender::Start(Conductor& c) {
+  if (running_.load())
+    return;
   conductor_ = &c;
 
   target_bps_ = cfg_.target_mbps * 1e6;
-  payload_.assign(cfg_.chunk_bytes, 0x00);
-
+  chunk_size_ = std::max(cfg_.chunk_bytes, sctp::kChunkHeaderSize);
+  // Both modes stop sending within one chunk past |buffered_cap|.
+  payloads_.assign(cfg_.buffered_cap / chunk_size_ + 2, PooledPayload());
+  for (PooledPayload& payload : payloads_)
+    payload.buffer = ZeroedPayload(chunk_size_);
+  next_payload_ = 0;
+  queued_bytes_ = 0;
+
+  seq_ = 0;
   credit_bytes_ = 0.0;
   last_ms_ = NowMillis();
+  report_bytes_ = 0;
+  report_start_ms_ = last_ms_;
 
   running_.store(true);
+
+  if (cfg_.mode == Mode::kEventDriven) {
+    rtc::Thread* signaling = conductor_->signaling_thread();
+    signaling->BlockingCall([this] {
+      safety_ = webrtc::PendingTaskSafetyFlag::Create();
+      conductor_->RegisterBufferedAmountHandler(
+          Kind::kBulkTest,
+          [this](uint64_t buffered_amount) { OnBufferedAmount(buffered_amount); });
+      Fill();
+    });
+    std::cout << "[BULK][TX] started: event-driven, watermarks="
+              << cfg_.low_watermark << "/" << cfg_.buffered_cap
+              << " B, chunk=" << cfg_.chunk_bytes << " B" << std::endl;
+    return;
+  }
+
   worker_ = std::thread([this]() {
     while (running_.load()) {
       PumpOnce(NowMillis());
@@ -46,13 +86,74 @@ void Sender::Start(Conductor& c) {
 }
 
 void Sender::Stop() {
-  running_.store(false);
+  if (!running_.exchange(false))
+    return;
   if (worker_.joinable())
     worker_.join();
+  if (safety_ && conductor_) {
+    conductor_->signaling_thread()->BlockingCall([this] {
+      safety_->SetNotAlive();
+      conductor_->RegisterBufferedAmountHandler(Kind::kBulkTest, nullptr);
+    });
+    safety_ = nullptr;
+  }
   conductor_ = nullptr;
   std::cout << "[BULK][TX] stopped" << std::endl;
 }
 
+void Sender::Fill() {
+  if (!running_.load())
+    return;
+  if (!conductor_->IsFlowOpen(Kind::kBulkTest)) {
+    webrtc::TaskQueueBase::Current()->PostDelayedTask(
+        webrtc::SafeTask(safety_, [this] { Fill(); }), kOpenRetryInterval);
+    return;
+  }
+
+  while (conductor_->BufferedAmount(Kind::kBulkTest) < cfg_.buffered_cap) {
+    if (!SendChunk())
+      break;
+    report_bytes_ += chunk_size_;
+  }
+  ReportRate(NowMillis());
+}
+
+bool Sender::SendChunk() {
+  PooledPayload& payload = payloads_[next_payload_];
+  // Sends drain in order, so everything queued up to the buffered bytes is
+  // out of the channel.
+  const uint64_t drained =
+      queued_bytes_ - std::min<uint64_t>(
+                          queued_bytes_,
+                          conductor_->BufferedAmount(Kind::kBulkTest));
+  if (payload.queued_until > drained)
+    payload.buffer = ZeroedPayload(chunk_size_);
+  WriteChunkHeader(payload.buffer.MutableData(), {seq_, WallClockMicros()});
+  if (!conductor_->SendPayload(Kind::kBulkTest, payload.buffer))
+    return false;
+  queued_bytes_ += chunk_size_;
+  payload.queued_until = queued_bytes_;
+  next_payload_ = (next_payload_ + 1) % payloads_.size();
+  ++seq_;
+  return true;
+}
+
+void Sender::OnBufferedAmount(uint64_t buffered_amount) {
+  if (buffered_amount <= cfg_.low_watermark)
+    Fill();
+}
+
+void Sender::ReportRate(int64_t now_ms) {
+  const int64_t elapsed_ms = now_ms - report_start_ms_;
+  if (elapsed_ms < 1000)
+    return;
+  const double mbps = (report_bytes_ * 8.0) / (elapsed_ms * 1e3);
+  std::cout << "[BULK][TX] ~" << mbps << " Mbps, buffered="
+            << conductor_->BufferedAmount(Kind::kBulkTest) << std::endl;
+  report_bytes_ = 0;
+  report_start_ms_ = now_ms;
+}
+
 void Sender::PumpOnce(int64_t now_ms) {
   if (!conductor_ || !conductor_->IsFlowOpen(Kind::kBulkTest))
     return;
@@ -65,12 +166,11 @@ void Sender::PumpOnce(int64_t now_ms) {
     return;
 
   size_t sent_bytes = 0;
-  while (credit_bytes_ >= static_cast<double>(payload_.size())) {
-    conductor_->SendPayload(
-        Kind::kBulkTest,
-        absl::Span<const uint8_t>(payload_.data(), payload_.size()));
-    credit_bytes_ -= payload_.size();
-    sent_bytes += payload_.size();
+  while (credit_bytes_ >= static_cast<double>(chunk_size_)) {
+    if (!SendChunk())
+      break;
+    credit_bytes_ -= chunk_size_;
+    sent_bytes += chunk_size_;
 
     if (conductor_->BufferedAmount(Kind::kBulkTest) > cfg_.buffered_cap)
       break;
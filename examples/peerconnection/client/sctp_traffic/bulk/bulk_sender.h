@@ -1,20 +1,37 @@
 #pragma once
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <thread>
 #include <vector>
 
+#include "api/scoped_refptr.h"
+#include "api/task_queue/pending_task_safety_flag.h"
+#include "rtc_base/copy_on_write_buffer.h"
 #include "sctp_traffic/traffic.h"
 
 class Conductor;
 
 namespace sctp::bulk {
 
+enum class Mode {
+  // Refill from the data channel's OnBufferedAmountChange on the signaling
+  // thread, keeping buffered_amount between the two watermarks.
+  kEventDriven,
+  // Legacy rate-paced loop on a private thread, polling every
+  // pump_interval_ms.
+  kPolled,
+};
+
 struct Config {
-  double target_mbps = 500.0;
+  Mode mode = Mode::kEventDriven;
+  double target_mbps = 500.0;  // kPolled only.
   size_t chunk_bytes = 16 * 1024;
+  // Upper bound on buffered_amount; the high watermark in kEventDriven.
   uint64_t buffered_cap = 8 * 1024 * 1024;
-  int pump_interval_ms = 10;
+  // kEventDriven refills once buffered_amount drains to this level.
+  uint64_t low_watermark = 2 * 1024 * 1024;
+  int pump_interval_ms = 10;  // kPolled only.
 };
 
 class Sender final : public sctp::Sender {
@@ -27,16 +44,44 @@ class Sender final : public sctp::Sender {
 
  private:
   void PumpOnce(int64_t now_ms);
+  // Stamps the next ChunkHeader into a free pool buffer and hands it to the
+  // channel.
+  bool SendChunk();
+
+  // kEventDriven: runs on the signaling thread.
+  void Fill();
+  void OnBufferedAmount(uint64_t buffered_amount);
+  void ReportRate(int64_t now_ms);
 
   Conductor* conductor_ = nullptr;
   Config cfg_;
   std::thread worker_;
   std::atomic<bool> running_{false};
+  rtc::scoped_refptr<webrtc::PendingTaskSafetyFlag> safety_;
 
-  std::vector<uint8_t> payload_;
+  struct PooledPayload {
+    rtc::CopyOnWriteBuffer buffer;
+    // |queued_bytes_| once this buffer's last send was queued; the channel
+    // has let go of it when that much has drained from buffered_amount.
+    uint64_t queued_until = 0;
+  };
+
+  // Built once in Start(), enough to cover |buffered_cap|; each send only
+  // hands the channel a reference. Buffers are used in turn, and the next
+  // one is stamped only once its previous send has drained, so stamping
+  // never copies a chunk the channel still holds. Should the channel run
+  // further ahead, that slot gets a fresh buffer instead.
+  std::vector<PooledPayload> payloads_;
+  size_t next_payload_ = 0;
+  uint64_t queued_bytes_ = 0;
+  size_t chunk_size_ = 0;
+  uint64_t seq_ = 0;
   double target_bps_ = 0.0;
   double credit_bytes_ = 0.0;
   int64_t last_ms_ = 0;
+
+  uint64_t report_bytes_ = 0;
+  int64_t report_start_ms_ = 0;
 };
 
 }  // namespace sctp::bulk
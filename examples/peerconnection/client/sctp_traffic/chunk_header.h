@@ -0,0 +1,44 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/types/span.h"
+#include "rtc_base/byte_order.h"
+
+namespace sctp {
+
+// Every generated SCTP message starts with this header so the receiver can
+// measure one-way delay and detect reordering/loss per flow. Both fields are
+// big-endian on the wire.
+struct ChunkHeader {
+  uint64_t seq = 0;
+  int64_t send_time_us = 0;  // WallClockMicros() at the sender.
+};
+
+constexpr size_t kChunkHeaderSize = 16;
+
+// Wall clock rather than steady clock: sender and receiver usually run in
+// different processes (or hosts synchronised with NTP/PTP).
+inline int64_t WallClockMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// |dst| must have room for kChunkHeaderSize bytes.
+inline void WriteChunkHeader(uint8_t* dst, const ChunkHeader& header) {
+  rtc::SetBE64(dst, header.seq);
+  rtc::SetBE64(dst + 8, static_cast<uint64_t>(header.send_time_us));
+}
+
+inline bool ParseChunkHeader(absl::Span<const uint8_t> bytes,
+                             ChunkHeader* header) {
+  if (bytes.size() < kChunkHeaderSize)
+    return false;
+  header->seq = rtc::GetBE64(bytes.data());
+  header->send_time_us = static_cast<int64_t>(rtc::GetBE64(bytes.data() + 8));
+  return true;
+}
+
+}  // namespace sctp
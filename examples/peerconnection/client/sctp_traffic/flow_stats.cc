@@ -0,0 +1,46 @@
+#include "sctp_traffic/flow_stats.h"
+
+#include "sctp_traffic/chunk_header.h"
+
+namespace sctp {
+
+void FlowStats::OnMessage(absl::Span<const uint8_t> bytes, int64_t now_us) {
+  bytes_.fetch_add(bytes.size(), std::memory_order_relaxed);
+  total_bytes_.fetch_add(bytes.size(), std::memory_order_relaxed);
+  messages_.fetch_add(1, std::memory_order_relaxed);
+
+  ChunkHeader header;
+  if (!ParseChunkHeader(bytes, &header))
+    return;
+
+  delay_us_.Add(now_us - header.send_time_us);
+
+  if (!have_seq_) {
+    have_seq_ = true;
+    highest_seq_ = header.seq;
+  } else if (header.seq > highest_seq_) {
+    missing_.fetch_add(static_cast<int64_t>(header.seq - highest_seq_ - 1),
+                       std::memory_order_relaxed);
+    highest_seq_ = header.seq;
+  } else {
+    // A late arrival fills a gap counted earlier.
+    reordered_.fetch_add(1, std::memory_order_relaxed);
+    missing_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+void FlowStats::Collect(Interval* out) {
+  out->bytes = bytes_.exchange(0, std::memory_order_relaxed);
+  out->messages = messages_.exchange(0, std::memory_order_relaxed);
+  out->reordered = reordered_.exchange(0, std::memory_order_relaxed);
+  const int64_t missing = missing_.exchange(0, std::memory_order_relaxed);
+  if (missing < 0) {
+    missing_.fetch_add(missing, std::memory_order_relaxed);
+    out->missing = 0;
+  } else {
+    out->missing = static_cast<uint64_t>(missing);
+  }
+  delay_us_.Collect(&out->delay_us);
+}
+
+}  // namespace sctp
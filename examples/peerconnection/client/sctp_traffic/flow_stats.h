@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#include "absl/types/span.h"
+#include "sctp_traffic/latency_histogram.h"
+
+namespace sctp {
+
+// Receive-side accounting for one SCTP flow. OnMessage() runs on the data
+// channel callback thread and Collect() on the logging thread; all shared
+// state is atomic so neither side takes a lock or allocates.
+class FlowStats {
+ public:
+  struct Interval {
+    uint64_t bytes = 0;
+    uint64_t messages = 0;
+    uint64_t reordered = 0;  // Arrived with a seq below the highest seen.
+    // Seq gaps opened in the interval, less late arrivals filling gaps of
+    // this or earlier intervals; fills beyond the interval's gaps carry
+    // over to the next one, so the sum over a run stays exact.
+    uint64_t missing = 0;
+    LatencyHistogram::Snapshot delay_us;
+  };
+
+  // |bytes| is the whole message including the chunk header, if any.
+  void OnMessage(absl::Span<const uint8_t> bytes, int64_t now_us);
+
+  // Drains everything recorded since the previous call.
+  void Collect(Interval* out);
+
+  uint64_t total_bytes() const {
+    return total_bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<uint64_t> messages_{0};
+  std::atomic<uint64_t> reordered_{0};
+  std::atomic<int64_t> missing_{0};
+  std::atomic<uint64_t> total_bytes_{0};
+
+  // Only touched by the receiving thread.
+  bool have_seq_ = false;
+  uint64_t highest_seq_ = 0;
+
+  LatencyHistogram delay_us_;
+};
+
+}  // namespace sctp
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/types/span.h"
+#include "rtc_base/byte_order.h"
+#include "sctp_traffic/chunk_header.h"
+
+namespace sctp::kv {
+
+// Wire layout of a kv message:
+//   ChunkHeader | type (1 byte) | response_bytes (4 bytes, BE) | padding
+// A response echoes the request's ChunkHeader, so the requester computes
+// RTT against its own clock.
+enum class MessageType : uint8_t {
+  kRequest = 0,
+  kResponse = 1,
+};
+
+constexpr size_t kMessageHeaderSize = kChunkHeaderSize + 1 + 4;
+
+struct MessageHeader {
+  ChunkHeader chunk;
+  MessageType type = MessageType::kRequest;
+  uint32_t response_bytes = 0;  // Requested response size; requests only.
+};
+
+inline void WriteMessageHeader(uint8_t* dst, const MessageHeader& header) {
+  WriteChunkHeader(dst, header.chunk);
+  dst[kChunkHeaderSize] = static_cast<uint8_t>(header.type);
+  rtc::SetBE32(dst + kChunkHeaderSize + 1, header.response_bytes);
+}
+
+inline bool ParseMessageHeader(absl::Span<const uint8_t> bytes,
+                               MessageHeader* header) {
+  if (bytes.size() < kMessageHeaderSize ||
+      !ParseChunkHeader(bytes, &header->chunk))
+    return false;
+  header->type = static_cast<MessageType>(bytes[kChunkHeaderSize]);
+  header->response_bytes = rtc::GetBE32(bytes.data() + kChunkHeaderSize + 1);
+  return header->type == MessageType::kRequest ||
+         header->type == MessageType::kResponse;
+}
+
+}  // namespace sctp::kv
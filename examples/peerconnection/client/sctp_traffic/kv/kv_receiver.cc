@@ -0,0 +1,124 @@
+#include "sctp_traffic/kv/kv_receiver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "examples/peerconnection/client/conductor.h"
+#include "rtc_base/copy_on_write_buffer.h"
+#include "sctp_traffic/chunk_header.h"
+#include "sctp_traffic/kv/kv_message.h"
+
+namespace {
+int64_t NowMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+}  // namespace
+
+using Kind = Conductor::TrafficKind;
+
+namespace sctp::kv {
+
+Receiver::Receiver(const std::string& log_dir,
+                   uint64_t buffered_cap,
+                   int log_period_ms)
+    : buffered_cap_(buffered_cap), period_ms_(log_period_ms) {
+  log_file_.open(log_dir + "/sctp_kv.csv");
+  if (log_file_.is_open()) {
+    log_file_ << "Time,Requests,Responses,RttP50Ms,RttP95Ms,RttP99Ms,"
+                 "RttP999Ms,RttMaxMs,ReqDelayP50Ms,ReqDelayP99Ms,"
+                 "DroppedResponses\n";
+    log_file_.flush();
+  }
+}
+Receiver::~Receiver() {
+  Detach();
+}
+
+void Receiver::Attach(Conductor& c) {
+  conductor_ = &c;
+  conductor_->RegisterPayloadHandler(
+      Kind::kKv, [this](absl::Span<const uint8_t> bytes) { OnMessage(bytes); });
+
+  running_.store(true);
+  worker_ = std::thread([this]() {
+    while (running_.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(period_ms_));
+      Tick();
+    }
+  });
+}
+
+void Receiver::OnMessage(absl::Span<const uint8_t> bytes) {
+  MessageHeader header;
+  if (!ParseMessageHeader(bytes, &header))
+    return;
+  const int64_t now_us = WallClockMicros();
+
+  if (header.type == MessageType::kResponse) {
+    responses_.fetch_add(1, std::memory_order_relaxed);
+    rtt_us_.Add(now_us - header.chunk.send_time_us);
+    return;
+  }
+
+  requests_.OnMessage(bytes, now_us);
+  if (!conductor_)
+    return;
+  if (conductor_->BufferedAmount(Kind::kKv) > buffered_cap_) {
+    dropped_responses_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  // |response_bytes| comes off the wire; a larger send would fail anyway.
+  const size_t size = std::clamp<size_t>(
+      header.response_bytes, kMessageHeaderSize,
+      std::max(kMessageHeaderSize, conductor_->MaxMessageSize()));
+  rtc::CopyOnWriteBuffer response(size);
+  std::fill(response.MutableData(), response.MutableData() + size, 0x00);
+  header.type = MessageType::kResponse;
+  header.response_bytes = 0;
+  WriteMessageHeader(response.MutableData(), header);
+  if (!conductor_->SendPayload(Kind::kKv, std::move(response)))
+    dropped_responses_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Receiver::Tick() {
+  FlowStats::Interval served;
+  requests_.Collect(&served);
+  const uint64_t responses = responses_.exchange(0, std::memory_order_relaxed);
+  const uint64_t dropped =
+      dropped_responses_.exchange(0, std::memory_order_relaxed);
+  LatencyHistogram::Snapshot rtt;
+  rtt_us_.Collect(&rtt);
+
+  if ((served.messages == 0 && responses == 0) || !log_file_.is_open())
+    return;
+  log_file_ << NowMillis() << "," << served.messages << "," << responses
+            << "," << MicrosToMillis(rtt.Quantile(0.50)) << ","
+            << MicrosToMillis(rtt.Quantile(0.95)) << ","
+            << MicrosToMillis(rtt.Quantile(0.99)) << ","
+            << MicrosToMillis(rtt.Quantile(0.999)) << ","
+            << MicrosToMillis(rtt.total ? rtt.max : -1) << ","
+            << MicrosToMillis(served.delay_us.Quantile(0.50)) << ","
+            << MicrosToMillis(served.delay_us.Quantile(0.99)) << ","
+            << dropped << "\n";
+}
+
+void Receiver::Detach() {
+  if (conductor_) {
+    // OnMessage runs on the signaling thread; once the handler is gone
+    // there, none is in flight.
+    conductor_->signaling_thread()->BlockingCall(
+        [this] { conductor_->RegisterPayloadHandler(Kind::kKv, nullptr); });
+  }
+  running_.store(false);
+  if (worker_.joinable())
+    worker_.join();
+  conductor_ = nullptr;
+  if (log_file_.is_open()) {
+    log_file_.close();
+  }
+}
+
+}  // namespace sctp::kv
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "absl/types/span.h"
+#include "sctp_traffic/flow_stats.h"
+#include "sctp_traffic/latency_histogram.h"
+#include "sctp_traffic/traffic.h"
+
+class Conductor;
+
+namespace sctp::kv {
+
+// Both halves of the kv flow on one peer: answers the remote's requests and
+// measures RTT for responses to requests issued by the local kv::Sender.
+// Responses are capped at the association's maximum message size, and are
+// dropped (and counted) while more than |buffered_cap| bytes wait on the
+// channel, as kv::Sender does for requests. Intervals with traffic are
+// appended to sctp_kv.csv every |log_period_ms|.
+class Receiver final : public sctp::Receiver {
+ public:
+  Receiver(const std::string& log_dir,
+           uint64_t buffered_cap = 1024 * 1024,
+           int log_period_ms = 100);
+  ~Receiver() override;
+
+  void Attach(Conductor& c) override;
+  void Detach() override;
+
+ private:
+  void OnMessage(absl::Span<const uint8_t> bytes);
+  void Tick();
+
+  Conductor* conductor_ = nullptr;
+  const uint64_t buffered_cap_;
+  int period_ms_;
+  std::thread worker_;
+  std::atomic<bool> running_{false};
+
+  // Requests served for the remote; delay is one-way and needs synced clocks.
+  FlowStats requests_;
+  std::atomic<uint64_t> dropped_responses_{0};
+  // Responses to local requests; RTT uses the local clock only.
+  std::atomic<uint64_t> responses_{0};
+  LatencyHistogram rtt_us_;
+
+  std::ofstream log_file_;
+};
+
+}  // namespace sctp::kv
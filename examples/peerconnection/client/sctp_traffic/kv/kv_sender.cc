@@ -0,0 +1,101 @@
+#include "sctp_traffic/kv/kv_sender.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "api/units/time_delta.h"
+#include "examples/peerconnection/client/conductor.h"
+#include "rtc_base/copy_on_write_buffer.h"
+#include "sctp_traffic/kv/kv_message.h"
+
+using Kind = Conductor::TrafficKind;
+
+namespace sctp::kv {
+
+Sender::Sender(Config cfg) : cfg_(cfg) {}
+Sender::~Sender() {
+  Stop();
+}
+
+void Sender::Start(Conductor& c) {
+  if (running_.load())
+    return;
+  conductor_ = &c;
+  running_.store(true);
+  conductor_->signaling_thread()->BlockingCall([this] {
+    safety_ = webrtc::PendingTaskSafetyFlag::Create();
+    arrivals_.emplace(cfg_.requests_per_sec, cfg_.seed);
+    arrivals_->Reset();
+    seq_ = 0;
+    sent_ = 0;
+    dropped_ = 0;
+    report_start_ = std::chrono::steady_clock::now();
+    SendDue();
+  });
+  std::cout << "[KV][TX] started: " << cfg_.requests_per_sec << " req/s"
+            << std::endl;
+}
+
+void Sender::Stop() {
+  if (!running_.exchange(false))
+    return;
+  conductor_->signaling_thread()->BlockingCall([this] {
+    safety_->SetNotAlive();
+    arrivals_.reset();
+  });
+  safety_ = nullptr;
+  conductor_ = nullptr;
+  std::cout << "[KV][TX] stopped" << std::endl;
+}
+
+void Sender::SendDue() {
+  if (!running_.load())
+    return;
+  // Requests that fell due while the thread was busy all go out now, each
+  // stamped with its own scheduled time.
+  while (arrivals_->UntilDueUs() <= 0) {
+    SendOne(arrivals_->scheduled_wall_us());
+    arrivals_->Advance();
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  if (now - report_start_ >= std::chrono::seconds(1)) {
+    std::cout << "[KV][TX] sent=" << sent_ << " dropped=" << dropped_
+              << std::endl;
+    sent_ = 0;
+    dropped_ = 0;
+    report_start_ = now;
+  }
+
+  conductor_->signaling_thread()->PostDelayedHighPrecisionTask(
+      webrtc::SafeTask(safety_, [this] { SendDue(); }),
+      webrtc::TimeDelta::Micros(arrivals_->UntilDueUs()));
+}
+
+void Sender::SendOne(int64_t scheduled_us) {
+  const size_t size = std::max(kMessageHeaderSize,
+                               cfg_.request_size.Sample(arrivals_->rng()));
+  MessageHeader header;
+  header.chunk = {seq_, scheduled_us};
+  header.type = MessageType::kRequest;
+  header.response_bytes = static_cast<uint32_t>(std::max(
+      kMessageHeaderSize, cfg_.response_size.Sample(arrivals_->rng())));
+
+  if (!conductor_->IsFlowOpen(Kind::kKv) ||
+      conductor_->BufferedAmount(Kind::kKv) > cfg_.buffered_cap) {
+    ++dropped_;
+    return;
+  }
+  rtc::CopyOnWriteBuffer request(size);
+  std::fill(request.MutableData(), request.MutableData() + size, 0x00);
+  WriteMessageHeader(request.MutableData(), header);
+  if (conductor_->SendPayload(Kind::kKv, std::move(request))) {
+    ++seq_;
+    ++sent_;
+  } else {
+    ++dropped_;
+  }
+}
+
+}  // namespace sctp::kv
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+#include "api/scoped_refptr.h"
+#include "api/task_queue/pending_task_safety_flag.h"
+#include "sctp_traffic/poisson_arrivals.h"
+#include "sctp_traffic/size_distribution.h"
+#include "sctp_traffic/traffic.h"
+
+class Conductor;
+
+namespace sctp::kv {
+
+struct Config {
+  // Open-loop Poisson request rate; requests are never held back waiting
+  // for responses.
+  double requests_per_sec = 200.0;
+  SizeDistribution request_size = {SizeDistribution::Type::kFixed, 128};
+  SizeDistribution response_size = {SizeDistribution::Type::kLogNormal, 1024,
+                                    0, 16 * 1024, 1.0};
+  // Requests due while buffered_amount exceeds this are counted as dropped
+  // instead of queueing without bound behind a saturated association.
+  uint64_t buffered_cap = 1024 * 1024;
+  uint64_t seed = 1;
+};
+
+// Issues requests on the "kv" flow from the signaling thread, which owns the
+// data channels. Responses, and the RTT measured from them, are handled by
+// kv::Receiver on the same peer.
+class Sender final : public sctp::Sender {
+ public:
+  explicit Sender(Config cfg = {});
+  ~Sender() override;
+
+  void Start(Conductor& c) override;
+  void Stop() override;
+
+ private:
+  // Runs on the signaling thread: sends every request that is due, then
+  // schedules itself for the next one.
+  void SendDue();
+  void SendOne(int64_t scheduled_us);
+
+  Conductor* conductor_ = nullptr;
+  Config cfg_;
+  std::atomic<bool> running_{false};
+  rtc::scoped_refptr<webrtc::PendingTaskSafetyFlag> safety_;
+
+  // Signaling thread only.
+  std::optional<PoissonArrivals> arrivals_;
+  uint64_t seq_ = 0;
+  uint64_t sent_ = 0;
+  uint64_t dropped_ = 0;
+  std::chrono::steady_clock::time_point report_start_;
+};
+
+}  // namespace sctp::kv
@@ -0,0 +1,71 @@
+#include "sctp_traffic/latency_histogram.h"
+
+#include <algorithm>
+
+namespace sctp {
+
+// static
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < kSubBuckets)
+    return static_cast<size_t>(value);
+  int msb = 63 - __builtin_clzll(value);
+  if (msb > kMaxMsb)
+    return kNumBuckets - 1;
+  const int shift = msb - kSubBucketBits;
+  const size_t group = static_cast<size_t>(shift + 1);
+  return group * kSubBuckets + ((value >> shift) & (kSubBuckets - 1));
+}
+
+// static
+int64_t LatencyHistogram::BucketLowerBound(size_t index) {
+  const size_t group = index / kSubBuckets;
+  const int64_t sub = static_cast<int64_t>(index % kSubBuckets);
+  if (group == 0)
+    return sub;
+  return (kSubBuckets + sub) << (group - 1);
+}
+
+void LatencyHistogram::Add(int64_t value) {
+  if (value < 0)
+    value = 0;
+  counts_[BucketIndex(static_cast<uint64_t>(value))].fetch_add(
+      1, std::memory_order_relaxed);
+  int64_t prev = max_.load(std::memory_order_relaxed);
+  while (value > prev &&
+         !max_.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::Collect(Snapshot* out) {
+  out->counts.fill(0);
+  out->total = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    const uint32_t n = counts_[i].exchange(0, std::memory_order_relaxed);
+    out->counts[i] = n;
+    out->total += n;
+  }
+  out->max = max_.exchange(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Snapshot::Merge(const Snapshot& other) {
+  for (size_t i = 0; i < kNumBuckets; ++i)
+    counts[i] += other.counts[i];
+  total += other.total;
+  max = std::max(max, other.max);
+}
+
+int64_t LatencyHistogram::Snapshot::Quantile(double q) const {
+  if (total == 0)
+    return -1;
+  const uint64_t rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(q * static_cast<double>(total) + 0.5));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= rank)
+      return std::min(BucketLowerBound(i), max);
+  }
+  return max;
+}
+
+}  // namespace sctp
@@ -0,0 +1,48 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace sctp {
+
+// Log-linear histogram (HDR style) with 16 linear sub-buckets per power of
+// two, i.e. ~6% relative error, covering 0 .. 2^40 in the recorded unit.
+// Add() is wait-free and may run concurrently with Collect(); Collect()
+// atomically drains the counts into a plain snapshot.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kMaxMsb = 40;
+  static constexpr size_t kNumBuckets = (kMaxMsb - kSubBucketBits + 2) * kSubBuckets;
+
+  struct Snapshot {
+    std::array<uint64_t, kNumBuckets> counts{};
+    uint64_t total = 0;
+    int64_t max = 0;
+
+    void Merge(const Snapshot& other);
+    // Returns the lower bound of the bucket holding quantile |q| in [0, 1],
+    // or -1 if the snapshot is empty.
+    int64_t Quantile(double q) const;
+  };
+
+  void Add(int64_t value);
+  // Moves the counts accumulated since the previous call into |out|.
+  void Collect(Snapshot* out);
+
+  static size_t BucketIndex(uint64_t value);
+  static int64_t BucketLowerBound(size_t index);
+
+ private:
+  std::array<std::atomic<uint32_t>, kNumBuckets> counts_{};
+  std::atomic<int64_t> max_{0};
+};
+
+// CSV helper: microseconds to milliseconds, keeping -1 for "no samples".
+inline double MicrosToMillis(int64_t us) {
+  return us < 0 ? -1.0 : us / 1000.0;
+}
+
+}  // namespace sctp
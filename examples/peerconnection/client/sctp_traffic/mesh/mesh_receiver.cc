@@ -0,0 +1,107 @@
+#include "sctp_traffic/mesh/mesh_receiver.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "examples/peerconnection/client/conductor.h"
+#include "sctp_traffic/chunk_header.h"
+
+namespace {
+int64_t NowMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+}  // namespace
+
+using Kind = Conductor::TrafficKind;
+
+namespace sctp::mesh {
+
+Receiver::Receiver(const std::string& log_dir, int log_period_ms)
+    : period_ms_(log_period_ms) {
+  log_file_.open(log_dir + "/sctp_mesh.csv");
+  if (log_file_.is_open()) {
+    log_file_ << "Time,Participant,Throughput,Messages,DelayP50Ms,DelayP95Ms,"
+                 "DelayP99Ms,DelayMaxMs,Reordered,Missing\n";
+    log_file_.flush();
+  }
+}
+Receiver::~Receiver() {
+  Detach();
+}
+
+void Receiver::Attach(Conductor& c) {
+  conductor_ = &c;
+  conductor_->RegisterPayloadHandler(
+      Kind::kMesh, [this](absl::Span<const uint8_t> bytes) {
+        if (bytes.size() < kMessageHeaderSize)
+          return;
+        const uint8_t participant = bytes[kChunkHeaderSize];
+        if (participant < kMaxParticipants)
+          participants_[participant].OnMessage(bytes, WallClockMicros());
+      });
+
+  last_ms_ = NowMillis();
+  running_.store(true);
+  worker_ = std::thread([this]() {
+    while (running_.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(period_ms_));
+      Tick();
+    }
+  });
+}
+
+void Receiver::Tick() {
+  const int64_t now = NowMillis();
+  const double dt = (now - last_ms_) / 1000.0;
+  last_ms_ = now;
+
+  auto write_row = [&](const std::string& name,
+                       const FlowStats::Interval& in) {
+    const double mbps = dt > 0 ? (in.bytes * 8.0) / (dt * 1e6) : 0.0;
+    const auto& delay = in.delay_us;
+    log_file_ << now << "," << name << "," << mbps << "," << in.messages
+              << "," << MicrosToMillis(delay.Quantile(0.50)) << ","
+              << MicrosToMillis(delay.Quantile(0.95)) << ","
+              << MicrosToMillis(delay.Quantile(0.99)) << ","
+              << MicrosToMillis(delay.total ? delay.max : -1) << ","
+              << in.reordered << "," << in.missing << "\n";
+  };
+
+  FlowStats::Interval all;
+  for (int i = 0; i < kMaxParticipants; ++i) {
+    FlowStats::Interval in;
+    participants_[i].Collect(&in);
+    if (in.messages == 0)
+      continue;
+    if (log_file_.is_open())
+      write_row(std::to_string(i), in);
+    all.bytes += in.bytes;
+    all.messages += in.messages;
+    all.reordered += in.reordered;
+    all.missing += in.missing;
+    all.delay_us.Merge(in.delay_us);
+  }
+  if (all.messages > 0 && log_file_.is_open())
+    write_row("all", all);
+}
+
+void Receiver::Detach() {
+  if (conductor_) {
+    // OnMessage runs on the signaling thread; once the handler is gone
+    // there, none is in flight.
+    conductor_->signaling_thread()->BlockingCall(
+        [this] { conductor_->RegisterPayloadHandler(Kind::kMesh, nullptr); });
+  }
+  running_.store(false);
+  if (worker_.joinable())
+    worker_.join();
+  conductor_ = nullptr;
+  if (log_file_.is_open()) {
+    log_file_.close();
+  }
+}
+
+}  // namespace sctp::mesh
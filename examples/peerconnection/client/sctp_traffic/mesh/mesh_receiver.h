@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "sctp_traffic/flow_stats.h"
+#include "sctp_traffic/mesh/mesh_sender.h"
+#include "sctp_traffic/traffic.h"
+
+class Conductor;
+
+namespace sctp::mesh {
+
+// Per-participant one-way delay, reordering and gaps. Every interval with
+// traffic appends one sctp_mesh.csv row per active participant plus an
+// "all" row aggregating them.
+class Receiver final : public sctp::Receiver {
+ public:
+  Receiver(const std::string& log_dir, int log_period_ms = 100);
+  ~Receiver() override;
+
+  void Attach(Conductor& c) override;
+  void Detach() override;
+
+ private:
+  void Tick();
+
+  Conductor* conductor_ = nullptr;
+  int period_ms_;
+  std::thread worker_;
+  std::atomic<bool> running_{false};
+  int64_t last_ms_ = 0;
+
+  std::array<FlowStats, kMaxParticipants> participants_;
+
+  std::ofstream log_file_;
+};
+
+}  // namespace sctp::mesh
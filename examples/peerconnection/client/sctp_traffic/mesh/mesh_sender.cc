@@ -0,0 +1,103 @@
+#include "sctp_traffic/mesh/mesh_sender.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "api/units/time_delta.h"
+#include "examples/peerconnection/client/conductor.h"
+#include "rtc_base/copy_on_write_buffer.h"
+
+using Kind = Conductor::TrafficKind;
+
+namespace sctp::mesh {
+
+Sender::Sender(Config cfg) : cfg_(cfg) {
+  cfg_.participants = std::clamp(cfg_.participants, 1, kMaxParticipants);
+}
+Sender::~Sender() {
+  Stop();
+}
+
+void Sender::Start(Conductor& c) {
+  if (running_.load())
+    return;
+  conductor_ = &c;
+  running_.store(true);
+  conductor_->signaling_thread()->BlockingCall([this] {
+    safety_ = webrtc::PendingTaskSafetyFlag::Create();
+    // The superposition of the participants' Poisson sources is one Poisson
+    // source at the summed rate; each arrival belongs to a uniformly chosen
+    // participant.
+    arrivals_.emplace(cfg_.messages_per_sec * cfg_.participants, cfg_.seed);
+    arrivals_->Reset();
+    seq_.fill(0);
+    sent_ = 0;
+    dropped_ = 0;
+    report_start_ = std::chrono::steady_clock::now();
+    SendDue();
+  });
+  std::cout << "[MESH][TX] started: " << cfg_.participants << " x "
+            << cfg_.messages_per_sec << " msg/s" << std::endl;
+}
+
+void Sender::Stop() {
+  if (!running_.exchange(false))
+    return;
+  conductor_->signaling_thread()->BlockingCall([this] {
+    safety_->SetNotAlive();
+    arrivals_.reset();
+  });
+  safety_ = nullptr;
+  conductor_ = nullptr;
+  std::cout << "[MESH][TX] stopped" << std::endl;
+}
+
+void Sender::SendDue() {
+  if (!running_.load())
+    return;
+  while (arrivals_->UntilDueUs() <= 0) {
+    SendOne(arrivals_->scheduled_wall_us());
+    arrivals_->Advance();
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  if (now - report_start_ >= std::chrono::seconds(1)) {
+    std::cout << "[MESH][TX] sent=" << sent_ << " dropped=" << dropped_
+              << std::endl;
+    sent_ = 0;
+    dropped_ = 0;
+    report_start_ = now;
+  }
+
+  conductor_->signaling_thread()->PostDelayedHighPrecisionTask(
+      webrtc::SafeTask(safety_, [this] { SendDue(); }),
+      webrtc::TimeDelta::Micros(arrivals_->UntilDueUs()));
+}
+
+void Sender::SendOne(int64_t scheduled_us) {
+  const int participant = std::uniform_int_distribution<int>(
+      0, cfg_.participants - 1)(arrivals_->rng());
+  const size_t size = std::max(kMessageHeaderSize,
+                               cfg_.message_size.Sample(arrivals_->rng()));
+
+  if (!conductor_->IsFlowOpen(Kind::kMesh) ||
+      conductor_->BufferedAmount(Kind::kMesh) > cfg_.buffered_cap) {
+    ++dropped_;
+    return;
+  }
+  rtc::CopyOnWriteBuffer message(size);
+  uint8_t* data = message.MutableData();
+  std::fill(data, data + size, 0x00);
+  WriteChunkHeader(data, {seq_[participant], scheduled_us});
+  data[kChunkHeaderSize] = static_cast<uint8_t>(participant);
+  if (conductor_->SendPayload(Kind::kMesh, std::move(message))) {
+    ++seq_[participant];
+    ++sent_;
+  } else {
+    ++dropped_;
+  }
+}
+
+}  // namespace sctp::mesh
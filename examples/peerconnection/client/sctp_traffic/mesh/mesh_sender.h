@@ -0,0 +1,65 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "api/scoped_refptr.h"
+#include "api/task_queue/pending_task_safety_flag.h"
+#include "sctp_traffic/chunk_header.h"
+#include "sctp_traffic/poisson_arrivals.h"
+#include "sctp_traffic/size_distribution.h"
+#include "sctp_traffic/traffic.h"
+
+class Conductor;
+
+namespace sctp::mesh {
+
+// Wire layout: ChunkHeader | participant (1 byte) | padding. Each
+// participant keeps its own sequence space.
+constexpr size_t kMessageHeaderSize = kChunkHeaderSize + 1;
+constexpr int kMaxParticipants = 16;
+
+struct Config {
+  // Logical participants multiplexed on the one association, each an
+  // independent open-loop Poisson source.
+  int participants = 4;
+  double messages_per_sec = 50.0;  // Per participant.
+  SizeDistribution message_size = {SizeDistribution::Type::kExponential, 200,
+                                   0, 4 * 1024, 1.0};
+  uint64_t buffered_cap = 1024 * 1024;
+  uint64_t seed = 2;
+};
+
+// Sends the participants' messages on the "mesh" flow from the signaling
+// thread, which owns the data channels.
+class Sender final : public sctp::Sender {
+ public:
+  explicit Sender(Config cfg = {});
+  ~Sender() override;
+
+  void Start(Conductor& c) override;
+  void Stop() override;
+
+ private:
+  // Runs on the signaling thread: sends every message that is due, then
+  // schedules itself for the next one.
+  void SendDue();
+  void SendOne(int64_t scheduled_us);
+
+  Conductor* conductor_ = nullptr;
+  Config cfg_;
+  std::atomic<bool> running_{false};
+  rtc::scoped_refptr<webrtc::PendingTaskSafetyFlag> safety_;
+
+  // Signaling thread only.
+  std::optional<PoissonArrivals> arrivals_;
+  std::array<uint64_t, kMaxParticipants> seq_{};
+  uint64_t sent_ = 0;
+  uint64_t dropped_ = 0;
+  std::chrono::steady_clock::time_point report_start_;
+};
+
+}  // namespace sctp::mesh
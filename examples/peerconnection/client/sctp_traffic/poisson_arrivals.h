@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+#include "sctp_traffic/chunk_header.h"
+
+namespace sctp {
+
+// Open-loop Poisson arrival clock. Arrivals are scheduled on absolute
+// deadlines, so a slow send never delays the following ones, and each
+// arrival is reported with its *scheduled* wall-clock time. Stamping that
+// instead of the actual send time keeps sender-side stalls in the measured
+// latency rather than hiding them (coordinated omission).
+//
+// The clock never blocks: the owner sends every arrival that is due, then
+// schedules itself again after UntilDueUs().
+class PoissonArrivals {
+ public:
+  PoissonArrivals(double rate_per_sec, uint64_t seed)
+      : gap_s_(rate_per_sec), rng_(seed) {}
+
+  // Restarts the schedule from now and draws the first arrival.
+  void Reset() {
+    start_ = std::chrono::steady_clock::now();
+    start_wall_us_ = WallClockMicros();
+    next_ = start_;
+    Advance();
+  }
+
+  // Moves on to the arrival after the pending one.
+  void Advance() {
+    next_ += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(gap_s_(rng_)));
+  }
+
+  // Microseconds until the pending arrival is due; <= 0 once it is.
+  int64_t UntilDueUs() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               next_ - std::chrono::steady_clock::now())
+        .count();
+  }
+
+  // Wall-clock time the pending arrival is scheduled for.
+  int64_t scheduled_wall_us() const {
+    return start_wall_us_ +
+           std::chrono::duration_cast<std::chrono::microseconds>(next_ -
+                                                                 start_)
+               .count();
+  }
+
+  std::mt19937_64& rng() { return rng_; }
+
+ private:
+  std::exponential_distribution<double> gap_s_;
+  std::mt19937_64 rng_;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point next_;
+  int64_t start_wall_us_ = 0;
+};
+
+}  // namespace sctp
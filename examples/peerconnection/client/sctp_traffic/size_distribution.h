@@ -0,0 +1,103 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+
+namespace sctp {
+
+// Message-size distribution for the small-message generators. Samples are
+// clamped to [min_bytes, max_bytes].
+struct SizeDistribution {
+  enum class Type {
+    kFixed,        // Always |mean_bytes|.
+    kUniform,      // Uniform in [min_bytes, max_bytes].
+    kExponential,  // Exponential with mean |mean_bytes|.
+    kLogNormal,    // Log-normal with median |mean_bytes| and shape |sigma|.
+  };
+
+  Type type = Type::kFixed;
+  size_t mean_bytes = 256;
+  size_t min_bytes = 0;
+  size_t max_bytes = 64 * 1024;
+  double sigma = 1.0;  // kLogNormal only.
+
+  template <typename Rng>
+  size_t Sample(Rng& rng) const {
+    double v = static_cast<double>(mean_bytes);
+    switch (type) {
+      case Type::kFixed:
+        break;
+      case Type::kUniform:
+        return std::uniform_int_distribution<size_t>(
+            min_bytes, std::max(min_bytes, max_bytes))(rng);
+      case Type::kExponential:
+        v = std::exponential_distribution<double>(1.0 / mean_bytes)(rng);
+        break;
+      case Type::kLogNormal:
+        v = std::lognormal_distribution<double>(
+            std::log(static_cast<double>(mean_bytes)), sigma)(rng);
+        break;
+    }
+    return std::clamp(static_cast<size_t>(std::llround(v)), min_bytes,
+                      std::max(min_bytes, max_bytes));
+  }
+};
+
+// Parses a command-line size distribution into |out|, keeping its fields
+// that the spec leaves out:
+//
+//   fixed:<bytes>
+//   uniform:<min>-<max>
+//   exp:<mean>[:<max>]
+//   lognormal:<median>:<sigma>[:<max>]
+inline bool ParseSizeDistribution(absl::string_view spec,
+                                  SizeDistribution* out) {
+  const std::vector<absl::string_view> parts = absl::StrSplit(spec, ':');
+  SizeDistribution parsed = *out;
+  size_t max_bytes = 0;
+  if (parts[0] == "fixed" && parts.size() == 2) {
+    parsed.type = SizeDistribution::Type::kFixed;
+    if (!absl::SimpleAtoi(parts[1], &parsed.mean_bytes))
+      return false;
+  } else if (parts[0] == "uniform" && parts.size() == 2) {
+    const std::vector<absl::string_view> range =
+        absl::StrSplit(parts[1], '-');
+    parsed.type = SizeDistribution::Type::kUniform;
+    if (range.size() != 2 || !absl::SimpleAtoi(range[0], &parsed.min_bytes) ||
+        !absl::SimpleAtoi(range[1], &parsed.max_bytes) ||
+        parsed.min_bytes > parsed.max_bytes) {
+      return false;
+    }
+  } else if (parts[0] == "exp" && (parts.size() == 2 || parts.size() == 3)) {
+    parsed.type = SizeDistribution::Type::kExponential;
+    if (!absl::SimpleAtoi(parts[1], &parsed.mean_bytes) ||
+        parsed.mean_bytes == 0 ||
+        (parts.size() == 3 && !absl::SimpleAtoi(parts[2], &max_bytes))) {
+      return false;
+    }
+  } else if (parts[0] == "lognormal" &&
+             (parts.size() == 3 || parts.size() == 4)) {
+    parsed.type = SizeDistribution::Type::kLogNormal;
+    if (!absl::SimpleAtoi(parts[1], &parsed.mean_bytes) ||
+        parsed.mean_bytes == 0 || !absl::SimpleAtod(parts[2], &parsed.sigma) ||
+        !(parsed.sigma > 0) ||
+        (parts.size() == 4 && !absl::SimpleAtoi(parts[3], &max_bytes))) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+  if (max_bytes > 0)
+    parsed.max_bytes = max_bytes;
+  *out = parsed;
+  return true;
+}
+
+}  // namespace sctp
@@ -0,0 +1,66 @@
+#include "examples/peerconnection/client/session_manager.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "api/make_ref_counted.h"
+#include "rtc_base/logging.h"
+
+SessionManager::SessionManager() = default;
+
+SessionManager::~SessionManager() {
+  CloseAll();
+  sessions_.clear();
+  // The factory must go before the thread it was created on.
+  factory_ = nullptr;
+}
+
+bool SessionManager::Initialize(size_t expected_sessions) {
+  certificate_pool_ =
+      std::make_shared<CertificatePool>(std::max<size_t>(4, expected_sessions));
+  signaling_thread_ = rtc::Thread::CreateWithSocketServer();
+  signaling_thread_->SetName("shared_signaling", nullptr);
+  signaling_thread_->Start();
+  factory_ = Conductor::CreateFactory(signaling_thread_.get(),
+                                      &task_queue_factory_);
+  if (!factory_) {
+    RTC_LOG(LS_ERROR) << "Failed to create shared PeerConnectionFactory";
+    return false;
+  }
+  return true;
+}
+
+Conductor* SessionManager::AddSession(MainWindow* wnd, bool headless) {
+  Session session;
+  session.client = std::make_unique<PeerConnectionClient>();
+  session.conductor = rtc::make_ref_counted<Conductor>(session.client.get(),
+                                                       wnd, headless);
+  session.conductor->SetSharedFactory(factory_, signaling_thread_.get(),
+                                      task_queue_factory_);
+  session.conductor->SetCertificatePool(certificate_pool_);
+  sessions_.push_back(std::move(session));
+  return sessions_.back().conductor.get();
+}
+
+void SessionManager::StartAll() {
+  RTC_LOG(LS_INFO) << "Starting " << sessions_.size() << " session(s)";
+  for (Session& session : sessions_)
+    session.conductor->Start();
+}
+
+void SessionManager::CloseAll() {
+  for (Session& session : sessions_) {
+    if (session.conductor->connection_active())
+      session.conductor->Close();
+  }
+}
+
+bool SessionManager::Active() const {
+  for (const Session& session : sessions_) {
+    if (session.conductor->connection_active() ||
+        session.client->is_connected()) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,56 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_SESSION_MANAGER_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_SESSION_MANAGER_H_
+
+#include <memory>
+#include <vector>
+
+#include "api/peer_connection_interface.h"
+#include "api/scoped_refptr.h"
+#include "api/task_queue/task_queue_factory.h"
+#include "examples/peerconnection/client/certificate_pool.h"
+#include "examples/peerconnection/client/conductor.h"
+#include "examples/peerconnection/client/main_wnd.h"
+#include "examples/peerconnection/client/peer_connection_client.h"
+#include "rtc_base/thread.h"
+
+// Runs several Conductors in one process on a single PeerConnectionFactory,
+// so all sessions share one signaling thread and the factory's worker and
+// network threads. Each session keeps its own PeerConnection, flows, stats
+// collector and log directory; the caller configures those on the Conductor
+// returned by AddSession().
+//
+// All methods run on the main (UI) thread.
+class SessionManager {
+ public:
+  SessionManager();
+  ~SessionManager();
+
+  // Creates the shared signaling thread and factory, and a certificate pool
+  // sized so |expected_sessions| can start without generating inline.
+  bool Initialize(size_t expected_sessions = 1);
+
+  // |wnd| must outlive the manager.
+  Conductor* AddSession(MainWindow* wnd, bool headless);
+
+  void StartAll();
+  void CloseAll();
+
+  // True while any session has a PeerConnection or a signaling connection.
+  bool Active() const;
+
+  size_t size() const { return sessions_.size(); }
+
+ private:
+  struct Session {
+    std::unique_ptr<PeerConnectionClient> client;
+    rtc::scoped_refptr<Conductor> conductor;
+  };
+
+  std::unique_ptr<rtc::Thread> signaling_thread_;
+  webrtc::TaskQueueFactory* task_queue_factory_ = nullptr;
+  rtc::scoped_refptr<webrtc::PeerConnectionFactoryInterface> factory_;
+  std::shared_ptr<CertificatePool> certificate_pool_;
+  std::vector<Session> sessions_;
+};
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_SESSION_MANAGER_H_
@@ -0,0 +1,94 @@
+#include "examples/peerconnection/client/stats_delta.h"
+
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+struct Field {
+  const char* name;
+  size_t offset;
+  bool is_double;
+};
+
+#define INT_FIELD(name) {#name, offsetof(InboundRtpRecord, name), false}
+#define DOUBLE_FIELD(name) {#name, offsetof(InboundRtpRecord, name), true}
+
+// Everything but timestamp_us and ssrc, which head every line.
+constexpr Field kFields[] = {
+    INT_FIELD(frames_received),
+    INT_FIELD(frames_decoded),
+    INT_FIELD(frames_dropped),
+    INT_FIELD(key_frames_decoded),
+    INT_FIELD(frame_width),
+    INT_FIELD(frame_height),
+    DOUBLE_FIELD(frames_per_second),
+    DOUBLE_FIELD(jitter_buffer_delay_s),
+    INT_FIELD(jitter_buffer_emitted_count),
+    DOUBLE_FIELD(total_decode_time_s),
+    DOUBLE_FIELD(min_playout_delay_s),
+    DOUBLE_FIELD(jitter_s),
+    INT_FIELD(bytes_received),
+    INT_FIELD(header_bytes_received),
+    INT_FIELD(packets_received),
+    INT_FIELD(packets_lost),
+    INT_FIELD(packets_discarded),
+    INT_FIELD(fec_packets_received),
+    INT_FIELD(fec_packets_discarded),
+    INT_FIELD(fec_bytes_received),
+    INT_FIELD(retransmitted_packets_received),
+    INT_FIELD(retransmitted_bytes_received),
+    INT_FIELD(nack_count),
+    INT_FIELD(pli_count),
+    INT_FIELD(freeze_count),
+    DOUBLE_FIELD(total_freezes_duration_s),
+    INT_FIELD(remote_bytes_sent),
+    INT_FIELD(remote_packets_sent),
+    DOUBLE_FIELD(remote_round_trip_time_s),
+};
+
+#undef INT_FIELD
+#undef DOUBLE_FIELD
+
+const char* FieldAddress(const InboundRtpRecord& record, const Field& field) {
+  return reinterpret_cast<const char*>(&record) + field.offset;
+}
+
+}  // namespace
+
+bool StatsDeltaTracker::Update(const InboundRtpRecord& record,
+                               std::string* line) {
+  constexpr size_t kFieldCount = sizeof(kFields) / sizeof(kFields[0]);
+  auto [it, inserted] = previous_.try_emplace(record.ssrc, record);
+  const Field* changed[kFieldCount];
+  size_t changed_count = 0;
+  for (const Field& field : kFields) {
+    if (inserted || std::memcmp(FieldAddress(record, field),
+                                FieldAddress(it->second, field),
+                                sizeof(int64_t)) != 0) {
+      changed[changed_count++] = &field;
+    }
+  }
+  it->second = record;
+  if (changed_count == 0)
+    return false;
+
+  std::ostringstream out;
+  out << record.timestamp_us << " " << record.ssrc;
+  for (size_t i = 0; i < changed_count; ++i) {
+    const Field& field = *changed[i];
+    out << " " << field.name << "=";
+    if (field.is_double) {
+      double value;
+      std::memcpy(&value, FieldAddress(record, field), sizeof(value));
+      out << value;
+    } else {
+      int64_t value;
+      std::memcpy(&value, FieldAddress(record, field), sizeof(value));
+      out << value;
+    }
+  }
+  *line = out.str();
+  return true;
+}
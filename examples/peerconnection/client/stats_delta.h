@@ -0,0 +1,26 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_STATS_DELTA_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_STATS_DELTA_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "examples/peerconnection/client/stats_ring_file.h"
+
+// Keeps the last InboundRtpRecord of every SSRC and reduces each new one to
+// the fields that moved. Only the logged fields are compared, each as one
+// 8-byte word, so a poll costs no more than the record it diffs.
+class StatsDeltaTracker {
+ public:
+  // Sets |line| to "<timestamp_us> <ssrc> name=value ..." with the fields
+  // that changed since the previous record of the same SSRC (all of them
+  // for a new SSRC). Returns false, leaving |line| alone, if none did.
+  bool Update(const InboundRtpRecord& record, std::string* line);
+
+  void Reset() { previous_.clear(); }
+
+ private:
+  std::map<int64_t, InboundRtpRecord> previous_;
+};
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_STATS_DELTA_H_
@@ -0,0 +1,86 @@
+#include "examples/peerconnection/client/stats_ring_file.h"
+
+#include <cstring>
+
+#include "rtc_base/logging.h"
+
+#if defined(WEBRTC_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+StatsRingFile::~StatsRingFile() {
+  Close();
+}
+
+#if defined(WEBRTC_POSIX)
+
+bool StatsRingFile::Open(const std::string& path, size_t capacity) {
+  Close();
+  if (capacity == 0)
+    return false;
+
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open stats ring " << path;
+    return false;
+  }
+  mapped_size_ = sizeof(Header) + capacity * sizeof(InboundRtpRecord);
+  if (::ftruncate(fd_, static_cast<off_t>(mapped_size_)) != 0) {
+    RTC_LOG(LS_ERROR) << "Failed to size stats ring " << path;
+    Close();
+    return false;
+  }
+  void* mapping = ::mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd_, 0);
+  if (mapping == MAP_FAILED) {
+    RTC_LOG(LS_ERROR) << "Failed to map stats ring " << path;
+    Close();
+    return false;
+  }
+
+  header_ = static_cast<Header*>(mapping);
+  records_ = reinterpret_cast<InboundRtpRecord*>(header_ + 1);
+  std::memcpy(header_->magic, kMagic, sizeof(kMagic));
+  header_->version = kVersion;
+  header_->record_size = sizeof(InboundRtpRecord);
+  header_->capacity = capacity;
+  header_->count = 0;
+  return true;
+}
+
+void StatsRingFile::Close() {
+  if (header_) {
+    ::msync(header_, mapped_size_, MS_ASYNC);
+    ::munmap(header_, mapped_size_);
+    header_ = nullptr;
+    records_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+void StatsRingFile::Append(const InboundRtpRecord& record) {
+  if (!header_)
+    return;
+  const uint64_t count = header_->count;
+  std::memcpy(&records_[count % header_->capacity], &record, sizeof(record));
+  // Publish the record only after it is complete.
+  __atomic_store_n(&header_->count, count + 1, __ATOMIC_RELEASE);
+}
+
+#else  // !defined(WEBRTC_POSIX)
+
+bool StatsRingFile::Open(const std::string& path, size_t capacity) {
+  RTC_LOG(LS_WARNING) << "Stats ring file is not supported on this platform";
+  return false;
+}
+
+void StatsRingFile::Close() {}
+
+void StatsRingFile::Append(const InboundRtpRecord& record) {}
+
+#endif  // defined(WEBRTC_POSIX)
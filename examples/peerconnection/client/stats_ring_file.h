@@ -0,0 +1,89 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_STATS_RING_FILE_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_STATS_RING_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// One sample of a video inbound-rtp stream together with the matching
+// remote-outbound-rtp counters. Every field is 8 bytes wide so the layout has
+// no padding; analysis/stats_ring_to_csv.py mirrors it field by field.
+// Counters the report does not carry are stored as -1.
+struct InboundRtpRecord {
+  int64_t timestamp_us;  // RTCStatsReport timestamp.
+  int64_t ssrc;
+  int64_t frames_received;
+  int64_t frames_decoded;
+  int64_t frames_dropped;
+  int64_t key_frames_decoded;
+  int64_t frame_width;
+  int64_t frame_height;
+  double frames_per_second;
+  double jitter_buffer_delay_s;
+  int64_t jitter_buffer_emitted_count;
+  double total_decode_time_s;
+  double min_playout_delay_s;
+  double jitter_s;
+  int64_t bytes_received;
+  int64_t header_bytes_received;
+  int64_t packets_received;
+  int64_t packets_lost;
+  int64_t packets_discarded;
+  int64_t fec_packets_received;
+  int64_t fec_packets_discarded;
+  int64_t fec_bytes_received;
+  int64_t retransmitted_packets_received;
+  int64_t retransmitted_bytes_received;
+  int64_t nack_count;
+  int64_t pli_count;
+  int64_t freeze_count;
+  double total_freezes_duration_s;
+  int64_t remote_bytes_sent;
+  int64_t remote_packets_sent;
+  double remote_round_trip_time_s;
+};
+static_assert(sizeof(InboundRtpRecord) == 31 * 8,
+              "InboundRtpRecord must stay padding-free");
+
+// Memory-mapped ring of InboundRtpRecords. Append() is a memcpy into the
+// mapping, so the stats callback never formats text or issues a write();
+// the kernel flushes dirty pages in the background. Once |capacity| records
+// have been written the oldest ones are overwritten.
+//
+// File layout: Header, then |capacity| records. |count| is the total number
+// of records ever appended; record n lives in slot n % capacity. Once the
+// ring has wrapped, the oldest record is in slot count % capacity and the
+// newest in the slot before it.
+class StatsRingFile {
+ public:
+  static constexpr char kMagic[8] = {'W', 'R', 'T', 'C', 'S', 'T', 'R', '1'};
+  static constexpr uint32_t kVersion = 1;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+    uint64_t count;
+  };
+
+  StatsRingFile() = default;
+  ~StatsRingFile();
+  StatsRingFile(const StatsRingFile&) = delete;
+  StatsRingFile& operator=(const StatsRingFile&) = delete;
+
+  bool Open(const std::string& path, size_t capacity);
+  void Close();
+  bool is_open() const { return header_ != nullptr; }
+
+  // Single writer only.
+  void Append(const InboundRtpRecord& record);
+
+ private:
+  int fd_ = -1;
+  size_t mapped_size_ = 0;
+  Header* header_ = nullptr;
+  InboundRtpRecord* records_ = nullptr;
+};
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_STATS_RING_FILE_H_
@@ -0,0 +1,378 @@
+#include "examples/peerconnection/client/traffic_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <utility>
+
+#include "absl/strings/match.h"
+#include "api/make_ref_counted.h"
+#include "api/stats/rtc_stats_collector_callback.h"
+#include "api/stats/rtcstats_objects.h"
+#include "rtc_base/byte_order.h"
+#include "rtc_base/copy_on_write_buffer.h"
+#include "rtc_base/logging.h"
+#include "sctp_traffic/chunk_header.h"
+
+namespace {
+
+// Every chunk of an object carries ChunkHeader (seq = object id,
+// send_time_us = scheduled start) followed by the object's total size, so
+// the receiver can tell when the last chunk of an object has arrived.
+constexpr size_t kObjectHeaderSize = sctp::kChunkHeaderSize + 4;
+constexpr size_t kMaxChunkBytes = 16 * 1024;
+// Stay below the channel's 16 MiB send queue limit, past which Send() fails
+// and the channel is closed.
+constexpr uint64_t kMaxBufferedBytes = 12 * 1024 * 1024;
+constexpr int kRtpStatsIntervalMs = 1000;
+
+int64_t WallClockMillis() {
+  return sctp::WallClockMicros() / 1000;
+}
+
+std::string ToLower(std::string s) {
+  std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+  return s;
+}
+
+struct TraceEntry {
+  int64_t offset_ms = 0;
+  size_t size_bytes = 0;
+};
+
+// One object per line, either "size_bytes" (objects spaced |period_ms|
+// apart) or "offset_ms,size_bytes". Blank lines and lines starting with '#'
+// are skipped. The trace loops; |cycle_ms| receives its length.
+std::vector<TraceEntry> LoadTrace(const std::string& path,
+                                  int period_ms,
+                                  int64_t* cycle_ms) {
+  std::vector<TraceEntry> entries;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    TraceEntry entry;
+    const size_t comma = line.find(',');
+    char* end = nullptr;
+    if (comma == std::string::npos) {
+      entry.offset_ms = static_cast<int64_t>(entries.size()) * period_ms;
+      entry.size_bytes = std::strtoull(line.c_str(), &end, 10);
+    } else {
+      entry.offset_ms = std::strtoll(line.c_str(), &end, 10);
+      entry.size_bytes = std::strtoull(line.c_str() + comma + 1, &end, 10);
+    }
+    if (end == line.c_str())
+      continue;  // Header or junk.
+    entries.push_back(entry);
+  }
+  *cycle_ms = entries.empty() ? 0
+                              : entries.back().offset_ms +
+                                    std::max(period_ms, 1);
+  return entries;
+}
+
+class StatsCallback : public webrtc::RTCStatsCollectorCallback {
+ public:
+  using Handler =
+      std::function<void(const rtc::scoped_refptr<const webrtc::RTCStatsReport>&)>;
+  explicit StatsCallback(Handler handler) : handler_(std::move(handler)) {}
+
+  void OnStatsDelivered(
+      const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) override {
+    handler_(report);
+  }
+
+ private:
+  Handler handler_;
+};
+
+}  // namespace
+
+// Sending side of one scheduled SCTP row.
+class TrafficScheduler::SctpFlow {
+ public:
+  SctpFlow(TrafficProfile profile,
+           rtc::scoped_refptr<webrtc::DataChannelInterface> channel)
+      : profile_(std::move(profile)), channel_(std::move(channel)) {
+    if (!profile_.custom_trace.empty()) {
+      trace_ = LoadTrace(profile_.custom_trace, profile_.periodicity,
+                         &cycle_ms_);
+      if (trace_.empty())
+        RTC_LOG(LS_WARNING) << "Empty trace " << profile_.custom_trace
+                            << " for " << profile_.traffic_name;
+    } else {
+      trace_ = {{0, static_cast<size_t>(std::max(profile_.file_size, 0))}};
+      cycle_ms_ = std::max(profile_.periodicity, 1);
+    }
+  }
+  ~SctpFlow() { Stop(); }
+
+  void Start() {
+    if (trace_.empty() || running_.exchange(true))
+      return;
+    worker_ = std::thread([this] { Run(); });
+  }
+
+  void Stop() {
+    if (!running_.exchange(false))
+      return;
+    if (worker_.joinable())
+      worker_.join();
+  }
+
+ private:
+  void Run() {
+    const auto start = std::chrono::steady_clock::now();
+    const int64_t start_wall_us = sctp::WallClockMicros();
+    uint64_t skipped = 0;
+
+    for (uint64_t id = 0; running_.load(); ++id) {
+      const TraceEntry& entry = trace_[id % trace_.size()];
+      const int64_t due_ms =
+          static_cast<int64_t>(id / trace_.size()) * cycle_ms_ +
+          entry.offset_ms;
+      const auto due = start + std::chrono::milliseconds(due_ms);
+      while (running_.load() && std::chrono::steady_clock::now() < due) {
+        std::this_thread::sleep_for(
+            std::min<std::chrono::steady_clock::duration>(
+                due - std::chrono::steady_clock::now(),
+                std::chrono::milliseconds(50)));
+      }
+      if (!running_.load())
+        break;
+
+      const size_t size = std::max(entry.size_bytes, kObjectHeaderSize);
+      if (channel_->state() != webrtc::DataChannelInterface::kOpen ||
+          channel_->buffered_amount() + size > kMaxBufferedBytes) {
+        if (++skipped % 100 == 1)
+          RTC_LOG(LS_WARNING) << profile_.traffic_name << ": skipped "
+                              << skipped << " objects";
+        continue;
+      }
+      SendObject(id, start_wall_us + due_ms * 1000, size);
+    }
+  }
+
+  void SendObject(uint64_t id, int64_t scheduled_us, size_t size) {
+    for (size_t offset = 0; offset < size;) {
+      const size_t chunk = std::min(kMaxChunkBytes, size - offset);
+      rtc::CopyOnWriteBuffer buffer(std::max(chunk, kObjectHeaderSize));
+      uint8_t* data = buffer.MutableData();
+      std::memset(data, 0, buffer.size());
+      sctp::WriteChunkHeader(data, {id, scheduled_us});
+      rtc::SetBE32(data + sctp::kChunkHeaderSize, static_cast<uint32_t>(size));
+      if (!channel_->Send(webrtc::DataBuffer(std::move(buffer), true)))
+        return;
+      offset += chunk;
+    }
+  }
+
+  TrafficProfile profile_;
+  rtc::scoped_refptr<webrtc::DataChannelInterface> channel_;
+  std::vector<TraceEntry> trace_;
+  int64_t cycle_ms_ = 0;
+  std::thread worker_;
+  std::atomic<bool> running_{false};
+};
+
+// Receiving side of one scheduled SCTP row. Callbacks arrive on the
+// signaling thread.
+class TrafficScheduler::SctpSink : public webrtc::DataChannelObserver {
+ public:
+  SctpSink(rtc::scoped_refptr<webrtc::DataChannelInterface> channel,
+           std::ofstream& log)
+      : channel_(std::move(channel)),
+        name_(channel_->label().substr(std::strlen(kLabelPrefix))),
+        log_(log) {
+    channel_->RegisterObserver(this);
+  }
+  ~SctpSink() override { channel_->UnregisterObserver(); }
+
+  void OnStateChange() override {}
+
+  void OnMessage(const webrtc::DataBuffer& buffer) override {
+    absl::Span<const uint8_t> bytes(buffer.data.cdata(), buffer.data.size());
+    sctp::ChunkHeader header;
+    if (bytes.size() < kObjectHeaderSize ||
+        !sctp::ParseChunkHeader(bytes, &header))
+      return;
+    const uint32_t object_bytes =
+        rtc::GetBE32(bytes.data() + sctp::kChunkHeaderSize);
+
+    if (!have_object_ || header.seq != object_id_) {
+      have_object_ = true;
+      object_id_ = header.seq;
+      received_ = 0;
+    }
+    received_ += bytes.size();
+    if (received_ < object_bytes)
+      return;
+
+    const int64_t now_us = sctp::WallClockMicros();
+    if (log_.is_open()) {
+      log_ << name_ << "," << now_us / 1000 << "," << object_bytes << ","
+           << (now_us - header.send_time_us) / 1000.0 << "\n";
+    }
+    have_object_ = false;
+  }
+
+ private:
+  rtc::scoped_refptr<webrtc::DataChannelInterface> channel_;
+  std::string name_;
+  std::ofstream& log_;
+
+  bool have_object_ = false;
+  uint64_t object_id_ = 0;
+  uint64_t received_ = 0;
+};
+
+struct TrafficScheduler::RtpTrack {
+  std::string name;
+  rtc::scoped_refptr<webrtc::RtpSenderInterface> sender;
+  // Previous sample; touched only by stats callbacks.
+  int64_t last_ms = -1;
+  uint64_t last_bytes = 0;
+  uint32_t last_frames = 0;
+};
+
+TrafficScheduler::TrafficScheduler(std::vector<TrafficProfile> profiles,
+                                   const std::string& log_dir)
+    : profiles_(std::move(profiles)), log_dir_(log_dir) {
+  sctp_log_.open(log_dir_ + "/sctp_log.csv");
+  if (sctp_log_.is_open())
+    sctp_log_ << "traffic_name,timestamp,size_bytes,latency_ms\n";
+  rtp_log_->file.open(log_dir_ + "/rtp_log.csv");
+  if (rtp_log_->file.is_open())
+    rtp_log_->file << "traffic_name,timestamp,bitrate_bps,fps\n";
+}
+
+TrafficScheduler::~TrafficScheduler() {
+  Stop();
+}
+
+// static
+bool TrafficScheduler::IsScheduledSctp(const TrafficProfile& profile) {
+  if (ToLower(profile.protocol) != "sctp")
+    return false;
+  const std::string pattern = ToLower(profile.pattern);
+  return !profile.custom_trace.empty() || pattern == "periodic" ||
+         pattern == "trace";
+}
+
+// static
+bool TrafficScheduler::IsRtp(const TrafficProfile& profile) {
+  return ToLower(profile.protocol) == "rtp";
+}
+
+void TrafficScheduler::AddDataChannels(webrtc::PeerConnectionInterface* pc) {
+  for (const TrafficProfile& profile : profiles_) {
+    if (!IsScheduledSctp(profile))
+      continue;
+    webrtc::DataChannelInit init;
+    init.ordered = true;
+    auto result = pc->CreateDataChannelOrError(
+        std::string(kLabelPrefix) + profile.traffic_name, &init);
+    if (!result.ok()) {
+      RTC_LOG(LS_ERROR) << "CreateDataChannel failed for "
+                        << profile.traffic_name << ": "
+                        << result.error().message();
+      continue;
+    }
+    flows_.push_back(
+        std::make_unique<SctpFlow>(profile, std::move(result.value())));
+    std::cout << "Scheduled SCTP flow '" << profile.traffic_name << "'"
+              << std::endl;
+  }
+}
+
+void TrafficScheduler::AddRtpSender(
+    const std::string& traffic_name,
+    rtc::scoped_refptr<webrtc::RtpSenderInterface> sender) {
+  auto track = std::make_shared<RtpTrack>();
+  track->name = traffic_name;
+  track->sender = std::move(sender);
+  rtp_tracks_.push_back(std::move(track));
+}
+
+bool TrafficScheduler::OnRemoteDataChannel(
+    rtc::scoped_refptr<webrtc::DataChannelInterface> channel) {
+  if (!absl::StartsWith(channel->label(), kLabelPrefix))
+    return false;
+  sinks_.push_back(std::make_unique<SctpSink>(std::move(channel), sctp_log_));
+  return true;
+}
+
+void TrafficScheduler::Start(
+    rtc::scoped_refptr<webrtc::PeerConnectionInterface> pc) {
+  pc_ = std::move(pc);
+  for (auto& flow : flows_)
+    flow->Start();
+
+  if (rtp_tracks_.empty() || running_.exchange(true))
+    return;
+  {
+    std::lock_guard<std::mutex> lock(rtp_log_->mutex);
+    rtp_log_->stopped = false;
+  }
+  rtp_poller_ = std::thread([this] {
+    while (running_.load()) {
+      std::this_thread::sleep_for(
+          std::chrono::milliseconds(kRtpStatsIntervalMs));
+      if (running_.load())
+        PollRtpStats();
+    }
+  });
+}
+
+void TrafficScheduler::PollRtpStats() {
+  for (const auto& t : rtp_tracks_) {
+    // The callback may still be pending on the signaling thread after
+    // Stop() or destruction, so it holds only shared state, never |this|.
+    auto callback = rtc::make_ref_counted<StatsCallback>(
+        [log = rtp_log_, t](
+            const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) {
+          std::lock_guard<std::mutex> lock(log->mutex);
+          if (log->stopped)
+            return;
+          uint64_t bytes = 0;
+          uint32_t frames = 0;
+          for (const auto* rtp :
+               report->GetStatsOfType<webrtc::RTCOutboundRtpStreamStats>()) {
+            bytes += rtp->bytes_sent.value_or(0);
+            frames += rtp->frames_encoded.value_or(0);
+          }
+          const int64_t now_ms = WallClockMillis();
+          if (t->last_ms >= 0 && now_ms > t->last_ms && log->file.is_open()) {
+            const double dt = (now_ms - t->last_ms) / 1000.0;
+            log->file << t->name << "," << now_ms << ","
+                      << (bytes - t->last_bytes) * 8.0 / dt << ","
+                      << (frames - t->last_frames) / dt << "\n";
+          }
+          t->last_ms = now_ms;
+          t->last_bytes = bytes;
+          t->last_frames = frames;
+        });
+    pc_->GetStats(t->sender, callback);
+  }
+}
+
+void TrafficScheduler::Stop() {
+  running_.store(false);
+  if (rtp_poller_.joinable())
+    rtp_poller_.join();
+  for (auto& flow : flows_)
+    flow->Stop();
+  flows_.clear();
+  sinks_.clear();
+  rtp_tracks_.clear();
+  pc_ = nullptr;
+  if (sctp_log_.is_open())
+    sctp_log_.flush();
+  std::lock_guard<std::mutex> lock(rtp_log_->mutex);
+  rtp_log_->stopped = true;
+  if (rtp_log_->file.is_open())
+    rtp_log_->file.flush();
+}
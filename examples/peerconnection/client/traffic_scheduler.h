@@ -0,0 +1,89 @@
+#ifndef EXAMPLES_PEERCONNECTION_CLIENT_TRAFFIC_SCHEDULER_H_
+#define EXAMPLES_PEERCONNECTION_CLIENT_TRAFFIC_SCHEDULER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "api/data_channel_interface.h"
+#include "api/peer_connection_interface.h"
+#include "api/rtp_sender_interface.h"
+#include "api/scoped_refptr.h"
+#include "examples/peerconnection/client/traffic_profile.h"
+
+// Runs the SCTP rows of a traffic profile CSV as concurrent flows and logs
+// the per-row results:
+//   - sctp_log.csv (receiving peer): traffic_name,timestamp,size_bytes,
+//     latency_ms, one row per completed burst/trace object.
+//   - rtp_log.csv (sending peer): traffic_name,timestamp,bitrate_bps,fps,
+//     once per second for each video track registered with AddRtpSender().
+//
+// Column meanings for SCTP rows: |pattern| "periodic" sends |file_size|
+// bytes every |periodicity| ms; "trace" (or a non-empty |custom_trace|)
+// replays object sizes from the trace file. See LoadTrace() for its format.
+// Rows whose pattern names a built-in generator (bulk, kv, mesh) and RTP
+// rows (|video_file_name| capped at |max_bitrate| kbps and |frame_rate|
+// fps) are set up by the Conductor.
+class TrafficScheduler {
+ public:
+  // Label prefix of the in-band data channels opened for SCTP rows; the
+  // remote side recognises them in OnDataChannel.
+  static constexpr char kLabelPrefix[] = "profile/";
+
+  TrafficScheduler(std::vector<TrafficProfile> profiles,
+                   const std::string& log_dir);
+  ~TrafficScheduler();
+
+  static bool IsScheduledSctp(const TrafficProfile& profile);
+  static bool IsRtp(const TrafficProfile& profile);
+
+  // Sending peer: opens one data channel per scheduled SCTP row.
+  void AddDataChannels(webrtc::PeerConnectionInterface* pc);
+  // Sending peer: samples outbound-rtp stats of |sender| into rtp_log.csv.
+  void AddRtpSender(const std::string& traffic_name,
+                    rtc::scoped_refptr<webrtc::RtpSenderInterface> sender);
+  // Receiving peer: takes over a remote channel carrying kLabelPrefix.
+  // Returns false for any other label.
+  bool OnRemoteDataChannel(
+      rtc::scoped_refptr<webrtc::DataChannelInterface> channel);
+
+  void Start(rtc::scoped_refptr<webrtc::PeerConnectionInterface> pc);
+  void Stop();
+
+ private:
+  class SctpFlow;
+  class SctpSink;
+  struct RtpTrack;
+  // rtp_log.csv, shared with the stats callbacks: one can still be queued
+  // on the signaling thread after Stop() or destruction, so it holds the
+  // file itself and checks |stopped| under the lock.
+  struct RtpLog {
+    std::mutex mutex;
+    bool stopped = false;
+    std::ofstream file;
+  };
+
+  void PollRtpStats();
+
+  std::vector<TrafficProfile> profiles_;
+  std::string log_dir_;
+
+  std::vector<std::unique_ptr<SctpFlow>> flows_;
+  std::vector<std::unique_ptr<SctpSink>> sinks_;
+  std::vector<std::shared_ptr<RtpTrack>> rtp_tracks_;
+
+  rtc::scoped_refptr<webrtc::PeerConnectionInterface> pc_;
+  std::thread rtp_poller_;
+  std::atomic<bool> running_{false};
+
+  // Written only from the signaling thread (data channel observers).
+  std::ofstream sctp_log_;
+  std::shared_ptr<RtpLog> rtp_log_ = std::make_shared<RtpLog>();
+};
+
+#endif  // EXAMPLES_PEERCONNECTION_CLIENT_TRAFFIC_SCHEDULER_H_
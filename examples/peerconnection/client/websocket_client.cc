@@ -1,9 +1,53 @@
 // websocket_client.cc
 #include "examples/peerconnection/client/websocket_client.h"
+
+#include <poll.h>
+
+#include "api/units/time_delta.h"
 #include "rtc_base/logging.h"
 
-WebSocketClient::WebSocketClient()
-    : context_(nullptr),
+namespace {
+// lws only needs the timer for timeouts and pings once its descriptors are
+// in the socket server; otherwise the timer is all that drives it.
+constexpr webrtc::TimeDelta kTimerInterval = webrtc::TimeDelta::Seconds(1);
+constexpr webrtc::TimeDelta kPollInterval = webrtc::TimeDelta::Millis(10);
+}  // namespace
+
+// One lws descriptor, watched by the socket server for the events lws last
+// asked for.
+class WebSocketClient::PollFd : public rtc::Dispatcher {
+ public:
+  PollFd(WebSocketClient* client, int fd) : client_(client), fd_(fd) {}
+
+  void set_events(int events) { events_ = events; }
+
+  uint32_t GetRequestedEvents() override {
+    uint32_t ff = 0;
+    if (events_ & POLLIN)
+      ff |= rtc::DE_READ;
+    if (events_ & POLLOUT)
+      ff |= rtc::DE_WRITE;
+    return ff;
+  }
+
+  void OnEvent(uint32_t ff, int err) override {
+    // lws may drop the descriptor, and with it |this|, before this returns.
+    client_->OnPollEvent(fd_, events_, ff);
+  }
+
+  int GetDescriptor() override { return fd_; }
+  bool IsDescriptorClosed() override { return false; }
+
+ private:
+  WebSocketClient* const client_;
+  const int fd_;
+  int events_ = 0;
+};
+
+WebSocketClient::WebSocketClient(rtc::PhysicalSocketServer* socket_server)
+    : socket_server_(socket_server),
+      thread_(rtc::Thread::Current()),
+      context_(nullptr),
       websocket_(nullptr),
       is_connected_(false) {
   RTC_LOG(LS_INFO) << "WebSocketClient constructor";
@@ -40,7 +84,11 @@ WebSocketClient::WebSocketClient()
   context_ = lws_create_context(&info);
   if (!context_) {
     RTC_LOG(LS_ERROR) << "Failed to create libwebsocket context";
+    return;
   }
+  thread_->PostDelayedTask(
+      webrtc::SafeTask(safety_.flag(), [this] { OnTimer(); }),
+      ExternalPoll() ? kTimerInterval : kPollInterval);
 }
 
 WebSocketClient::~WebSocketClient() {
@@ -48,6 +96,71 @@ WebSocketClient::~WebSocketClient() {
   if (context_) {
     lws_context_destroy(context_);
   }
+  // Anything lws did not hand back through LWS_CALLBACK_DEL_POLL_FD.
+  for (auto& entry : poll_fds_)
+    socket_server_->Remove(entry.second.get());
+}
+
+void WebSocketClient::UpdatePollFd(int fd, int events) {
+  if (!socket_server_)
+    return;
+  auto it = poll_fds_.find(fd);
+  if (it == poll_fds_.end()) {
+    auto poll_fd = std::make_unique<PollFd>(this, fd);
+    poll_fd->set_events(events);
+    socket_server_->Add(poll_fd.get());
+    poll_fds_.emplace(fd, std::move(poll_fd));
+    return;
+  }
+  it->second->set_events(events);
+  socket_server_->Update(it->second.get());
+}
+
+void WebSocketClient::RemovePollFd(int fd) {
+  auto it = poll_fds_.find(fd);
+  if (it == poll_fds_.end())
+    return;
+  socket_server_->Remove(it->second.get());
+  poll_fds_.erase(it);
+}
+
+void WebSocketClient::OnPollEvent(int fd, int events, uint32_t ff) {
+  struct lws_pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = events;
+  pfd.revents = 0;
+  if (ff & rtc::DE_READ)
+    pfd.revents |= POLLIN;
+  if (ff & rtc::DE_WRITE)
+    pfd.revents |= POLLOUT;
+  if (ff & rtc::DE_CLOSE)
+    pfd.revents |= POLLHUP;
+  lws_service_fd(context_, &pfd);
+  // TLS may have decrypted more than one frame off the socket; the rest
+  // never makes the descriptor readable again, so drain it now.
+  if (!lws_service_adjust_timeout(context_, 1, 0))
+    lws_service_tsi(context_, -1, 0);
+}
+
+void WebSocketClient::OnTimer() {
+  if (ExternalPoll()) {
+    lws_service_fd(context_, nullptr);
+  } else {
+    if (socket_server_ && websocket_ && !poll_fallback_logged_) {
+      RTC_LOG(LS_WARNING) << "lws registered no descriptors, polling every "
+                          << kPollInterval.ms() << " ms";
+      poll_fallback_logged_ = true;
+    }
+    lws_service(context_, 0);
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  if (now - last_ping_time_ >= ping_interval_ && SendPing())
+    last_ping_time_ = now;
+
+  thread_->PostDelayedTask(
+      webrtc::SafeTask(safety_.flag(), [this] { OnTimer(); }),
+      ExternalPoll() ? kTimerInterval : kPollInterval);
 }
 
 bool WebSocketClient::SendPing() {
@@ -142,13 +255,10 @@ bool WebSocketClient::Connect(const std::string& url) {
     return false;
   }
 
-  // Service the event loop a few times to establish the connection
-  for (int i = 0; i < 50 && !is_connected_; i++) {
-    lws_service(context_, 50);
-    rtc::Thread::Current()->SleepMs(100);
-  }
-
-  return is_connected_;
+  // The handshake proceeds as the socket server reports the socket ready;
+  // LWS_CALLBACK_CLIENT_ESTABLISHED then fires the connection callback.
+  // Blocking here would stall the UI for the whole handshake.
+  return true;
 }
 
 void WebSocketClient::Close() {
@@ -188,6 +298,12 @@ bool WebSocketClient::ProcessCompleteMessage(const std::string& complete_message
 
 // Update the SendMessage method for better fragmentation handling:
 bool WebSocketClient::SendMessage(const std::string& message) {
+  if (!thread_->IsCurrent()) {
+    // lws is single-threaded; queue on the thread that services it.
+    thread_->PostTask(webrtc::SafeTask(
+        safety_.flag(), [this, message] { SendMessage(message); }));
+    return is_connected_;
+  }
   if (!is_connected_) {
       RTC_LOG(LS_ERROR) << "Cannot send message - not connected";
       return false;
@@ -205,15 +321,13 @@ bool WebSocketClient::SendMessage(const std::string& message) {
 
   if (websocket_) {
       RTC_LOG(LS_INFO) << "Requesting writable callback for " << send_queue_.size() << " fragments";
+      // Asks lws for POLLOUT; the write happens once the socket server
+      // sees the socket writable.
       int result = lws_callback_on_writable(websocket_);
       if (result < 0) {
           RTC_LOG(LS_ERROR) << "Failed to request writable callback";
           return false;
       }
-      
-      if (context_) {
-          lws_service(context_, 0);
-      }
   }
 
   return true;
@@ -365,32 +479,27 @@ void WebSocketClient::HandleCallback(struct lws *wsi,
       websocket_ = nullptr;
       break;
 
+    case LWS_CALLBACK_ADD_POLL_FD:
+    case LWS_CALLBACK_CHANGE_MODE_POLL_FD: {
+      const auto* args = static_cast<const lws_pollargs*>(in);
+      UpdatePollFd(args->fd, args->events);
+      break;
+    }
+
+    case LWS_CALLBACK_DEL_POLL_FD:
+      RemovePollFd(static_cast<const lws_pollargs*>(in)->fd);
+      break;
+
+    case LWS_CALLBACK_LOCK_POLL:
+    case LWS_CALLBACK_UNLOCK_POLL:
+      break;
+
     default:
       RTC_LOG(LS_INFO) << "Unhandled callback reason: " << reason;
       break;
   }
 }
 
-void WebSocketClient::Service() {
-    if (context_) {
-        lws_service(context_, 0);
-
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - last_ping_time_);
-        if (elapsed >= ping_interval_) {
-          if (SendPing()) {
-             last_ping_time_ = now;
-          }
-        }
-        
-        // Trigger next service immediately if connected
-        if (is_connected_ && websocket_) {
-            lws_callback_on_writable(websocket_);
-        }
-    }
-}
-
-
 bool WebSocketClient::ParseURL(const std::string& url) {
   size_t pos = 0;
   size_t protocol_end = url.find("://", pos);
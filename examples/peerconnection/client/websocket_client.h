@@ -2,13 +2,18 @@
 #ifndef WEBSOCKET_CLIENT_H_
 #define WEBSOCKET_CLIENT_H_
 
+#include <atomic>
 #include <string>
 #include <functional>
+#include <map>
 #include <memory>
 #include <libwebsockets.h>
 #include <deque>
 #include <chrono>
 
+#include "api/task_queue/pending_task_safety_flag.h"
+#include "examples/peerconnection/client/collider_connection.h"
+#include "rtc_base/physical_socket_server.h"
 #include "rtc_base/thread.h"
 
 #include "json/reader.h"
@@ -16,32 +21,31 @@
 #include "json/writer.h"
 #include "rtc_base/strings/json.h"
 
-class WebSocketClient {
+// AppRTC collider client over libwebsockets. The lws descriptors are
+// registered with |socket_server| (the one of the thread that creates the
+// client), so frames are read and written as soon as the socket is ready
+// rather than when a poll loop next gets around to lws_service(). A timer
+// on the same thread runs lws' timeouts and the keep-alive ping. Without a
+// socket server, or while lws has registered no descriptors with it (an lws
+// built without external poll support never does), the timer polls lws
+// instead.
+//
+// Callbacks run on the creating thread; SendMessage() may be called from
+// any thread.
+class WebSocketClient : public ColliderConnection {
  public:
-  using MessageCallback = std::function<void(const std::string&)>;
-  using ConnectionCallback = std::function<void(bool)>;
-
-  WebSocketClient();
-  ~WebSocketClient();
-
-  bool Connect(const std::string& url);
-  void Close();
-  bool SendMessage(const std::string& message);
-  bool IsConnected() const { return is_connected_; }
-  
-  void SetMessageCallback(MessageCallback callback) {
-    message_callback_ = std::move(callback);
-  }
-  
-  void SetConnectionCallback(ConnectionCallback callback) {
-    connection_callback_ = std::move(callback);
-  }
+  explicit WebSocketClient(rtc::PhysicalSocketServer* socket_server);
+  ~WebSocketClient() override;
+
+  bool Connect(const std::string& url) override;
+  void Close() override;
+  bool SendMessage(const std::string& message) override;
+  bool IsConnected() const override { return is_connected_; }
 
   static int CallbackFunction(struct lws *wsi, 
                             enum lws_callback_reasons reason,
                             void *user, void *in, size_t len);
 
-  void Service();
   bool ParseURL(const std::string& url);
 
   // New: Send periodic ping
@@ -53,15 +57,31 @@ class WebSocketClient {
   const std::chrono::seconds ping_interval_{30};  // 30-second keepalive
 
  private:
+  class PollFd;
+
   void HandleCallback(struct lws *wsi, 
                      enum lws_callback_reasons reason,
                      void *user, void *in, size_t len);
 
+  // LWS_CALLBACK_{ADD,DEL,CHANGE_MODE}_POLL_FD.
+  void UpdatePollFd(int fd, int events);
+  void RemovePollFd(int fd);
+  void OnPollEvent(int fd, int events, uint32_t ff);
+  // lws timeouts and keep-alive; reschedules itself.
+  void OnTimer();
+  // True while lws' descriptors are in |socket_server_|.
+  bool ExternalPoll() const { return socket_server_ && !poll_fds_.empty(); }
+
+  rtc::PhysicalSocketServer* const socket_server_;
+  rtc::Thread* const thread_;
+  std::map<int, std::unique_ptr<PollFd>> poll_fds_;
+  webrtc::ScopedTaskSafety safety_;
+  bool poll_fallback_logged_ = false;
+
   struct lws_context *context_;
   struct lws *websocket_;
-  bool is_connected_;
-  MessageCallback message_callback_;
-  ConnectionCallback connection_callback_;
+  // Written on |thread_|, read by SendMessage() and IsConnected() anywhere.
+  std::atomic<bool> is_connected_;
   std::deque<std::string> send_queue_;  // Queue for outgoing messages
 
   std::string message_buffer_;  // Buffer for accumulating partial messages
@@ -10,19 +10,41 @@
 
 #include "examples/peerconnection/server/data_socket.h"
 
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #if defined(WEBRTC_POSIX)
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+
 #include "examples/peerconnection/server/utils.h"
 #include "rtc_base/checks.h"
 
 static const char kHeaderTerminator[] = "\r\n\r\n";
 static const int kHeaderTerminatorLength = sizeof(kHeaderTerminator) - 1;
 
+#if defined(MSG_NOSIGNAL)
+// A peer that went away must not take the server down with SIGPIPE.
+static const int kSendFlags = MSG_NOSIGNAL;
+#else
+static const int kSendFlags = 0;
+#endif
+
+static bool WouldBlock() {
+#if defined(WEBRTC_POSIX)
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+#else
+  return false;
+#endif
+}
+
 // static
 const char DataSocket::kCrossOriginAllowHeaders[] =
     "Access-Control-Allow-Origin: *\r\n"
@@ -57,6 +79,19 @@ bool SocketBase::Create() {
   return valid();
 }
 
+bool SocketBase::SetNonBlocking() {
+  RTC_DCHECK(valid());
+#if defined(WEBRTC_POSIX)
+  int flags = fcntl(socket_, F_GETFL, 0);
+  if (flags == -1 || fcntl(socket_, F_SETFL, flags | O_NONBLOCK) == -1)
+    return false;
+  nonblocking_ = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
 void SocketBase::Close() {
   if (socket_ != INVALID_SOCKET) {
     closesocket(socket_);
@@ -85,45 +120,102 @@ bool DataSocket::PathEquals(const char* path) const {
 
 bool DataSocket::OnDataAvailable(bool* close_socket) {
   RTC_DCHECK(valid());
-  char buffer[0xfff] = {0};
-  int bytes = recv(socket_, buffer, sizeof(buffer), 0);
-  if (bytes == SOCKET_ERROR || bytes == 0) {
-    *close_socket = true;
+  // A keep-alive client only sends its next request once the previous one
+  // was answered, possibly while this socket was parked as a wait request.
+  if (response_sent_ && keep_alive_ && !NextRequest())
     return false;
-  }
-
-  *close_socket = false;
 
+  char buffer[0xfff] = {0};
   bool ret = true;
+  do {
+    int bytes = recv(socket_, buffer, sizeof(buffer), 0);
+    if (bytes == SOCKET_ERROR && nonblocking_ && WouldBlock())
+      break;
+    if (bytes == SOCKET_ERROR || bytes == 0) {
+      *close_socket = true;
+      return false;
+    }
+    *close_socket = false;
+    ret = Consume(buffer, bytes) && ret;
+  } while (nonblocking_);
+  return ret;
+}
+
+bool DataSocket::Consume(const char* buffer, size_t bytes) {
   if (headers_received()) {
-    if (method_ != POST) {
-      // unexpectedly received data.
-      ret = false;
-    } else {
-      data_.append(buffer, bytes);
+    if (method_ != POST || data_received()) {
+      // Only a keep-alive client may send ahead; anything else is
+      // unexpected.
+      if (!keep_alive_)
+        return false;
+      leftover_.append(buffer, bytes);
+      return true;
     }
+    data_.append(buffer, bytes);
   } else {
     request_headers_.append(buffer, bytes);
     size_t found = request_headers_.find(kHeaderTerminator);
-    if (found != std::string::npos) {
-      data_ = request_headers_.substr(found + kHeaderTerminatorLength);
-      request_headers_.resize(found + kHeaderTerminatorLength);
-      ret = ParseHeaders();
+    if (found == std::string::npos)
+      return true;
+    data_ = request_headers_.substr(found + kHeaderTerminatorLength);
+    request_headers_.resize(found + kHeaderTerminatorLength);
+    if (!ParseHeaders())
+      return false;
+  }
+  // Whatever follows this request's body belongs to the next one.
+  const size_t body_length = method_ == POST ? content_length_ : 0;
+  if (data_.length() > body_length) {
+    leftover_.append(data_, body_length, std::string::npos);
+    data_.resize(body_length);
+  }
+  return true;
+}
+
+bool DataSocket::Send(const std::string& data) {
+  if (!nonblocking_ || outbox_.empty()) {
+    // Common case: nothing queued, so try to hand the data over directly.
+    size_t offset = 0;
+    while (offset < data.length()) {
+      int sent = send(socket_, data.data() + offset,
+                      static_cast<int>(data.length() - offset), kSendFlags);
+      if (sent == SOCKET_ERROR) {
+        if (nonblocking_ && WouldBlock())
+          break;
+        return false;
+      }
+      offset += sent;
     }
+    if (offset == data.length())
+      return true;
+    outbox_.append(data, offset, std::string::npos);
+    return true;
   }
-  return ret;
+  outbox_ += data;
+  return Flush();
 }
 
-bool DataSocket::Send(const std::string& data) const {
-  return send(socket_, data.data(), static_cast<int>(data.length()), 0) !=
-         SOCKET_ERROR;
+bool DataSocket::Flush() {
+  size_t offset = 0;
+  while (offset < outbox_.length()) {
+    int sent = send(socket_, outbox_.data() + offset,
+                    static_cast<int>(outbox_.length() - offset), kSendFlags);
+    if (sent == SOCKET_ERROR) {
+      if (nonblocking_ && WouldBlock())
+        break;
+      outbox_.clear();
+      return false;
+    }
+    offset += sent;
+  }
+  outbox_.erase(0, offset);
+  return true;
 }
 
 bool DataSocket::Send(const std::string& status,
                       bool connection_close,
                       const std::string& content_type,
                       const std::string& extra_headers,
-                      const std::string& data) const {
+                      const std::string& data) {
   RTC_DCHECK(valid());
   RTC_DCHECK(!status.empty());
   std::string buffer("HTTP/1.1 " + status + "\r\n");
@@ -132,8 +224,11 @@ bool DataSocket::Send(const std::string& status,
       "Server: PeerConnectionTestServer/0.1\r\n"
       "Cache-Control: no-cache\r\n";
 
+  connection_close = connection_close && !keep_alive_;
   if (connection_close)
     buffer += "Connection: close\r\n";
+  else
+    buffer += "Connection: keep-alive\r\n";
 
   if (!content_type.empty())
     buffer += "Content-Type: " + content_type + "\r\n";
@@ -151,6 +246,8 @@ bool DataSocket::Send(const std::string& status,
   buffer += "\r\n";
   buffer += data;
 
+  response_sent_ = true;
+  close_when_flushed_ = connection_close;
   return Send(buffer);
 }
 
@@ -161,6 +258,17 @@ void DataSocket::Clear() {
   request_path_.clear();
   request_headers_.clear();
   data_.clear();
+  keep_alive_ = false;
+  response_sent_ = false;
+  close_when_flushed_ = false;
+}
+
+bool DataSocket::NextRequest() {
+  RTC_DCHECK(keep_alive_);
+  std::string pending;
+  pending.swap(leftover_);
+  Clear();
+  return pending.empty() || Consume(pending.data(), pending.length());
 }
 
 bool DataSocket::ParseHeaders() {
@@ -173,6 +281,8 @@ bool DataSocket::ParseHeaders() {
   if (!ParseMethodAndPath(request_headers_.data(), i))
     return false;
 
+  ParseConnection(request_headers_.data(), i);
+
   RTC_DCHECK_NE(method_, INVALID);
   RTC_DCHECK(!request_path_.empty());
 
@@ -261,6 +371,28 @@ bool DataSocket::ParseContentLengthAndType(const char* headers, size_t length) {
   return !content_type_.empty() && content_length_ != 0;
 }
 
+void DataSocket::ParseConnection(const char* request_line, size_t len) {
+  static const char kHttp11[] = "HTTP/1.1";
+  const std::string line(request_line, len);
+  keep_alive_ = line.find(kHttp11) != std::string::npos;
+
+  std::string headers(request_headers_, len);
+  std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+  static const char kConnection[] = "\r\nconnection:";
+  size_t found = headers.find(kConnection);
+  if (found == std::string::npos)
+    return;
+  size_t end = headers.find("\r\n", found + 2);
+  const std::string value = headers.substr(
+      found + ARRAYSIZE(kConnection) - 1,
+      end == std::string::npos ? std::string::npos
+                               : end - found - ARRAYSIZE(kConnection) + 1);
+  if (value.find("close") != std::string::npos)
+    keep_alive_ = false;
+  else if (value.find("keep-alive") != std::string::npos)
+    keep_alive_ = true;
+}
+
 //
 // ListeningSocket
 //
@@ -283,7 +415,8 @@ bool ListeningSocket::Listen(unsigned short port) {
     printf("bind failed\n");
     return false;
   }
-  return listen(socket_, 5) != SOCKET_ERROR;
+  // Room for a burst of test clients signing in at once.
+  return listen(socket_, SOMAXCONN) != SOCKET_ERROR;
 }
 
 DataSocket* ListeningSocket::Accept() const {
@@ -295,5 +428,11 @@ DataSocket* ListeningSocket::Accept() const {
   if (client == INVALID_SOCKET)
     return NULL;
 
+#if defined(WEBRTC_POSIX)
+  // Responses are small and connections are reused, so Nagle would only
+  // hold them back waiting for an ACK.
+  int enabled = 1;
+  setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+#endif
   return new DataSocket(client);
 }
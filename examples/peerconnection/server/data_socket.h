@@ -36,20 +36,27 @@ typedef int NativeSocket;
 
 class SocketBase {
  public:
-  SocketBase() : socket_(INVALID_SOCKET) {}
-  explicit SocketBase(NativeSocket socket) : socket_(socket) {}
+  SocketBase() : socket_(INVALID_SOCKET), nonblocking_(false) {}
+  explicit SocketBase(NativeSocket socket)
+      : socket_(socket), nonblocking_(false) {}
   SocketBase(SocketBase& other) = delete;
   SocketBase& operator=(const SocketBase& other) = delete;
   ~SocketBase() { Close(); }
 
   NativeSocket socket() const { return socket_; }
   bool valid() const { return socket_ != INVALID_SOCKET; }
+  bool nonblocking() const { return nonblocking_; }
 
   bool Create();
   void Close();
 
+  // Makes send/recv/accept return immediately instead of blocking; needed
+  // for sockets driven by an edge-triggered event loop. POSIX only.
+  bool SetNonBlocking();
+
  protected:
   NativeSocket socket_;
+  bool nonblocking_;
 };
 
 // Represents an HTTP server socket.
@@ -63,7 +70,12 @@ class DataSocket : public SocketBase {
   };
 
   explicit DataSocket(NativeSocket socket)
-      : SocketBase(socket), method_(INVALID), content_length_(0) {}
+      : SocketBase(socket),
+        method_(INVALID),
+        content_length_(0),
+        keep_alive_(false),
+        response_sent_(false),
+        close_when_flushed_(false) {}
 
   ~DataSocket() {}
 
@@ -90,20 +102,42 @@ class DataSocket : public SocketBase {
     return method_ != POST || data_.length() >= content_length_;
   }
 
+  // True for HTTP/1.1 requests without "Connection: close" and for HTTP/1.0
+  // requests with "Connection: keep-alive". Such connections are reused for
+  // further requests after the response instead of being closed. The
+  // bundled peerconnection_client sends HTTP/1.0 without keep-alive: it
+  // learns that a request completed from the connection closing.
+  bool keep_alive() const { return keep_alive_; }
+
+  // Set once a response to the current request has been queued.
+  bool response_sent() const { return response_sent_; }
+
+  // Set when the response was sent with "Connection: close"; the socket is
+  // to be closed once its output has been flushed.
+  bool close_when_flushed() const { return close_when_flushed_; }
+
+  bool has_pending_output() const { return !outbox_.empty(); }
+
   // Checks if the request path (minus arguments) matches a given path.
   bool PathEquals(const char* path) const;
 
-  // Called when we have received some data from clients.
+  // Called when we have received some data from clients. In non-blocking
+  // mode this reads until the socket is drained.
   // Returns false if an error occurred.
   bool OnDataAvailable(bool* close_socket);
 
-  // Send a raw buffer of bytes.
-  bool Send(const std::string& data) const;
+  // Send a raw buffer of bytes. In non-blocking mode whatever the socket does
+  // not take right away is kept for `Flush()`.
+  bool Send(const std::string& data);
+
+  // Writes buffered output. Returns false on a socket error.
+  bool Flush();
 
   // Send an HTTP response.  The `status` should start with a valid HTTP
   // response code, followed by a string.  E.g. "200 OK".
-  // If `connection_close` is set to true, an extra "Connection: close" HTTP
-  // header will be included.  `content_type` is the mime content type, not
+  // If `connection_close` is set to true and the request did not ask for a
+  // persistent connection, an extra "Connection: close" HTTP header will be
+  // included.  `content_type` is the mime content type, not
   // including the "Content-Type: " string.
   // `extra_headers` should be either empty or a list of headers where each
   // header terminates with "\r\n".
@@ -113,11 +147,16 @@ class DataSocket : public SocketBase {
             bool connection_close,
             const std::string& content_type,
             const std::string& extra_headers,
-            const std::string& data) const;
+            const std::string& data);
 
   // Clears all held state and prepares the socket for receiving a new request.
   void Clear();
 
+  // For keep-alive connections: clears the handled request and parses any
+  // bytes of the next one that already arrived behind it.
+  // Returns false if those bytes are not a valid request.
+  bool NextRequest();
+
  protected:
   // A fairly relaxed HTTP header parser.  Parses the method, path and
   // content length (POST only) of a request.
@@ -131,6 +170,12 @@ class DataSocket : public SocketBase {
   // Determines the length of the body and it's mime type.
   bool ParseContentLengthAndType(const char* headers, size_t length);
 
+  // Decides `keep_alive_` from the request line and Connection header.
+  void ParseConnection(const char* request_line, size_t len);
+
+  // Feeds received bytes into the request parser.
+  bool Consume(const char* data, size_t len);
+
  protected:
   RequestMethod method_;
   size_t content_length_;
@@ -138,6 +183,12 @@ class DataSocket : public SocketBase {
   std::string request_path_;
   std::string request_headers_;
   std::string data_;
+  // Bytes received after the end of the current request.
+  std::string leftover_;
+  std::string outbox_;
+  bool keep_alive_;
+  bool response_sent_;
+  bool close_when_flushed_;
 };
 
 // The server socket.  Accepts connections and generates DataSocket instances
@@ -147,6 +198,8 @@ class ListeningSocket : public SocketBase {
   ListeningSocket() {}
 
   bool Listen(unsigned short port);
+  // Returns NULL when no connection is pending. Accepted sockets inherit
+  // nothing from the listener; callers pick their blocking mode.
   DataSocket* Accept() const;
 };
 
@@ -13,9 +13,16 @@
 #if defined(WEBRTC_POSIX)
 #include <sys/select.h>
 #endif
+#if defined(WEBRTC_LINUX)
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
 #include <time.h>
 
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "absl/flags/flag.h"
@@ -38,8 +45,6 @@ ABSL_FLAG(
     "trials are separated by \"/\"");
 ABSL_FLAG(int, port, 8888, "default: 8888");
 
-static const size_t kMaxConnections = (FD_SETSIZE - 2);
-
 void HandleBrowserRequest(DataSocket* ds, bool* quit) {
   RTC_DCHECK(ds && ds->valid());
   RTC_DCHECK(quit);
@@ -65,45 +70,194 @@ void HandleBrowserRequest(DataSocket* ds, bool* quit) {
   }
 }
 
-int main(int argc, char* argv[]) {
-  absl::SetProgramUsageMessage(
-      "Example usage: ./peerconnection_server --port=8888\n");
-  absl::ParseCommandLine(argc, argv);
+// Dispatches the complete request held by `s`. Returns false when `s` is
+// done and should be closed once its response has been flushed.
+bool HandleRequest(PeerChannel* clients, DataSocket* s, bool* quit) {
+  ChannelMember* member = clients->Lookup(s);
+  if (member || PeerChannel::IsPeerConnection(s)) {
+    if (!member) {
+      if (s->PathEquals("/sign_in")) {
+        clients->AddMember(s);
+      } else {
+        printf("No member found for: %s\n", s->request_path().c_str());
+        s->Send("500 Error", true, "text/plain", "",
+                "Peer most likely gone.");
+      }
+    } else if (member->is_wait_request(s)) {
+      // no need to do anything.
+      return true;
+    } else {
+      ChannelMember* target = clients->IsTargetedRequest(s);
+      if (target) {
+        member->ForwardRequestToPeer(s, target);
+      } else if (s->PathEquals("/sign_out")) {
+        s->Send("200 OK", true, "text/plain", "", "");
+        // A keep-alive socket may stay open, so the member cannot wait for
+        // it to close before leaving the channel.
+        if (s->keep_alive())
+          clients->OnClosing(s);
+      } else {
+        printf("Couldn't find target for request: %s\n",
+               s->request_path().c_str());
+        s->Send("500 Error", true, "text/plain", "",
+                "Peer most likely gone.");
+      }
+    }
+  } else {
+    HandleBrowserRequest(s, quit);
+  }
+  return s->keep_alive();
+}
 
-  // InitFieldTrialsFromString stores the char*, so the char array must outlive
-  // the application.
-  const std::string force_field_trials = absl::GetFlag(FLAGS_force_fieldtrials);
-  webrtc::field_trial::InitFieldTrialsFromString(force_field_trials.c_str());
+// Handles everything that arrived on `s`, including further requests a
+// keep-alive client sent behind the first. Returns false when `s` should
+// be closed once its output has been flushed.
+bool OnSocketReadable(PeerChannel* clients, DataSocket* s, bool* quit) {
+  bool close_socket = true;
+  if (!s->OnDataAvailable(&close_socket))
+    return false;
+  while (s->request_received()) {
+    if (!HandleRequest(clients, s, quit))
+      return false;
+    // Parked as a wait request, or answered and about to be closed.
+    if (!s->response_sent() || !s->keep_alive())
+      break;
+    if (!s->NextRequest())
+      return false;
+  }
+  return true;
+}
 
-  int port = absl::GetFlag(FLAGS_port);
+#if defined(WEBRTC_LINUX)
 
-  // Abort if the user specifies a port that is outside the allowed
-  // range [1, 65535].
-  if ((port < 1) || (port > 65535)) {
-    printf("Error: %i is not a valid port.\n", port);
-    return -1;
+// Raises the open file limit to the hard limit; each client holds one or
+// two sockets.
+void RaiseFileLimit() {
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+      limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
   }
+}
 
-  ListeningSocket listener;
-  if (!listener.Create()) {
-    printf("Failed to create server socket\n");
+// Edge-triggered epoll loop. Every socket is non-blocking and registered
+// once for input and output; a read drains the socket and an output event
+// flushes whatever Send() could not write at once. There is no connection
+// cap beyond the process file limit.
+int RunEpollLoop(ListeningSocket* listener, PeerChannel* clients) {
+  RaiseFileLimit();
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd == -1 || !listener->SetNonBlocking()) {
+    printf("Failed to set up epoll\n");
     return -1;
-  } else if (!listener.Listen(port)) {
-    printf("Failed to listen on server socket\n");
+  }
+  struct epoll_event event = {};
+  event.events = EPOLLIN | EPOLLET;
+  event.data.ptr = listener;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener->socket(), &event) == -1) {
+    printf("Failed to add the listening socket to epoll\n");
+    close(epoll_fd);
     return -1;
   }
 
-  printf("Server listening on port %i\n", port);
+  std::unordered_set<DataSocket*> sockets;
+  auto close_socket = [&](DataSocket* s) {
+    clients->OnClosing(s);
+    RTC_DCHECK(s->valid());  // Close must not have been called yet.
+    sockets.erase(s);
+    delete s;  // Closing the descriptor also removes it from the epoll set.
+  };
 
-  PeerChannel clients;
+  static const int kMaxEvents = 256;
+  struct epoll_event events[kMaxEvents];
+  time_t last_timeout_check = time(NULL);
+  bool quit = false;
+  while (!quit) {
+    int count = epoll_wait(epoll_fd, events, kMaxEvents, 10 * 1000);
+    if (count == -1) {
+      if (errno == EINTR)
+        continue;
+      printf("epoll_wait failed\n");
+      break;
+    }
+
+    for (int i = 0; i < count && !quit; ++i) {
+      if (events[i].data.ptr == listener) {
+        while (DataSocket* s = listener->Accept()) {
+          if (!s->SetNonBlocking()) {
+            delete s;
+            continue;
+          }
+          struct epoll_event socket_event = {};
+          socket_event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+          socket_event.data.ptr = s;
+          if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, s->socket(), &socket_event) ==
+              -1) {
+            // Never reported, so it would never be read or closed.
+            printf("Failed to add a connection to epoll\n");
+            delete s;
+            continue;
+          }
+          sockets.insert(s);
+        }
+        continue;
+      }
+
+      DataSocket* s = static_cast<DataSocket*>(events[i].data.ptr);
+      bool keep = true;
+      if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        keep = OnSocketReadable(clients, s, &quit);
+      if (keep && (events[i].events & EPOLLOUT))
+        keep = s->Flush();
+      if (keep && s->close_when_flushed() && !s->has_pending_output() &&
+          s->response_sent()) {
+        keep = false;
+      }
+      if (!keep && s->has_pending_output() && s->Flush() &&
+          s->has_pending_output()) {
+        // Let the rest drain; the next output event closes it.
+        continue;
+      }
+      if (!keep)
+        close_socket(s);
+    }
+
+    if (quit) {
+      printf("Quitting...\n");
+      listener->Close();
+      clients->CloseAll();
+    }
+
+    // Timeouts are in whole seconds, so once a second is enough even when
+    // the loop is busy.
+    time_t now = time(NULL);
+    if (now != last_timeout_check) {
+      clients->CheckForTimeout();
+      last_timeout_check = now;
+    }
+  }
+
+  for (DataSocket* s : sockets)
+    delete s;
+  sockets.clear();
+  close(epoll_fd);
+  return 0;
+}
+
+#else  // !defined(WEBRTC_LINUX)
+
+static const size_t kMaxConnections = (FD_SETSIZE - 2);
+
+int RunSelectLoop(ListeningSocket* listener, PeerChannel* clients) {
   typedef std::vector<DataSocket*> SocketArray;
   SocketArray sockets;
   bool quit = false;
   while (!quit) {
     fd_set socket_set;
     FD_ZERO(&socket_set);
-    if (listener.valid())
-      FD_SET(listener.socket(), &socket_set);
+    if (listener->valid())
+      FD_SET(listener->socket(), &socket_set);
 
     for (SocketArray::iterator i = sockets.begin(); i != sockets.end(); ++i)
       FD_SET((*i)->socket(), &socket_set);
@@ -116,52 +270,20 @@ int main(int argc, char* argv[]) {
 
     for (SocketArray::iterator i = sockets.begin(); i != sockets.end(); ++i) {
       DataSocket* s = *i;
-      bool socket_done = true;
+      bool socket_done = false;
       if (FD_ISSET(s->socket(), &socket_set)) {
-        if (s->OnDataAvailable(&socket_done) && s->request_received()) {
-          ChannelMember* member = clients.Lookup(s);
-          if (member || PeerChannel::IsPeerConnection(s)) {
-            if (!member) {
-              if (s->PathEquals("/sign_in")) {
-                clients.AddMember(s);
-              } else {
-                printf("No member found for: %s\n", s->request_path().c_str());
-                s->Send("500 Error", true, "text/plain", "",
-                        "Peer most likely gone.");
-              }
-            } else if (member->is_wait_request(s)) {
-              // no need to do anything.
-              socket_done = false;
-            } else {
-              ChannelMember* target = clients.IsTargetedRequest(s);
-              if (target) {
-                member->ForwardRequestToPeer(s, target);
-              } else if (s->PathEquals("/sign_out")) {
-                s->Send("200 OK", true, "text/plain", "", "");
-              } else {
-                printf("Couldn't find target for request: %s\n",
-                       s->request_path().c_str());
-                s->Send("500 Error", true, "text/plain", "",
-                        "Peer most likely gone.");
-              }
-            }
-          } else {
-            HandleBrowserRequest(s, &quit);
-            if (quit) {
-              printf("Quitting...\n");
-              FD_CLR(listener.socket(), &socket_set);
-              listener.Close();
-              clients.CloseAll();
-            }
-          }
+        socket_done = !OnSocketReadable(clients, s, &quit);
+        if (quit) {
+          printf("Quitting...\n");
+          FD_CLR(listener->socket(), &socket_set);
+          listener->Close();
+          clients->CloseAll();
         }
-      } else {
-        socket_done = false;
       }
 
       if (socket_done) {
         printf("Disconnecting socket\n");
-        clients.OnClosing(s);
+        clients->OnClosing(s);
         RTC_DCHECK(s->valid());  // Close must not have been called yet.
         FD_CLR(s->socket(), &socket_set);
         delete (*i);
@@ -171,10 +293,10 @@ int main(int argc, char* argv[]) {
       }
     }
 
-    clients.CheckForTimeout();
+    clients->CheckForTimeout();
 
-    if (FD_ISSET(listener.socket(), &socket_set)) {
-      DataSocket* s = listener.Accept();
+    if (FD_ISSET(listener->socket(), &socket_set)) {
+      DataSocket* s = listener->Accept();
       if (sockets.size() >= kMaxConnections) {
         delete s;  // sorry, that's all we can take.
         printf("Connection limit reached\n");
@@ -191,3 +313,43 @@ int main(int argc, char* argv[]) {
 
   return 0;
 }
+
+#endif  // defined(WEBRTC_LINUX)
+
+int main(int argc, char* argv[]) {
+  absl::SetProgramUsageMessage(
+      "Example usage: ./peerconnection_server --port=8888\n");
+  absl::ParseCommandLine(argc, argv);
+
+  // InitFieldTrialsFromString stores the char*, so the char array must outlive
+  // the application.
+  const std::string force_field_trials = absl::GetFlag(FLAGS_force_fieldtrials);
+  webrtc::field_trial::InitFieldTrialsFromString(force_field_trials.c_str());
+
+  int port = absl::GetFlag(FLAGS_port);
+
+  // Abort if the user specifies a port that is outside the allowed
+  // range [1, 65535].
+  if ((port < 1) || (port > 65535)) {
+    printf("Error: %i is not a valid port.\n", port);
+    return -1;
+  }
+
+  ListeningSocket listener;
+  if (!listener.Create()) {
+    printf("Failed to create server socket\n");
+    return -1;
+  } else if (!listener.Listen(port)) {
+    printf("Failed to listen on server socket\n");
+    return -1;
+  }
+
+  printf("Server listening on port %i\n", port);
+
+  PeerChannel clients;
+#if defined(WEBRTC_LINUX)
+  return RunEpollLoop(&listener, &clients);
+#else
+  return RunSelectLoop(&listener, &clients);
+#endif
+}
@@ -46,6 +46,8 @@ enum RequestPathIndex {
 
 const size_t kMaxNameLength = 512;
 
+static const char kBatchArgument[] = "batch=1";
+
 //
 // ChannelMember
 //
@@ -150,7 +152,11 @@ void ChannelMember::QueueResponse(const std::string& status,
 
 void ChannelMember::SetWaitingSocket(DataSocket* ds) {
   RTC_DCHECK_EQ(ds->method(), DataSocket::GET);
-  if (ds && !queue_.empty()) {
+  if (ds && queue_.size() > 1 &&
+      ds->request_arguments().find(kBatchArgument) != std::string::npos) {
+    RTC_DCHECK(!waiting_socket_);
+    SendBatch(ds);
+  } else if (ds && !queue_.empty()) {
     RTC_DCHECK(!waiting_socket_);
     const QueuedResponse& response = queue_.front();
     ds->Send(response.status, true, response.content_type,
@@ -161,6 +167,23 @@ void ChannelMember::SetWaitingSocket(DataSocket* ds) {
   }
 }
 
+void ChannelMember::SendBatch(DataSocket* ds) {
+  std::string body;
+  const size_t count = queue_.size();
+  while (!queue_.empty()) {
+    const QueuedResponse& response = queue_.front();
+    body += response.extra_headers;
+    if (!response.content_type.empty())
+      body += "Content-Type: " + response.content_type + "\r\n";
+    body += "Content-Length: " +
+            int2str(static_cast<int>(response.data.size())) + "\r\n\r\n";
+    body += response.data;
+    queue_.pop();
+  }
+  ds->Send("200 OK", true, "multipart/x-peer-batch",
+           "X-Batch-Count: " + size_t2str(count) + "\r\n", body);
+}
+
 //
 // PeerChannel
 //
@@ -194,18 +217,19 @@ ChannelMember* PeerChannel::Lookup(DataSocket* ds) const {
     return NULL;
 
   int id = atoi(&args[found + ARRAYSIZE(kPeerId) - 1]);
-  Members::const_iterator iter = members_.begin();
-  for (; iter != members_.end(); ++iter) {
-    if (id == (*iter)->id()) {
-      if (i == kWait)
-        (*iter)->SetWaitingSocket(ds);
-      if (i == kSignOut)
-        (*iter)->set_disconnected();
-      return *iter;
-    }
-  }
+  ChannelMember* member = FindMember(id);
+  if (!member)
+    return NULL;
+  if (i == kWait)
+    member->SetWaitingSocket(ds);
+  if (i == kSignOut)
+    member->set_disconnected();
+  return member;
+}
 
-  return NULL;
+ChannelMember* PeerChannel::FindMember(int id) const {
+  auto found = members_by_id_.find(id);
+  return found == members_by_id_.end() ? NULL : found->second;
 }
 
 ChannelMember* PeerChannel::IsTargetedRequest(const DataSocket* ds) const {
@@ -228,14 +252,7 @@ ChannelMember* PeerChannel::IsTargetedRequest(const DataSocket* ds) const {
     }
     args = found + ARRAYSIZE(kTargetPeerIdParam) - 1;
   } while (true);
-  int id = atoi(&path[found]);
-  Members::const_iterator i = members_.begin();
-  for (; i != members_.end(); ++i) {
-    if ((*i)->id() == id) {
-      return *i;
-    }
-  }
-  return NULL;
+  return FindMember(atoi(&path[found]));
 }
 
 bool PeerChannel::AddMember(DataSocket* ds) {
@@ -245,6 +262,7 @@ bool PeerChannel::AddMember(DataSocket* ds) {
   BroadcastChangedState(*new_guy, &failures);
   HandleDeliveryFailures(&failures);
   members_.push_back(new_guy);
+  members_by_id_[new_guy->id()] = new_guy;
 
   printf("New member added (total=%s): %s\n",
          size_t2str(members_.size()).c_str(), new_guy->name().c_str());
@@ -270,7 +288,7 @@ void PeerChannel::OnClosing(DataSocket* ds) {
     ChannelMember* m = (*i);
     m->OnClosing(ds);
     if (!m->connected()) {
-      i = members_.erase(i);
+      i = EraseMember(i);
       Members failures;
       BroadcastChangedState(*m, &failures);
       HandleDeliveryFailures(&failures);
@@ -288,7 +306,7 @@ void PeerChannel::CheckForTimeout() {
     if (m->TimedOut()) {
       printf("Timeout: %s\n", m->name().c_str());
       m->set_disconnected();
-      i = members_.erase(i);
+      i = EraseMember(i);
       Members failures;
       BroadcastChangedState(*m, &failures);
       HandleDeliveryFailures(&failures);
@@ -303,6 +321,12 @@ void PeerChannel::DeleteAll() {
   for (Members::iterator i = members_.begin(); i != members_.end(); ++i)
     delete (*i);
   members_.clear();
+  members_by_id_.clear();
+}
+
+PeerChannel::Members::iterator PeerChannel::EraseMember(Members::iterator i) {
+  members_by_id_.erase((*i)->id());
+  return members_.erase(i);
 }
 
 void PeerChannel::BroadcastChangedState(const ChannelMember& member,
@@ -320,7 +344,7 @@ void PeerChannel::BroadcastChangedState(const ChannelMember& member,
       if (!(*i)->NotifyOfOtherMember(member)) {
         (*i)->set_disconnected();
         delivery_failures->push_back(*i);
-        i = members_.erase(i);
+        i = EraseMember(i);
         if (i == members_.end())
           break;
       }
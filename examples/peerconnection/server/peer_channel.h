@@ -15,6 +15,7 @@
 
 #include <queue>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class DataSocket;
@@ -49,6 +50,9 @@ class ChannelMember {
                      const std::string& extra_headers,
                      const std::string& data);
 
+  // Answers `ds` from the queue if anything is pending, otherwise parks it
+  // until the next QueueResponse(). A wait request carrying "batch=1" gets
+  // every queued message in one response (see SendBatch()).
   void SetWaitingSocket(DataSocket* ds);
 
  protected:
@@ -56,6 +60,12 @@ class ChannelMember {
     std::string status, content_type, extra_headers, data;
   };
 
+  // Sends all queued messages as one "multipart/x-peer-batch" response.
+  // Each part is the message's own headers (including the Pragma peer id),
+  // Content-Type and Content-Length, a blank line and the body, so a client
+  // parses the parts exactly like consecutive single responses.
+  void SendBatch(DataSocket* ds);
+
   DataSocket* waiting_socket_;
   int id_;
   bool connected_;
@@ -83,6 +93,9 @@ class PeerChannel {
   // Finds a connected peer that's associated with the `ds` socket.
   ChannelMember* Lookup(DataSocket* ds) const;
 
+  // Returns the member with the given id, or NULL.
+  ChannelMember* FindMember(int id) const;
+
   // Checks if the request has a "peer_id" parameter and if so, looks up the
   // peer for which the request is targeted at.
   ChannelMember* IsTargetedRequest(const DataSocket* ds) const;
@@ -103,6 +116,8 @@ class PeerChannel {
 
  protected:
   void DeleteAll();
+  // Erases `i` from `members_` and the id index.
+  Members::iterator EraseMember(Members::iterator i);
   void BroadcastChangedState(const ChannelMember& member,
                              Members* delivery_failures);
   void HandleDeliveryFailures(Members* failures);
@@ -113,6 +128,9 @@ class PeerChannel {
 
  protected:
   Members members_;
+  // Index over `members_` so requests resolve their peer in O(1) with
+  // thousands of members signed in.
+  std::unordered_map<int, ChannelMember*> members_by_id_;
 };
 
 #endif  // EXAMPLES_PEERCONNECTION_SERVER_PEER_CHANNEL_H_
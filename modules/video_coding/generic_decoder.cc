@@ -265,6 +265,8 @@ void VCMDecodedFrameCallback::Decoded(VideoFrame& decodedImage,
 
   frame_timing.is_keyframe = (frame_info->frame_type == VideoFrameType::kVideoFrameKey);
   frame_timing.frame_type  = frame_info->frame_type;
+  frame_timing.timing_info = timing_frame_info;
+  frame_timing.qp = qp ? *qp : -1;
 
   // Set frame timing on decoded image
   decodedImage.set_frame_timing(frame_timing);
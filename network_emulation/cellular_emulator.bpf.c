@@ -1,57 +1,148 @@
 // cellular_emulator.bpf.c
 #include <linux/bpf.h>
-#include <bpf/bpf_helpers.h>
 #include <linux/if_ether.h>
+#include <linux/in.h>
+#include <linux/ip.h>
+#include <linux/pkt_cls.h>
+#include <linux/udp.h>
+#include <bpf/bpf_helpers.h>
 #include <bpf/bpf_endian.h>
 
-#define TC_ACT_OK 0
-#define MAX_PKT_SIZE 256  // Maximum number of packet bytes to capture
+#include "cellular_emulator.h"
 
-struct packet_data {
-    __u32 pkt_len;           // Full packet length
-    __u32 arrival_time_ms;   // Packet arrival time (in milliseconds)
-    __u8 data[MAX_PKT_SIZE]; // Snapshot of packet data (first MAX_PKT_SIZE bytes)
+#define NSEC_PER_SEC 1000000000ULL
+// Wake the consumer only once this much telemetry is waiting; it also
+// polls on a timeout, so a quiet link is still drained.
+#define RINGBUF_WAKEUP_BYTES (64 * sizeof(struct packet_record))
+
+struct link_state {
+    __u64 next_free_ns;  // when the emulated bottleneck is idle again
 };
 
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct shaper_config);
+} shaper_config_map SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct link_state);
+} link_state_map SEC(".maps");
+
 struct {
     __uint(type, BPF_MAP_TYPE_RINGBUF);
-    __uint(max_entries, 512 * 1024);  // Adjust the ring buffer size if needed
+    __uint(max_entries, 512 * 1024);
 } packet_ringbuf SEC(".maps");
 
 /*
- * This eBPF program is attached to the egress hook.
- * It captures every outgoing packet on the interface and copies up to MAX_PKT_SIZE bytes
- * along with some metadata into the ring buffer for userspace processing.
+ * Fills the 5-tuple and, for UDP that looks like RTP or RTCP, the SSRC and
+ * sequence number. Uses bpf_skb_load_bytes so non-linear skbs work too.
  */
-SEC("classifier/egress")
-int cellular_emulator(struct __sk_buff *skb) {
-    void *data = (void *)(long)skb->data;
-    void *data_end = (void *)(long)skb->data_end;
-    __u32 pkt_len = skb->len;
+static __always_inline void parse_packet(struct __sk_buff *skb,
+                                         struct packet_record *rec) {
+    struct iphdr ip;
+    struct udphdr udp;
+    __u8 rtp[12];
 
-    // Get current time in milliseconds.
-    __u32 arrival_time = (__u32)(bpf_ktime_get_ns() / 1000000);
+    if (skb->protocol != bpf_htons(ETH_P_IP))
+        return;
+    if (bpf_skb_load_bytes(skb, ETH_HLEN, &ip, sizeof(ip)) < 0)
+        return;
+    rec->saddr = ip.saddr;
+    rec->daddr = ip.daddr;
+    rec->protocol = ip.protocol;
+    if (ip.protocol != IPPROTO_UDP && ip.protocol != IPPROTO_TCP)
+        return;
 
-    // Reserve space in the ring buffer.
-    struct packet_data *pkt;
-    pkt = bpf_ringbuf_reserve(&packet_ringbuf, sizeof(*pkt), 0);
-    if (!pkt)
-        return TC_ACT_OK;
+    __u32 l4_offset = ETH_HLEN + ip.ihl * 4;
+    // Ports sit at the same offset in TCP and UDP.
+    if (bpf_skb_load_bytes(skb, l4_offset, &udp, sizeof(udp)) < 0)
+        return;
+    rec->sport = udp.source;
+    rec->dport = udp.dest;
+    if (ip.protocol != IPPROTO_UDP)
+        return;
+
+    if (bpf_skb_load_bytes(skb, l4_offset + sizeof(udp), rtp, sizeof(rtp)) < 0)
+        return;
+    if ((rtp[0] & 0xc0) != 0x80)
+        return;
+    // RFC 5761: RTCP packet types 192-223 collide with no RTP payload type
+    // in use.
+    if (rtp[1] >= 192 && rtp[1] <= 223) {
+        rec->flags |= PACKET_RECORD_RTCP;
+        rec->ssrc = ((__u32)rtp[4] << 24) | ((__u32)rtp[5] << 16) |
+                    ((__u32)rtp[6] << 8) | rtp[7];
+        return;
+    }
+    rec->flags |= PACKET_RECORD_RTP;
+    rec->rtp_seq = ((__u16)rtp[2] << 8) | rtp[3];
+    rec->ssrc = ((__u32)rtp[8] << 24) | ((__u32)rtp[9] << 16) |
+                ((__u32)rtp[10] << 8) | rtp[11];
+}
 
-    pkt->pkt_len = pkt_len;
-    pkt->arrival_time_ms = arrival_time;
+/*
+ * Attached to the egress hook under an fq root qdisc. Emulates the
+ * bottleneck with earliest departure times: each packet leaves once the
+ * link has serialized everything before it at the configured rate, plus the
+ * one-way delay. fq holds it until skb->tstamp, so nothing here sleeps or
+ * takes a qdisc lock. Every packet, dropped or not, yields a packet_record.
+ */
+SEC("tc")
+int cellular_emulator(struct __sk_buff *skb) {
+    __u32 key = 0;
+    struct shaper_config *cfg = bpf_map_lookup_elem(&shaper_config_map, &key);
+    struct link_state *state = bpf_map_lookup_elem(&link_state_map, &key);
+    if (!cfg || !state)
+        return TC_ACT_OK;
 
-    // Determine how many bytes to copy.
-    __u32 copy_size = pkt_len < MAX_PKT_SIZE ? pkt_len : MAX_PKT_SIZE;
-    if (data + copy_size > data_end)
-        copy_size = data_end - data;
+    __u64 now = bpf_ktime_get_ns();
+    __u64 departure = now;
+    int verdict = TC_ACT_OK;
 
-    // Copy packet data into the ring buffer.
-    bpf_probe_read(pkt->data, copy_size, data);
+    if (cfg->rate_bytes_per_sec > 0) {
+        __u64 start = state->next_free_ns;
+        if (start < now)
+            start = now;
+        if (cfg->max_backlog_ns && start - now > cfg->max_backlog_ns) {
+            verdict = TC_ACT_SHOT;
+        } else {
+            departure = start + (__u64)skb->len * NSEC_PER_SEC /
+                                    cfg->rate_bytes_per_sec;
+            // Racy across CPUs, as in other EDT shapers; a lost update only
+            // lets one packet through early.
+            state->next_free_ns = departure;
+        }
+    }
+    if (verdict == TC_ACT_OK) {
+        departure += cfg->delay_ns;
+        if (departure > now)
+            skb->tstamp = departure;
+    }
 
-    bpf_ringbuf_submit(pkt, 0);
+    struct packet_record *rec =
+        bpf_ringbuf_reserve(&packet_ringbuf, sizeof(*rec), 0);
+    if (!rec)
+        return verdict;
+    __builtin_memset(rec, 0, sizeof(*rec));
+    rec->arrival_ns = now;
+    rec->len = skb->len;
+    if (verdict == TC_ACT_OK)
+        rec->departure_ns = departure;
+    else
+        rec->flags |= PACKET_RECORD_DROPPED;
+    parse_packet(skb, rec);
 
-    return TC_ACT_OK;
+    __u64 wakeup = bpf_ringbuf_query(&packet_ringbuf, BPF_RB_AVAIL_DATA) >=
+                           RINGBUF_WAKEUP_BYTES
+                       ? BPF_RB_FORCE_WAKEUP
+                       : BPF_RB_NO_WAKEUP;
+    bpf_ringbuf_submit(rec, wakeup);
+    return verdict;
 }
 
 char LICENSE[] SEC("license") = "GPL";
@@ -0,0 +1,38 @@
+// cellular_emulator.h
+// Layout shared by cellular_emulator.bpf.c and its loader in EbpfShaper.
+#ifndef CELLULAR_EMULATOR_H_
+#define CELLULAR_EMULATOR_H_
+
+#include <linux/types.h>
+
+// Single entry of shaper_config_map, rewritten by userspace on every trace
+// step.
+struct shaper_config {
+    __u64 rate_bytes_per_sec;  // 0 leaves the rate unlimited
+    __u64 delay_ns;            // added to every packet's departure time
+    __u64 max_backlog_ns;      // drop once the bottleneck is this far behind; 0 never
+};
+
+enum packet_record_flags {
+    PACKET_RECORD_RTP = 1 << 0,
+    PACKET_RECORD_RTCP = 1 << 1,
+    PACKET_RECORD_DROPPED = 1 << 2,
+};
+
+// One per egress packet, 40 bytes. Addresses and ports are in network
+// order, as on the wire.
+struct packet_record {
+    __u64 arrival_ns;    // CLOCK_MONOTONIC at the egress hook
+    __u64 departure_ns;  // skb->tstamp handed to fq, 0 if dropped
+    __u32 saddr;
+    __u32 daddr;
+    __u16 sport;
+    __u16 dport;
+    __u32 len;
+    __u32 ssrc;          // RTP SSRC, or the RTCP sender SSRC
+    __u16 rtp_seq;
+    __u8 protocol;
+    __u8 flags;          // packet_record_flags
+};
+
+#endif // CELLULAR_EMULATOR_H_
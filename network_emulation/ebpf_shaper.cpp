@@ -0,0 +1,251 @@
+#include "ebpf_shaper.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "../../logger/Logger.h"
+#include "cellular_emulator.h"
+
+#ifdef HAVE_LIBBPF
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+#include <net/if.h>
+
+#include "netns.h"
+
+static const char* EBPF_SHAPER_MODULE_NAME = "EBPF";
+
+namespace {
+
+constexpr char kProgramName[] = "cellular_emulator";
+constexpr int kDrainTimeoutMs = 10;
+
+struct TelemetryHeader {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t reserved;
+};
+
+std::string ErrorString(const char* what, int error) {
+    return std::string(what) + ": " + std::strerror(error < 0 ? -error : error);
+}
+
+}  // namespace
+
+EbpfShaper::~EbpfShaper() {
+    Close();
+}
+
+bool EbpfShaper::Open(const std::string& object_path, const std::string& netns,
+                      const std::string& interface_name,
+                      const std::string& telemetry_path) {
+    Close();
+
+    object_ = bpf_object__open_file(object_path.c_str(), nullptr);
+    if (!object_) {
+        last_error_ = ErrorString(("open " + object_path).c_str(), errno);
+        return false;
+    }
+    int error = bpf_object__load(object_);
+    if (error) {
+        last_error_ = ErrorString("bpf_object__load", error);
+        Close();
+        return false;
+    }
+    bpf_program* program =
+        bpf_object__find_program_by_name(object_, kProgramName);
+    bpf_map* config_map =
+        bpf_object__find_map_by_name(object_, "shaper_config_map");
+    bpf_map* ringbuf = bpf_object__find_map_by_name(object_, "packet_ringbuf");
+    if (!program || !config_map || !ringbuf) {
+        last_error_ = object_path + " is not a cellular_emulator object";
+        Close();
+        return false;
+    }
+    config_fd_ = bpf_map__fd(config_map);
+
+    // Unlimited until the first trace step.
+    const uint32_t key = 0;
+    shaper_config config = {};
+    bpf_map_update_elem(config_fd_, &key, &config, BPF_ANY);
+
+    // The tc hook is set up over rtnetlink, so it has to happen inside the
+    // namespace that owns the interface.
+    netns_ = netns;
+    std::string netns_error;
+    const int program_fd = bpf_program__fd(program);
+    bool entered = RunInNetns(netns, [&] {
+        ifindex_ = static_cast<int>(if_nametoindex(interface_name.c_str()));
+        if (ifindex_ == 0) {
+            error = -errno;
+            return;
+        }
+        bpf_tc_hook hook = {};
+        hook.sz = sizeof(hook);
+        hook.ifindex = ifindex_;
+        hook.attach_point = BPF_TC_EGRESS;
+        error = bpf_tc_hook_create(&hook);
+        if (error && error != -EEXIST)
+            return;
+        bpf_tc_opts options = {};
+        options.sz = sizeof(options);
+        options.prog_fd = program_fd;
+        options.handle = 1;
+        options.priority = 1;
+        options.flags = BPF_TC_F_REPLACE;
+        error = bpf_tc_attach(&hook, &options);
+    }, &netns_error);
+    if (!entered || error || ifindex_ == 0) {
+        last_error_ = entered ? ErrorString(("attach to " + interface_name).c_str(),
+                                            error)
+                              : netns_error;
+        Close();
+        return false;
+    }
+
+    if (!telemetry_path.empty()) {
+        telemetry_ = std::fopen(telemetry_path.c_str(), "wb");
+        if (!telemetry_) {
+            LOG_WARNING(EBPF_SHAPER_MODULE_NAME, "Cannot write ", telemetry_path,
+                        ", packet records are discarded");
+        } else {
+            TelemetryHeader header = {{'C', 'E', 'L', 'L', 'P', 'K', 'T', '1'},
+                                      sizeof(packet_record), 0};
+            std::fwrite(&header, sizeof(header), 1, telemetry_);
+        }
+    }
+    ring_ = ring_buffer__new(bpf_map__fd(ringbuf), &EbpfShaper::OnRecord, this,
+                             nullptr);
+    if (!ring_) {
+        last_error_ = ErrorString("ring_buffer__new", errno);
+        Close();
+        return false;
+    }
+    draining_ = true;
+    drain_thread_ = std::thread(&EbpfShaper::DrainLoop, this);
+
+    LOG_INFO(EBPF_SHAPER_MODULE_NAME, "Attached ", object_path, " to ",
+             interface_name, " egress");
+    return true;
+}
+
+void EbpfShaper::Close() {
+    if (draining_) {
+        draining_ = false;
+        drain_thread_.join();
+        // Whatever arrived after the last poll.
+        ring_buffer__consume(ring_);
+        LOG_INFO(EBPF_SHAPER_MODULE_NAME, "Drained ", records_,
+                 " packet records, ", dropped_packets_, " dropped packets");
+    }
+    if (ring_) {
+        ring_buffer__free(ring_);
+        ring_ = nullptr;
+    }
+    if (telemetry_) {
+        std::fclose(telemetry_);
+        telemetry_ = nullptr;
+    }
+    if (ifindex_ != 0) {
+        // Removes clsact and the program with it. Harmless if the namespace
+        // is already gone.
+        std::string ignored;
+        RunInNetns(netns_, [this] {
+            bpf_tc_hook hook = {};
+            hook.sz = sizeof(hook);
+            hook.ifindex = ifindex_;
+            hook.attach_point =
+                static_cast<bpf_tc_attach_point>(BPF_TC_INGRESS | BPF_TC_EGRESS);
+            bpf_tc_hook_destroy(&hook);
+        }, &ignored);
+        ifindex_ = 0;
+    }
+    if (object_) {
+        bpf_object__close(object_);
+        object_ = nullptr;
+    }
+    config_fd_ = -1;
+    records_ = 0;
+    dropped_packets_ = 0;
+}
+
+bool EbpfShaper::SetConditions(const Conditions& conditions,
+                               int64_t* elapsed_us) {
+    if (config_fd_ < 0) {
+        last_error_ = "not open";
+        return false;
+    }
+    shaper_config config = {};
+    config.rate_bytes_per_sec =
+        static_cast<uint64_t>(std::llround(conditions.rate_kbps * 1000.0 / 8.0));
+    config.delay_ns = static_cast<uint64_t>(std::llround(conditions.delay_ms * 1e6));
+    config.max_backlog_ns =
+        static_cast<uint64_t>(std::llround(conditions.max_backlog_ms * 1e6));
+
+    const uint32_t key = 0;
+    auto start = std::chrono::steady_clock::now();
+    int error = bpf_map_update_elem(config_fd_, &key, &config, BPF_ANY);
+    if (error) {
+        last_error_ = ErrorString("bpf_map_update_elem", error);
+        return false;
+    }
+    if (elapsed_us) {
+        *elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    }
+    return true;
+}
+
+int EbpfShaper::OnRecord(void* context, void* data, size_t size) {
+    auto* self = static_cast<EbpfShaper*>(context);
+    if (size < sizeof(packet_record))
+        return 0;
+    const auto* record = static_cast<const packet_record*>(data);
+    self->records_++;
+    if (record->flags & PACKET_RECORD_DROPPED)
+        self->dropped_packets_++;
+    if (self->telemetry_)
+        std::fwrite(record, sizeof(packet_record), 1, self->telemetry_);
+    return 0;
+}
+
+void EbpfShaper::DrainLoop() {
+    // The program only wakes us once a batch is waiting; the timeout picks
+    // up the tail when traffic is light.
+    while (draining_) {
+        int result = ring_buffer__poll(ring_, kDrainTimeoutMs);
+        if (result < 0 && result != -EINTR) {
+            LOG_ERROR(EBPF_SHAPER_MODULE_NAME, ErrorString("ring_buffer__poll", result));
+            break;
+        }
+    }
+}
+
+#else  // !HAVE_LIBBPF
+
+EbpfShaper::~EbpfShaper() = default;
+
+bool EbpfShaper::Open(const std::string&, const std::string&, const std::string&,
+                      const std::string&) {
+    last_error_ = "built without libbpf (make HAVE_LIBBPF=1)";
+    return false;
+}
+
+void EbpfShaper::Close() {}
+
+bool EbpfShaper::SetConditions(const Conditions&, int64_t*) {
+    last_error_ = "not open";
+    return false;
+}
+
+int EbpfShaper::OnRecord(void*, void*, size_t) {
+    return 0;
+}
+
+void EbpfShaper::DrainLoop() {}
+
+#endif  // HAVE_LIBBPF
@@ -0,0 +1,80 @@
+#ifndef EBPF_SHAPER_H_
+#define EBPF_SHAPER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+struct bpf_object;
+struct ring_buffer;
+
+// Loads cellular_emulator.bpf.o onto the egress hook of an interface and
+// drives it: each trace step is one update of shaper_config_map, and the
+// per-packet records from packet_ringbuf are drained in batches to a
+// telemetry file.
+//
+// The program only sets departure times; the interface's root qdisc must be
+// fq (NetlinkQdisc::SetFq()) for them to take effect. fq holds every packet
+// until its departure time, i.e. up to delay + max_backlog_ms worth of
+// traffic, nearly all in the one flow of a WebRTC call. Its packet limits
+// and horizon have to cover that: fq drops past them without the program
+// knowing, and the packet record still reads as departed.
+//
+// Without libbpf at build time (HAVE_LIBBPF unset) Open() always fails and
+// the emulator falls back to netem.
+//
+// Telemetry file, in host byte order: a 16-byte header ("CELLPKT1", the
+// record size as a u32, four reserved bytes) followed by packet_record
+// structs (cellular_emulator.h) in ring buffer order.
+class EbpfShaper {
+public:
+    struct Conditions {
+        double rate_kbps = 0;
+        double delay_ms = 0;
+        // Packets arriving when the bottleneck is further behind than this
+        // are dropped, like a full netem queue.
+        double max_backlog_ms = 1000;
+    };
+
+    EbpfShaper() = default;
+    ~EbpfShaper();
+
+    EbpfShaper(const EbpfShaper&) = delete;
+    EbpfShaper& operator=(const EbpfShaper&) = delete;
+
+    // Loads |object_path| and attaches it to the egress of |interface_name|
+    // in |netns|. An empty |telemetry_path| discards the records.
+    bool Open(const std::string& object_path, const std::string& netns,
+              const std::string& interface_name,
+              const std::string& telemetry_path);
+    void Close();
+    bool IsOpen() const { return object_ != nullptr; }
+
+    // One map update; |elapsed_us|, if set, is how long it took.
+    bool SetConditions(const Conditions& conditions,
+                       int64_t* elapsed_us = nullptr);
+
+    const std::string& LastError() const { return last_error_; }
+
+private:
+    static int OnRecord(void* context, void* data, size_t size);
+    void DrainLoop();
+
+    bpf_object* object_ = nullptr;
+    ring_buffer* ring_ = nullptr;
+    int config_fd_ = -1;
+    std::string netns_;
+    int ifindex_ = 0;
+
+    FILE* telemetry_ = nullptr;
+    std::atomic<bool> draining_{false};
+    std::thread drain_thread_;
+    uint64_t records_ = 0;
+    uint64_t dropped_packets_ = 0;
+
+    std::string last_error_;
+};
+
+#endif // EBPF_SHAPER_H_
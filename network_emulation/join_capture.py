@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""Splits per-frame network delay into where it was spent.
+
+Reads a PacketCapture file (network_emulator --capture_path), matches every
+RTP packet's departure at the sending-side tap with its arrival at the
+receiving-side tap, and groups packets into frames by (SSRC, RTP timestamp).
+For each frame:
+
+  wire_ms          last packet in - first packet out
+  propagation_ms   the smallest one-way packet delay seen in that direction
+                   (link delay plus fixed host overhead)
+  queueing_ms      extra delay of the frame's first packet over that floor
+  pacing_ms        how far the sender spread the frame's packets
+  serialization_ms how much longer the frame took to come out than to go
+                   in, i.e. the bottleneck draining it
+
+so wire_ms = propagation + queueing + pacing + serialization whenever the
+bottleneck, not the pacer, is the slower of the two.
+
+With --frames (per_frame_stats.csv or frame_metrics.csv, which carry
+rtp_timestamp and network_ms), endpoint_ms = network_ms - wire_ms is the
+part of the client's own network_ms that never showed up on the wire.
+
+The taps are on veth_ns and veth_host. Under the trace shaper they bracket
+the bottleneck in both directions. Under netem or the eBPF shaper the
+bottleneck is the qdisc on veth_ns egress, which that tap only sees
+afterwards, so uplink queueing would read as zero; pass the eBPF shaper's
+--ebpf_telemetry file via --ebpf to take uplink departures from its
+pre-qdisc arrival times instead.
+"""
+
+import argparse
+import collections
+import csv
+import math
+import statistics
+import struct
+import sys
+
+CAPTURE_HEADER = struct.Struct('=8sIIq')
+CAPTURE_TAP = struct.Struct('=16s')
+# CaptureRecord in packet_capture.h.
+CAPTURE_RECORD = struct.Struct('=QQIIIIHHHBB')
+KIND_MASK = 0x0f
+KIND_RTP = 1
+OUTGOING = 0x80
+
+EBPF_HEADER = struct.Struct('=8sII')
+# packet_record in cellular_emulator.h.
+EBPF_RECORD = struct.Struct('=QQIIHHIIHBB')
+EBPF_RTP = 1 << 0
+EBPF_DROPPED = 1 << 2
+
+
+def ReadCapture(path):
+  with open(path, 'rb') as f:
+    data = f.read()
+  magic, record_size, tap_count, realtime_offset_ns = (
+      CAPTURE_HEADER.unpack_from(data, 0))
+  if magic != b'PKTCAP01' or record_size != CAPTURE_RECORD.size:
+    sys.exit('%s is not a packet capture' % path)
+  offset = CAPTURE_HEADER.size
+  taps = []
+  for _ in range(tap_count):
+    (name,) = CAPTURE_TAP.unpack_from(data, offset)
+    taps.append(name.rstrip(b'\0').decode())
+    offset += CAPTURE_TAP.size
+  body = data[offset:]
+  # A capture cut short by a crash may end in a partial record.
+  body = body[:len(body) - len(body) % CAPTURE_RECORD.size]
+  return taps, realtime_offset_ns, list(CAPTURE_RECORD.iter_unpack(body))
+
+
+def ReadEbpfDepartures(path, realtime_offset_ns):
+  """Maps (ssrc, seq) to pre-qdisc times, in capture (realtime) ns."""
+  with open(path, 'rb') as f:
+    data = f.read()
+  magic, record_size, _ = EBPF_HEADER.unpack_from(data, 0)
+  if magic != b'CELLPKT1' or record_size != EBPF_RECORD.size:
+    sys.exit('%s is not eBPF shaper telemetry' % path)
+  body = data[EBPF_HEADER.size:]
+  body = body[:len(body) - len(body) % EBPF_RECORD.size]
+  departures = collections.defaultdict(collections.deque)
+  for (arrival_ns, _, _, _, _, _, _, ssrc, seq, _,
+       flags) in EBPF_RECORD.iter_unpack(body):
+    if flags & EBPF_RTP and not flags & EBPF_DROPPED:
+      departures[(ssrc, seq)].append(arrival_ns + realtime_offset_ns)
+  return departures
+
+
+class Frame:
+
+  def __init__(self, ssrc, rtp_timestamp, direction):
+    self.ssrc = ssrc
+    self.rtp_timestamp = rtp_timestamp
+    self.direction = direction
+    self.sends = []
+    self.receives = []
+    self.bytes = 0
+    self.lost = 0
+
+
+def JoinPackets(taps, records, ebpf_departures):
+  """Returns frames and the per-direction propagation floor in ns."""
+  # Outgoing sightings waiting for their arrival, per (ssrc, seq).
+  pending = collections.defaultdict(collections.deque)
+  frames = {}
+  floor_ns = {}
+  for (timestamp_ns, seq, ssrc, rtp_timestamp, _, _, _, _, length, tap,
+       flags) in sorted(records):
+    if flags & KIND_MASK != KIND_RTP:
+      continue
+    key = (ssrc, seq)
+    if flags & OUTGOING:
+      send_ns = timestamp_ns
+      early = ebpf_departures.get(key)
+      if early:
+        send_ns = min(send_ns, early.popleft())
+      pending[key].append((send_ns, tap, rtp_timestamp, length))
+      continue
+    if not pending[key]:
+      continue
+    send_ns, send_tap, rtp_timestamp, length = pending[key].popleft()
+    if send_tap == tap:
+      continue
+    direction = '%s->%s' % (taps[send_tap], taps[tap])
+    frame_key = (ssrc, rtp_timestamp)
+    frame = frames.get(frame_key)
+    if frame is None:
+      frame = frames[frame_key] = Frame(ssrc, rtp_timestamp, direction)
+    frame.sends.append(send_ns)
+    frame.receives.append(timestamp_ns)
+    frame.bytes += length
+    delay_ns = timestamp_ns - send_ns
+    floor_ns[direction] = min(floor_ns.get(direction, delay_ns), delay_ns)
+
+  # Whatever never arrived was lost (or is still in flight at the end).
+  for key, sends in pending.items():
+    for _, _, rtp_timestamp, _ in sends:
+      frame = frames.get((key[0], rtp_timestamp))
+      if frame:
+        frame.lost += 1
+  return frames, floor_ns
+
+
+def ReadFrameLog(path):
+  network_ms = {}
+  with open(path, newline='') as f:
+    for row in csv.DictReader(f):
+      try:
+        network_ms[int(row['rtp_timestamp'])] = float(row['network_ms'])
+      except (KeyError, ValueError):
+        continue
+  return network_ms
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+  parser.add_argument('capture', help='network_emulator --capture_path file')
+  parser.add_argument('--ebpf', help='network_emulator --ebpf_telemetry file')
+  parser.add_argument('--frames',
+                      help='per_frame_stats.csv or frame_metrics.csv')
+  parser.add_argument('--out',
+                      default='frame_delay_breakdown.csv',
+                      help='output CSV (default: %(default)s)')
+  args = parser.parse_args()
+
+  taps, realtime_offset_ns, records = ReadCapture(args.capture)
+  ebpf_departures = (ReadEbpfDepartures(args.ebpf, realtime_offset_ns)
+                     if args.ebpf else {})
+  frames, floor_ns = JoinPackets(taps, records, ebpf_departures)
+
+  network_ms = ReadFrameLog(args.frames) if args.frames else {}
+  # An RTP timestamp in the client's log goes to the biggest stream
+  # carrying it, which is the video frame rather than audio.
+  by_timestamp = {}
+  for frame in frames.values():
+    best = by_timestamp.get(frame.rtp_timestamp)
+    if best is None or frame.bytes > best.bytes:
+      by_timestamp[frame.rtp_timestamp] = frame
+
+  columns = collections.defaultdict(list)
+  with open(args.out, 'w', newline='') as f:
+    writer = csv.writer(f)
+    writer.writerow([
+        'ssrc', 'rtp_timestamp', 'direction', 'packets', 'lost_packets',
+        'bytes', 'first_send_ms', 'wire_ms', 'propagation_ms', 'queueing_ms',
+        'pacing_ms', 'serialization_ms', 'network_ms', 'endpoint_ms'
+    ])
+    for frame in sorted(frames.values(), key=lambda fr: min(fr.sends)):
+      first_send = min(frame.sends)
+      send_spread = max(frame.sends) - first_send
+      receive_spread = max(frame.receives) - min(frame.receives)
+      floor = floor_ns[frame.direction]
+      row = {
+          'wire_ms': (max(frame.receives) - first_send) / 1e6,
+          'propagation_ms': floor / 1e6,
+          'queueing_ms': (min(frame.receives) - first_send - floor) / 1e6,
+          'pacing_ms': send_spread / 1e6,
+          'serialization_ms': max(0, receive_spread - send_spread) / 1e6,
+      }
+      app_network_ms = ''
+      endpoint_ms = ''
+      if by_timestamp.get(frame.rtp_timestamp) is frame and \
+          frame.rtp_timestamp in network_ms:
+        app_network_ms = network_ms[frame.rtp_timestamp]
+        endpoint_ms = app_network_ms - row['wire_ms']
+        columns['endpoint_ms'].append(endpoint_ms)
+      for name, value in row.items():
+        columns[name].append(value)
+      writer.writerow([
+          frame.ssrc, frame.rtp_timestamp, frame.direction,
+          len(frame.receives), frame.lost, frame.bytes,
+          '%.3f' % (first_send / 1e6)
+      ] + ['%.3f' % row[name] for name in row] +
+                      [app_network_ms, endpoint_ms])
+
+  print('%d frames from %d packet records -> %s' %
+        (len(frames), len(records), args.out))
+  for name in ('wire_ms', 'propagation_ms', 'queueing_ms', 'pacing_ms',
+               'serialization_ms', 'endpoint_ms'):
+    values = sorted(columns[name])
+    if values:
+      print('  %-17s median %8.3f  p95 %8.3f' %
+            (name, statistics.median(values),
+             values[math.ceil(0.95 * (len(values) - 1))]))
+
+
+if __name__ == '__main__':
+  main()
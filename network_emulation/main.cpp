@@ -11,6 +11,14 @@ ABSL_FLAG(std::string, profile_path, "", "Path to the network profile CSV file (
 ABSL_FLAG(std::string, interface_name, "", "Network interface name to be emulated (mandatory)");
 ABSL_FLAG(bool, loop, false, "Loop the profile forever");
 ABSL_FLAG(int, repeat_count, 1, "Repeat the profile N times (>=1). Ignored if --loop");
+ABSL_FLAG(std::string, ebpf_object, "", "cellular_emulator.bpf.o to shape veth_ns with EDT under fq instead of netem");
+ABSL_FLAG(std::string, ebpf_telemetry, "", "Where the eBPF shaper writes its per-packet records (optional)");
+ABSL_FLAG(std::string, capture_path, "", "Record RTP/RTCP/DTLS/SCTP packet timestamps on both veth ends to this file (see join_capture.py)");
+ABSL_FLAG(std::string, uplink_trace, "", "Delivery-opportunity trace (mahimahi format) for ns1 -> host; enables the userspace shaper");
+ABSL_FLAG(std::string, downlink_trace, "", "Delivery-opportunity trace (mahimahi format) for host -> ns1; enables the userspace shaper");
+ABSL_FLAG(int, link_delay_ms, 0, "One-way delay added by the userspace shaper in each direction");
+ABSL_FLAG(std::string, aqm, "droptail", "Userspace shaper queue discipline: droptail, codel or pie");
+ABSL_FLAG(int64_t, queue_limit_bytes, 0, "Userspace shaper queue limit per direction in bytes (0 = unbounded)");
 
 // Global emulator instance
 std::unique_ptr<NetworkEmulator> g_emulator;
@@ -52,6 +60,30 @@ int main(int argc, char* argv[]) {
     std::string interface_name = absl::GetFlag(FLAGS_interface_name);
     bool loop = absl::GetFlag(FLAGS_loop);
     int repeat_count = absl::GetFlag(FLAGS_repeat_count);
+    std::string uplink_trace = absl::GetFlag(FLAGS_uplink_trace);
+    std::string downlink_trace = absl::GetFlag(FLAGS_downlink_trace);
+
+    bool trace_shaping = !uplink_trace.empty() || !downlink_trace.empty();
+    TraceLinkShaper::Direction uplink;
+    if (trace_shaping) {
+        if (uplink_trace.empty() || downlink_trace.empty()) {
+            std::cerr << "Error: --uplink_trace and --downlink_trace go together\n";
+            return 1;
+        }
+        if (!profile_path.empty()) {
+            std::cerr << "Error: --profile_path drives netem and cannot be combined with traces\n";
+            return 1;
+        }
+        if (!PacketQueue::ParseAqm(absl::GetFlag(FLAGS_aqm), &uplink.aqm)) {
+            std::cerr << "Error: unknown --aqm " << absl::GetFlag(FLAGS_aqm) << "\n";
+            return 1;
+        }
+        uplink.queue_limit_bytes = absl::GetFlag(FLAGS_queue_limit_bytes);
+        uplink.delay_ms = std::max(0, absl::GetFlag(FLAGS_link_delay_ms));
+    }
+    TraceLinkShaper::Direction downlink = uplink;
+    uplink.trace_path = uplink_trace;
+    downlink.trace_path = downlink_trace;
 
     // Auto-detect if not specified
     if (interface_name.empty()) {
@@ -83,6 +115,13 @@ int main(int argc, char* argv[]) {
         // Create and initialize the emulator
         g_emulator = std::make_unique<NetworkEmulator>();
         g_emulator->SetLoop(loop, repeat_count);
+        if (!absl::GetFlag(FLAGS_capture_path).empty())
+            g_emulator->SetCapture(absl::GetFlag(FLAGS_capture_path));
+        if (trace_shaping)
+            g_emulator->SetTraceShaper(uplink, downlink);
+        else if (!absl::GetFlag(FLAGS_ebpf_object).empty())
+            g_emulator->SetEbpfShaper(absl::GetFlag(FLAGS_ebpf_object),
+                                      absl::GetFlag(FLAGS_ebpf_telemetry));
         // Generate a unique name for the peer interface
         std::string peer_name = interface_name + "_peer";
         
@@ -0,0 +1,408 @@
+#include "netlink_qdisc.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include <linux/netlink.h>
+#include <linux/pkt_sched.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "netns.h"
+
+namespace {
+
+// Room for a 4096-entry delay distribution table.
+constexpr size_t kMessageBufferSize = 16384;
+// PSCHED_SHIFT from the kernel: netem's legacy latency field is in 64 ns
+// ticks. TCA_NETEM_LATENCY64 carries the exact value alongside it.
+constexpr int kPschedShift = 6;
+
+// One RTM_NEWQDISC message. Everything, attributes included, is addressed
+// from |buffer| so writes past the tcmsg stay inside a single object.
+struct QdiscRequest {
+    alignas(nlmsghdr) char buffer[NLMSG_SPACE(sizeof(tcmsg)) +
+                                  kMessageBufferSize];
+
+    nlmsghdr* header() { return reinterpret_cast<nlmsghdr*>(buffer); }
+    tcmsg* tc() { return static_cast<tcmsg*>(NLMSG_DATA(header())); }
+};
+
+// RTM_NEWQDISC for the root of |ifindex|, as "tc qdisc replace": changes
+// the qdisc in place if it is of the same kind, or installs it over
+// whatever is there.
+void InitRootQdiscRequest(QdiscRequest* request, uint32_t seq, int ifindex) {
+    nlmsghdr* header = request->header();
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(tcmsg));
+    header->nlmsg_type = RTM_NEWQDISC;
+    header->nlmsg_flags =
+        NLM_F_REQUEST | NLM_F_ACK | NLM_F_CREATE | NLM_F_REPLACE;
+    header->nlmsg_seq = seq;
+    tcmsg* tc = request->tc();
+    tc->tcm_family = AF_UNSPEC;
+    tc->tcm_ifindex = ifindex;
+    tc->tcm_parent = TC_H_ROOT;
+    tc->tcm_handle = TC_H_MAKE(1u << 16, 0);
+}
+
+rtattr* Tail(QdiscRequest* request) {
+    return reinterpret_cast<rtattr*>(
+        request->buffer + NLMSG_ALIGN(request->header()->nlmsg_len));
+}
+
+bool AddAttribute(QdiscRequest* request, uint16_t type, const void* data,
+                  size_t length) {
+    nlmsghdr* header = request->header();
+    const size_t attribute_length = RTA_LENGTH(length);
+    if (NLMSG_ALIGN(header->nlmsg_len) + RTA_ALIGN(attribute_length) >
+        sizeof(request->buffer)) {
+        return false;
+    }
+    rtattr* attribute = Tail(request);
+    attribute->rta_type = type;
+    attribute->rta_len = attribute_length;
+    if (length > 0)
+        std::memcpy(RTA_DATA(attribute), data, length);
+    header->nlmsg_len =
+        NLMSG_ALIGN(header->nlmsg_len) + RTA_ALIGN(attribute_length);
+    return true;
+}
+
+// NETEM_DIST_SCALE: table entries are in units of sigma / 8192.
+constexpr int kDistributionScale = 8192;
+constexpr int kUniformTableSize = 4096;
+// Where iproute2 installs normal.dist and friends.
+const char* const kDistributionDirs[] = {"/usr/lib/tc", "/usr/lib64/tc",
+                                         "/usr/local/lib/tc", "/lib/tc"};
+
+// netem probabilities are fractions of UINT32_MAX.
+uint32_t Probability(double pct) {
+    pct = std::clamp(pct, 0.0, 100.0);
+    return static_cast<uint32_t>(std::llround(pct / 100.0 * UINT32_MAX));
+}
+
+uint32_t Ticks(int64_t ns) {
+    return static_cast<uint32_t>(std::min<int64_t>(ns >> kPschedShift, UINT32_MAX));
+}
+
+std::string ErrnoString(const char* what) {
+    return std::string(what) + ": " + std::strerror(errno);
+}
+
+}  // namespace
+
+NetlinkQdisc::~NetlinkQdisc() {
+    Close();
+}
+
+bool NetlinkQdisc::Open(const std::string& netns,
+                        const std::string& interface_name) {
+    Close();
+
+    int fd = -1;
+    int ifindex = 0;
+    std::string error;
+    RunInNetns(netns, [&] {
+        ifindex = if_nametoindex(interface_name.c_str());
+        if (ifindex == 0) {
+            error = ErrnoString(("if_nametoindex " + interface_name).c_str());
+            return;
+        }
+        fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        if (fd < 0)
+            error = ErrnoString("socket(NETLINK_ROUTE)");
+    }, &error);
+
+    if (fd < 0) {
+        last_error_ = error;
+        return false;
+    }
+
+    sockaddr_nl local = {};
+    local.nl_family = AF_NETLINK;
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+        last_error_ = ErrnoString("bind(NETLINK_ROUTE)");
+        ::close(fd);
+        return false;
+    }
+    // A lost ack must not stall the emulation loop for good.
+    timeval timeout = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    fd_ = fd;
+    ifindex_ = ifindex;
+    return true;
+}
+
+void NetlinkQdisc::Close() {
+    if (fd_ >= 0)
+        ::close(fd_);
+    fd_ = -1;
+    ifindex_ = 0;
+}
+
+bool NetlinkQdisc::ParseDistribution(const std::string& name,
+                                     Distribution* distribution) {
+    for (Distribution candidate :
+         {Distribution::kUniform, Distribution::kNormal, Distribution::kPareto,
+          Distribution::kParetoNormal}) {
+        if (name == DistributionName(candidate)) {
+            *distribution = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* NetlinkQdisc::DistributionName(Distribution distribution) {
+    switch (distribution) {
+        case Distribution::kNormal:
+            return "normal";
+        case Distribution::kPareto:
+            return "pareto";
+        case Distribution::kParetoNormal:
+            return "paretonormal";
+        case Distribution::kUniform:
+            break;
+    }
+    return "uniform";
+}
+
+const std::vector<int16_t>* NetlinkQdisc::DistributionTable(
+    Distribution distribution) {
+    auto it = distribution_tables_.find(distribution);
+    if (it != distribution_tables_.end())
+        return &it->second;
+
+    if (distribution == Distribution::kUniform) {
+        // What netem does without a table, spelled out as one so it can
+        // replace a table sent earlier.
+        std::vector<int16_t> table(kUniformTableSize);
+        for (int i = 0; i < kUniformTableSize; i++) {
+            table[i] = static_cast<int16_t>(-kDistributionScale +
+                                            i * 2 * kDistributionScale / kUniformTableSize);
+        }
+        return &(distribution_tables_[distribution] = std::move(table));
+    }
+
+    const std::string file_name = std::string(DistributionName(distribution)) + ".dist";
+    for (const char* dir : kDistributionDirs) {
+        std::ifstream file(std::string(dir) + "/" + file_name);
+        if (!file.is_open())
+            continue;
+        std::vector<int16_t> table;
+        std::string token;
+        while (file >> token) {
+            // Same format tc reads: whitespace-separated integers, '#'
+            // comments to end of line.
+            if (token[0] == '#') {
+                std::getline(file, token);
+                continue;
+            }
+            char* end = nullptr;
+            const long value = std::strtol(token.c_str(), &end, 10);
+            if (*end != '\0' || value < INT16_MIN || value > INT16_MAX) {
+                table.clear();
+                break;
+            }
+            table.push_back(static_cast<int16_t>(value));
+        }
+        if (table.empty() || table.size() * sizeof(int16_t) > kMessageBufferSize / 2)
+            break;
+        return &(distribution_tables_[distribution] = std::move(table));
+    }
+    last_error_ = "no usable " + file_name + " (is iproute2 installed?)";
+    return nullptr;
+}
+
+bool NetlinkQdisc::SetNetem(const NetemParams& params, int64_t* elapsed_us) {
+    if (fd_ < 0) {
+        last_error_ = "socket not open";
+        return false;
+    }
+    const std::vector<int16_t>* table = nullptr;
+    if (params.jitter_ms > 0) {
+        table = DistributionTable(params.jitter_distribution);
+        if (!table)
+            return false;
+    }
+
+    QdiscRequest request = {};
+    InitRootQdiscRequest(&request, ++seq_, ifindex_);
+
+    const char kKind[] = "netem";
+    const int64_t delay_ns = std::llround(params.delay_ms * 1e6);
+    const int64_t jitter_ns = std::llround(params.jitter_ms * 1e6);
+    const uint64_t rate_bytes_per_s =
+        static_cast<uint64_t>(std::llround(params.rate_kbps * 1000.0 / 8.0));
+
+    tc_netem_qopt qopt = {};
+    qopt.limit = params.limit_packets;
+    qopt.latency = Ticks(delay_ns);
+    qopt.jitter = Ticks(jitter_ns);
+    qopt.duplicate = Probability(params.duplicate_pct);
+    if (params.loss_model == LossModel::kBernoulli)
+        qopt.loss = Probability(params.loss_pct);
+    // As tc does: reordering works by letting some packets skip the delay.
+    if (params.reorder_pct > 0)
+        qopt.gap = 1;
+
+    // netem_change() keeps the old reorder and corrupt settings when these
+    // are missing, so they always go out, zero or not.
+    tc_netem_reorder reorder = {};
+    reorder.probability = Probability(params.reorder_pct);
+    tc_netem_corrupt corrupt = {};
+    corrupt.probability = Probability(params.corrupt_pct);
+    tc_netem_gemodel gemodel = {};
+    gemodel.p = Probability(params.ge_p_pct);
+    gemodel.r = Probability(params.ge_r_pct);
+    gemodel.h = UINT32_MAX - Probability(params.ge_bad_loss_pct);
+    gemodel.k1 = Probability(params.ge_good_loss_pct);
+
+    tc_netem_rate rate = {};
+    rate.rate = rate_bytes_per_s >= (1ull << 32)
+                    ? UINT32_MAX
+                    : static_cast<uint32_t>(rate_bytes_per_s);
+
+    if (!AddAttribute(&request, TCA_KIND, kKind,
+                      sizeof(kKind))) {
+        last_error_ = "message too long";
+        return false;
+    }
+    // netem's TCA_OPTIONS is its qopt struct followed by nested attributes.
+    rtattr* options = Tail(&request);
+    bool ok = AddAttribute(&request, TCA_OPTIONS, &qopt,
+                           sizeof(qopt)) &&
+              AddAttribute(&request, TCA_NETEM_LATENCY64,
+                           &delay_ns, sizeof(delay_ns)) &&
+              AddAttribute(&request, TCA_NETEM_JITTER64,
+                           &jitter_ns, sizeof(jitter_ns)) &&
+              AddAttribute(&request, TCA_NETEM_REORDER,
+                           &reorder, sizeof(reorder)) &&
+              AddAttribute(&request, TCA_NETEM_CORRUPT,
+                           &corrupt, sizeof(corrupt));
+    if (ok && params.loss_model == LossModel::kGilbertElliott) {
+        // Without TCA_NETEM_LOSS netem goes back to the Bernoulli qopt.loss.
+        rtattr* loss = Tail(&request);
+        ok = AddAttribute(&request, TCA_NETEM_LOSS, nullptr, 0) &&
+             AddAttribute(&request, NETEM_LOSS_GE, &gemodel,
+                          sizeof(gemodel));
+        if (ok) {
+            loss->rta_type |= NLA_F_NESTED;
+            loss->rta_len = reinterpret_cast<char*>(Tail(&request)) -
+                            reinterpret_cast<char*>(loss);
+        }
+    }
+    // netem keeps its current table when none is sent, so every jittered
+    // step carries its own, uniform included.
+    if (ok && table) {
+        ok = AddAttribute(&request, TCA_NETEM_DELAY_DIST,
+                          table->data(), table->size() * sizeof(int16_t));
+    }
+    if (ok && rate_bytes_per_s >= (1ull << 32)) {
+        ok = AddAttribute(&request, TCA_NETEM_RATE64,
+                          &rate_bytes_per_s, sizeof(rate_bytes_per_s));
+    }
+    ok = ok && AddAttribute(&request, TCA_NETEM_RATE,
+                            &rate, sizeof(rate));
+    if (!ok) {
+        last_error_ = "message too long";
+        return false;
+    }
+    options->rta_len = reinterpret_cast<char*>(Tail(&request)) -
+                       reinterpret_cast<char*>(options);
+
+    auto start = std::chrono::steady_clock::now();
+    if (!SendAndWaitAck(request.buffer, request.header()->nlmsg_len))
+        return false;
+    if (elapsed_us) {
+        *elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    }
+    return true;
+}
+
+bool NetlinkQdisc::SetFq(const FqParams& params) {
+    if (fd_ < 0) {
+        last_error_ = "socket not open";
+        return false;
+    }
+    QdiscRequest request = {};
+    InitRootQdiscRequest(&request, ++seq_, ifindex_);
+    const char kKind[] = "fq";
+    if (!AddAttribute(&request, TCA_KIND, kKind,
+                      sizeof(kKind))) {
+        last_error_ = "message too long";
+        return false;
+    }
+    // Unlike netem's, fq's TCA_OPTIONS holds only nested attributes.
+    rtattr* options = Tail(&request);
+    const bool ok =
+        AddAttribute(&request, TCA_OPTIONS, nullptr, 0) &&
+        AddAttribute(&request, TCA_FQ_PLIMIT,
+                     &params.limit_packets, sizeof(params.limit_packets)) &&
+        AddAttribute(&request, TCA_FQ_FLOW_PLIMIT,
+                     &params.flow_limit_packets, sizeof(params.flow_limit_packets)) &&
+        AddAttribute(&request, TCA_FQ_HORIZON,
+                     &params.horizon_us, sizeof(params.horizon_us));
+    if (!ok) {
+        last_error_ = "message too long";
+        return false;
+    }
+    options->rta_len = reinterpret_cast<char*>(Tail(&request)) -
+                       reinterpret_cast<char*>(options);
+    return SendAndWaitAck(request.buffer, request.header()->nlmsg_len);
+}
+
+bool NetlinkQdisc::SendAndWaitAck(void* message, uint32_t length) {
+    sockaddr_nl kernel = {};
+    kernel.nl_family = AF_NETLINK;
+    iovec iov = {message, length};
+    msghdr msg = {};
+    msg.msg_name = &kernel;
+    msg.msg_namelen = sizeof(kernel);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (::sendmsg(fd_, &msg, 0) < 0) {
+        last_error_ = ErrnoString("sendmsg(RTM_NEWQDISC)");
+        return false;
+    }
+
+    const uint32_t seq = static_cast<nlmsghdr*>(message)->nlmsg_seq;
+    alignas(nlmsghdr) char buffer[8192];
+    while (true) {
+        ssize_t received = ::recv(fd_, buffer, sizeof(buffer), 0);
+        if (received < 0) {
+            if (errno == EINTR)
+                continue;
+            last_error_ = ErrnoString("recv(NETLINK_ROUTE)");
+            return false;
+        }
+        int remaining = static_cast<int>(received);
+        for (nlmsghdr* header = reinterpret_cast<nlmsghdr*>(buffer);
+             NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining)) {
+            // Skip acks left over from a request that timed out earlier.
+            if (header->nlmsg_seq != seq || header->nlmsg_type != NLMSG_ERROR)
+                continue;
+            const nlmsgerr* error =
+                static_cast<const nlmsgerr*>(NLMSG_DATA(header));
+            if (error->error != 0) {
+                last_error_ = std::string("RTM_NEWQDISC: ") +
+                              std::strerror(-error->error);
+                return false;
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef NETLINK_QDISC_H_
+#define NETLINK_QDISC_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Programs the root qdisc of one interface over rtnetlink, so a trace step
+// costs one sendmsg/recv instead of forking sudo, ip and tc.
+//
+// The socket is created inside the target network namespace (see
+// RunInNetns) and stays bound to it, so updates can be sent from any
+// thread. Needs CAP_SYS_ADMIN for setns and CAP_NET_ADMIN for the qdisc
+// changes.
+class NetlinkQdisc {
+public:
+    enum class Distribution { kUniform, kNormal, kPareto, kParetoNormal };
+    enum class LossModel { kBernoulli, kGilbertElliott };
+
+    // The complete netem state of one trace step. Every update sends all of
+    // it, so nothing from an earlier step lingers. Percentages are 0-100.
+    struct NetemParams {
+        double rate_kbps = 0;
+        double delay_ms = 0;
+        double jitter_ms = 0;
+        // Shapes other than uniform use iproute2's <name>.dist tables.
+        Distribution jitter_distribution = Distribution::kUniform;
+        LossModel loss_model = LossModel::kBernoulli;
+        double loss_pct = 0;
+        // Gilbert-Elliott as in "tc ... loss gemodel p r 1-h 1-k": the
+        // good->bad and bad->good transition probabilities, then the loss
+        // probability in the bad and in the good state.
+        double ge_p_pct = 0;
+        double ge_r_pct = 100;
+        double ge_bad_loss_pct = 100;
+        double ge_good_loss_pct = 0;
+        // Packets sent right away, ahead of the delayed ones; needs a delay.
+        double reorder_pct = 0;
+        double duplicate_pct = 0;
+        double corrupt_pct = 0;
+        uint32_t limit_packets = 50000;
+    };
+
+    // fq's packet limits and how far ahead a departure time may be. The
+    // defaults are the kernel's; fq drops silently past any of them.
+    struct FqParams {
+        uint32_t limit_packets = 10000;
+        uint32_t flow_limit_packets = 100;
+        uint32_t horizon_us = 10000000;
+    };
+
+    static bool ParseDistribution(const std::string& name,
+                                  Distribution* distribution);
+    static const char* DistributionName(Distribution distribution);
+
+    NetlinkQdisc() = default;
+    ~NetlinkQdisc();
+
+    NetlinkQdisc(const NetlinkQdisc&) = delete;
+    NetlinkQdisc& operator=(const NetlinkQdisc&) = delete;
+
+    // Opens the socket in /var/run/netns/<netns> and resolves the interface
+    // index there. An empty |netns| stays in the current namespace.
+    bool Open(const std::string& netns, const std::string& interface_name);
+    void Close();
+    bool IsOpen() const { return fd_ >= 0; }
+
+    // Replaces (or creates) the root netem qdisc and waits for the kernel's
+    // ack. On success |elapsed_us|, if set, is the send-to-ack time.
+    bool SetNetem(const NetemParams& params, int64_t* elapsed_us = nullptr);
+    // Replaces the root qdisc with fq, which honours the departure times
+    // set by the eBPF shaper.
+    bool SetFq(const FqParams& params);
+
+    const std::string& LastError() const { return last_error_; }
+
+private:
+    bool SendAndWaitAck(void* message, uint32_t length);
+    // The delay table for |distribution|, loaded (or built) once.
+    const std::vector<int16_t>* DistributionTable(Distribution distribution);
+
+    int fd_ = -1;
+    int ifindex_ = 0;
+    uint32_t seq_ = 0;
+    std::map<Distribution, std::vector<int16_t>> distribution_tables_;
+    std::string last_error_;
+};
+
+#endif // NETLINK_QDISC_H_
@@ -0,0 +1,34 @@
+#include "netns.h"
+
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+
+bool RunInNetns(const std::string& netns, const std::function<void()>& fn,
+                std::string* error) {
+    bool entered = false;
+    std::thread runner([&] {
+        if (!netns.empty()) {
+            const std::string path = "/var/run/netns/" + netns;
+            int ns_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (ns_fd < 0) {
+                *error = "open " + path + ": " + std::strerror(errno);
+                return;
+            }
+            int result = ::setns(ns_fd, CLONE_NEWNET);
+            ::close(ns_fd);
+            if (result != 0) {
+                *error = std::string("setns: ") + std::strerror(errno);
+                return;
+            }
+        }
+        entered = true;
+        fn();
+    });
+    runner.join();
+    return entered;
+}
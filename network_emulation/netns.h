@@ -0,0 +1,15 @@
+#ifndef NETNS_H_
+#define NETNS_H_
+
+#include <functional>
+#include <string>
+
+// Runs |fn| inside the network namespace /var/run/netns/<netns>. setns()
+// only moves the calling thread, so this happens on a throwaway thread and
+// the rest of the process stays where it is; sockets created by |fn| stay
+// bound to the namespace. An empty |netns| runs |fn| in the current one.
+// Returns false with |error| set if the namespace cannot be entered.
+bool RunInNetns(const std::string& netns, const std::function<void()>& fn,
+                std::string* error);
+
+#endif // NETNS_H_
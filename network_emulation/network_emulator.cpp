@@ -4,11 +4,116 @@
 #include <sstream>
 #include <chrono>
 #include <cstdlib>
+#include <cmath>
+#include <stdexcept>
 #include <atomic>
+#include <sys/prctl.h>
 
 
 static const char* NETWORK_EMULATOR_MODULE_NAME = "PHY";
 
+namespace {
+
+// netem counts its limit in packets; queue sizes in bytes or time are
+// converted at this size.
+constexpr double kQueuePacketBytes = 1500;
+
+std::vector<std::string> SplitCsvLine(const std::string& line) {
+    std::vector<std::string> cells;
+    std::stringstream ss(line);
+    std::string cell;
+    while (std::getline(ss, cell, ',')) {
+        const size_t begin = cell.find_first_not_of(" \t\r");
+        const size_t end = cell.find_last_not_of(" \t\r");
+        cells.push_back(begin == std::string::npos ? ""
+                                                   : cell.substr(begin, end - begin + 1));
+    }
+    return cells;
+}
+
+double ParseNumber(const std::string& cell, const std::string& column) {
+    size_t used = 0;
+    double value = std::stod(cell, &used);
+    if (used != cell.size() || !std::isfinite(value) || value < 0)
+        throw std::invalid_argument("bad " + column + " '" + cell + "'");
+    return value;
+}
+
+// Fills in one of the named columns; throws std::invalid_argument (or
+// std::out_of_range from stod) on a bad value.
+void SetProfileColumn(const std::string& column, const std::string& cell,
+                      NetworkEmulator::NetworkProfile* profile) {
+    NetlinkQdisc::NetemParams& netem = profile->netem;
+    if (column == "jitter_dist") {
+        if (!NetlinkQdisc::ParseDistribution(cell, &netem.jitter_distribution))
+            throw std::invalid_argument("unknown jitter_dist '" + cell + "'");
+    } else if (column == "loss_model") {
+        if (cell == "bernoulli") {
+            netem.loss_model = NetlinkQdisc::LossModel::kBernoulli;
+        } else if (cell == "ge") {
+            netem.loss_model = NetlinkQdisc::LossModel::kGilbertElliott;
+        } else {
+            throw std::invalid_argument("unknown loss_model '" + cell + "'");
+        }
+    } else {
+        const double value = ParseNumber(cell, column);
+        if (column.size() > 4 && column.compare(column.size() - 4, 4, "_pct") == 0 &&
+            value > 100) {
+            throw std::invalid_argument(column + " over 100");
+        }
+        if (column == "jitter_ms") {
+            netem.jitter_ms = value;
+        } else if (column == "loss_pct") {
+            netem.loss_pct = value;
+        } else if (column == "ge_p_pct") {
+            netem.ge_p_pct = value;
+        } else if (column == "ge_r_pct") {
+            netem.ge_r_pct = value;
+        } else if (column == "ge_bad_loss_pct") {
+            netem.ge_bad_loss_pct = value;
+        } else if (column == "ge_good_loss_pct") {
+            netem.ge_good_loss_pct = value;
+        } else if (column == "reorder_pct") {
+            netem.reorder_pct = value;
+        } else if (column == "duplicate_pct") {
+            netem.duplicate_pct = value;
+        } else if (column == "corrupt_pct") {
+            netem.corrupt_pct = value;
+        } else {
+            throw std::invalid_argument("unknown column '" + column + "'");
+        }
+    }
+}
+
+// Turns a queue_* cell into the netem packet limit and the eBPF backlog
+// bound. netem's limit also covers packets still serving their delay, so
+// byte and time sizes get the delay's worth of packets on top.
+void SetProfileQueue(const std::string& column, double value,
+                     NetworkEmulator::NetworkProfile* profile) {
+    NetlinkQdisc::NetemParams& netem = profile->netem;
+    const double bytes_per_ms = netem.rate_kbps / 8.0;
+    double queue_bytes;
+    if (column == "queue_packets") {
+        netem.limit_packets = static_cast<uint32_t>(std::max(1.0, std::ceil(value)));
+        queue_bytes = value * kQueuePacketBytes;
+    } else {
+        queue_bytes = column == "queue_bytes" ? value : value * bytes_per_ms;
+        if (netem.rate_kbps > 0) {
+            const double in_flight = bytes_per_ms * netem.delay_ms;
+            netem.limit_packets = static_cast<uint32_t>(std::min<double>(
+                UINT32_MAX,
+                std::max(1.0, std::ceil((queue_bytes + in_flight) / kQueuePacketBytes))));
+        }
+    }
+    if (column == "queue_ms") {
+        profile->max_backlog_ms = value;
+    } else if (netem.rate_kbps > 0) {
+        profile->max_backlog_ms = queue_bytes / bytes_per_ms;
+    }
+}
+
+}  // namespace
+
 NetworkEmulator::NetworkEmulator() 
     : is_running_(false), current_profile_index_(0) {
     LOG_INFO(NETWORK_EMULATOR_MODULE_NAME, "NetworkEmulator initialized");
@@ -63,6 +168,8 @@ bool NetworkEmulator::CreateVirtualInterface() {
         sudo ip link del veth1 2>/dev/null
         sudo ip link del veth_host 2>/dev/null
         sudo ip link del veth_ns 2>/dev/null
+        sudo ip link del veth_shh 2>/dev/null
+        sudo ip link del veth_shn 2>/dev/null
         sudo rm -rf /etc/netns/ns1 2>/dev/null
     )";
     system(cleanup_cmd.c_str());
@@ -76,11 +183,28 @@ bool NetworkEmulator::CreateVirtualInterface() {
         return false;
     }
 
-    // Create veth pair for connectivity
-    cmd = "sudo ip link add veth_host type veth peer name veth_ns";
-    if (system(cmd.c_str()) != 0) {
-        LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, "Failed to create veth pair");
-        return false;
+    if (trace_config_) {
+        // Two pairs with the userspace shaper bridging veth_shh and veth_shn:
+        // veth_host <-> veth_shh ~ shaper ~ veth_shn <-> veth_ns
+        cmd = "sudo ip link add veth_host type veth peer name veth_shh && "
+              "sudo ip link add veth_shn type veth peer name veth_ns";
+        if (system(cmd.c_str()) != 0) {
+            LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, "Failed to create shaper veth pairs");
+            return false;
+        }
+        for (const char* name : {"veth_shh", "veth_shn"}) {
+            cmd = std::string("sudo sysctl -qw net.ipv6.conf.") + name + ".disable_ipv6=1";
+            system(cmd.c_str());
+            cmd = std::string("sudo ip link set ") + name + " up";
+            system(cmd.c_str());
+        }
+    } else {
+        // Create veth pair for connectivity
+        cmd = "sudo ip link add veth_host type veth peer name veth_ns";
+        if (system(cmd.c_str()) != 0) {
+            LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, "Failed to create veth pair");
+            return false;
+        }
     }
 
     // Move veth_ns to namespace
@@ -104,6 +228,24 @@ bool NetworkEmulator::CreateVirtualInterface() {
     cmd = "sudo ip netns exec ns1 ip link set lo up";
     system(cmd.c_str());
 
+    if (trace_config_) {
+        // The shaper forwards frames as read, so they must be complete
+        // MTU-sized frames with real checksums rather than offload stubs.
+        // With offloads left on the trace would be replayed wrongly, so
+        // refuse to start instead.
+        const char* kNoOffload = " tx off tso off gso off gro off";
+        const char* kDevices[] = {"sudo ethtool -K veth_host",
+                                  "sudo ip netns exec ns1 ethtool -K veth_ns"};
+        for (const char* device : kDevices) {
+            cmd = std::string(device) + kNoOffload;
+            if (system(cmd.c_str()) != 0) {
+                LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME,
+                          "Failed to disable offloads: ", cmd);
+                return false;
+            }
+        }
+    }
+
     // Set up NAT in host to allow internet access from namespace
     cmd = "sudo sysctl -w net.ipv4.ip_forward=1";
     system(cmd.c_str());
@@ -129,6 +271,9 @@ bool NetworkEmulator::CreateVirtualInterface() {
 }
 
 void NetworkEmulator::DeleteVirtualInterface() {
+    // Lets the namespace go away with "ip netns del".
+    qdisc_.Close();
+
     // Clean up NAT rules
     std::string cmd = "sudo iptables -t nat -D POSTROUTING -s 192.168.100.0/24 -o " + interface_name_ + " -j MASQUERADE";
     system(cmd.c_str());
@@ -146,6 +291,8 @@ void NetworkEmulator::DeleteVirtualInterface() {
     // Delete virtual interfaces and namespace
     cmd = "sudo ip link del veth_host 2>/dev/null";  // This also removes the peer
     system(cmd.c_str());
+    cmd = "sudo ip link del veth_shn 2>/dev/null";
+    system(cmd.c_str());
     
     cmd = "sudo ip netns del ns1 2>/dev/null";
     system(cmd.c_str());
@@ -161,12 +308,85 @@ void NetworkEmulator::Start() {
     if (is_running_)
         return;
 
+    if (!capture_path_.empty() && !capture_) {
+        // The taps sit on either side of whichever shaper is in use.
+        capture_ = std::make_unique<PacketCapture>();
+        if (!capture_->Start({{"ns1", "veth_ns"}, {"", "veth_host"}}, capture_path_)) {
+            LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, "Packet capture unavailable");
+            capture_.reset();
+        }
+    }
+
+    if (trace_config_) {
+        trace_shaper_ = std::make_unique<TraceLinkShaper>(*trace_config_);
+        if (!trace_shaper_->Start()) {
+            LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, "Failed to start the trace shaper");
+            trace_shaper_.reset();
+            return;
+        }
+        is_running_ = true;
+        LOG_INFO(NETWORK_EMULATOR_MODULE_NAME, "Trace shaper running");
+        return;
+    }
+
     LOG_INFO(NETWORK_EMULATOR_MODULE_NAME, "Starting emulation loop");
+    if (!qdisc_.IsOpen()) {
+        if (qdisc_.Open("ns1", "veth_ns")) {
+            LOG_INFO(NETWORK_EMULATOR_MODULE_NAME, "Programming veth_ns over rtnetlink");
+        } else {
+            LOG_WARNING(NETWORK_EMULATOR_MODULE_NAME, "rtnetlink unavailable (",
+                        qdisc_.LastError(), "), falling back to tc");
+        }
+    }
+    if (!ebpf_object_path_.empty() && !ebpf_shaper_ && qdisc_.IsOpen()) {
+        // The first netem update replaces fq again if the program fails.
+        ebpf_shaper_ = std::make_unique<EbpfShaper>();
+        if (!qdisc_.SetFq(FqParamsForProfiles())) {
+            LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, "Cannot install fq on veth_ns (",
+                      qdisc_.LastError(), "), falling back to netem");
+            ebpf_shaper_.reset();
+        } else if (!ebpf_shaper_->Open(ebpf_object_path_, "ns1", "veth_ns",
+                                       ebpf_telemetry_path_)) {
+            LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, "eBPF shaper unavailable (",
+                      ebpf_shaper_->LastError(), "), falling back to netem");
+            ebpf_shaper_.reset();
+        }
+    } else if (!ebpf_object_path_.empty() && !ebpf_shaper_) {
+        LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME,
+                  "eBPF shaper needs rtnetlink for fq, falling back to tc netem");
+    }
     is_running_ = true;
     emulation_thread_ = std::thread(&NetworkEmulator::EmulationLoop, this);
     LOG_INFO(NETWORK_EMULATOR_MODULE_NAME, "Emulation thread created");
 }
 
+NetlinkQdisc::FqParams NetworkEmulator::FqParamsForProfiles() const {
+    // Sized for minimum-size frames, since limits count packets. Steps
+    // without a rate limit only hold their delay's worth and cannot be
+    // sized, so they leave the kernel defaults as the floor.
+    constexpr double kMinPacketBytes = 64;
+    constexpr double kHorizonMarginMs = 1000;
+    NetlinkQdisc::FqParams params;
+    double max_window_ms = 0;
+    double max_packets = 0;
+    for (const auto& profile : network_profiles_) {
+        const double window_ms = profile.netem.delay_ms + profile.max_backlog_ms;
+        max_window_ms = std::max(max_window_ms, window_ms);
+        max_packets = std::max(max_packets,
+                               profile.netem.rate_kbps / 8.0 * window_ms / kMinPacketBytes);
+    }
+    const auto packets = static_cast<uint32_t>(
+        std::min<double>(std::ceil(max_packets), UINT32_MAX));
+    params.limit_packets = std::max(params.limit_packets, packets);
+    params.flow_limit_packets = std::max(params.flow_limit_packets, packets);
+    params.horizon_us = std::max(params.horizon_us, static_cast<uint32_t>(std::min<double>(
+        (max_window_ms + kHorizonMarginMs) * 1000.0, UINT32_MAX)));
+    LOG_INFO(NETWORK_EMULATOR_MODULE_NAME, "fq limits: ", params.limit_packets,
+             " packets, ", params.flow_limit_packets, " per flow, horizon ",
+             params.horizon_us / 1000, " ms");
+    return params;
+}
+
 void NetworkEmulator::Stop() {
     if (!is_running_)
         return;
@@ -174,6 +394,13 @@ void NetworkEmulator::Stop() {
     is_running_ = false;
     if (emulation_thread_.joinable())
         emulation_thread_.join();
+    if (trace_shaper_) {
+        trace_shaper_->Stop();
+        trace_shaper_.reset();
+    }
+    // Stops shaping and drains the last packet records.
+    ebpf_shaper_.reset();
+    capture_.reset();
     LOG_INFO(NETWORK_EMULATOR_MODULE_NAME, "Stopped network emulation");
 }
 
@@ -185,21 +412,58 @@ bool NetworkEmulator::ParseProfileFile() {
     }
 
     std::string line;
-    // Skip header
     std::getline(file, line);
+    const std::vector<std::string> columns = SplitCsvLine(line);
+    if (columns.size() < 3) {
+        LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, profile_path_,
+                  ": header needs timestamp, bandwidth and latency columns");
+        return false;
+    }
 
+    int line_number = 1;
     while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string token;
-        NetworkProfile profile;
+        line_number++;
+        const std::vector<std::string> cells = SplitCsvLine(line);
+        if (cells.empty() || (cells.size() == 1 && cells[0].empty()))
+            continue;
+        if (cells.size() < 3 || cells.size() > columns.size()) {
+            LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, profile_path_, ":", line_number,
+                      ": expected 3 to ", columns.size(), " cells, got ", cells.size());
+            return false;
+        }
 
-        // Parse CSV format: timestamp,bandwidth,latency
-        std::getline(ss, token, ',');
-        profile.timestamp_ms = std::stoll(token);
-        std::getline(ss, token, ',');
-        profile.bandwidth_kbps = std::stod(token);
-        std::getline(ss, token, ',');
-        profile.latency_ms = std::stod(token);
+        NetworkProfile profile;
+        try {
+            profile.timestamp_ms = std::stoll(cells[0]);
+            profile.netem.rate_kbps = ParseNumber(cells[1], columns[1]);
+            profile.netem.delay_ms = ParseNumber(cells[2], columns[2]);
+            // Queue sizes in bytes or time depend on the rate and delay, so
+            // they are resolved after everything else.
+            std::string queue_column;
+            double queue_value = 0;
+            for (size_t i = 3; i < cells.size(); i++) {
+                if (cells[i].empty())
+                    continue;
+                if (columns[i].compare(0, 6, "queue_") != 0) {
+                    SetProfileColumn(columns[i], cells[i], &profile);
+                    continue;
+                }
+                if (columns[i] != "queue_packets" && columns[i] != "queue_bytes" &&
+                    columns[i] != "queue_ms") {
+                    throw std::invalid_argument("unknown column '" + columns[i] + "'");
+                }
+                if (!queue_column.empty())
+                    throw std::invalid_argument("both " + queue_column + " and " + columns[i]);
+                queue_column = columns[i];
+                queue_value = ParseNumber(cells[i], columns[i]);
+            }
+            if (!queue_column.empty())
+                SetProfileQueue(queue_column, queue_value, &profile);
+        } catch (const std::exception& e) {
+            LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, profile_path_, ":", line_number,
+                      ": ", e.what());
+            return false;
+        }
 
         network_profiles_.push_back(profile);
     }
@@ -232,9 +496,13 @@ bool NetworkEmulator::ParseProfileFile() {
 void NetworkEmulator::EmulationLoop() {
     LOG_INFO(NETWORK_EMULATOR_MODULE_NAME, "Entering emulation loop");
 
+    // The default 50 us timer slack alone would eat half the scheduling
+    // budget of a trace step.
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+
     using Clock = std::chrono::steady_clock;
-    auto start_time = Clock::now();
-    auto next_update_time = start_time;
+    // Profile timestamps are offsets from the start of the current pass.
+    auto pass_start = Clock::now();
 
     int loops_done = 0;
 
@@ -251,9 +519,9 @@ void NetworkEmulator::EmulationLoop() {
             // Check repeat condition
             if (loop_ || loops_done < repeat_count_) {
                 if (profile_duration_ms_ > 0) {
-                    next_update_time += std::chrono::milliseconds(profile_duration_ms_);
+                    pass_start += std::chrono::milliseconds(profile_duration_ms_);
                 } else {
-                    next_update_time = Clock::now();
+                    pass_start = Clock::now();
                 }
                 current_profile_index_ = 0;
                 continue;
@@ -263,28 +531,21 @@ void NetworkEmulator::EmulationLoop() {
             }
         }
 
-        auto before_update = Clock::now();
-
         const auto& current_profile = network_profiles_[current_profile_index_];
-        ApplyNetworkConditions(current_profile.bandwidth_kbps, current_profile.latency_ms);
-
-        auto after_update = Clock::now();
-        auto overhead = std::chrono::duration_cast<std::chrono::microseconds>(after_update - before_update);
+        auto scheduled = pass_start + std::chrono::milliseconds(current_profile.timestamp_ms);
+        std::this_thread::sleep_until(scheduled);
+        if (!is_running_)
+            break;
 
-        if (current_profile_index_ + 1 < network_profiles_.size()) {
-            const auto& next_profile = network_profiles_[current_profile_index_ + 1];
-            int64_t time_diff = next_profile.timestamp_ms - current_profile.timestamp_ms;
+        auto late = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - scheduled);
+        ApplyNetworkConditions(current_profile, late.count());
+        current_profile_index_++;
+    }
 
-            auto sleep_duration = std::chrono::milliseconds(time_diff) - overhead;
-            if (sleep_duration.count() > 0) {
-                next_update_time += std::chrono::milliseconds(time_diff);
-                auto adjusted_sleep_time = next_update_time - overhead;
-                std::this_thread::sleep_until(adjusted_sleep_time);
-            }
-            current_profile_index_++;
-        } else {
-            current_profile_index_++;
-        }
+    if (update_count_ > 0) {
+        LOG_INFO(NETWORK_EMULATOR_MODULE_NAME, "Applied ", update_count_,
+                 " updates - mean ", update_total_us_ / update_count_,
+                 " us, max ", update_max_us_, " us, max lateness ", late_max_us_, " us");
     }
 
     is_running_ = false;
@@ -292,28 +553,95 @@ void NetworkEmulator::EmulationLoop() {
 }
 
 
-void NetworkEmulator::ApplyNetworkConditions(double bandwidth_kbps, double latency_ms) {
+void NetworkEmulator::ApplyNetworkConditions(const NetworkProfile& profile,
+                                             int64_t late_us) {
+    const NetlinkQdisc::NetemParams& netem = profile.netem;
+    auto before_update = std::chrono::steady_clock::now();
+
+    bool applied = false;
+    if (ebpf_shaper_) {
+        if (!warned_ebpf_impairments_ &&
+            (netem.jitter_ms > 0 || netem.reorder_pct > 0 || netem.duplicate_pct > 0 ||
+             netem.corrupt_pct > 0 || netem.loss_pct > 0 ||
+             netem.loss_model != NetlinkQdisc::LossModel::kBernoulli)) {
+            LOG_WARNING(NETWORK_EMULATOR_MODULE_NAME, "The eBPF shaper only does rate, ",
+                        "delay and queue size; loss, jitter, reordering, duplication ",
+                        "and corruption in the profile are ignored");
+            warned_ebpf_impairments_ = true;
+        }
+        EbpfShaper::Conditions conditions;
+        conditions.rate_kbps = netem.rate_kbps;
+        conditions.delay_ms = netem.delay_ms;
+        conditions.max_backlog_ms = profile.max_backlog_ms;
+        applied = ebpf_shaper_->SetConditions(conditions);
+        if (!applied) {
+            LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, "Failed to update the eBPF shaper: ",
+                      ebpf_shaper_->LastError());
+        }
+    } else if (qdisc_.IsOpen()) {
+        applied = qdisc_.SetNetem(netem);
+        if (!applied) {
+            LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, "Failed to apply netem to veth_ns: ",
+                      qdisc_.LastError());
+        }
+    } else {
+        applied = ApplyWithTc(netem);
+    }
+    if (!applied)
+        return;
+
+    int64_t update_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - before_update).count();
+    update_count_++;
+    update_total_us_ += update_us;
+    update_max_us_ = std::max(update_max_us_, update_us);
+    late_max_us_ = std::max(late_max_us_, late_us);
+
+    LOG_INFO(NETWORK_EMULATOR_MODULE_NAME, "Applied to veth_ns - Rate: ",
+             netem.rate_kbps, " kbps, Delay: ", netem.delay_ms, " ms, Jitter: ",
+             netem.jitter_ms, " ms, Limit: ", netem.limit_packets, " packets, update ",
+             update_us, " us, late ", late_us, " us");
+}
+
+bool NetworkEmulator::ApplyWithTc(const NetlinkQdisc::NetemParams& params) {
+    // Same full state as SetNetem(). tc only sends reorder and corrupt when
+    // named, so they are always named, zero or not. One gap: tc cannot send
+    // a uniform table, so uniform jitter after a shaped one keeps the shape.
+    std::string options = "rate " + std::to_string(params.rate_kbps) + "kbit delay " +
+                          std::to_string(params.delay_ms) + "ms";
+    if (params.jitter_ms > 0) {
+        options += " " + std::to_string(params.jitter_ms) + "ms";
+        if (params.jitter_distribution != NetlinkQdisc::Distribution::kUniform) {
+            options += " distribution ";
+            options += NetlinkQdisc::DistributionName(params.jitter_distribution);
+        }
+    }
+    options += " limit " + std::to_string(params.limit_packets);
+    if (params.loss_model == NetlinkQdisc::LossModel::kGilbertElliott) {
+        options += " loss gemodel " + std::to_string(params.ge_p_pct) + "% " +
+                   std::to_string(params.ge_r_pct) + "% " +
+                   std::to_string(100 - params.ge_bad_loss_pct) + "% " +
+                   std::to_string(params.ge_good_loss_pct) + "%";
+    } else if (params.loss_pct > 0) {
+        options += " loss random " + std::to_string(params.loss_pct) + "%";
+    }
+    options += " reorder " + std::to_string(params.reorder_pct) + "%";
+    if (params.duplicate_pct > 0)
+        options += " duplicate " + std::to_string(params.duplicate_pct) + "%";
+    options += " corrupt " + std::to_string(params.corrupt_pct) + "%";
+
     // Apply tc rules to veth_ns in namespace
-    std::string cmd = "sudo ip netns exec ns1 tc qdisc change dev veth_ns root netem rate " + 
-                     std::to_string(bandwidth_kbps) + "kbit delay " + 
-                     std::to_string(latency_ms) + "ms limit 50000";
-    
+    std::string cmd = "sudo ip netns exec ns1 tc qdisc change dev veth_ns root netem " +
+                      options;
+
     if (system(cmd.c_str()) != 0) {
         // If change fails, try to add the qdisc
-        cmd = "sudo ip netns exec ns1 tc qdisc add dev veth_ns root netem rate " + 
-              std::to_string(bandwidth_kbps) + "kbit delay " + 
-              std::to_string(latency_ms) + "ms limit 50000";
-        
+        cmd = "sudo ip netns exec ns1 tc qdisc add dev veth_ns root netem " + options;
+
         if (system(cmd.c_str()) != 0) {
             LOG_ERROR(NETWORK_EMULATOR_MODULE_NAME, "Failed to apply tc rules to veth_ns");
-            return;
+            return false;
         }
     }
-
-    LOG_INFO(NETWORK_EMULATOR_MODULE_NAME, "Applied to veth_ns - Rate: ", 
-             bandwidth_kbps, " kbps, Delay: ", latency_ms, " ms");
-
-    // Log the tc rules for verification
-    cmd = "sudo ip netns exec ns1 tc qdisc show dev veth_ns";
-    system(cmd.c_str());
+    return true;
 }
\ No newline at end of file
@@ -7,14 +7,33 @@
 #include <vector>
 #include <memory>
 #include <algorithm> // For sorting
+#include <optional>
 #include "../../logger/Logger.h"
+#include "ebpf_shaper.h"
+#include "netlink_qdisc.h"
+#include "packet_capture.h"
+#include "trace_link_shaper.h"
 
 class NetworkEmulator {
 public:
+    // One row of the profile CSV. The first three columns are positional:
+    // timestamp_ms, bandwidth_kbps, latency_ms. Any further columns are
+    // picked by header name and an empty cell keeps the default:
+    //
+    //   jitter_ms, jitter_dist     uniform|normal|pareto|paretonormal
+    //   loss_pct, loss_model       bernoulli|ge; for ge, loss_pct is unused
+    //                              and ge_p_pct, ge_r_pct, ge_bad_loss_pct,
+    //                              ge_good_loss_pct give the model
+    //   reorder_pct, duplicate_pct, corrupt_pct
+    //   queue_packets | queue_bytes | queue_ms   at most one per row
+    //
+    // Each row replaces the whole link state, so an impairment lasts only
+    // as long as the rows that set it.
     struct NetworkProfile {
-        int64_t timestamp_ms;
-        double bandwidth_kbps;
-        double latency_ms;
+        int64_t timestamp_ms = 0;
+        NetlinkQdisc::NetemParams netem;
+        // The eBPF shaper's queue bound, from the same queue_* column.
+        double max_backlog_ms = 1000;
     };
 
     NetworkEmulator();
@@ -41,11 +60,38 @@ public:
         loop_ = loop;
         repeat_count_ = std::max(1, repeat_count);
     }
+    // Shapes veth_ns with cellular_emulator.bpf.o under fq instead of netem,
+    // writing per-packet records to |telemetry_path| if set. Falls back to
+    // netem if the program cannot be attached.
+    void SetEbpfShaper(const std::string& object_path,
+                       const std::string& telemetry_path) {
+        ebpf_object_path_ = object_path;
+        ebpf_telemetry_path_ = telemetry_path;
+    }
+    // Records RTP/RTCP/DTLS/SCTP packets on veth_ns (tap 0) and veth_host
+    // (tap 1) to |path| while emulation runs; see PacketCapture.
+    void SetCapture(const std::string& path) { capture_path_ = path; }
+    // Replaces netem with the userspace trace shaper. Must be called before
+    // Initialize(), which then puts the shaper between veth_host and
+    // veth_ns; downlink is towards the namespace.
+    void SetTraceShaper(const TraceLinkShaper::Direction& uplink,
+                        const TraceLinkShaper::Direction& downlink) {
+        TraceLinkShaper::Config config;
+        config.host_interface = "veth_shh";
+        config.namespace_interface = "veth_shn";
+        config.uplink = uplink;
+        config.downlink = downlink;
+        trace_config_ = config;
+    }
 
 private:
     bool ParseProfileFile();
     void EmulationLoop();
-    void ApplyNetworkConditions(double bandwidth_kbps, double latency_ms);
+    void ApplyNetworkConditions(const NetworkProfile& profile, int64_t late_us);
+    // Slow path for when rtnetlink is unavailable (e.g. no CAP_SYS_ADMIN).
+    bool ApplyWithTc(const NetlinkQdisc::NetemParams& params);
+    // fq limits large enough to hold the eBPF shaper's worst step.
+    NetlinkQdisc::FqParams FqParamsForProfiles() const;
 
     std::string profile_path_;
     std::string interface_name_;
@@ -58,6 +104,24 @@ private:
     bool loop_ = false;
     int  repeat_count_ = 1;                
     int64_t profile_duration_ms_ = 0;      
+
+    std::optional<TraceLinkShaper::Config> trace_config_;
+    std::unique_ptr<TraceLinkShaper> trace_shaper_;
+
+    std::string capture_path_;
+    std::unique_ptr<PacketCapture> capture_;
+
+    std::string ebpf_object_path_;
+    std::string ebpf_telemetry_path_;
+    std::unique_ptr<EbpfShaper> ebpf_shaper_;
+
+    // Root qdisc of veth_ns, programmed from the emulation thread.
+    NetlinkQdisc qdisc_;
+    int64_t update_count_ = 0;
+    int64_t update_total_us_ = 0;
+    int64_t update_max_us_ = 0;
+    int64_t late_max_us_ = 0;
+    bool warned_ebpf_impairments_ = false;
 };
 
 #endif // NETWORK_EMULATOR_H_
\ No newline at end of file
@@ -0,0 +1,321 @@
+#include "packet_capture.h"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../../logger/Logger.h"
+#include "netns.h"
+
+static const char* PACKET_CAPTURE_MODULE_NAME = "CAPTURE";
+
+namespace {
+
+// 16 x 1 MiB blocks; a block is handed over when full or after
+// kBlockTimeoutMs, whichever comes first.
+constexpr unsigned int kBlockSize = 1 << 20;
+constexpr unsigned int kBlockCount = 16;
+constexpr unsigned int kFrameSize = 2048;
+constexpr unsigned int kBlockTimeoutMs = 10;
+// Enough for Ethernet, IPv4 with options, UDP and the RTP/DTLS header.
+constexpr uint32_t kSnapLength = 128;
+constexpr int kPollTimeoutMs = 100;
+
+constexpr size_t kIpv4MinHeader = 20;
+constexpr size_t kUdpHeader = 8;
+constexpr size_t kSctpCommonHeader = 12;
+constexpr uint8_t kSctpData = 0;
+
+uint16_t ReadU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] << 8 | p[1]);
+}
+
+uint32_t ReadU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+           static_cast<uint32_t>(p[2]) << 8 | p[3];
+}
+
+int64_t ClockNs(clockid_t clock) {
+    timespec now;
+    clock_gettime(clock, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+// Fills the key fields of |record| from a UDP payload. Returns false for
+// anything that is not RTP, RTCP or DTLS (STUN, for one).
+bool ClassifyUdp(const uint8_t* payload, size_t size, CaptureRecord* record) {
+    if (size < 1)
+        return false;
+    const uint8_t first = payload[0];
+    // RFC 7983 demultiplexing on the first byte.
+    if (first >= 128 && first <= 191) {
+        if (size < 12)
+            return false;
+        const uint8_t payload_type = payload[1];
+        if (payload_type >= 192 && payload_type <= 223) {
+            record->flags = CaptureRecord::kRtcp;
+            record->stream = ReadU32(payload + 4);
+            return true;
+        }
+        record->flags = CaptureRecord::kRtp;
+        record->sequence = ReadU16(payload + 2);
+        record->rtp_timestamp = ReadU32(payload + 4);
+        record->stream = ReadU32(payload + 8);
+        return true;
+    }
+    if (first >= 20 && first <= 25) {
+        // DTLS 1.2 record: type, version(2), epoch(2), sequence(6), length.
+        // DTLS 1.3 unified headers (0x20-0x3f) have a different layout and
+        // are not classified.
+        if (size < 13)
+            return false;
+        record->flags = CaptureRecord::kDtls;
+        uint64_t sequence = 0;
+        for (int i = 3; i < 11; ++i)
+            sequence = sequence << 8 | payload[i];
+        record->sequence = sequence;
+        return true;
+    }
+    return false;
+}
+
+bool ClassifySctp(const uint8_t* packet, size_t size, CaptureRecord* record) {
+    if (size < kSctpCommonHeader + 8)
+        return false;
+    record->flags = CaptureRecord::kSctp;
+    record->stream = ReadU32(packet + 4);
+    const uint8_t* chunk = packet + kSctpCommonHeader;
+    if (chunk[0] == kSctpData)
+        record->sequence = ReadU32(chunk + 4);
+    return true;
+}
+
+}  // namespace
+
+PacketCapture::~PacketCapture() {
+    Stop();
+}
+
+bool PacketCapture::OpenRing(const Tap& tap, Ring* ring) {
+    std::string error;
+    int ifindex = 0;
+    int fd = -1;
+    // Packet sockets see the namespace they are created in.
+    RunInNetns(tap.netns, [&] {
+        ifindex = static_cast<int>(if_nametoindex(tap.interface_name.c_str()));
+        if (ifindex == 0) {
+            error = "unknown interface";
+            return;
+        }
+        // Protocol 0 receives nothing until bind() names the protocol and
+        // interface, so no other interface's frames land in the ring first.
+        fd = ::socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            error = std::strerror(errno);
+    }, &error);
+    if (fd < 0) {
+        LOG_ERROR(PACKET_CAPTURE_MODULE_NAME, "Cannot capture on ", tap.interface_name,
+                  ": ", error);
+        return false;
+    }
+
+    // Truncate in the kernel; only headers are needed.
+    sock_filter snap = BPF_STMT(BPF_RET | BPF_K, kSnapLength);
+    sock_fprog program = {1, &snap};
+    int version = TPACKET_V3;
+    tpacket_req3 request = {};
+    request.tp_block_size = kBlockSize;
+    request.tp_block_nr = kBlockCount;
+    request.tp_frame_size = kFrameSize;
+    request.tp_frame_nr = kBlockSize / kFrameSize * kBlockCount;
+    request.tp_retire_blk_tov = kBlockTimeoutMs;
+
+    sockaddr_ll address = {};
+    address.sll_family = AF_PACKET;
+    address.sll_protocol = htons(ETH_P_ALL);
+    address.sll_ifindex = ifindex;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) != 0 ||
+        setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0 ||
+        setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) != 0) {
+        LOG_ERROR(PACKET_CAPTURE_MODULE_NAME, "Cannot set up a TPACKET_V3 ring on ",
+                  tap.interface_name, ": ", std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    const size_t map_size = static_cast<size_t>(kBlockSize) * kBlockCount;
+    void* map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        LOG_ERROR(PACKET_CAPTURE_MODULE_NAME, "mmap failed on ", tap.interface_name,
+                  ": ", std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        LOG_ERROR(PACKET_CAPTURE_MODULE_NAME, "Binding to ", tap.interface_name,
+                  " failed: ", std::strerror(errno));
+        munmap(map, map_size);
+        ::close(fd);
+        return false;
+    }
+
+    ring->fd = fd;
+    ring->map = static_cast<uint8_t*>(map);
+    ring->map_size = map_size;
+    ring->block_count = kBlockCount;
+    ring->block_size = kBlockSize;
+    ring->next_block = 0;
+    return true;
+}
+
+void PacketCapture::CloseRing(Ring* ring) {
+    if (ring->map)
+        munmap(ring->map, ring->map_size);
+    if (ring->fd >= 0)
+        ::close(ring->fd);
+    *ring = Ring();
+}
+
+bool PacketCapture::Start(const std::vector<Tap>& taps, const std::string& path) {
+    if (running_)
+        return true;
+
+    rings_.assign(taps.size(), Ring());
+    for (size_t i = 0; i < taps.size(); ++i) {
+        if (!OpenRing(taps[i], &rings_[i])) {
+            for (Ring& ring : rings_)
+                CloseRing(&ring);
+            rings_.clear();
+            return false;
+        }
+    }
+
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        LOG_ERROR(PACKET_CAPTURE_MODULE_NAME, "Cannot write ", path);
+        for (Ring& ring : rings_)
+            CloseRing(&ring);
+        rings_.clear();
+        return false;
+    }
+    CaptureFileHeader header = {{'P', 'K', 'T', 'C', 'A', 'P', '0', '1'},
+                                sizeof(CaptureRecord),
+                                static_cast<uint32_t>(taps.size()),
+                                ClockNs(CLOCK_REALTIME) - ClockNs(CLOCK_MONOTONIC)};
+    std::fwrite(&header, sizeof(header), 1, file_);
+    for (const Tap& tap : taps) {
+        CaptureTapName name = {};
+        std::strncpy(name.interface_name, tap.interface_name.c_str(),
+                     sizeof(name.interface_name) - 1);
+        std::fwrite(&name, sizeof(name), 1, file_);
+    }
+
+    records_ = 0;
+    running_ = true;
+    thread_ = std::thread(&PacketCapture::Run, this);
+    LOG_INFO(PACKET_CAPTURE_MODULE_NAME, "Capturing ", taps.size(), " taps to ", path);
+    return true;
+}
+
+void PacketCapture::Stop() {
+    if (!running_)
+        return;
+    running_ = false;
+    thread_.join();
+    // Blocks the kernel has not retired yet are lost; at most
+    // kBlockTimeoutMs worth per tap.
+    for (size_t i = 0; i < rings_.size(); ++i) {
+        DrainRing(static_cast<uint8_t>(i), &rings_[i]);
+        CloseRing(&rings_[i]);
+    }
+    rings_.clear();
+    std::fclose(file_);
+    file_ = nullptr;
+    LOG_INFO(PACKET_CAPTURE_MODULE_NAME, "Captured ", records_, " packets");
+}
+
+void PacketCapture::Run() {
+    std::vector<pollfd> fds;
+    for (const Ring& ring : rings_)
+        fds.push_back({ring.fd, POLLIN | POLLERR, 0});
+    while (running_) {
+        for (size_t i = 0; i < rings_.size(); ++i)
+            DrainRing(static_cast<uint8_t>(i), &rings_[i]);
+        poll(fds.data(), fds.size(), kPollTimeoutMs);
+    }
+}
+
+void PacketCapture::DrainRing(uint8_t tap, Ring* ring) {
+    while (true) {
+        auto* block = reinterpret_cast<tpacket_block_desc*>(
+            ring->map + static_cast<size_t>(ring->next_block) * ring->block_size);
+        if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+              TP_STATUS_USER)) {
+            return;
+        }
+        const uint32_t packets = block->hdr.bh1.num_pkts;
+        auto* packet = reinterpret_cast<const tpacket3_hdr*>(
+            reinterpret_cast<const uint8_t*>(block) + block->hdr.bh1.offset_to_first_pkt);
+        for (uint32_t i = 0; i < packets; ++i) {
+            const auto* link = reinterpret_cast<const sockaddr_ll*>(
+                reinterpret_cast<const uint8_t*>(packet) +
+                TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+            const uint64_t timestamp_ns =
+                static_cast<uint64_t>(packet->tp_sec) * 1000000000 + packet->tp_nsec;
+            HandleFrame(tap, reinterpret_cast<const uint8_t*>(packet) + packet->tp_mac,
+                        packet->tp_snaplen, packet->tp_len,
+                        link->sll_pkttype == PACKET_OUTGOING, timestamp_ns);
+            packet = reinterpret_cast<const tpacket3_hdr*>(
+                reinterpret_cast<const uint8_t*>(packet) + packet->tp_next_offset);
+        }
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL,
+                         __ATOMIC_RELEASE);
+        ring->next_block = (ring->next_block + 1) % ring->block_count;
+    }
+}
+
+void PacketCapture::HandleFrame(uint8_t tap, const uint8_t* frame, uint32_t captured,
+                                uint32_t length, bool outgoing, uint64_t timestamp_ns) {
+    if (captured < ETH_HLEN + kIpv4MinHeader || ReadU16(frame + 12) != ETH_P_IP)
+        return;
+    const uint8_t* ip = frame + ETH_HLEN;
+    const size_t ip_header = static_cast<size_t>(ip[0] & 0x0f) * 4;
+    if ((ip[0] >> 4) != 4 || ip_header < kIpv4MinHeader ||
+        ETH_HLEN + ip_header + 4 > captured) {
+        return;
+    }
+    const uint8_t* l4 = ip + ip_header;
+    const size_t l4_size = captured - ETH_HLEN - ip_header;
+
+    CaptureRecord record = {};
+    bool keep = false;
+    if (ip[9] == IPPROTO_UDP && l4_size >= kUdpHeader) {
+        keep = ClassifyUdp(l4 + kUdpHeader, l4_size - kUdpHeader, &record);
+    } else if (ip[9] == IPPROTO_SCTP) {
+        keep = ClassifySctp(l4, l4_size, &record);
+    }
+    if (!keep)
+        return;
+
+    record.timestamp_ns = timestamp_ns;
+    std::memcpy(&record.saddr, ip + 12, 4);
+    std::memcpy(&record.daddr, ip + 16, 4);
+    std::memcpy(&record.sport, l4, 2);
+    std::memcpy(&record.dport, l4 + 2, 2);
+    record.length = static_cast<uint16_t>(length > 0xffff ? 0xffff : length);
+    record.tap = tap;
+    if (outgoing)
+        record.flags |= CaptureRecord::kOutgoing;
+    std::fwrite(&record, sizeof(record), 1, file_);
+    records_++;
+}
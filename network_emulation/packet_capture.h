@@ -0,0 +1,103 @@
+#ifndef PACKET_CAPTURE_H_
+#define PACKET_CAPTURE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Ground-truth packet timestamps at the emulated link's interfaces, for
+// telling bottleneck queueing apart from host stack and endpoint delay
+// (see join_capture.py).
+//
+// Each tap is a TPACKET_V3 mmap ring on one interface, seeing both
+// directions. Only the media and data channel packets are kept, each as a
+// 40-byte CaptureRecord keyed so the same packet can be matched across
+// taps:
+//
+//   RTP    stream = SSRC, sequence = RTP sequence number
+//   RTCP   stream = sender SSRC, sequence = 0
+//   DTLS   stream = 0, sequence = epoch << 48 | record sequence number
+//          (WebRTC data channels: SCTP runs inside DTLS, so its TSN is
+//          encrypted and the DTLS record number stands in for it)
+//   SCTP   stream = verification tag, sequence = TSN of the first DATA
+//          chunk (plain SCTP over IP)
+//
+// File layout, host byte order: CaptureFileHeader, one CaptureTapName per
+// tap, then CaptureRecords in the order the rings returned them (per tap
+// in time order, interleaved across taps).
+struct CaptureFileHeader {
+    char magic[8];            // "PKTCAP01"
+    uint32_t record_size;     // sizeof(CaptureRecord)
+    uint32_t tap_count;
+    // CLOCK_REALTIME - CLOCK_MONOTONIC at start, to line records up with
+    // the monotonic eBPF shaper telemetry.
+    int64_t realtime_offset_ns;
+};
+
+struct CaptureTapName {
+    char interface_name[16];
+};
+
+struct CaptureRecord {
+    enum Kind : uint8_t { kRtp = 1, kRtcp = 2, kDtls = 3, kSctp = 4 };
+    static constexpr uint8_t kKindMask = 0x0f;
+    static constexpr uint8_t kOutgoing = 0x80;
+
+    uint64_t timestamp_ns;  // kernel CLOCK_REALTIME
+    uint64_t sequence;
+    uint32_t stream;
+    uint32_t rtp_timestamp;
+    uint32_t saddr;         // network order
+    uint32_t daddr;
+    uint16_t sport;         // network order
+    uint16_t dport;
+    uint16_t length;        // on the wire, Ethernet header included
+    uint8_t tap;
+    uint8_t flags;          // Kind | kOutgoing
+};
+static_assert(sizeof(CaptureRecord) == 40, "CaptureRecord is a file format");
+
+class PacketCapture {
+public:
+    struct Tap {
+        std::string netns;  // empty for the current namespace
+        std::string interface_name;
+    };
+
+    PacketCapture() = default;
+    ~PacketCapture();
+
+    PacketCapture(const PacketCapture&) = delete;
+    PacketCapture& operator=(const PacketCapture&) = delete;
+
+    bool Start(const std::vector<Tap>& taps, const std::string& path);
+    void Stop();
+
+private:
+    struct Ring {
+        int fd = -1;
+        uint8_t* map = nullptr;
+        size_t map_size = 0;
+        unsigned int block_count = 0;
+        unsigned int block_size = 0;
+        unsigned int next_block = 0;
+    };
+
+    bool OpenRing(const Tap& tap, Ring* ring);
+    void CloseRing(Ring* ring);
+    void Run();
+    void DrainRing(uint8_t tap, Ring* ring);
+    void HandleFrame(uint8_t tap, const uint8_t* frame, uint32_t captured,
+                     uint32_t length, bool outgoing, uint64_t timestamp_ns);
+
+    std::vector<Ring> rings_;
+    FILE* file_ = nullptr;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    uint64_t records_ = 0;
+};
+
+#endif // PACKET_CAPTURE_H_
@@ -0,0 +1,195 @@
+#include "packet_queue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+constexpr int64_t kCoDelTargetUs = 5000;
+constexpr int64_t kCoDelIntervalUs = 100000;
+constexpr int64_t kMaxPacketBytes = 1514;
+
+constexpr int64_t kPieTargetUs = 15000;
+constexpr int64_t kPieUpdateUs = 15000;
+constexpr double kPieAlpha = 0.125;
+constexpr double kPieBeta = 1.25;
+// RFC 8033 section 4.2: past 10% the probability rises at most 2% per
+// update, so a single delay spike cannot push it to 100%.
+constexpr double kPieMaxDeltaProbability = 0.1;
+constexpr double kPieMaxDelta = 0.02;
+
+}  // namespace
+
+bool PacketQueue::ParseAqm(const std::string& name, Aqm* aqm) {
+    if (name == "droptail") {
+        *aqm = Aqm::kDropTail;
+    } else if (name == "codel") {
+        *aqm = Aqm::kCoDel;
+    } else if (name == "pie") {
+        *aqm = Aqm::kPie;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<PacketQueue> PacketQueue::Create(Aqm aqm, int64_t limit_bytes) {
+    switch (aqm) {
+        case Aqm::kCoDel:
+            return std::make_unique<CoDelQueue>(limit_bytes);
+        case Aqm::kPie:
+            return std::make_unique<PieQueue>(limit_bytes);
+        case Aqm::kDropTail:
+            break;
+    }
+    return std::make_unique<PacketQueue>(limit_bytes);
+}
+
+bool PacketQueue::Enqueue(ShapedPacket packet, int64_t now_us) {
+    const int64_t length = static_cast<int64_t>(packet.data.size());
+    if ((limit_bytes_ > 0 && bytes_ + length > limit_bytes_) ||
+        ShouldDropOnEnqueue(now_us)) {
+        dropped_++;
+        return false;
+    }
+    packet.enqueue_us = now_us;
+    bytes_ += length;
+    packets_.push_back(std::move(packet));
+    return true;
+}
+
+bool PacketQueue::Dequeue(int64_t /*now_us*/, ShapedPacket* packet) {
+    return PopFront(packet);
+}
+
+bool PacketQueue::PopFront(ShapedPacket* packet) {
+    if (packets_.empty())
+        return false;
+    *packet = std::move(packets_.front());
+    packets_.pop_front();
+    bytes_ -= static_cast<int64_t>(packet->data.size());
+    return true;
+}
+
+bool CoDelQueue::DoDequeue(int64_t now_us, ShapedPacket* packet,
+                           bool* ok_to_drop) {
+    *ok_to_drop = false;
+    if (!PopFront(packet)) {
+        first_above_time_us_ = 0;
+        return false;
+    }
+    const int64_t sojourn_us = now_us - packet->enqueue_us;
+    if (sojourn_us < kCoDelTargetUs || bytes_ <= kMaxPacketBytes) {
+        first_above_time_us_ = 0;
+    } else if (first_above_time_us_ == 0) {
+        first_above_time_us_ = now_us + kCoDelIntervalUs;
+    } else if (now_us >= first_above_time_us_) {
+        *ok_to_drop = true;
+    }
+    return true;
+}
+
+int64_t CoDelQueue::ControlLaw(int64_t t_us) const {
+    return t_us + static_cast<int64_t>(kCoDelIntervalUs / std::sqrt(count_));
+}
+
+bool CoDelQueue::Dequeue(int64_t now_us, ShapedPacket* packet) {
+    bool ok_to_drop = false;
+    if (!DoDequeue(now_us, packet, &ok_to_drop)) {
+        dropping_ = false;
+        return false;
+    }
+    if (dropping_) {
+        if (!ok_to_drop)
+            dropping_ = false;
+        while (dropping_ && now_us >= drop_next_us_) {
+            dropped_++;
+            count_++;
+            if (!DoDequeue(now_us, packet, &ok_to_drop)) {
+                dropping_ = false;
+                return false;
+            }
+            if (!ok_to_drop) {
+                dropping_ = false;
+            } else {
+                drop_next_us_ = ControlLaw(drop_next_us_);
+            }
+        }
+    } else if (ok_to_drop) {
+        dropped_++;
+        if (!DoDequeue(now_us, packet, &ok_to_drop))
+            return false;
+        dropping_ = true;
+        // Resume near the previous drop rate if we only just left the
+        // dropping state.
+        const uint32_t delta = count_ - last_count_;
+        count_ = 1;
+        if (delta > 1 && now_us - drop_next_us_ < 16 * kCoDelIntervalUs)
+            count_ = delta;
+        drop_next_us_ = ControlLaw(now_us);
+        last_count_ = count_;
+    }
+    return true;
+}
+
+PieQueue::PieQueue(int64_t limit_bytes)
+    : PacketQueue(limit_bytes), random_(std::random_device()()) {}
+
+bool PieQueue::Dequeue(int64_t now_us, ShapedPacket* packet) {
+    if (!PopFront(packet)) {
+        queue_delay_us_ = 0;
+        return false;
+    }
+    queue_delay_us_ = now_us - packet->enqueue_us;
+    return true;
+}
+
+bool PieQueue::ShouldDropOnEnqueue(int64_t now_us) {
+    UpdateProbability(now_us);
+    // Safeguards from RFC 8033 section 4.1: no drops while the queue is
+    // short or the delay has been well under target.
+    if (queue_delay_old_us_ < kPieTargetUs / 2 && drop_probability_ < 0.2)
+        return false;
+    if (bytes_ <= 2 * kMaxPacketBytes)
+        return false;
+    return std::uniform_real_distribution<double>(0.0, 1.0)(random_) <
+           drop_probability_;
+}
+
+void PieQueue::UpdateProbability(int64_t now_us) {
+    if (next_update_us_ == 0)
+        next_update_us_ = now_us + kPieUpdateUs;
+    while (now_us >= next_update_us_) {
+        next_update_us_ += kPieUpdateUs;
+        if (packets_.empty())
+            queue_delay_us_ = 0;
+
+        // Auto-tuning: scale the gains down while the probability is low
+        // so it ramps up gently.
+        double scale = 1.0;
+        if (drop_probability_ < 0.000001)
+            scale = 1.0 / 2048;
+        else if (drop_probability_ < 0.00001)
+            scale = 1.0 / 512;
+        else if (drop_probability_ < 0.0001)
+            scale = 1.0 / 128;
+        else if (drop_probability_ < 0.001)
+            scale = 1.0 / 32;
+        else if (drop_probability_ < 0.01)
+            scale = 1.0 / 8;
+        else if (drop_probability_ < 0.1)
+            scale = 1.0 / 2;
+
+        double delta =
+            scale * (kPieAlpha * (queue_delay_us_ - kPieTargetUs) +
+                     kPieBeta * (queue_delay_us_ - queue_delay_old_us_)) /
+            1e6;
+        if (drop_probability_ >= kPieMaxDeltaProbability)
+            delta = std::min(delta, kPieMaxDelta);
+        drop_probability_ = std::clamp(drop_probability_ + delta, 0.0, 1.0);
+        if (queue_delay_us_ == 0 && queue_delay_old_us_ == 0)
+            drop_probability_ *= 0.98;
+        queue_delay_old_us_ = queue_delay_us_;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef PACKET_QUEUE_H_
+#define PACKET_QUEUE_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// One Ethernet frame inside the userspace shaper.
+struct ShapedPacket {
+    std::vector<uint8_t> data;
+    int64_t enqueue_us = 0;
+};
+
+// Bottleneck queue of one link direction. Drops on enqueue once
+// |limit_bytes| is queued (0 is unbounded); the AQM variants may also drop
+// earlier, on enqueue (PIE) or dequeue (CoDel).
+class PacketQueue {
+public:
+    enum class Aqm { kDropTail, kCoDel, kPie };
+
+    static bool ParseAqm(const std::string& name, Aqm* aqm);
+    static std::unique_ptr<PacketQueue> Create(Aqm aqm, int64_t limit_bytes);
+
+    explicit PacketQueue(int64_t limit_bytes) : limit_bytes_(limit_bytes) {}
+    virtual ~PacketQueue() = default;
+
+    // Returns false if the packet was dropped.
+    bool Enqueue(ShapedPacket packet, int64_t now_us);
+    // Returns false when nothing is left to send.
+    virtual bool Dequeue(int64_t now_us, ShapedPacket* packet);
+
+    size_t size_packets() const { return packets_.size(); }
+    int64_t size_bytes() const { return bytes_; }
+    bool empty() const { return packets_.empty(); }
+    int64_t dropped() const { return dropped_; }
+
+protected:
+    // Early drop for AQMs that decide on arrival.
+    virtual bool ShouldDropOnEnqueue(int64_t /*now_us*/) { return false; }
+
+    bool PopFront(ShapedPacket* packet);
+
+    const int64_t limit_bytes_;
+    std::deque<ShapedPacket> packets_;
+    int64_t bytes_ = 0;
+    int64_t dropped_ = 0;
+};
+
+// RFC 8289, 5 ms target and 100 ms interval.
+class CoDelQueue : public PacketQueue {
+public:
+    explicit CoDelQueue(int64_t limit_bytes) : PacketQueue(limit_bytes) {}
+
+    bool Dequeue(int64_t now_us, ShapedPacket* packet) override;
+
+private:
+    // dodequeue() of the RFC: pops the head and says whether CoDel may
+    // drop it.
+    bool DoDequeue(int64_t now_us, ShapedPacket* packet, bool* ok_to_drop);
+    int64_t ControlLaw(int64_t t_us) const;
+
+    int64_t first_above_time_us_ = 0;
+    int64_t drop_next_us_ = 0;
+    uint32_t count_ = 0;
+    uint32_t last_count_ = 0;
+    bool dropping_ = false;
+};
+
+// RFC 8033 with the queue delay taken from packet timestamps: 15 ms target,
+// probability updated every 15 ms.
+class PieQueue : public PacketQueue {
+public:
+    explicit PieQueue(int64_t limit_bytes);
+
+    bool Dequeue(int64_t now_us, ShapedPacket* packet) override;
+
+    double drop_probability() const { return drop_probability_; }
+
+protected:
+    bool ShouldDropOnEnqueue(int64_t now_us) override;
+
+private:
+    void UpdateProbability(int64_t now_us);
+
+    std::mt19937 random_;
+    double drop_probability_ = 0;
+    int64_t queue_delay_us_ = 0;
+    int64_t queue_delay_old_us_ = 0;
+    int64_t next_update_us_ = 0;
+};
+
+#endif // PACKET_QUEUE_H_
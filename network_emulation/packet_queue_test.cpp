@@ -0,0 +1,121 @@
+#include "packet_queue.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+ShapedPacket Packet(size_t bytes = 1000) {
+    ShapedPacket packet;
+    packet.data.resize(bytes);
+    return packet;
+}
+
+// Times (in ms) at which a CoDel queue holding a standing backlog drops,
+// when one packet is dequeued every millisecond from |first_ms| on.
+std::vector<int64_t> CoDelDropTimesMs(int64_t first_ms, int64_t last_ms) {
+    CoDelQueue queue(0);
+    for (int i = 0; i < 1000; ++i)
+        queue.Enqueue(Packet(), 0);
+    std::vector<int64_t> drops;
+    for (int64_t ms = first_ms; ms <= last_ms; ++ms) {
+        const int64_t dropped = queue.dropped();
+        ShapedPacket packet;
+        EXPECT_TRUE(queue.Dequeue(ms * 1000, &packet));
+        if (queue.dropped() != dropped)
+            drops.push_back(ms);
+    }
+    return drops;
+}
+
+TEST(CoDelQueueTest, NoDropsBelowTarget) {
+    CoDelQueue queue(0);
+    for (int64_t ms = 0; ms < 1000; ++ms) {
+        queue.Enqueue(Packet(), ms * 1000);
+        queue.Enqueue(Packet(), ms * 1000);
+        ShapedPacket packet;
+        // Each packet waits 2 ms, under the 5 ms target.
+        ASSERT_TRUE(queue.Dequeue(ms * 1000 + 2000, &packet));
+        ASSERT_TRUE(queue.Dequeue(ms * 1000 + 2000, &packet));
+    }
+    EXPECT_EQ(queue.dropped(), 0);
+}
+
+TEST(CoDelQueueTest, DropScheduleFollowsControlLaw) {
+    // Above target from 10 ms: the first drop comes one interval later,
+    // then every interval / sqrt(count).
+    EXPECT_EQ(CoDelDropTimesMs(10, 400),
+              (std::vector<int64_t>{110, 210, 281, 339, 389}));
+}
+
+TEST(CoDelQueueTest, LeavesDroppingStateOnceBelowTarget) {
+    CoDelQueue queue(0);
+    for (int i = 0; i < 300; ++i)
+        queue.Enqueue(Packet(), 0);
+    ShapedPacket packet;
+    for (int64_t ms = 10; ms <= 250; ++ms)
+        ASSERT_TRUE(queue.Dequeue(ms * 1000, &packet));
+    const int64_t dropped = queue.dropped();
+    ASSERT_GT(dropped, 0);
+
+    // Drain, then keep the queue short.
+    while (queue.Dequeue(250000, &packet)) {
+    }
+    for (int64_t ms = 251; ms < 1000; ++ms) {
+        queue.Enqueue(Packet(), ms * 1000);
+        ASSERT_TRUE(queue.Dequeue(ms * 1000 + 1000, &packet));
+    }
+    EXPECT_EQ(queue.dropped(), dropped);
+}
+
+TEST(PieQueueTest, FirstUpdateIsScaledDown) {
+    PieQueue queue(0);
+    queue.Enqueue(Packet(), 0);
+    queue.Enqueue(Packet(), 0);
+    ShapedPacket packet;
+    ASSERT_TRUE(queue.Dequeue(15000, &packet));
+    // Update at 15 ms sees a 15 ms delay, up from 0: only the beta term
+    // counts, scaled by 1/2048 while the probability is below 1e-6.
+    queue.Enqueue(Packet(), 15000);
+    EXPECT_NEAR(queue.drop_probability(), 1.25 * 0.015 / 2048, 1e-12);
+}
+
+TEST(PieQueueTest, NoUpdateBelowTargetFromZero) {
+    PieQueue queue(0);
+    for (int64_t ms = 0; ms < 1000; ms += 5) {
+        queue.Enqueue(Packet(), ms * 1000);
+        ShapedPacket packet;
+        ASSERT_TRUE(queue.Dequeue(ms * 1000 + 1000, &packet));
+    }
+    EXPECT_EQ(queue.drop_probability(), 0);
+    EXPECT_EQ(queue.dropped(), 0);
+}
+
+TEST(PieQueueTest, IncreaseIsCappedAboveTenPercent) {
+    PieQueue queue(0);
+    // Build a 500 ms backlog, one packet per update interval.
+    int64_t now_us = 0;
+    for (; now_us <= 500000; now_us += 15000)
+        queue.Enqueue(Packet(), now_us);
+
+    // Keep the queue growing so every update sees a large delay.
+    double previous = queue.drop_probability();
+    bool capped = false;
+    for (int step = 0; step < 40; ++step, now_us += 15000) {
+        ShapedPacket packet;
+        ASSERT_TRUE(queue.Dequeue(now_us, &packet));
+        for (int i = 0; i < 3; ++i)
+            queue.Enqueue(Packet(), now_us);
+        const double probability = queue.drop_probability();
+        if (previous >= 0.1) {
+            EXPECT_LE(probability - previous, 0.02 + 1e-9);
+            capped = true;
+        }
+        previous = probability;
+    }
+    EXPECT_TRUE(capped);
+    EXPECT_GT(previous, 0.3);
+}
+
+}  // namespace
@@ -0,0 +1,346 @@
+#include "trace_link_shaper.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../../logger/Logger.h"
+
+static const char* TRACE_LINK_SHAPER_MODULE_NAME = "LINK";
+
+namespace {
+
+// Bytes one delivery opportunity carries, as in mahimahi.
+constexpr int64_t kOpportunityBytes = 1504;
+constexpr size_t kMaxFrameBytes = 65536;
+// Bounds how long one busy interface can starve the other.
+constexpr int kMaxReceiveBurst = 256;
+// Upper bound on a poll, so Stop() is noticed.
+constexpr int64_t kMaxWaitMs = 100;
+// Slack past the largest delay, for loop iterations that run late.
+constexpr int64_t kWheelSlackMs = 1024;
+
+int OpenPacketSocket(const std::string& interface_name) {
+    const unsigned int ifindex = if_nametoindex(interface_name.c_str());
+    if (ifindex == 0) {
+        LOG_ERROR(TRACE_LINK_SHAPER_MODULE_NAME, "Unknown interface ", interface_name);
+        return -1;
+    }
+    int fd = ::socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                      htons(ETH_P_ALL));
+    if (fd < 0) {
+        LOG_ERROR(TRACE_LINK_SHAPER_MODULE_NAME, "AF_PACKET socket failed: ",
+                  std::strerror(errno));
+        return -1;
+    }
+    sockaddr_ll address = {};
+    address.sll_family = AF_PACKET;
+    address.sll_protocol = htons(ETH_P_ALL);
+    address.sll_ifindex = static_cast<int>(ifindex);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        LOG_ERROR(TRACE_LINK_SHAPER_MODULE_NAME, "Binding to ", interface_name,
+                  " failed: ", std::strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    // The shaper forwards frames addressed to the far end's MAC.
+    packet_mreq membership = {};
+    membership.mr_ifindex = static_cast<int>(ifindex);
+    membership.mr_type = PACKET_MR_PROMISC;
+    setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &membership,
+               sizeof(membership));
+    return fd;
+}
+
+}  // namespace
+
+bool DeliveryTrace::Load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR(TRACE_LINK_SHAPER_MODULE_NAME, "Failed to open trace: ", path);
+        return false;
+    }
+    return Load(file, path);
+}
+
+bool DeliveryTrace::Load(std::istream& input, const std::string& name) {
+    opportunities_ms_.clear();
+    std::string line;
+    while (std::getline(input, line)) {
+        if (line.empty())
+            continue;
+        try {
+            opportunities_ms_.push_back(std::stoll(line));
+        } catch (const std::exception&) {
+            LOG_ERROR(TRACE_LINK_SHAPER_MODULE_NAME, "Bad trace line in ", name,
+                      ": ", line);
+            return false;
+        }
+    }
+    if (opportunities_ms_.empty() || opportunities_ms_.back() <= 0 ||
+        !std::is_sorted(opportunities_ms_.begin(), opportunities_ms_.end())) {
+        LOG_ERROR(TRACE_LINK_SHAPER_MODULE_NAME, "Trace ", name,
+                  " must be non-decreasing and end after 0 ms");
+        return false;
+    }
+    period_ms_ = opportunities_ms_.back();
+    return true;
+}
+
+int64_t DeliveryTrace::OpportunityMs(uint64_t index) const {
+    const uint64_t size = opportunities_ms_.size();
+    return static_cast<int64_t>(index / size) * period_ms_ +
+           opportunities_ms_[index % size];
+}
+
+uint64_t DeliveryTrace::FirstOpportunityAt(int64_t time_ms) const {
+    const uint64_t size = opportunities_ms_.size();
+    // Repetition k covers (k * period, (k + 1) * period]; the first one also
+    // has whatever the trace holds at 0 ms.
+    const int64_t period = std::max<int64_t>(0, time_ms - 1) / period_ms_;
+    const auto it = std::lower_bound(opportunities_ms_.begin(),
+                                     opportunities_ms_.end(),
+                                     time_ms - period * period_ms_);
+    return static_cast<uint64_t>(period) * size +
+           static_cast<uint64_t>(it - opportunities_ms_.begin());
+}
+
+TimerWheel::TimerWheel(int64_t max_delay_ms)
+    : slots_(static_cast<size_t>(max_delay_ms + kWheelSlackMs)) {}
+
+void TimerWheel::Schedule(int64_t due_ms, ShapedPacket packet) {
+    const int64_t size = static_cast<int64_t>(slots_.size());
+    due_ms = std::clamp(due_ms, cursor_ms_, cursor_ms_ + size - 1);
+    slots_[due_ms % size].push_back(std::move(packet));
+    scheduled_++;
+}
+
+void TimerWheel::Advance(int64_t now_ms, std::vector<ShapedPacket>* expired) {
+    const int64_t size = static_cast<int64_t>(slots_.size());
+    const int64_t end_ms = std::min(now_ms + 1, cursor_ms_ + size);
+    for (int64_t t = cursor_ms_; scheduled_ > 0 && t < end_ms; ++t) {
+        std::vector<ShapedPacket>& slot = slots_[t % size];
+        scheduled_ -= slot.size();
+        for (ShapedPacket& packet : slot)
+            expired->push_back(std::move(packet));
+        slot.clear();
+    }
+    cursor_ms_ = std::max(cursor_ms_, now_ms + 1);
+}
+
+int64_t TimerWheel::NextDueMs() const {
+    if (scheduled_ == 0)
+        return -1;
+    const int64_t size = static_cast<int64_t>(slots_.size());
+    for (int64_t t = cursor_ms_; t < cursor_ms_ + size; ++t) {
+        if (!slots_[t % size].empty())
+            return t;
+    }
+    return -1;
+}
+
+TraceBottleneck::TraceBottleneck(const DeliveryTrace& trace,
+                                 std::unique_ptr<PacketQueue> queue,
+                                 int64_t delay_ms)
+    : trace_(trace),
+      queue_(std::move(queue)),
+      wheel_(delay_ms),
+      delay_ms_(delay_ms) {}
+
+void TraceBottleneck::Enqueue(ShapedPacket packet, int64_t now_us) {
+    // Nothing was waiting for the opportunities since the last one served,
+    // so they must not be spent on a packet that arrived after them.
+    if (!serving_ && queue_->empty()) {
+        next_opportunity_ = std::max(next_opportunity_,
+                                     trace_.FirstOpportunityAt(now_us / 1000));
+    }
+    queue_->Enqueue(std::move(packet), now_us);
+}
+
+void TraceBottleneck::ServeOpportunities(int64_t now_us) {
+    const int64_t now_ms = now_us / 1000;
+    while (trace_.OpportunityMs(next_opportunity_) <= now_ms) {
+        const int64_t opportunity_ms = trace_.OpportunityMs(next_opportunity_++);
+        // Capacity of an opportunity nobody uses is lost, as on a real
+        // cellular link.
+        int64_t credit = kOpportunityBytes;
+        while (credit > 0) {
+            if (!serving_) {
+                if (!queue_->Dequeue(now_us, &in_service_))
+                    break;
+                serving_ = true;
+                in_service_sent_bytes_ = 0;
+            }
+            const int64_t remaining =
+                static_cast<int64_t>(in_service_.data.size()) -
+                in_service_sent_bytes_;
+            if (remaining > credit) {
+                in_service_sent_bytes_ += credit;
+                break;
+            }
+            credit -= remaining;
+            wheel_.Schedule(opportunity_ms + delay_ms_, std::move(in_service_));
+            serving_ = false;
+        }
+    }
+}
+
+void TraceBottleneck::Release(int64_t now_ms, std::vector<ShapedPacket>* expired) {
+    wheel_.Advance(now_ms, expired);
+}
+
+int64_t TraceBottleneck::NextWakeMs(int64_t max_ms) const {
+    int64_t wake_ms = max_ms;
+    if (serving_ || !queue_->empty())
+        wake_ms = std::min(wake_ms, trace_.OpportunityMs(next_opportunity_));
+    const int64_t due_ms = wheel_.NextDueMs();
+    if (due_ms >= 0)
+        wake_ms = std::min(wake_ms, due_ms);
+    return wake_ms;
+}
+
+TraceLinkShaper::TraceLinkShaper(const Config& config) : config_(config) {
+    uplink_.name = "uplink";
+    downlink_.name = "downlink";
+}
+
+TraceLinkShaper::~TraceLinkShaper() {
+    Stop();
+}
+
+bool TraceLinkShaper::SetUpLink(Link* link, const Direction& direction,
+                                int in_fd, int out_fd) {
+    DeliveryTrace trace;
+    if (!trace.Load(direction.trace_path))
+        return false;
+    link->in_fd = in_fd;
+    link->out_fd = out_fd;
+    link->bottleneck = std::make_unique<TraceBottleneck>(
+        trace, PacketQueue::Create(direction.aqm, direction.queue_limit_bytes),
+        direction.delay_ms);
+    LOG_INFO(TRACE_LINK_SHAPER_MODULE_NAME, "Shaping ", link->name, " with ",
+             direction.trace_path, " (", trace.size(), " opportunities), ",
+             direction.delay_ms, " ms delay");
+    return true;
+}
+
+bool TraceLinkShaper::Start() {
+    if (running_)
+        return true;
+
+    host_fd_ = OpenPacketSocket(config_.host_interface);
+    namespace_fd_ = OpenPacketSocket(config_.namespace_interface);
+    if (host_fd_ < 0 || namespace_fd_ < 0 ||
+        !SetUpLink(&downlink_, config_.downlink, host_fd_, namespace_fd_) ||
+        !SetUpLink(&uplink_, config_.uplink, namespace_fd_, host_fd_)) {
+        if (host_fd_ >= 0)
+            ::close(host_fd_);
+        if (namespace_fd_ >= 0)
+            ::close(namespace_fd_);
+        host_fd_ = namespace_fd_ = -1;
+        return false;
+    }
+
+    running_ = true;
+    thread_ = std::thread(&TraceLinkShaper::Run, this);
+    return true;
+}
+
+void TraceLinkShaper::Stop() {
+    if (!running_)
+        return;
+    running_ = false;
+    if (thread_.joinable())
+        thread_.join();
+    LogStats(downlink_);
+    LogStats(uplink_);
+    ::close(host_fd_);
+    ::close(namespace_fd_);
+    host_fd_ = namespace_fd_ = -1;
+}
+
+void TraceLinkShaper::Run() {
+    // Opportunities are 1 ms apart at best; keep wakeups on time.
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    auto elapsed_us = [&start] {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - start).count();
+    };
+
+    pollfd fds[2] = {{host_fd_, POLLIN, 0}, {namespace_fd_, POLLIN, 0}};
+    while (running_) {
+        const int64_t now_us = elapsed_us();
+        const int64_t now_ms = now_us / 1000;
+        for (Link* link : {&downlink_, &uplink_}) {
+            Receive(link, now_us);
+            link->bottleneck->ServeOpportunities(now_us);
+            Release(link, now_ms);
+        }
+
+        const int64_t wake_ms =
+            std::min(downlink_.bottleneck->NextWakeMs(now_ms + kMaxWaitMs),
+                     uplink_.bottleneck->NextWakeMs(now_ms + kMaxWaitMs));
+        const int64_t wait_us = std::max<int64_t>(0, wake_ms * 1000 - elapsed_us());
+        timespec timeout = {static_cast<time_t>(wait_us / 1000000),
+                            static_cast<long>(wait_us % 1000000) * 1000};
+        ppoll(fds, 2, &timeout, nullptr);
+    }
+}
+
+void TraceLinkShaper::Receive(Link* link, int64_t now_us) {
+    receive_buffer_.resize(kMaxFrameBytes);
+    for (int i = 0; i < kMaxReceiveBurst; ++i) {
+        sockaddr_ll from = {};
+        socklen_t from_length = sizeof(from);
+        ssize_t received = ::recvfrom(link->in_fd, receive_buffer_.data(),
+                                      receive_buffer_.size(), 0,
+                                      reinterpret_cast<sockaddr*>(&from),
+                                      &from_length);
+        if (received < 0)
+            return;
+        // Our own transmissions on this interface loop back here.
+        if (from.sll_pkttype == PACKET_OUTGOING)
+            continue;
+        ShapedPacket packet;
+        packet.data.assign(receive_buffer_.begin(),
+                           receive_buffer_.begin() + received);
+        link->received_packets++;
+        link->bottleneck->Enqueue(std::move(packet), now_us);
+    }
+}
+
+void TraceLinkShaper::Release(Link* link, int64_t now_ms) {
+    std::vector<ShapedPacket> expired;
+    link->bottleneck->Release(now_ms, &expired);
+    for (const ShapedPacket& packet : expired) {
+        if (::send(link->out_fd, packet.data.data(), packet.data.size(), 0) < 0) {
+            link->send_failures++;
+            continue;
+        }
+        link->delivered_packets++;
+        link->delivered_bytes += static_cast<int64_t>(packet.data.size());
+    }
+}
+
+void TraceLinkShaper::LogStats(const Link& link) const {
+    LOG_INFO(TRACE_LINK_SHAPER_MODULE_NAME, link.name, ": received ",
+             link.received_packets, ", delivered ", link.delivered_packets,
+             " (", link.delivered_bytes, " bytes), dropped ",
+             link.bottleneck ? link.bottleneck->dropped() : 0, ", send failures ",
+             link.send_failures);
+}
@@ -0,0 +1,151 @@
+#ifndef TRACE_LINK_SHAPER_H_
+#define TRACE_LINK_SHAPER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "packet_queue.h"
+
+// Delivery-opportunity trace in the mahimahi format: one millisecond
+// timestamp per line, each granting one MTU worth of bytes at that time.
+// Repeated timestamps are bursts. The trace wraps around after its last
+// entry.
+class DeliveryTrace {
+public:
+    bool Load(const std::string& path);
+    // Reads the trace from |input|; |name| is only used in errors.
+    bool Load(std::istream& input, const std::string& name);
+
+    // Time of the |index|-th opportunity, counting across repetitions.
+    int64_t OpportunityMs(uint64_t index) const;
+    // Index of the first opportunity at or after |time_ms|.
+    uint64_t FirstOpportunityAt(int64_t time_ms) const;
+    size_t size() const { return opportunities_ms_.size(); }
+
+private:
+    std::vector<int64_t> opportunities_ms_;
+    int64_t period_ms_ = 0;
+};
+
+// Releases packets a fixed number of milliseconds after they leave the
+// bottleneck. One slot per millisecond, so the wheel covers the largest
+// delay it is built for and scheduling is O(1).
+class TimerWheel {
+public:
+    explicit TimerWheel(int64_t max_delay_ms);
+
+    void Schedule(int64_t due_ms, ShapedPacket packet);
+    // Moves every packet due at or before |now_ms| into |expired|, in
+    // release order.
+    void Advance(int64_t now_ms, std::vector<ShapedPacket>* expired);
+    // Earliest due time, or -1 if nothing is scheduled.
+    int64_t NextDueMs() const;
+
+private:
+    std::vector<std::vector<ShapedPacket>> slots_;
+    int64_t cursor_ms_ = 0;
+    size_t scheduled_ = 0;
+};
+
+// One direction of the link without its sockets: a bottleneck queue
+// drained at the trace's delivery opportunities, then the one-way delay.
+class TraceBottleneck {
+public:
+    TraceBottleneck(const DeliveryTrace& trace,
+                    std::unique_ptr<PacketQueue> queue, int64_t delay_ms);
+
+    // Opportunities that passed while the link was idle are lost, so a
+    // packet arriving at an idle link waits for the next one.
+    void Enqueue(ShapedPacket packet, int64_t now_us);
+    // Spends the opportunities due by |now_us| on the queue.
+    void ServeOpportunities(int64_t now_us);
+    // Moves the packets whose delay is over by |now_ms| into |expired|.
+    void Release(int64_t now_ms, std::vector<ShapedPacket>* expired);
+    // Next time anything is due, capped at |max_ms|.
+    int64_t NextWakeMs(int64_t max_ms) const;
+
+    int64_t dropped() const { return queue_->dropped(); }
+
+private:
+    DeliveryTrace trace_;
+    std::unique_ptr<PacketQueue> queue_;
+    TimerWheel wheel_;
+    int64_t delay_ms_;
+    uint64_t next_opportunity_ = 0;
+    // A packet bigger than what is left of an opportunity keeps being
+    // sent in the next ones.
+    ShapedPacket in_service_;
+    bool serving_ = false;
+    int64_t in_service_sent_bytes_ = 0;
+};
+
+// Userspace link between two interfaces, in the spirit of mahimahi's
+// LinkShell: frames read from one side with AF_PACKET go through a
+// bottleneck queue, leave it only at the trace's delivery opportunities,
+// wait out the one-way delay on a timer wheel and are written to the other
+// side. Uplink and downlink are independent.
+class TraceLinkShaper {
+public:
+    struct Direction {
+        std::string trace_path;
+        PacketQueue::Aqm aqm = PacketQueue::Aqm::kDropTail;
+        // 0 is unbounded.
+        int64_t queue_limit_bytes = 0;
+        int64_t delay_ms = 0;
+    };
+
+    struct Config {
+        // Frames arriving on |host_interface| go downlink to
+        // |namespace_interface|, and the reverse uplink. Both must be in
+        // the shaper's network namespace.
+        std::string host_interface;
+        std::string namespace_interface;
+        Direction uplink;
+        Direction downlink;
+    };
+
+    explicit TraceLinkShaper(const Config& config);
+    ~TraceLinkShaper();
+
+    TraceLinkShaper(const TraceLinkShaper&) = delete;
+    TraceLinkShaper& operator=(const TraceLinkShaper&) = delete;
+
+    bool Start();
+    void Stop();
+    bool IsRunning() const { return running_; }
+
+private:
+    struct Link {
+        std::string name;
+        int in_fd = -1;
+        int out_fd = -1;
+        std::unique_ptr<TraceBottleneck> bottleneck;
+        int64_t received_packets = 0;
+        int64_t delivered_packets = 0;
+        int64_t delivered_bytes = 0;
+        int64_t send_failures = 0;
+    };
+
+    bool SetUpLink(Link* link, const Direction& direction, int in_fd,
+                   int out_fd);
+    void Run();
+    void Receive(Link* link, int64_t now_us);
+    void Release(Link* link, int64_t now_ms);
+    void LogStats(const Link& link) const;
+
+    const Config config_;
+    int host_fd_ = -1;
+    int namespace_fd_ = -1;
+    Link uplink_;
+    Link downlink_;
+    std::vector<uint8_t> receive_buffer_;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
+
+#endif // TRACE_LINK_SHAPER_H_
@@ -0,0 +1,86 @@
+#include "trace_link_shaper.h"
+
+#include <sstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+ShapedPacket Packet(size_t bytes = 1500) {
+    ShapedPacket packet;
+    packet.data.resize(bytes);
+    return packet;
+}
+
+// One opportunity every millisecond, repeating every 10 ms.
+DeliveryTrace EveryMillisecondTrace() {
+    std::istringstream input("1\n2\n3\n4\n5\n6\n7\n8\n9\n10\n");
+    DeliveryTrace trace;
+    EXPECT_TRUE(trace.Load(input, "every_ms"));
+    return trace;
+}
+
+TraceBottleneck Bottleneck(int64_t delay_ms) {
+    return TraceBottleneck(EveryMillisecondTrace(),
+                           PacketQueue::Create(PacketQueue::Aqm::kDropTail, 0),
+                           delay_ms);
+}
+
+size_t Released(TraceBottleneck* bottleneck, int64_t now_ms) {
+    std::vector<ShapedPacket> expired;
+    bottleneck->Release(now_ms, &expired);
+    return expired.size();
+}
+
+TEST(DeliveryTraceTest, WrapsAroundAfterLastOpportunity) {
+    std::istringstream input("0\n4\n4\n10\n");
+    DeliveryTrace trace;
+    ASSERT_TRUE(trace.Load(input, "burst"));
+    EXPECT_EQ(trace.OpportunityMs(2), 4);
+    EXPECT_EQ(trace.OpportunityMs(4), 10);
+    EXPECT_EQ(trace.OpportunityMs(5), 14);
+    EXPECT_EQ(trace.FirstOpportunityAt(0), 0u);
+    EXPECT_EQ(trace.FirstOpportunityAt(3), 1u);
+    EXPECT_EQ(trace.FirstOpportunityAt(10), 3u);
+    EXPECT_EQ(trace.FirstOpportunityAt(11), 5u);
+    EXPECT_EQ(trace.FirstOpportunityAt(15), 7u);
+}
+
+TEST(TraceBottleneckTest, IdleOpportunitiesAreNotBanked) {
+    TraceBottleneck bottleneck = Bottleneck(20);
+    bottleneck.ServeOpportunities(0);
+    // Five packets arrive after half a second of idle link; the 500
+    // opportunities that passed meanwhile must not carry them.
+    for (int i = 0; i < 5; ++i)
+        bottleneck.Enqueue(Packet(), 500000);
+    bottleneck.ServeOpportunities(500000);
+    EXPECT_EQ(Released(&bottleneck, 519), 0u);
+    EXPECT_EQ(Released(&bottleneck, 520), 1u);
+
+    // The rest leave one per opportunity.
+    bottleneck.ServeOpportunities(504000);
+    EXPECT_EQ(Released(&bottleneck, 523), 3u);
+    EXPECT_EQ(Released(&bottleneck, 524), 1u);
+}
+
+TEST(TraceBottleneckTest, LargePacketSpansOpportunities) {
+    TraceBottleneck bottleneck = Bottleneck(0);
+    bottleneck.Enqueue(Packet(4000), 100000);
+    bottleneck.ServeOpportunities(101000);
+    EXPECT_EQ(Released(&bottleneck, 101), 0u);
+    EXPECT_EQ(bottleneck.NextWakeMs(200), 102);
+    bottleneck.ServeOpportunities(102000);
+    EXPECT_EQ(Released(&bottleneck, 102), 1u);
+}
+
+TEST(TraceBottleneckTest, IdleLinkWakesOnlyForDeliveries) {
+    TraceBottleneck bottleneck = Bottleneck(30);
+    EXPECT_EQ(bottleneck.NextWakeMs(100), 100);
+    bottleneck.Enqueue(Packet(), 50000);
+    EXPECT_EQ(bottleneck.NextWakeMs(150), 50);
+    bottleneck.ServeOpportunities(50000);
+    EXPECT_EQ(bottleneck.NextWakeMs(150), 80);
+}
+
+}  // namespace